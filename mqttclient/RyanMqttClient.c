@@ -33,6 +33,7 @@ RyanMqttError_e RyanMqttInit(RyanMqttClient_t **pClient)
 	RyanMqttBool_e msgHandleLockIsOk = RyanMqttFalse;
 	RyanMqttBool_e ackHandleLockIsOk = RyanMqttFalse;
 	RyanMqttBool_e userSessionLockIsOk = RyanMqttFalse;
+	RyanMqttBool_e wakeSemIsOk = RyanMqttFalse;
 	RyanMqttBool_e networkIsOk = RyanMqttFalse;
 
 	result = platformCriticalInit(client->config.userData, &client->criticalLock); // 初始化临界区
@@ -55,11 +56,20 @@ RyanMqttError_e RyanMqttInit(RyanMqttClient_t **pClient)
 	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
 	userSessionLockIsOk = RyanMqttTrue;
 
+	result = platformSemaphoreInit(client->config.userData, &client->wakeSem, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+	wakeSemIsOk = RyanMqttTrue;
+
 	result = platformNetworkInit(client->config.userData, &client->network); // 网络接口初始化
 	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
 	// networkIsOk = RyanMqttTrue;
 
 	RyanMqttListInit(&client->msgHandlerList);
+	for (uint32_t i = 0; i < RyanMqttMsgHashBucketCount; i++)
+	{
+		RyanMqttListInit(&client->msgHashList[i]);
+	}
+	RyanMqttListInit(&client->msgWildcardList);
 	RyanMqttListInit(&client->ackHandlerList);
 	RyanMqttListInit(&client->userAckHandlerList);
 
@@ -95,6 +105,11 @@ __exit:
 		platformMutexDestroy(client->config.userData, &client->userSessionLock);
 	}
 
+	if (wakeSemIsOk)
+	{
+		platformSemaphoreDestroy(client->config.userData, &client->wakeSem);
+	}
+
 	if (networkIsOk)
 	{
 		platformNetworkClose(client->config.userData, &client->network);
@@ -108,9 +123,10 @@ __exit:
 /**
  * @brief 销毁mqtt客户端
  *  !用户线程直接删除mqtt线程是很危险的行为。所以这里设置标志位，稍后由mqtt线程自己释放所占有的资源。
- *  !mqtt删除自己的延时最大不会超过config里面 recvTimeout + 1秒
+ *  !mqtt线程会被立即唤醒，传输层不支持唤醒时删除自己的延时最大不会超过config里面 recvTimeout + 1秒
  *  !mqtt删除自己前会调用 RyanMqttEventDestroyBefore 事件回调
  *  !调用此函数后就不应该再对该客户端进行任何操作
+ *  !单步模式下没有mqtt线程，直接在调用线程中释放资源，不能和 RyanMqttStep 并发调用
  * @param client
  * @return RyanMqttError_e
  */
@@ -118,8 +134,17 @@ RyanMqttError_e RyanMqttDestroy(RyanMqttClient_t *client)
 {
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 
+	if (RyanMqttTrue == client->config.stepModeFlag)
+	{
+		RyanMqttPurgeClient(client);
+		platformMemoryFree(client);
+		return RyanMqttSuccessError;
+	}
+
+	// mqtt线程可能正在等待重连或新报文，在临界区内唤醒，避免mqtt线程先看到标志位释放了信号量和传输层
 	platformCriticalEnter(client->config.userData, &client->criticalLock);
 	client->destroyFlag = RyanMqttTrue;
+	RyanMqttThreadWakeup(client);
 	platformCriticalExit(client->config.userData, &client->criticalLock);
 
 	return RyanMqttSuccessError;
@@ -139,11 +164,61 @@ RyanMqttError_e RyanMqttStart(RyanMqttClient_t *client)
 	RyanMqttCheck(RyanMqttInitState == RyanMqttGetClientState(client), RyanMqttFailedError, RyanMqttLog_d);
 
 	RyanMqttSetClientState(client, RyanMqttStartState);
+
+	// 回调工作线程、拉取模式接收队列和离线发布队列需要在mqtt线程之前创建
+	if (0 != client->config.dispatchWorkerCount)
+	{
+		result = RyanMqttDispatchCreate(client);
+		RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d,
+				  { RyanMqttSetClientState(client, RyanMqttInitState); });
+	}
+
+	if (0 != client->config.recvQueueSize)
+	{
+		result = RyanMqttRecvRingCreate(client);
+		RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+			RyanMqttDispatchDestroy(client);
+			RyanMqttSetClientState(client, RyanMqttInitState);
+		});
+	}
+
+	if (0 != client->config.offlineQueueMaxCount)
+	{
+		result = RyanMqttOfflineQueueCreate(client);
+		RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+			RyanMqttRecvRingDestroy(client);
+			RyanMqttDispatchDestroy(client);
+			RyanMqttSetClientState(client, RyanMqttInitState);
+		});
+	}
+
+	// 恢复上次进程退出前未完成的qos1/qos2会话
+	result = RyanMqttAckListRestore(client);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+		RyanMqttOfflineQueueDestroy(client);
+		RyanMqttRecvRingDestroy(client);
+		RyanMqttDispatchDestroy(client);
+		RyanMqttSetClientState(client, RyanMqttInitState);
+	});
+
+	// 单步模式由用户事件循环驱动，不创建mqtt线程
+	if (RyanMqttTrue == client->config.stepModeFlag)
+	{
+		return RyanMqttSuccessError;
+	}
+
 	// 连接成功，需要初始化 MQTT 线程
 	result = platformThreadInit(client->config.userData, &client->mqttThread, client->config.taskName,
 				    RyanMqttThread, client, client->config.taskStack, client->config.taskPrio);
-	RyanMqttCheckCode(RyanMqttSuccessError == result, RyanMqttNoRescourceError, RyanMqttLog_d,
-			  { RyanMqttSetClientState(client, RyanMqttInitState); });
+	RyanMqttCheckCode(RyanMqttSuccessError == result, RyanMqttNoRescourceError, RyanMqttLog_d, {
+		// 恢复的会话只丢弃内存中的部分，持久化的记录保留到下次启动
+		client->persist = NULL;
+		RyanMqttPurgeSession(client);
+		RyanMqttOfflineQueueDestroy(client);
+		RyanMqttRecvRingDestroy(client);
+		RyanMqttDispatchDestroy(client);
+		RyanMqttSetClientState(client, RyanMqttInitState);
+	});
 
 	return result;
 }
@@ -192,45 +267,126 @@ RyanMqttError_e RyanMqttDisconnect(RyanMqttClient_t *client, RyanMqttBool_e send
 	return RyanMqttSuccessError;
 }
 
-// todo 这里考虑要不要使用信号量来实现吧,会增加platform厚度,目前不想加。最好用自动重连
-// ?现在取巧使用线程的暂停和恢复实现，如果mqtt线程还没有暂停,用户就调用这个函数就会没有效果。
-// ?用户不用自动重连的话，也可以通过一直判断 client 的状态是不是为 RyanMqttDisconnectState 是的话可以调用
-// ?RyanMqttReconnect。 最推荐的是用自动重连
 /**
- * @brief 手动重连mqtt客户端
- * ! 仅在未使能自动连接时，客户端断开连接时用户手动调用
+ * @brief 立即重连mqtt客户端，客户端断开连接时用户调用
+ * 未使能自动重连时必须由用户调用此函数重连；使能自动重连时调用此函数会跳过当前的退避等待
  *
  * @param client
  * @return RyanMqttError_e
  */
 RyanMqttError_e RyanMqttReconnect(RyanMqttClient_t *client)
 {
-	RyanMqttError_e result = RyanMqttSuccessError;
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(RyanMqttDisconnectState == RyanMqttGetClientState(client), RyanMqttConnectError, RyanMqttLog_d);
 
-	if (RyanMqttTrue == client->config.autoReconnectFlag)
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	client->reconnectFlag = RyanMqttTrue;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+
+	// 单步模式下由下一次 RyanMqttStep 连接，线程模式下唤醒正在等待的mqtt线程
+	RyanMqttThreadWakeup(client);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 单步模式下执行一次mqtt状态机，代替mqtt线程嵌入用户的事件循环
+ * 典型用法是监听 RyanMqttGetFd 获取的socket，RyanMqttGetWantWrite 为真时同时监听可写，
+ * 超时时间使用 RyanMqttGetNextTimeoutMs，socket就绪或超时后调用此函数。只能在同一个线程中调用
+ * 报文只读取已经到达的部分，没有读完的报文保存在客户端中，下一次socket可读时继续读取，不会等待报文剩余部分
+ * 连接服务器分为传输层连接、发送CONNECT、等待CONNACK三个阶段，每次调用只推进已经就绪的阶段
+ * !传输层没有提供异步连接接口时(如TLS和自定义传输层)，传输层连接阶段依然是阻塞的
+ *
+ * @param client
+ * @param readable socket可读
+ * @param writable socket可写，连接中和CONNECT报文没有发送完时使用，连接成功后的发送依然是同步完成的
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttStep(RyanMqttClient_t *client, RyanMqttBool_e readable, RyanMqttBool_e writable)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(RyanMqttTrue == client->config.stepModeFlag, RyanMqttFailedError, RyanMqttLog_d);
+	RyanMqttCheck(RyanMqttInitState != RyanMqttGetClientState(client), RyanMqttFailedError, RyanMqttLog_d);
+
+	RyanMqttStepOnce(client, readable, writable);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取当前连接的socket描述符，连接中返回正在连接的socket
+ * !重连后描述符会变化，同时尝试多个地址时正在连接的描述符也会变化，
+ * 每次 RyanMqttStep 后都需要重新获取并更新事件循环中的监听
+ *
+ * @param client
+ * @param fd 没有连接时为 -1
+ * @return RyanMqttError_e 没有连接时返回 RyanMqttNotConnectError
+ */
+RyanMqttError_e RyanMqttGetFd(RyanMqttClient_t *client, int32_t *fd)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != fd, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	*fd = RyanMqttTransportGetFd(client);
+	if (*fd < 0)
 	{
-		return RyanMqttNoRescourceError;
+		return RyanMqttNotConnectError;
 	}
 
-	result = platformThreadStart(client->config.userData, &client->mqttThread);
-	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+	return RyanMqttSuccessError;
+}
 
-	return result;
+/**
+ * @brief 单步模式下获取是否需要监听socket可写
+ * 传输层连接中和CONNECT报文没有发送完时为真，其他时候只需要监听可读
+ *
+ * @param client
+ * @param wantWrite
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttGetWantWrite(RyanMqttClient_t *client, RyanMqttBool_e *wantWrite)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != wantWrite, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttState_e clientState = RyanMqttGetClientState(client);
+	*wantWrite = ((RyanMqttStartState == clientState || RyanMqttReconnectState == clientState) &&
+		      (RyanMqttStepConnectTransport == client->stepConnectState ||
+		       RyanMqttStepConnectSend == client->stepConnectState))
+			     ? RyanMqttTrue
+			     : RyanMqttFalse;
+	return RyanMqttSuccessError;
 }
 
 /**
- * @brief 订阅主题
+ * @brief 获取距离下一次需要调用 RyanMqttStep 的时间，取心跳、ack重发、重连和连接中最近的一个
  *
  * @param client
- * @param topic
- * @param qos
+ * @param timeoutMs 为0时需要立即调用 RyanMqttStep
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttGetNextTimeoutMs(RyanMqttClient_t *client, uint32_t *timeoutMs)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != timeoutMs, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	*timeoutMs = RyanMqttGetNextDeadline(client);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 批量订阅主题并指定这些订阅的消息回调函数
+ * 匹配这些订阅的消息会直接调用 msgHandle，msgHandle为NULL时通过 RyanMqttEventData 事件分发
+ *
+ * @param client
+ * @param count
+ * @param subscribeManyData
+ * @param msgHandle 订阅消息回调函数，在mqtt线程中调用
+ * @param userData 传递给 msgHandle 的用户数据,用户需要保证指针指向内容的持久性
  * 服务端可以授予比订阅者要求的低一些的QoS等级，可在订阅成功回调函数中查看服务端给定的qos等级
  * @return RyanMqttError_e
  */
-RyanMqttError_e RyanMqttSubscribeMany(RyanMqttClient_t *client, int32_t count,
-				      RyanMqttSubscribeData_t subscribeManyData[])
+RyanMqttError_e RyanMqttSubscribeManyWithMsgHandle(RyanMqttClient_t *client, int32_t count,
+						   RyanMqttSubscribeData_t subscribeManyData[],
+						   RyanMqttMsgHandle msgHandle, void *userData)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
 	uint16_t packetId;
@@ -294,9 +450,11 @@ RyanMqttError_e RyanMqttSubscribeMany(RyanMqttClient_t *client, int32_t count,
 		// 创建msg包
 		result = RyanMqttMsgHandlerCreate(client, subscriptionList[i].pTopicFilter,
 						  subscriptionList[i].topicFilterLength, packetId,
-						  (RyanMqttQos_e)subscriptionList[i].qos, NULL, &msgHandler);
+						  (RyanMqttQos_e)subscriptionList[i].qos, userData,
+						  &msgHandler);
 		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d,
 					  { goto __RyanMqttSubCreateAckErrorExit; });
+		msgHandler->msgHandle = msgHandle;
 
 		result = RyanMqttAckHandlerCreate(client, MQTT_PACKET_TYPE_SUBACK, packetId, 0, NULL, msgHandler,
 						  &userAckHandler, RyanMqttFalse);
@@ -319,16 +477,25 @@ __RyanMqttSubCreateAckErrorExit:
 	}
 
 	// ?创建msg包,3.8.4响应,允许服务端在发送 SUBACK 报文之前就开始发送与订阅匹配的 PUBLISH 报文。
+	// 外层持有msg链表锁，所有主题添加完成后只发布一次订阅快照
+	RyanMqttMsgListLock(client);
 	for (int32_t i = 0; i < count; i++)
 	{
 		result = RyanMqttMsgHandlerCreate(client, subscriptionList[i].pTopicFilter,
 						  subscriptionList[i].topicFilterLength, packetId,
-						  (RyanMqttQos_e)subscriptionList[i].qos, NULL, &msgToListHandler);
-		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+						  (RyanMqttQos_e)subscriptionList[i].qos, userData,
+						  &msgToListHandler);
+		if (RyanMqttSuccessError != result)
+		{
+			break;
+		}
+		msgToListHandler->msgHandle = msgHandle;
 
 		// 将msg信息添加到订阅链表上
 		RyanMqttMsgHandlerAddToMsgList(client, msgToListHandler);
 	}
+	RyanMqttMsgListUnLock(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
 
 	// 发送订阅主题包
 	// 如果发送失败就清除ack链表,创建ack链表必须在发送前
@@ -344,6 +511,7 @@ __exit:
 
 		// 清除msg链表
 		RyanMqttMsgHandler_t msgMatchCriteria;
+		RyanMqttMsgListLock(client);
 		for (int32_t i = 0; i < count; i++)
 		{
 			msgMatchCriteria.topic = (char *)subscriptionList[i].pTopicFilter;
@@ -352,6 +520,7 @@ __exit:
 
 			RyanMqttMsgHandlerFindAndDestroyByPacketId(client, &msgMatchCriteria, RyanMqttFalse);
 		}
+		RyanMqttMsgListUnLock(client);
 	}
 
 	platformMemoryFree(subscriptionList);
@@ -359,6 +528,21 @@ __exit:
 	return result;
 }
 
+/**
+ * @brief 批量订阅主题
+ *
+ * @param client
+ * @param count
+ * @param subscribeManyData
+ * 服务端可以授予比订阅者要求的低一些的QoS等级，可在订阅成功回调函数中查看服务端给定的qos等级
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttSubscribeMany(RyanMqttClient_t *client, int32_t count,
+				      RyanMqttSubscribeData_t subscribeManyData[])
+{
+	return RyanMqttSubscribeManyWithMsgHandle(client, count, subscribeManyData, NULL, NULL);
+}
+
 /**
  * @brief 订阅主题
  *
@@ -376,6 +560,27 @@ RyanMqttError_e RyanMqttSubscribe(RyanMqttClient_t *client, char *topic, RyanMqt
 	return RyanMqttSubscribeMany(client, 1, &subscribeManyData);
 }
 
+/**
+ * @brief 订阅主题并指定该订阅的消息回调函数
+ * 匹配该订阅的消息会直接调用 msgHandle，不再触发 RyanMqttEventData 事件
+ *
+ * @param client
+ * @param topic
+ * @param topicLen
+ * @param qos
+ * @param msgHandle 订阅消息回调函数，在mqtt线程中调用
+ * @param userData 传递给 msgHandle 的用户数据,用户需要保证指针指向内容的持久性
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttSubscribeWithMsgHandle(RyanMqttClient_t *client, char *topic, uint16_t topicLen,
+					       RyanMqttQos_e qos, RyanMqttMsgHandle msgHandle, void *userData)
+{
+	RyanMqttCheck(NULL != msgHandle, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttSubscribeData_t subscribeManyData = {.qos = qos, .topic = topic, .topicLen = topicLen};
+	return RyanMqttSubscribeManyWithMsgHandle(client, 1, &subscribeManyData, msgHandle, userData);
+}
+
 /**
  * @brief 取消订阅指定主题
  *
@@ -446,7 +651,7 @@ RyanMqttError_e RyanMqttUnSubscribeMany(RyanMqttClient_t *client, int32_t count,
 		RyanMqttMsgHandler_t msgMatchCriteria = {.topic = (char *)unSubscriptionList[i].pTopicFilter,
 							 .topicLen = unSubscriptionList[i].topicFilterLength};
 
-		platformMutexLock(client->config.userData, &client->msgHandleLock);
+		RyanMqttMsgListLock(client);
 		result =
 			RyanMqttMsgHandlerFind(client, &msgMatchCriteria, RyanMqttFalse, &subMsgHandler, RyanMqttFalse);
 		if (RyanMqttSuccessError == result)
@@ -455,7 +660,7 @@ RyanMqttError_e RyanMqttUnSubscribeMany(RyanMqttClient_t *client, int32_t count,
 			// 同步msg qos等级，之后unsub回调使用
 			unSubscriptionList[i].qos = (MQTTQoS_t)subMsgHandler->qos;
 		}
-		platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+		RyanMqttMsgListUnLock(client);
 
 		result = RyanMqttMsgHandlerCreate(client, unSubscriptionList[i].pTopicFilter,
 						  unSubscriptionList[i].topicFilterLength, packetId,
@@ -511,9 +716,21 @@ RyanMqttError_e RyanMqttUnSubscribe(RyanMqttClient_t *client, char *topic)
 	return RyanMqttUnSubscribeMany(client, 1, &subscribeManyData);
 }
 
-RyanMqttError_e RyanMqttPublishWithUserData(RyanMqttClient_t *client, char *topic, uint16_t topicLen, char *payload,
-					    uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain,
-					    void *userData)
+/**
+ * @brief 序列化并发送publish报文，参数由调用者检查
+ *
+ * @param client
+ * @param topic
+ * @param topicLen
+ * @param payload
+ * @param payloadLen
+ * @param qos
+ * @param retain
+ * @param userData
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttPublishPacket(RyanMqttClient_t *client, char *topic, uint16_t topicLen, char *payload,
+				      uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain, void *userData)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
 	uint16_t packetId;
@@ -521,18 +738,8 @@ RyanMqttError_e RyanMqttPublishWithUserData(RyanMqttClient_t *client, char *topi
 	MQTTFixedBuffer_t fixedBuffer;
 	size_t remainingLength;
 
-	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
-	RyanMqttCheck(NULL != topic && topicLen > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
-	RyanMqttCheck(RyanMqttMaxPayloadLen >= payloadLen, RyanMqttParamInvalidError, RyanMqttLog_d);
-	RyanMqttCheck(RyanMqttQos0 <= qos && RyanMqttQos2 >= qos, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetClientState(client), RyanMqttNotConnectError, RyanMqttLog_d);
 
-	// 报文支持有效载荷长度为0
-	if (payloadLen > 0 && NULL == payload)
-	{
-		return RyanMqttParamInvalidError;
-	}
-
 	// 序列化pub发送包
 	MQTTPublishInfo_t publishInfo = {
 		.qos = (MQTTQoS_t)qos,
@@ -607,6 +814,46 @@ RyanMqttError_e RyanMqttPublishWithUserData(RyanMqttClient_t *client, char *topi
 	return result;
 }
 
+RyanMqttError_e RyanMqttPublishWithUserData(RyanMqttClient_t *client, char *topic, uint16_t topicLen, char *payload,
+					    uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain,
+					    void *userData)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != topic && topicLen > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(RyanMqttMaxPayloadLen >= payloadLen, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(RyanMqttQos0 <= qos && RyanMqttQos2 >= qos, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	// 报文支持有效载荷长度为0
+	if (payloadLen > 0 && NULL == payload)
+	{
+		return RyanMqttParamInvalidError;
+	}
+
+	// 使能离线队列时由队列决定直接发送还是缓存
+	if (NULL != client->offlineQueue)
+	{
+		return RyanMqttOfflineQueuePublish(client, topic, topicLen, payload, payloadLen, qos, retain, userData);
+	}
+
+	return RyanMqttPublishPacket(client, topic, topicLen, payload, payloadLen, qos, retain, userData);
+}
+
+/**
+ * @brief 获取离线发布队列中等待补发的消息数，包括溢出存储中的消息
+ *
+ * @param client
+ * @param count
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttGetOfflineCount(RyanMqttClient_t *client, uint32_t *count)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != count, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	*count = RyanMqttOfflineQueueGetCount(client);
+	return RyanMqttSuccessError;
+}
+
 /**
  * @brief 客户端向服务端发送消息
  *
@@ -653,7 +900,7 @@ RyanMqttError_e RyanMqttGetSubscribe(RyanMqttClient_t *client, RyanMqttMsgHandle
 
 	*subscribeNum = 0;
 
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListLock(client);
 	RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
 	{
 		if (*subscribeNum >= msgHandleSize)
@@ -668,13 +915,14 @@ RyanMqttError_e RyanMqttGetSubscribe(RyanMqttClient_t *client, RyanMqttMsgHandle
 
 		(*subscribeNum)++;
 	}
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListUnLock(client);
 
 	return result;
 }
 
 /**
  * @brief 安全的获取已订阅主题列表，仅可通过 RyanMqttSafeFreeSubscribeResources 进行安全释放。
+ * 主题和数组在同一块内存中，只申请一次内存。只需要读取订阅时推荐使用 RyanMqttIterateSubscribe
  *
  * @param client
  * @param msgHandles
@@ -685,59 +933,53 @@ RyanMqttError_e RyanMqttGetSubscribeSafe(RyanMqttClient_t *client, RyanMqttMsgHa
 					 int32_t *subscribeNum)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
-	RyanMqttList_t *curr, *next;
-	RyanMqttMsgHandler_t *msgHandler;
-	int32_t subscribeTotal;
+	RyanMqttMsgSnapshot_t *snapshot;
+	RyanMqttMsgHandler_t *msgHandlerArr = NULL;
+	char *topicPool = NULL;
+	int32_t subscribeCount = 0;
 
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(NULL != msgHandles, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(NULL != subscribeNum, RyanMqttParamInvalidError, RyanMqttLog_d);
 
-	RyanMqttGetSubscribeTotalCount(client, &subscribeTotal);
-	if (0 == subscribeTotal)
-	{
-		*msgHandles = NULL;
-		*subscribeNum = 0;
-		return RyanMqttSuccessError;
-	}
+	// 从订阅快照拷贝，不持有msg链表锁
+	snapshot = RyanMqttMsgSnapshotAcquire(client);
+	RyanMqttCheck(NULL != snapshot, RyanMqttNotEnoughMemError, RyanMqttLog_d);
 
-	RyanMqttMsgHandler_t *msgHandlerArr = platformMemoryMalloc(sizeof(RyanMqttMsgHandler_t) * subscribeTotal);
-	if (NULL == msgHandlerArr)
+	if (0 != snapshot->count)
 	{
-		result = RyanMqttNotEnoughMemError;
-		goto __exit;
-	}
-
-	int32_t subscribeCount = 0;
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
-	RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
-	{
-		if (subscribeCount >= subscribeTotal)
+		uint32_t topicTotalLen = 0;
+		for (uint16_t i = 0; i < snapshot->count; i++)
 		{
-			break;
+			topicTotalLen += snapshot->msgHandlers[i].topicLen + 1U;
 		}
 
-		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
-
-		RyanMqttMemcpy(&msgHandlerArr[subscribeCount], msgHandler, sizeof(RyanMqttMsgHandler_t));
-		result = RyanMqttDupString(&msgHandlerArr[subscribeCount].topic, msgHandler->topic,
-					   msgHandler->topicLen);
-		if (RyanMqttSuccessError != result)
-		{
-			platformMutexUnLock(client->config.userData, &client->msgHandleLock);
-			RyanMqttSafeFreeSubscribeResources(msgHandlerArr, subscribeCount);
+		msgHandlerArr = platformMemoryMalloc(sizeof(RyanMqttMsgHandler_t) * snapshot->count + topicTotalLen);
+		RyanMqttCheckCodeNoReturn(NULL != msgHandlerArr, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
 			result = RyanMqttNotEnoughMemError;
 			goto __exit;
-		}
+		});
+		topicPool = (char *)&msgHandlerArr[snapshot->count];
+	}
+
+	for (; subscribeCount < snapshot->count; subscribeCount++)
+	{
+		RyanMqttMsgHandler_t *msgHandler = &snapshot->msgHandlers[subscribeCount];
 
-		subscribeCount++;
+		RyanMqttMemcpy(&msgHandlerArr[subscribeCount], msgHandler, sizeof(RyanMqttMsgHandler_t));
+		msgHandlerArr[subscribeCount].topicLevels = NULL; // 预编译层级随快照释放，不拷贝给用户
+		msgHandlerArr[subscribeCount].topicLevelCount = 0;
+		msgHandlerArr[subscribeCount].topic = topicPool;
+		RyanMqttMemcpy(topicPool, msgHandler->topic, msgHandler->topicLen);
+		topicPool[msgHandler->topicLen] = '\0';
+		topicPool += msgHandler->topicLen + 1U;
 	}
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
 
 	*msgHandles = msgHandlerArr;
 	*subscribeNum = subscribeCount;
 
 __exit:
+	RyanMqttMsgSnapshotRelease(client, snapshot);
 	return result;
 }
 
@@ -750,24 +992,137 @@ __exit:
  */
 RyanMqttError_e RyanMqttSafeFreeSubscribeResources(RyanMqttMsgHandler_t *msgHandles, int32_t subscribeNum)
 {
-	RyanMqttError_e result = RyanMqttSuccessError;
 	RyanMqttCheck(NULL != msgHandles, RyanMqttParamInvalidError, RyanMqttLog_d);
 	// RyanMqttGetSubscribeTotalCount 内部调用的时候可以会等于0
 	RyanMqttCheck(subscribeNum >= 0, RyanMqttParamInvalidError, RyanMqttLog_d);
 
-	for (int32_t i = 0; i < subscribeNum; i++)
+	// 主题和数组在同一块内存中
+	platformMemoryFree(msgHandles);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 遍历已订阅主题，不申请内存也不拷贝主题
+ * 遍历的是订阅快照，不持有msg链表锁。回调中可以订阅和取消订阅，但本次遍历看不到这些修改
+ *
+ * @param client
+ * @param iterateHandle 遍历回调函数，返回 RyanMqttFalse 时停止遍历
+ * @param userData 传递给回调函数的用户数据
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttIterateSubscribe(RyanMqttClient_t *client, RyanMqttSubscribeIterateHandle iterateHandle,
+					 void *userData)
+{
+	RyanMqttMsgSnapshot_t *snapshot;
+
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != iterateHandle, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	snapshot = RyanMqttMsgSnapshotAcquire(client);
+	RyanMqttCheck(NULL != snapshot, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+
+	for (uint16_t i = 0; i < snapshot->count; i++)
 	{
-		// 不加null判断，因为如果是空，一定是用户程序内存访问越界了
-		platformMemoryFree(msgHandles[i].topic);
+		if (RyanMqttTrue != iterateHandle(client, &snapshot->msgHandlers[i], userData))
+		{
+			break;
+		}
 	}
 
-	platformMemoryFree(msgHandles);
+	RyanMqttMsgSnapshotRelease(client, snapshot);
+	return RyanMqttSuccessError;
+}
 
-	return result;
+/**
+ * @brief 获取回调队列已满时丢弃的消息数，未使能回调工作线程时为0
+ *
+ * @param client
+ * @param dropCount
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttGetDispatchDropCount(RyanMqttClient_t *client, uint32_t *dropCount)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != dropCount, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	*dropCount = 0;
+	if (NULL != client->dispatchPool)
+	{
+		*dropCount = RyanMqttDispatchGetDropCount(client->dispatchPool);
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 拉取模式读取一条消息，需要配置 recvQueueSize 使能拉取模式
+ * topic和payload直接指向接收缓冲区，没有结束符，使用完成后需要调用 RyanMqttReleaseMessage 释放
+ *
+ * @param client
+ * @param msgData
+ * @param timeoutMs 队列为空时的等待时间，为0时不等待
+ * @return RyanMqttError_e 超时返回 RyanMqttRecvPacketTimeOutError，客户端销毁时返回 RyanMqttFailedError
+ */
+RyanMqttError_e RyanMqttRecvMessage(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData, uint32_t timeoutMs)
+{
+	int32_t count;
+	return RyanMqttRecvMessages(client, msgData, 1, &count, timeoutMs);
+}
+
+/**
+ * @brief 拉取模式批量读取消息，队列为空时等待，读取到至少一条消息后立即返回
+ * 每条消息使用完成后都需要调用 RyanMqttReleaseMessage 释放
+ *
+ * @param client
+ * @param msgDatas
+ * @param maxCount msgDatas数组长度
+ * @param count 实际读取到的消息数
+ * @param timeoutMs 队列为空时的等待时间，为0时不等待
+ * @return RyanMqttError_e 超时返回 RyanMqttRecvPacketTimeOutError，客户端销毁时返回 RyanMqttFailedError
+ */
+RyanMqttError_e RyanMqttRecvMessages(RyanMqttClient_t *client, RyanMqttMsgData_t msgDatas[], int32_t maxCount,
+				     int32_t *count, uint32_t timeoutMs)
+{
+	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != msgDatas, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(maxCount > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != count, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != client->recvRing, RyanMqttFailedError, RyanMqttLog_d);
+
+	int32_t popCount = RyanMqttRecvRingPop(client, msgDatas, maxCount, timeoutMs);
+	*count = (popCount > 0) ? popCount : 0;
+
+	// 客户端正在销毁
+	RyanMqttCheck(popCount >= 0, RyanMqttFailedError, RyanMqttLog_d);
+	if (0 == popCount)
+	{
+		return RyanMqttRecvPacketTimeOutError;
+	}
+
+	return RyanMqttSuccessError;
 }
 
 /**
- * @brief 获取已订阅主题个数
+ * @brief 释放拉取模式读取到的消息，客户端销毁后依然可以调用
+ *
+ * @param msgData
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttReleaseMessage(RyanMqttMsgData_t *msgData)
+{
+	RyanMqttCheck(NULL != msgData, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != msgData->packetBuf, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	platformMemoryFree(msgData->packetBuf);
+	msgData->packetBuf = NULL;
+	msgData->topic = NULL;
+	msgData->payload = NULL;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取已订阅主题个数，订阅个数在修改msg链表时维护，不需要遍历，使能原子操作时也不需要加锁
  *
  * @param client
  * @param subscribeTotalCount
@@ -775,18 +1130,17 @@ RyanMqttError_e RyanMqttSafeFreeSubscribeResources(RyanMqttMsgHandler_t *msgHand
  */
 RyanMqttError_e RyanMqttGetSubscribeTotalCount(RyanMqttClient_t *client, int32_t *subscribeTotalCount)
 {
-	RyanMqttList_t *curr, *next;
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(NULL != subscribeTotalCount, RyanMqttParamInvalidError, RyanMqttLog_d);
 
-	*subscribeTotalCount = 0;
+#if RyanMqttAtomicEnable
+	*subscribeTotalCount = (int32_t)atomic_load_explicit(&client->msgHandlerCount, memory_order_relaxed);
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	*subscribeTotalCount = (int32_t)client->msgHandlerCount;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
 
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
-	RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
-	{
-		(*subscribeTotalCount)++;
-	}
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
 	return RyanMqttSuccessError;
 }
 
@@ -818,9 +1172,7 @@ RyanMqttError_e RyanMqttGetKeepAliveRemain(RyanMqttClient_t *client, uint32_t *k
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(NULL != keepAliveRemain, RyanMqttParamInvalidError, RyanMqttLog_d);
 
-	platformCriticalEnter(client->config.userData, &client->criticalLock);
-	*keepAliveRemain = RyanMqttTimerRemain(&client->keepaliveTimer);
-	platformCriticalExit(client->config.userData, &client->criticalLock);
+	*keepAliveRemain = RyanMqttKeepaliveRemain(client);
 	return RyanMqttSuccessError;
 }
 
@@ -954,6 +1306,21 @@ RyanMqttError_e RyanMqttSetConfig(RyanMqttClient_t *client, RyanMqttClientConfig
 	RyanMqttCheck(clientConfig->recvTimeout <= (uint32_t)clientConfig->keepaliveTimeoutS * 1000 / 2,
 		      RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(clientConfig->recvTimeout >= clientConfig->sendTimeout, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(clientConfig->keepaliveJitter <= (uint32_t)clientConfig->keepaliveTimeoutS * 1000 / 2,
+		      RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(0 == clientConfig->reconnectMaxTimeout ||
+			      clientConfig->reconnectMaxTimeout >= clientConfig->reconnectTimeout,
+		      RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL == clientConfig->transport ||
+			      (NULL != clientConfig->transport->connect && NULL != clientConfig->transport->recv &&
+			       NULL != clientConfig->transport->send && NULL != clientConfig->transport->close),
+		      RyanMqttParamInvalidError, RyanMqttLog_d);
+	for (uint8_t qos = RyanMqttQos0; qos <= RyanMqttQos2; qos++)
+	{
+		RyanMqttCheck(RyanMqttOfflineDropNewest <= clientConfig->offlinePolicy[qos] &&
+				      RyanMqttOfflineNotQueue >= clientConfig->offlinePolicy[qos],
+			      RyanMqttParamInvalidError, RyanMqttLog_d);
+	}
 
 	RyanMqttClientConfig_t tempConfig;
 	result = RyanMqttClientConfigDeepCopy(&tempConfig, clientConfig);
@@ -964,6 +1331,13 @@ RyanMqttError_e RyanMqttSetConfig(RyanMqttClient_t *client, RyanMqttClientConfig
 		// todo !因为这里是非线程安全的
 		RyanMqttPurgeConfig(&client->config);
 		client->config = tempConfig;
+		RyanMqttConnectPacketInvalidate(client);
+
+		// 心跳等配置变化后mqtt线程按新的截止时间重新等待
+		if (RyanMqttInitState != RyanMqttGetClientState(client))
+		{
+			RyanMqttThreadWakeup(client);
+		}
 	}
 
 	return result;
@@ -999,6 +1373,7 @@ RyanMqttError_e RyanMqttSetLwt(RyanMqttClient_t *client, char *topicName, char *
 	}
 
 	platformMutexLock(client->config.userData, &client->userSessionLock);
+	RyanMqttConnectPacketInvalidate(client);
 
 	// 之前如果设置过遗嘱就进行资源释放，否则申请空间
 	if (NULL == client->lwtOptions)
@@ -1092,9 +1467,7 @@ RyanMqttError_e RyanMqttGetEventId(RyanMqttClient_t *client, RyanMqttEventId_e *
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 	RyanMqttCheck(NULL != eventId, RyanMqttParamInvalidError, RyanMqttLog_d);
 
-	platformCriticalEnter(client->config.userData, &client->criticalLock);
-	*eventId = client->eventFlag;
-	platformCriticalExit(client->config.userData, &client->criticalLock);
+	*eventId = RyanMqttGetEventFlag(client);
 	return RyanMqttSuccessError;
 }
 
@@ -1102,9 +1475,13 @@ RyanMqttError_e RyanMqttRegisterEventId(RyanMqttClient_t *client, RyanMqttEventI
 {
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 
+#if RyanMqttAtomicEnable
+	atomic_fetch_or_explicit(&client->eventFlag, (uint32_t)eventId, memory_order_relaxed);
+#else
 	platformCriticalEnter(client->config.userData, &client->criticalLock);
 	client->eventFlag |= eventId;
 	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
 	return RyanMqttSuccessError;
 }
 
@@ -1112,8 +1489,12 @@ RyanMqttError_e RyanMqttCancelEventId(RyanMqttClient_t *client, RyanMqttEventId_
 {
 	RyanMqttCheck(NULL != client, RyanMqttParamInvalidError, RyanMqttLog_d);
 
+#if RyanMqttAtomicEnable
+	atomic_fetch_and_explicit(&client->eventFlag, ~(uint32_t)eventId, memory_order_relaxed);
+#else
 	platformCriticalEnter(client->config.userData, &client->criticalLock);
 	client->eventFlag &= ~eventId;
 	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
 	return RyanMqttSuccessError;
 }
@@ -0,0 +1,392 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttPipe.h"
+#include "RyanMqttUtil.h"
+
+/**
+ * @brief 对端接受的连接是否已被客户端重连替换
+ *
+ * @param pipe
+ * @param peerFlag 是否为对端调用
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttPipeIsStale(RyanMqttPipe_t *pipe, RyanMqttBool_e peerFlag)
+{
+	return (RyanMqttTrue == peerFlag && pipe->peerConnectId != pipe->connectId) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 唤醒所有等待中的读者和写者，让它们重新检查连接状态
+ *
+ * @param pipe
+ */
+static void RyanMqttPipeWakeAll(RyanMqttPipe_t *pipe)
+{
+	platformSemaphoreGive(NULL, &pipe->toPeer.readableSem);
+	platformSemaphoreGive(NULL, &pipe->toPeer.writableSem);
+	platformSemaphoreGive(NULL, &pipe->toClient.readableSem);
+	platformSemaphoreGive(NULL, &pipe->toClient.writableSem);
+}
+
+/**
+ * @brief 从管道读取数据，连接关闭后仍然可以读完缓冲区中剩余的数据
+ *
+ * @param pipe
+ * @param ring
+ * @param peerFlag 是否为对端调用
+ * @param recvBuf
+ * @param recvLen
+ * @param timeout
+ * @return int32_t 读取的字节数，超时返回0，连接断开返回-1
+ */
+static int32_t RyanMqttPipeRead(RyanMqttPipe_t *pipe, RyanMqttPipeRing_t *ring, RyanMqttBool_e peerFlag,
+				char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	RyanMqttTimer_t timer;
+	RyanMqttTimerCutdown(&timer, timeout > 0 ? (uint32_t)timeout : 0);
+
+	while (1)
+	{
+		platformMutexLock(NULL, &pipe->lock);
+		if (RyanMqttTrue == RyanMqttPipeIsStale(pipe, peerFlag) ||
+		    (0 == ring->count && RyanMqttTrue == pipe->closeFlag))
+		{
+			platformMutexUnLock(NULL, &pipe->lock);
+			return -1;
+		}
+
+		if (ring->count > 0)
+		{
+			uint32_t readLen = ring->count < recvLen ? ring->count : (uint32_t)recvLen;
+			uint32_t firstLen = ring->size - ring->head;
+			if (firstLen > readLen)
+			{
+				firstLen = readLen;
+			}
+
+			// 环形缓冲区分两段拷贝
+			RyanMqttMemcpy(recvBuf, ring->buf + ring->head, firstLen);
+			RyanMqttMemcpy(recvBuf + firstLen, ring->buf, readLen - firstLen);
+			ring->head = (ring->head + readLen) % ring->size;
+			ring->count -= readLen;
+
+			if (RyanMqttTrue == ring->writeWaitFlag)
+			{
+				ring->writeWaitFlag = RyanMqttFalse;
+				platformSemaphoreGive(NULL, &ring->writableSem);
+			}
+			platformMutexUnLock(NULL, &pipe->lock);
+			return (int32_t)readLen;
+		}
+
+		uint32_t remain = RyanMqttTimerRemain(&timer);
+		if (0 == remain || (RyanMqttTrue != peerFlag && RyanMqttTrue == pipe->wakeupFlag))
+		{
+			if (RyanMqttTrue != peerFlag)
+			{
+				pipe->wakeupFlag = RyanMqttFalse;
+			}
+			platformMutexUnLock(NULL, &pipe->lock);
+			return 0;
+		}
+
+		ring->readWaitFlag = RyanMqttTrue;
+		platformMutexUnLock(NULL, &pipe->lock);
+		platformSemaphoreTake(NULL, &ring->readableSem, remain);
+	}
+}
+
+/**
+ * @brief 向管道写入数据，缓冲区已满时等待读者读出
+ *
+ * @param pipe
+ * @param ring
+ * @param peerFlag 是否为对端调用
+ * @param sendBuf
+ * @param sendLen
+ * @param timeout
+ * @return int32_t 写入的字节数，超时返回0，连接断开返回-1
+ */
+static int32_t RyanMqttPipeWrite(RyanMqttPipe_t *pipe, RyanMqttPipeRing_t *ring, RyanMqttBool_e peerFlag,
+				 char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	RyanMqttTimer_t timer;
+	RyanMqttTimerCutdown(&timer, timeout > 0 ? (uint32_t)timeout : 0);
+
+	while (1)
+	{
+		platformMutexLock(NULL, &pipe->lock);
+		if (RyanMqttTrue == RyanMqttPipeIsStale(pipe, peerFlag) || RyanMqttTrue == pipe->closeFlag)
+		{
+			platformMutexUnLock(NULL, &pipe->lock);
+			return -1;
+		}
+
+		uint32_t space = ring->size - ring->count;
+		if (space > 0)
+		{
+			uint32_t writeLen = space < sendLen ? space : (uint32_t)sendLen;
+			uint32_t tail = (ring->head + ring->count) % ring->size;
+			uint32_t firstLen = ring->size - tail;
+			if (firstLen > writeLen)
+			{
+				firstLen = writeLen;
+			}
+
+			RyanMqttMemcpy(ring->buf + tail, sendBuf, firstLen);
+			RyanMqttMemcpy(ring->buf, sendBuf + firstLen, writeLen - firstLen);
+			ring->count += writeLen;
+
+			if (RyanMqttTrue == ring->readWaitFlag)
+			{
+				ring->readWaitFlag = RyanMqttFalse;
+				platformSemaphoreGive(NULL, &ring->readableSem);
+			}
+			platformMutexUnLock(NULL, &pipe->lock);
+			return (int32_t)writeLen;
+		}
+
+		uint32_t remain = RyanMqttTimerRemain(&timer);
+		if (0 == remain)
+		{
+			platformMutexUnLock(NULL, &pipe->lock);
+			return 0;
+		}
+
+		ring->writeWaitFlag = RyanMqttTrue;
+		platformMutexUnLock(NULL, &pipe->lock);
+		platformSemaphoreTake(NULL, &ring->writableSem, remain);
+	}
+}
+
+/**
+ * @brief 客户端连接，清空缓冲区并开始新的连接，对端需要重新调用 RyanMqttPipePeerAccept
+ *
+ * @param userData
+ * @param host 忽略
+ * @param port 忽略
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPipeConnect(void *userData, const char *host, uint16_t port)
+{
+	RyanMqttPipe_t *pipe = (RyanMqttPipe_t *)userData;
+
+	platformMutexLock(NULL, &pipe->lock);
+	pipe->toPeer.head = 0;
+	pipe->toPeer.count = 0;
+	pipe->toClient.head = 0;
+	pipe->toClient.count = 0;
+	pipe->connectId++;
+	pipe->closeFlag = RyanMqttFalse;
+	platformMutexUnLock(NULL, &pipe->lock);
+
+	// 对端可能还在读写上一次的连接
+	RyanMqttPipeWakeAll(pipe);
+	platformSemaphoreGive(NULL, &pipe->acceptSem);
+	return RyanMqttSuccessError;
+}
+
+static int32_t RyanMqttPipeRecv(void *userData, char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	RyanMqttPipe_t *pipe = (RyanMqttPipe_t *)userData;
+	return RyanMqttPipeRead(pipe, &pipe->toClient, RyanMqttFalse, recvBuf, recvLen, timeout);
+}
+
+static int32_t RyanMqttPipeSend(void *userData, char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	RyanMqttPipe_t *pipe = (RyanMqttPipe_t *)userData;
+	return RyanMqttPipeWrite(pipe, &pipe->toPeer, RyanMqttFalse, sendBuf, sendLen, timeout);
+}
+
+static RyanMqttError_e RyanMqttPipeWakeup(void *userData)
+{
+	RyanMqttPipe_t *pipe = (RyanMqttPipe_t *)userData;
+
+	platformMutexLock(NULL, &pipe->lock);
+	pipe->wakeupFlag = RyanMqttTrue;
+	if (RyanMqttTrue == pipe->toClient.readWaitFlag)
+	{
+		pipe->toClient.readWaitFlag = RyanMqttFalse;
+		platformSemaphoreGive(NULL, &pipe->toClient.readableSem);
+	}
+	platformMutexUnLock(NULL, &pipe->lock);
+
+	return RyanMqttSuccessError;
+}
+
+static RyanMqttError_e RyanMqttPipeClose(void *userData)
+{
+	RyanMqttPipe_t *pipe = (RyanMqttPipe_t *)userData;
+
+	platformMutexLock(NULL, &pipe->lock);
+	pipe->closeFlag = RyanMqttTrue;
+	platformMutexUnLock(NULL, &pipe->lock);
+
+	RyanMqttPipeWakeAll(pipe);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 创建内存管道
+ *
+ * @param pPipe
+ * @param bufSize 每个方向的缓冲区大小，为0时使用 RyanMqttPipeDefaultBufSize
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttPipeCreate(RyanMqttPipe_t **pPipe, uint32_t bufSize)
+{
+	RyanMqttCheck(NULL != pPipe, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	if (0 == bufSize)
+	{
+		bufSize = RyanMqttPipeDefaultBufSize;
+	}
+
+	// 两个方向的缓冲区和管道一起申请
+	uint32_t mallocSize = sizeof(RyanMqttPipe_t) + bufSize * 2;
+	RyanMqttPipe_t *pipe = (RyanMqttPipe_t *)platformMemoryMalloc(mallocSize);
+	RyanMqttCheck(NULL != pipe, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemset(pipe, 0, sizeof(RyanMqttPipe_t));
+
+	pipe->toPeer.buf = (uint8_t *)(pipe + 1);
+	pipe->toPeer.size = bufSize;
+	pipe->toClient.buf = pipe->toPeer.buf + bufSize;
+	pipe->toClient.size = bufSize;
+	pipe->closeFlag = RyanMqttTrue;
+
+	platformMutexInit(NULL, &pipe->lock);
+	platformSemaphoreInit(NULL, &pipe->acceptSem, 0);
+	platformSemaphoreInit(NULL, &pipe->toPeer.readableSem, 0);
+	platformSemaphoreInit(NULL, &pipe->toPeer.writableSem, 0);
+	platformSemaphoreInit(NULL, &pipe->toClient.readableSem, 0);
+	platformSemaphoreInit(NULL, &pipe->toClient.writableSem, 0);
+
+	pipe->transport.userData = pipe;
+	pipe->transport.connect = RyanMqttPipeConnect;
+	pipe->transport.recv = RyanMqttPipeRecv;
+	pipe->transport.send = RyanMqttPipeSend;
+	pipe->transport.close = RyanMqttPipeClose;
+	pipe->transport.wakeup = RyanMqttPipeWakeup;
+
+	*pPipe = pipe;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 销毁内存管道，调用前客户端和对端都不能再使用管道
+ *
+ * @param pipe
+ */
+void RyanMqttPipeDestroy(RyanMqttPipe_t *pipe)
+{
+	if (NULL == pipe)
+	{
+		return;
+	}
+
+	platformSemaphoreDestroy(NULL, &pipe->toClient.writableSem);
+	platformSemaphoreDestroy(NULL, &pipe->toClient.readableSem);
+	platformSemaphoreDestroy(NULL, &pipe->toPeer.writableSem);
+	platformSemaphoreDestroy(NULL, &pipe->toPeer.readableSem);
+	platformSemaphoreDestroy(NULL, &pipe->acceptSem);
+	platformMutexDestroy(NULL, &pipe->lock);
+	platformMemoryFree(pipe);
+}
+
+/**
+ * @brief 获取客户端一端的传输层，设置到 RyanMqttClientConfig_t 的 transport
+ *
+ * @param pipe
+ * @return RyanMqttTransport_t*
+ */
+RyanMqttTransport_t *RyanMqttPipeGetTransport(RyanMqttPipe_t *pipe)
+{
+	RyanMqttCheck(NULL != pipe, NULL, RyanMqttLog_d);
+	return &pipe->transport;
+}
+
+/**
+ * @brief 对端等待客户端的新连接
+ *
+ * @param pipe
+ * @param timeout 单位ms
+ * @return RyanMqttError_e 超时返回 RyanMqttFailedError
+ */
+RyanMqttError_e RyanMqttPipePeerAccept(RyanMqttPipe_t *pipe, uint32_t timeout)
+{
+	RyanMqttTimer_t timer;
+	RyanMqttCheck(NULL != pipe, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttTimerCutdown(&timer, timeout);
+	while (1)
+	{
+		platformMutexLock(NULL, &pipe->lock);
+		if (RyanMqttFalse == pipe->closeFlag && pipe->peerConnectId != pipe->connectId)
+		{
+			pipe->peerConnectId = pipe->connectId;
+			platformMutexUnLock(NULL, &pipe->lock);
+			return RyanMqttSuccessError;
+		}
+		platformMutexUnLock(NULL, &pipe->lock);
+
+		uint32_t remain = RyanMqttTimerRemain(&timer);
+		if (0 == remain)
+		{
+			return RyanMqttFailedError;
+		}
+		platformSemaphoreTake(NULL, &pipe->acceptSem, remain);
+	}
+}
+
+/**
+ * @brief 对端读取客户端发送的数据
+ *
+ * @param pipe
+ * @param recvBuf
+ * @param recvLen
+ * @param timeout 单位ms
+ * @return int32_t 读取的字节数，超时返回0，连接断开返回-1
+ */
+int32_t RyanMqttPipePeerRecv(RyanMqttPipe_t *pipe, char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	RyanMqttCheck(NULL != pipe && NULL != recvBuf, -1, RyanMqttLog_d);
+	return RyanMqttPipeRead(pipe, &pipe->toPeer, RyanMqttTrue, recvBuf, recvLen, timeout);
+}
+
+/**
+ * @brief 对端向客户端发送数据
+ *
+ * @param pipe
+ * @param sendBuf
+ * @param sendLen
+ * @param timeout 单位ms
+ * @return int32_t 发送的字节数，超时返回0，连接断开返回-1
+ */
+int32_t RyanMqttPipePeerSend(RyanMqttPipe_t *pipe, char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	RyanMqttCheck(NULL != pipe && NULL != sendBuf, -1, RyanMqttLog_d);
+	return RyanMqttPipeWrite(pipe, &pipe->toClient, RyanMqttTrue, sendBuf, sendLen, timeout);
+}
+
+/**
+ * @brief 对端主动断开当前连接，客户端读完剩余数据后收到连接断开
+ *
+ * @param pipe
+ */
+void RyanMqttPipePeerClose(RyanMqttPipe_t *pipe)
+{
+	if (NULL == pipe)
+	{
+		return;
+	}
+
+	platformMutexLock(NULL, &pipe->lock);
+	if (pipe->peerConnectId == pipe->connectId)
+	{
+		pipe->closeFlag = RyanMqttTrue;
+	}
+	platformMutexUnLock(NULL, &pipe->lock);
+
+	RyanMqttPipeWakeAll(pipe);
+}
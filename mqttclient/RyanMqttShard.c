@@ -0,0 +1,393 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttShard.h"
+#include "RyanMqttThread.h"
+#include "RyanMqttUtil.h"
+
+/**
+ * @brief 根据主题选择连接，订阅和按主题哈希发布都使用这个规则
+ *
+ * @param shard
+ * @param topic
+ * @param topicLen
+ * @return RyanMqttClient_t*
+ */
+static RyanMqttClient_t *RyanMqttShardSelectByTopic(RyanMqttShardClient_t *shard, const char *topic, uint16_t topicLen)
+{
+	return shard->clients[RyanMqttTopicHash(topic, topicLen) % shard->shardCount];
+}
+
+/**
+ * @brief 选择发布消息使用的连接
+ *
+ * @param shard
+ * @param topic
+ * @param topicLen
+ * @return RyanMqttClient_t*
+ */
+static RyanMqttClient_t *RyanMqttShardSelectPublish(RyanMqttShardClient_t *shard, const char *topic, uint16_t topicLen)
+{
+	uint32_t index;
+
+	if (RyanMqttShardRouteTopicHash == shard->route)
+	{
+		return RyanMqttShardSelectByTopic(shard, topic, topicLen);
+	}
+
+#if RyanMqttAtomicEnable
+	index = atomic_fetch_add_explicit(&shard->nextShard, 1U, memory_order_relaxed);
+#else
+	platformCriticalEnter(NULL, &shard->criticalLock);
+	index = shard->nextShard++;
+	platformCriticalExit(NULL, &shard->criticalLock);
+#endif
+
+	return shard->clients[index % shard->shardCount];
+}
+
+static void RyanMqttShardAddPublishCount(RyanMqttShardClient_t *shard)
+{
+#if RyanMqttAtomicEnable
+	atomic_fetch_add_explicit(&shard->publishCount, 1U, memory_order_relaxed);
+#else
+	platformCriticalEnter(NULL, &shard->criticalLock);
+	shard->publishCount++;
+	platformCriticalExit(NULL, &shard->criticalLock);
+#endif
+}
+
+/**
+ * @brief 释放单个连接，没有启动的连接没有mqtt线程负责释放，直接在这里释放
+ *
+ * @param client
+ */
+static void RyanMqttShardDestroyClient(RyanMqttClient_t *client)
+{
+	if (RyanMqttInitState == RyanMqttGetClientState(client))
+	{
+		RyanMqttPurgeClient(client);
+		platformMemoryFree(client);
+		return;
+	}
+
+	RyanMqttDestroy(client);
+}
+
+/**
+ * @brief 分片客户端初始化，创建 shardCount 个mqtt客户端
+ *
+ * @param pShard
+ * @param shardCount 连接个数，范围 1 ~ RyanMqttShardMaxCount
+ * @param route 发布消息选择连接的方式
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardInit(RyanMqttShardClient_t **pShard, uint32_t shardCount, RyanMqttShardRoute_e route)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttCheck(NULL != pShard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(shardCount >= 1 && shardCount <= RyanMqttShardMaxCount, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(RyanMqttShardRouteTopicHash == route || RyanMqttShardRouteRoundRobin == route,
+		      RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	// 连接数组和分片客户端一起申请
+	uint32_t mallocSize = sizeof(RyanMqttShardClient_t) + sizeof(RyanMqttClient_t *) * shardCount;
+	RyanMqttShardClient_t *shard = (RyanMqttShardClient_t *)platformMemoryMalloc(mallocSize);
+	RyanMqttCheck(NULL != shard, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemset(shard, 0, mallocSize);
+
+	shard->clients = (RyanMqttClient_t **)(shard + 1);
+	shard->shardCount = shardCount;
+	shard->route = route;
+	platformCriticalInit(NULL, &shard->criticalLock);
+
+	for (uint32_t i = 0; i < shardCount; i++)
+	{
+		result = RyanMqttInit(&shard->clients[i]);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+			RyanMqttShardDestroy(shard);
+			return result;
+		});
+	}
+
+	*pShard = shard;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 销毁分片客户端，已启动的连接由各自的mqtt线程异步释放
+ *
+ * @param shard
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardDestroy(RyanMqttShardClient_t *shard)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	for (uint32_t i = 0; i < shard->shardCount; i++)
+	{
+		if (NULL != shard->clients[i])
+		{
+			RyanMqttShardDestroyClient(shard->clients[i]);
+		}
+	}
+
+	platformCriticalDestroy(NULL, &shard->criticalLock);
+	platformMemoryFree(shard);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 所有连接使用同一份配置，客户端id追加 "-连接序号"，事件回调和userData也会共享
+ * 事件回调的 pclient 参数是触发事件的连接，可以通过 clientId 区分
+ *
+ * @param shard
+ * @param clientConfig
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardSetConfig(RyanMqttShardClient_t *shard, RyanMqttClientConfig_t *clientConfig)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != clientConfig, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != clientConfig->clientId, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	// 预留 "-连接序号" 和结束符的空间
+	uint32_t clientIdSize = RyanMqttStrlen(clientConfig->clientId) + 12;
+	char *clientId = (char *)platformMemoryMalloc(clientIdSize);
+	RyanMqttCheck(NULL != clientId, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+
+	RyanMqttClientConfig_t shardConfig = *clientConfig;
+	shardConfig.clientId = clientId;
+	for (uint32_t i = 0; i < shard->shardCount; i++)
+	{
+		RyanMqttSnprintf(clientId, clientIdSize, "%s-%u", clientConfig->clientId, (unsigned int)i);
+
+		// SetConfig 会深拷贝配置，这里的clientId可以复用
+		result = RyanMqttSetConfig(shard->clients[i], &shardConfig);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { break; });
+	}
+
+	platformMemoryFree(clientId);
+	return result;
+}
+
+/**
+ * @brief 启动所有连接，某个连接启动失败时不会停止已经启动的连接，由 RyanMqttShardDestroy 统一释放
+ *
+ * @param shard
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardStart(RyanMqttShardClient_t *shard)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	for (uint32_t i = 0; i < shard->shardCount; i++)
+	{
+		result = RyanMqttStart(shard->clients[i]);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+	}
+
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttShardRegisterEventId(RyanMqttShardClient_t *shard, RyanMqttEventId_e eventId)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	for (uint32_t i = 0; i < shard->shardCount; i++)
+	{
+		RyanMqttRegisterEventId(shard->clients[i], eventId);
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 按配置的方式选择一个连接发布消息，参数与 RyanMqttPublishWithUserData 相同
+ *
+ * @param shard
+ * @param topic
+ * @param topicLen
+ * @param payload
+ * @param payloadLen
+ * @param qos
+ * @param retain
+ * @param userData
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardPublishWithUserData(RyanMqttShardClient_t *shard, char *topic, uint16_t topicLen,
+						 char *payload, uint32_t payloadLen, RyanMqttQos_e qos,
+						 RyanMqttBool_e retain, void *userData)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != topic && topicLen > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttClient_t *client = RyanMqttShardSelectPublish(shard, topic, topicLen);
+	RyanMqttError_e result =
+		RyanMqttPublishWithUserData(client, topic, topicLen, payload, payloadLen, qos, retain, userData);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	RyanMqttShardAddPublishCount(shard);
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttShardPublish(RyanMqttShardClient_t *shard, char *topic, char *payload, uint32_t payloadLen,
+				     RyanMqttQos_e qos, RyanMqttBool_e retain)
+{
+	RyanMqttCheck(NULL != topic, RyanMqttParamInvalidError, RyanMqttLog_d);
+	return RyanMqttShardPublishWithUserData(shard, topic, RyanMqttStrlen(topic), payload, payloadLen, qos, retain,
+						NULL);
+}
+
+/**
+ * @brief 订阅只发送到按主题过滤器哈希选择的一个连接，避免同一条消息从多个连接重复收到
+ *
+ * @param shard
+ * @param topic
+ * @param topicLen
+ * @param qos
+ * @param msgHandle
+ * @param userData
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardSubscribeWithMsgHandle(RyanMqttShardClient_t *shard, char *topic, uint16_t topicLen,
+						    RyanMqttQos_e qos, RyanMqttMsgHandle msgHandle, void *userData)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != topic && topicLen > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	return RyanMqttSubscribeWithMsgHandle(RyanMqttShardSelectByTopic(shard, topic, topicLen), topic, topicLen, qos,
+					      msgHandle, userData);
+}
+
+RyanMqttError_e RyanMqttShardSubscribe(RyanMqttShardClient_t *shard, char *topic, RyanMqttQos_e qos)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != topic && RyanMqttStrlen(topic) > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	return RyanMqttSubscribe(RyanMqttShardSelectByTopic(shard, topic, RyanMqttStrlen(topic)), topic, qos);
+}
+
+RyanMqttError_e RyanMqttShardUnSubscribe(RyanMqttShardClient_t *shard, char *topic)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != topic && RyanMqttStrlen(topic) > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	return RyanMqttUnSubscribe(RyanMqttShardSelectByTopic(shard, topic, RyanMqttStrlen(topic)), topic);
+}
+
+/**
+ * @brief 获取指定序号的连接，用于调用分片客户端没有封装的接口
+ *
+ * @param shard
+ * @param index
+ * @param pClient
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardGetClient(RyanMqttShardClient_t *shard, uint32_t index, RyanMqttClient_t **pClient)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != pClient, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(index < shard->shardCount, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	*pClient = shard->clients[index];
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取主题或主题过滤器对应的连接序号，与订阅和按主题哈希发布选择的连接一致
+ *
+ * @param shard
+ * @param topic
+ * @param topicLen
+ * @param index
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardGetIndex(RyanMqttShardClient_t *shard, char *topic, uint16_t topicLen, uint32_t *index)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != topic && topicLen > 0, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != index, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	*index = RyanMqttTopicHash(topic, topicLen) % shard->shardCount;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 所有连接都处于连接状态时返回 RyanMqttConnectState，否则返回序号最小的未连接的连接状态
+ *
+ * @param shard
+ * @return RyanMqttState_e
+ */
+RyanMqttState_e RyanMqttShardGetState(RyanMqttShardClient_t *shard)
+{
+	if (NULL == shard)
+	{
+		return RyanMqttInvalidState;
+	}
+
+	for (uint32_t i = 0; i < shard->shardCount; i++)
+	{
+		RyanMqttState_e state = RyanMqttGetState(shard->clients[i]);
+		if (RyanMqttConnectState != state)
+		{
+			return state;
+		}
+	}
+
+	return RyanMqttConnectState;
+}
+
+/**
+ * @brief 汇总所有连接的统计信息
+ *
+ * @param shard
+ * @param statistics
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttShardGetStatistics(RyanMqttShardClient_t *shard, RyanMqttShardStatistics_t *statistics)
+{
+	RyanMqttCheck(NULL != shard, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != statistics, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttMemset(statistics, 0, sizeof(RyanMqttShardStatistics_t));
+	statistics->shardCount = shard->shardCount;
+
+#if RyanMqttAtomicEnable
+	statistics->publishCount = atomic_load_explicit(&shard->publishCount, memory_order_relaxed);
+#else
+	platformCriticalEnter(NULL, &shard->criticalLock);
+	statistics->publishCount = shard->publishCount;
+	platformCriticalExit(NULL, &shard->criticalLock);
+#endif
+
+	for (uint32_t i = 0; i < shard->shardCount; i++)
+	{
+		RyanMqttClient_t *client = shard->clients[i];
+		uint32_t count = 0;
+		int32_t subscribeCount = 0;
+
+		if (RyanMqttConnectState == RyanMqttGetState(client))
+		{
+			statistics->connectedCount++;
+		}
+
+		platformMutexLock(client->config.userData, &client->ackHandleLock);
+		statistics->ackHandlerCount += client->ackHandlerCount;
+		platformMutexUnLock(client->config.userData, &client->ackHandleLock);
+
+		RyanMqttGetOfflineCount(client, &count);
+		statistics->offlineCount += count;
+
+		count = 0;
+		RyanMqttGetDispatchDropCount(client, &count);
+		statistics->dispatchDropCount += count;
+
+		RyanMqttGetSubscribeTotalCount(client, &subscribeCount);
+		statistics->subscribeCount += subscribeCount;
+	}
+
+	return RyanMqttSuccessError;
+}
@@ -9,12 +9,154 @@
 // mqtt标准是1.5倍，大部分mqtt服务器也是这个配置
 #define RyanMqttKeepAliveMultiplier (1.5)
 
-void RyanMqttRefreshKeepaliveTime(RyanMqttClient_t *client)
+// 接收方向没有报文时，到达 keepaliveTimeoutS 的 0.9 倍时间发送心跳探测连接
+#define RyanMqttKeepaliveIdleRatio (0.9)
+
+// 只有发送方向空闲时，收到的报文已经证明连接正常，心跳只是满足标准要求的客户端在心跳周期内发送报文
+// 推迟到 keepaliveTimeoutS 的 0.95 倍时间，留出发送的余量
+#define RyanMqttKeepaliveSendRatio (0.95)
+
+/**
+ * @brief 生成随机数，用于重连和心跳的抖动
+ * xorshift32，种子混入客户端地址，避免同时启动的多个客户端得到相同的随机序列
+ *
+ * @param client
+ * @return uint32_t
+ */
+static uint32_t RyanMqttRandom(RyanMqttClient_t *client)
 {
+	uint32_t x = client->randomSeed;
+	if (0 == x)
+	{
+		x = platformUptimeMs() ^ (uint32_t)(uintptr_t)client;
+		if (0 == x)
+		{
+			x = 0x9E3779B9U;
+		}
+	}
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	client->randomSeed = x;
+
+	return x;
+}
+
+/**
+ * @brief 刷新最近一次发送报文的时间，每次发送成功都会调用
+ *
+ * @param client
+ */
+void RyanMqttRefreshKeepaliveSendTime(RyanMqttClient_t *client)
+{
+#if RyanMqttAtomicEnable
+	atomic_store_explicit(&client->keepaliveSendTime, platformUptimeMs(), memory_order_relaxed);
+#else
 	platformCriticalEnter(client->config.userData, &client->criticalLock);
-	uint32_t timeout = (uint32_t)(client->config.keepaliveTimeoutS * 1000 * RyanMqttKeepAliveMultiplier);
-	RyanMqttTimerCutdown(&client->keepaliveTimer, timeout); // 启动心跳定时器
+	client->keepaliveSendTime = platformUptimeMs();
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+}
+
+/**
+ * @brief 刷新最近一次收到报文的时间，每次收到完整的报文都会调用
+ *
+ * @param client
+ */
+void RyanMqttRefreshKeepaliveRecvTime(RyanMqttClient_t *client)
+{
+#if RyanMqttAtomicEnable
+	atomic_store_explicit(&client->keepaliveRecvTime, platformUptimeMs(), memory_order_relaxed);
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	client->keepaliveRecvTime = platformUptimeMs();
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+}
+
+/**
+ * @brief 获取距离最近一次发送和接收报文已经过去的时间，考虑了32位溢出
+ *
+ * @param client
+ * @param sendElapsed
+ * @param recvElapsed
+ */
+static void RyanMqttKeepaliveElapsed(RyanMqttClient_t *client, uint32_t *sendElapsed, uint32_t *recvElapsed)
+{
+	uint32_t sendTime, recvTime;
+
+#if RyanMqttAtomicEnable
+	sendTime = atomic_load_explicit(&client->keepaliveSendTime, memory_order_relaxed);
+	recvTime = atomic_load_explicit(&client->keepaliveRecvTime, memory_order_relaxed);
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	sendTime = client->keepaliveSendTime;
+	recvTime = client->keepaliveRecvTime;
 	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+
+	uint32_t now = platformUptimeMs();
+	*sendElapsed = now - sendTime; // 计算内部自动绕回
+	*recvElapsed = now - recvTime;
+}
+
+/**
+ * @brief 获取距离心跳超时的剩余时间，从最近一次收到报文开始计算
+ * 发送成功不能证明服务端还活着，所以只看接收方向
+ *
+ * @param client
+ * @return uint32_t 超时返回0
+ */
+uint32_t RyanMqttKeepaliveRemain(RyanMqttClient_t *client)
+{
+	uint32_t timeout = (uint32_t)(client->config.keepaliveTimeoutS * 1000 * RyanMqttKeepAliveMultiplier);
+	uint32_t sendElapsed, recvElapsed;
+
+	RyanMqttKeepaliveElapsed(client, &sendElapsed, &recvElapsed);
+
+	return (recvElapsed >= timeout) ? 0 : timeout - recvElapsed;
+}
+
+/**
+ * @brief 获取距离需要发送心跳包的剩余时间
+ * 发送方向空闲到 0.95 倍心跳周期时必须发送，满足标准要求的客户端在心跳周期内发送报文。
+ * 接收方向空闲到 0.9 倍心跳周期并且之后还没有发送过心跳时提前发送，让服务端在心跳超时前回复pingresp。
+ * 两个时间都提前本轮随机的抖动时间，保证心跳间隔不会超过标准要求
+ *
+ * @param client
+ * @return uint32_t 单位ms，为0时需要发送心跳包
+ */
+static uint32_t RyanMqttKeepaliveSendRemain(RyanMqttClient_t *client)
+{
+	uint32_t keepalive = (uint32_t)client->config.keepaliveTimeoutS * 1000;
+	uint32_t sendInterval = (uint32_t)(keepalive * RyanMqttKeepaliveSendRatio) - client->keepaliveJitterTime;
+	uint32_t idleInterval = (uint32_t)(keepalive * RyanMqttKeepaliveIdleRatio) - client->keepaliveJitterTime;
+	uint32_t sendElapsed, recvElapsed;
+
+	RyanMqttKeepaliveElapsed(client, &sendElapsed, &recvElapsed);
+	uint32_t pingElapsed = platformUptimeMs() - client->keepalivePingTime;
+
+	uint32_t sendRemain = (sendElapsed >= sendInterval) ? 0 : sendInterval - sendElapsed;
+
+	// 最近一次收到报文后已经发送过心跳，等待pingresp或心跳超时，不重复探测
+	if (pingElapsed < recvElapsed)
+	{
+		return sendRemain;
+	}
+
+	uint32_t idleRemain = (recvElapsed >= idleInterval) ? 0 : idleInterval - recvElapsed;
+	return (sendRemain < idleRemain) ? sendRemain : idleRemain;
+}
+
+/**
+ * @brief 重新生成下一轮心跳提前发送的随机时间，在0到 keepaliveJitter 之间
+ *
+ * @param client
+ */
+static void RyanMqttKeepaliveJitterRefresh(RyanMqttClient_t *client)
+{
+	uint32_t jitter = client->config.keepaliveJitter;
+	client->keepaliveJitterTime = (0 == jitter) ? 0 : RyanMqttRandom(client) % (jitter + 1);
 }
 
 /**
@@ -33,27 +175,8 @@ static RyanMqttError_e RyanMqttKeepalive(RyanMqttClient_t *client)
 		return RyanMqttNotConnectError;
 	}
 
-	uint32_t timeRemain = RyanMqttTimerRemain(&client->keepaliveTimer);
-
-	// 当剩余时间大于 recvtimeout 并且小于 keepaliveTimeoutS 的 0.9 倍时间时不进行发送心跳包
-	if (timeRemain > (uint32_t)(client->config.recvTimeout + 100))
-	{
-		// 当没有到达 keepaliveTimeoutS 的 0.9 倍时间时不进行发送心跳包
-		// timeRemain 是剩余时间，所以 timeRemain > RyanMqttKeepAliveMultiplier - 0.9 就是还没有到达0.9倍时间
-		if (timeRemain > client->config.keepaliveTimeoutS * 1000 * (RyanMqttKeepAliveMultiplier - 0.9))
-		{
-			return RyanMqttSuccessError;
-		}
-
-		// 节流时间内不发送心跳报文
-		if (RyanMqttTimerRemain(&client->keepaliveThrottleTimer))
-		{
-			return RyanMqttSuccessError;
-		}
-	}
-
-	// 超过设置的 1.5 倍心跳周期，主动通知用户断开连接
-	if (0 == timeRemain)
+	// 超过设置的 1.5 倍心跳周期没有收到任何报文，主动通知用户断开连接
+	if (0 == RyanMqttKeepaliveRemain(client))
 	{
 		RyanMqttConnectStatus_e connectState = RyanMqttKeepaliveTimeout;
 		RyanMqttEventMachine(client, RyanMqttEventDisconnected, (void *)&connectState);
@@ -62,6 +185,13 @@ static RyanMqttError_e RyanMqttKeepalive(RyanMqttClient_t *client)
 		return RyanMqttFailedError;
 	}
 
+	// 没有到达心跳发送时间时不发送心跳包，mqtt线程会在到达时唤醒
+	// 发送成功会刷新发送时间和心跳时间，所以发送后不需要节流
+	if (RyanMqttKeepaliveSendRemain(client) > 0)
+	{
+		return RyanMqttSuccessError;
+	}
+
 	// 发送mqtt心跳包
 	{
 		// MQTT_PACKET_PINGREQ_SIZE
@@ -74,11 +204,12 @@ static RyanMqttError_e RyanMqttKeepalive(RyanMqttClient_t *client)
 
 		RyanMqttError_e result = RyanMqttSendPacket(client, fixedBuffer.pBuffer, fixedBuffer.size);
 		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
-
-		RyanMqttTimerCutdown(&client->keepaliveThrottleTimer,
-				     client->config.recvTimeout + 1500); // 启动心跳检查节流定时器
 	}
 
+	client->keepalivePingTime = platformUptimeMs();
+
+	// 每一轮心跳使用不同的抖动时间，避免同时连接的大量客户端一直同时发送心跳
+	RyanMqttKeepaliveJitterRefresh(client);
 	return RyanMqttSuccessError;
 }
 
@@ -96,7 +227,8 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 	RyanMqttList_t *curr, *next;
 	RyanMqttAckHandler_t *ackHandler;
 	RyanMqttTimer_t ackScanRemainTimer;
-	uint32_t ackScanThrottleTime = 1000; // ack扫描节流最长一秒
+	// 下一次扫描的时间取最近一个ack的超时时间，链表为空时不需要扫描，加入新ack时会提前
+	uint32_t ackExpireTime = UINT32_MAX;
 	RyanMqttAssert(NULL != client);
 
 	// mqtt没有连接就退出
@@ -105,8 +237,8 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 		return;
 	}
 
-	// 节流时间内不检查ack链表
-	if (RyanMqttTimerRemain(&client->ackScanThrottleTimer))
+	// 最近的ack还没有超时就不检查ack链表
+	if (RyanMqttTrue == waitFlag && RyanMqttTimerRemain(&client->ackExpireTimer))
 	{
 		return;
 	}
@@ -123,6 +255,9 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 	}
 	RyanMqttTimerCutdown(&ackScanRemainTimer, ackScanWindowMs);
 
+	// 没有超时的ack使用同一个时间判断，只在处理超时ack(重发或销毁)后重新读取时间
+	uint32_t now = platformUptimeMs();
+
 	platformMutexLock(client->config.userData, &client->ackHandleLock);
 	RyanMqttListForEachSafe(curr, next, &client->ackHandlerList)
 	{
@@ -133,7 +268,7 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 		}
 
 		// 超过最大处理时间,直接跳出处理函数,等待下次再处理
-		if (0 == RyanMqttTimerRemain(&ackScanRemainTimer))
+		if (0 == RyanMqttTimerRemainAt(&ackScanRemainTimer, now))
 		{
 			break;
 		}
@@ -142,13 +277,13 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 		ackHandler = RyanMqttListEntry(curr, RyanMqttAckHandler_t, list);
 
 		// ack响应没有超时就不进行处理
-		uint32_t ackRemainTime = RyanMqttTimerRemain(&ackHandler->timer);
+		uint32_t ackRemainTime = RyanMqttTimerRemainAt(&ackHandler->timer, now);
 		if (0 != ackRemainTime)
 		{
-			// 如果ack剩余时间小于节流时间，就把ack剩余时间更新到节流上
-			if (ackRemainTime < ackScanThrottleTime)
+			// 记录最近一个ack的超时时间
+			if (ackRemainTime < ackExpireTime)
 			{
-				ackScanThrottleTime = ackRemainTime;
+				ackExpireTime = ackRemainTime;
 			}
 
 			if (RyanMqttTrue == waitFlag)
@@ -180,6 +315,10 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 			// 重置ack超时时间
 			RyanMqttTimerCutdown(&ackHandler->timer, client->config.ackTimeout);
 			ackHandler->repeatCount++;
+			if (client->config.ackTimeout < ackExpireTime)
+			{
+				ackExpireTime = client->config.ackTimeout;
+			}
 
 			// 重发次数超过警告值回调
 			if (ackHandler->repeatCount >= client->config.ackHandlerRepeatCountWarning)
@@ -212,14 +351,15 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 			break;
 		}
 		}
+
+		now = platformUptimeMs();
 	}
 	platformMutexUnLock(client->config.userData, &client->ackHandleLock);
 
-	// 扫描链表没有超时时，才设置scan节流定时器
-	if (RyanMqttTimerRemain(&ackScanRemainTimer))
+	// 扫描完整个链表时，才设置下一次扫描的时间
+	if (RyanMqttTimerRemainAt(&ackScanRemainTimer, now))
 	{
-		// 启动ack scan节流定时器
-		RyanMqttTimerCutdown(&client->ackScanThrottleTimer, ackScanThrottleTime);
+		RyanMqttTimerCutdown(&client->ackExpireTimer, ackExpireTime);
 		client->pendingAckFlag = RyanMqttFalse;
 	}
 	else
@@ -229,79 +369,58 @@ static void RyanMqttAckListScan(RyanMqttClient_t *client, RyanMqttBool_e waitFla
 }
 
 /**
- * @brief mqtt连接函数
+ * @brief 序列化connect报文并缓存到客户端，调用前需要持有 userSessionLock
  *
  * @param client
  * @return RyanMqttError_e
  */
-static RyanMqttError_e RyanMqttConnectBroker(RyanMqttClient_t *client, RyanMqttConnectStatus_e *connectState)
+static RyanMqttError_e RyanMqttConnectPacketBuild(RyanMqttClient_t *client)
 {
-	RyanMqttError_e result = RyanMqttSuccessError;
 	MQTTStatus_t status;
 	MQTTConnectInfo_t connectInfo;
 	MQTTPublishInfo_t willInfo;
 	MQTTFixedBuffer_t fixedBuffer = {0};
 	size_t remainingLength;
-	RyanMqttBool_e lwtFlag;
-	RyanMqttAssert(NULL != client);
-	RyanMqttAssert(NULL != connectState);
-
-	RyanMqttCheckCodeNoReturn(RyanMqttConnectState != RyanMqttGetClientState(client), RyanMqttConnectError,
-				  RyanMqttLog_d, {
-					  result = RyanMqttNoRescourceError;
-					  *connectState = RyanMqttConnectClientInvalid;
-					  goto __exit;
-				  });
+	RyanMqttBool_e lwtFlag = RyanMqttFalse;
 
 	// 填充 connect 信息
+	// 无需判断config有效性，如果无效一定是用户内存访问越界了
+	// RyanMqtt不允许 pClientIdentifier 为NULL
+	connectInfo.pClientIdentifier = client->config.clientId;
+	connectInfo.clientIdentifierLength = RyanMqttStrlen(client->config.clientId);
+	connectInfo.pUserName = client->config.userName;
+	if (connectInfo.pUserName)
 	{
-		// 无需判断config有效性，如果无效一定是用户内存访问越界了
-		// RyanMqtt不允许 pClientIdentifier 为NULL
-		connectInfo.pClientIdentifier = client->config.clientId;
-		connectInfo.clientIdentifierLength = RyanMqttStrlen(client->config.clientId);
-		connectInfo.pUserName = client->config.userName;
-		if (connectInfo.pUserName)
-		{
-			connectInfo.userNameLength = RyanMqttStrlen(client->config.userName);
-		}
-		else
-		{
-			connectInfo.userNameLength = 0;
-		}
+		connectInfo.userNameLength = RyanMqttStrlen(client->config.userName);
+	}
+	else
+	{
+		connectInfo.userNameLength = 0;
+	}
 
-		connectInfo.pPassword = client->config.password;
-		if (connectInfo.pPassword)
-		{
-			connectInfo.passwordLength = RyanMqttStrlen(client->config.password);
-		}
-		else
-		{
-			connectInfo.passwordLength = 0;
-		}
-		connectInfo.keepAliveSeconds = client->config.keepaliveTimeoutS;
-		connectInfo.cleanSession = client->config.cleanSessionFlag;
+	connectInfo.pPassword = client->config.password;
+	if (connectInfo.pPassword)
+	{
+		connectInfo.passwordLength = RyanMqttStrlen(client->config.password);
+	}
+	else
+	{
+		connectInfo.passwordLength = 0;
+	}
+	connectInfo.keepAliveSeconds = client->config.keepaliveTimeoutS;
+	connectInfo.cleanSession = client->config.cleanSessionFlag;
 
-		// 验证lwt信息
-		platformMutexLock(client->config.userData, &client->userSessionLock);
-		if (NULL != client->lwtOptions)
-		{
-			lwtFlag = client->lwtOptions->lwtFlag;
-			if (lwtFlag)
-			{
-				willInfo.qos = (MQTTQoS_t)client->lwtOptions->qos;
-				willInfo.retain = client->lwtOptions->retain;
-				willInfo.pPayload = client->lwtOptions->payload;
-				willInfo.payloadLength = client->lwtOptions->payloadLen;
-				willInfo.pTopicName = client->lwtOptions->topic;
-				willInfo.topicNameLength = RyanMqttStrlen(client->lwtOptions->topic);
-				willInfo.dup = RyanMqttFalse;
-			}
-		}
-		else
-		{
-			lwtFlag = RyanMqttFalse;
-		}
-		platformMutexUnLock(client->config.userData, &client->userSessionLock);
+	// 验证lwt信息
+	if (NULL != client->lwtOptions && RyanMqttTrue == client->lwtOptions->lwtFlag)
+	{
+		lwtFlag = RyanMqttTrue;
+		willInfo.qos = (MQTTQoS_t)client->lwtOptions->qos;
+		willInfo.retain = client->lwtOptions->retain;
+		willInfo.pPayload = client->lwtOptions->payload;
+		willInfo.payloadLength = client->lwtOptions->payloadLen;
+		willInfo.pTopicName = client->lwtOptions->topic;
+		willInfo.topicNameLength = RyanMqttStrlen(client->lwtOptions->topic);
+		willInfo.dup = RyanMqttFalse;
 	}
 
 	// 获取数据包大小
@@ -311,53 +430,115 @@ static RyanMqttError_e RyanMqttConnectBroker(RyanMqttClient_t *client, RyanMqttC
 
 	// 申请数据包的空间
 	fixedBuffer.pBuffer = platformMemoryMalloc(fixedBuffer.size);
-	RyanMqttCheckCodeNoReturn(NULL != fixedBuffer.pBuffer, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
-		result = RyanMqttNotEnoughMemError;
-		*connectState = RyanMqttConnectFailedError;
-		goto __exit;
-	});
+	RyanMqttCheck(NULL != fixedBuffer.pBuffer, RyanMqttNotEnoughMemError, RyanMqttLog_d);
 
 	// 序列化数据包
 	status = MQTT_SerializeConnect(&connectInfo, RyanMqttTrue == lwtFlag ? &willInfo : NULL, remainingLength,
 				       &fixedBuffer);
-	RyanMqttCheckCodeNoReturn(MQTTSuccess == status, RyanMqttSerializePacketError, RyanMqttLog_d, {
-		result = RyanMqttSerializePacketError;
-		*connectState = RyanMqttConnectFailedError;
-		goto __exit;
-	});
+	RyanMqttCheckCode(MQTTSuccess == status, RyanMqttSerializePacketError, RyanMqttLog_d,
+			  { platformMemoryFree(fixedBuffer.pBuffer); });
 
-	// 调用底层的连接函数连接上服务器
-	result = platformNetworkConnect(client->config.userData, &client->network, client->config.host,
-					client->config.port);
-	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanSocketFailedError, RyanMqttLog_d, {
-		*connectState = RyanMqttConnectNetWorkFail;
-		goto __exit;
-	});
+	client->connectPacket = fixedBuffer.pBuffer;
+	client->connectPacketLen = (uint32_t)fixedBuffer.size;
+	return RyanMqttSuccessError;
+}
 
-	// 发送序列化mqtt的CONNECT报文
-	result = RyanMqttSendPacket(client, fixedBuffer.pBuffer, fixedBuffer.size);
-	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
-		*connectState = RyanMqttConnectNetWorkFail;
-		goto __exit;
-	});
+/**
+ * @brief 通知持久化后端刷盘，是否真正写入由后端按批量策略决定
+ *
+ * @param client
+ */
+static void RyanMqttPersistSync(RyanMqttClient_t *client)
+{
+	if (NULL != client->persist)
+	{
+		client->persist->sync(client->persist->userData, RyanMqttFalse);
+	}
+}
 
-	// 等待报文
-	// mqtt规范 服务端接收到connect报文后，服务端发送给客户端的第一个报文必须是 CONNACK
-	MQTTPacketInfo_t pIncomingPacket = {0};
-	result = RyanMqttGetPacketInfo(client, &pIncomingPacket);
-	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttSerializePacketError, RyanMqttLog_d, {
-		*connectState = RyanMqttConnectInvalidPacketError;
-		goto __exit;
-	});
+/**
+ * @brief 连接期间取走缓存的connect报文，没有缓存时重新序列化
+ * 避免用户同时修改配置或遗嘱时释放正在发送的报文
+ *
+ * @param client
+ * @param pPacket
+ * @param pPacketLen
+ * @param pVersion 取走时的报文版本，放回时用于判断期间是否被修改
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttConnectPacketTake(RyanMqttClient_t *client, uint8_t **pPacket, uint32_t *pPacketLen,
+						 uint32_t *pVersion)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
 
-	if (MQTT_PACKET_TYPE_CONNACK == (pIncomingPacket.type & 0xF0U))
+	platformMutexLock(client->config.userData, &client->userSessionLock);
+	if (NULL == client->connectPacket)
+	{
+		result = RyanMqttConnectPacketBuild(client);
+	}
+	*pPacket = client->connectPacket;
+	*pPacketLen = client->connectPacketLen;
+	*pVersion = client->connectPacketVersion;
+	client->connectPacket = NULL;
+	platformMutexUnLock(client->config.userData, &client->userSessionLock);
+
+	return result;
+}
+
+/**
+ * @brief 连接结束后放回connect报文，期间配置和遗嘱没有被修改时放回缓存供下次重连使用，否则释放
+ *
+ * @param client
+ * @param packet
+ * @param packetLen
+ * @param version
+ */
+static void RyanMqttConnectPacketRestore(RyanMqttClient_t *client, uint8_t *packet, uint32_t packetLen,
+					 uint32_t version)
+{
+	if (NULL == packet)
+	{
+		return;
+	}
+
+	platformMutexLock(client->config.userData, &client->userSessionLock);
+	if (version == client->connectPacketVersion && NULL == client->connectPacket)
+	{
+		client->connectPacket = packet;
+		client->connectPacketLen = packetLen;
+		packet = NULL;
+	}
+	platformMutexUnLock(client->config.userData, &client->userSessionLock);
+
+	if (NULL != packet)
+	{
+		platformMemoryFree(packet);
+	}
+}
+
+/**
+ * @brief 处理连接后收到的第一个报文
+ * mqtt规范 服务端接收到connect报文后，服务端发送给客户端的第一个报文必须是 CONNACK
+ *
+ * @param client
+ * @param pIncomingPacket
+ * @param connectState
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttConnackHandle(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket,
+					     RyanMqttConnectStatus_e *connectState)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	MQTTStatus_t status;
+
+	if (MQTT_PACKET_TYPE_CONNACK == (pIncomingPacket->type & 0xF0U))
 	{
 		uint16_t packetId;
 		bool sessionPresent; // 会话位
 
 		// 反序列化ack包，MQTTSuccess 和 MQTTServerRefused 都会返回正确的connectState
 		// MQTTServerRefused 表示连接被拒绝，但是可以获取原因思什么
-		status = MQTT_DeserializeAck(&pIncomingPacket, &packetId, &sessionPresent);
+		status = MQTT_DeserializeAck(pIncomingPacket, &packetId, &sessionPresent);
 		if (MQTTSuccess != status && MQTTServerRefused != status)
 		{
 			result = RyanMqttFailedError;
@@ -366,7 +547,7 @@ static RyanMqttError_e RyanMqttConnectBroker(RyanMqttClient_t *client, RyanMqttC
 		else
 		{
 			// 获取连接返回值
-			*connectState = pIncomingPacket.pRemainingData[1];
+			*connectState = pIncomingPacket->pRemainingData[1];
 			if (RyanMqttConnectAccepted != *connectState)
 			{
 				result = RyanMqttFailedError;
@@ -387,19 +568,136 @@ static RyanMqttError_e RyanMqttConnectBroker(RyanMqttClient_t *client, RyanMqttC
 		*connectState = RyanMqttConnectFirstPackNotConnack;
 	}
 
+	return result;
+}
+
+/**
+ * @brief mqtt连接函数
+ * connect报文只在第一次连接或者配置、遗嘱修改后序列化，断线重连时直接发送缓存的报文
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttConnectBroker(RyanMqttClient_t *client, RyanMqttConnectStatus_e *connectState)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint8_t *connectPacket = NULL;
+	uint32_t connectPacketLen = 0;
+	uint32_t connectPacketVersion = 0;
+	RyanMqttAssert(NULL != client);
+	RyanMqttAssert(NULL != connectState);
+
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState != RyanMqttGetClientState(client), RyanMqttConnectError,
+				  RyanMqttLog_d, {
+					  result = RyanMqttNoRescourceError;
+					  *connectState = RyanMqttConnectClientInvalid;
+					  goto __exit;
+				  });
+
+	result = RyanMqttConnectPacketTake(client, &connectPacket, &connectPacketLen, &connectPacketVersion);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+		*connectState = RyanMqttConnectFailedError;
+		goto __exit;
+	});
+
+	// 调用传输层的连接函数连接上服务器
+	result = RyanMqttTransportConnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanSocketFailedError, RyanMqttLog_d, {
+		*connectState = RyanMqttConnectNetWorkFail;
+		goto __exit;
+	});
+
+	// 发送序列化mqtt的CONNECT报文
+	result = RyanMqttSendPacket(client, connectPacket, connectPacketLen);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+		*connectState = RyanMqttConnectNetWorkFail;
+		goto __exit;
+	});
+
+	// 等待报文
+	// 等待期间被唤醒时提前返回超时，继续等到 recvTimeout
+	MQTTPacketInfo_t pIncomingPacket = {0};
+	RyanMqttTimer_t connackTimer;
+	RyanMqttTimerCutdown(&connackTimer, client->config.recvTimeout);
+	do
+	{
+		result = RyanMqttGetPacketInfo(client, &pIncomingPacket, RyanMqttTimerRemain(&connackTimer));
+	} while (RyanMqttRecvPacketTimeOutError == result && 0 != RyanMqttTimerRemain(&connackTimer));
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttSerializePacketError, RyanMqttLog_d, {
+		*connectState = RyanMqttConnectInvalidPacketError;
+		goto __exit;
+	});
+
+	result = RyanMqttConnackHandle(client, &pIncomingPacket, connectState);
 	platformMemoryFree(pIncomingPacket.pRemainingData);
 
 	if (RyanMqttSuccessError != result)
 	{
-		platformNetworkClose(client->config.userData, &client->network);
+		RyanMqttTransportClose(client);
 	}
 
 __exit:
-	if (fixedBuffer.pBuffer)
+	RyanMqttConnectPacketRestore(client, connectPacket, connectPacketLen, connectPacketVersion);
+	return result;
+}
+
+/**
+ * @brief 计算下一次重连前的等待时间
+ * 未配置最大重连间隔时使用固定的 reconnectTimeout，否则退避上限先乘以 reconnectMultiplier(不超过 reconnectMaxTimeout)，
+ * 等待时间在 reconnectTimeout 到新的上限之间随机。断开后的第一次重连也带有抖动，同时断开的客户端不会一起重连
+ *
+ * @param client
+ * @param stableFlag 断开前的连接已经稳定保持，退避上限恢复为最小间隔
+ * @return uint32_t 单位ms
+ */
+static uint32_t RyanMqttReconnectDelay(RyanMqttClient_t *client, RyanMqttBool_e stableFlag)
+{
+	uint32_t minTimeout = client->config.reconnectTimeout;
+	uint32_t maxTimeout = client->config.reconnectMaxTimeout;
+	uint32_t multiplier = (0 == client->config.reconnectMultiplier) ? 2 : client->config.reconnectMultiplier;
+
+	if (0 == maxTimeout)
 	{
-		platformMemoryFree(fixedBuffer.pBuffer);
+		return minTimeout;
 	}
-	return result;
+
+	if (RyanMqttTrue == stableFlag || client->reconnectBackoff < minTimeout)
+	{
+		client->reconnectBackoff = minTimeout;
+	}
+
+	uint32_t ceiling = client->reconnectBackoff;
+	ceiling = (ceiling > maxTimeout / multiplier) ? maxTimeout : ceiling * multiplier;
+	client->reconnectBackoff = ceiling;
+
+	return minTimeout + (uint32_t)(RyanMqttRandom(client) % ((uint64_t)(ceiling - minTimeout) + 1));
+}
+
+/**
+ * @brief 是否需要开始重连，用户请求立即重连或者自动重连的等待时间已到
+ *
+ * @param client
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttReconnectIsDue(RyanMqttClient_t *client)
+{
+	RyanMqttBool_e reconnectFlag;
+
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	reconnectFlag = client->reconnectFlag;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+
+	if (RyanMqttTrue == reconnectFlag)
+	{
+		return RyanMqttTrue;
+	}
+
+	if (RyanMqttTrue == client->config.autoReconnectFlag && 0 == RyanMqttTimerRemain(&client->reconnectTimer))
+	{
+		return RyanMqttTrue;
+	}
+
+	return RyanMqttFalse;
 }
 
 /**
@@ -417,21 +715,47 @@ void RyanMqttEventMachine(RyanMqttClient_t *client, RyanMqttEventId_e eventId, v
 	{
 	case RyanMqttEventConnected: // 第一次连接成功
 		RyanMqttSetClientState(client, RyanMqttConnectState);
-		RyanMqttRefreshKeepaliveTime(client);
+		client->connectedTime = platformUptimeMs();
+		RyanMqttRefreshKeepaliveSendTime(client);
+		RyanMqttRefreshKeepaliveRecvTime(client);
+		client->keepalivePingTime = client->connectedTime;
+		RyanMqttKeepaliveJitterRefresh(client);
 		RyanMqttAckListScan(client, RyanMqttFalse); // 扫描确认列表，销毁已超时的确认处理程序或重新发送它们
 		break;
 
 	case RyanMqttEventDisconnected: // 断开连接事件
+	{
+		RyanMqttState_e oldState = RyanMqttGetClientState(client);
+		uint32_t stableTime = (uint32_t)client->config.reconnectStableTimeS * 1000;
+		RyanMqttBool_e stableFlag =
+			(RyanMqttConnectState == oldState && platformUptimeMs() - client->connectedTime >= stableTime)
+				? RyanMqttTrue
+				: RyanMqttFalse;
+
 		// 先将客户端状态设置为断开连接,避免close网络资源时用户依然在使用
 		RyanMqttSetClientState(client, RyanMqttDisconnectState);
-		platformNetworkClose(client->config.userData, &client->network);
+		RyanMqttTransportClose(client);
+
+		// 重复的断开事件不再推进退避
+		if (RyanMqttDisconnectState != oldState)
+		{
+			RyanMqttTimerCutdown(&client->reconnectTimer, RyanMqttReconnectDelay(client, stableFlag));
+
+			// 用户线程关闭socket不会打断mqtt线程的接收等待，唤醒它进入重连流程
+			RyanMqttThreadWakeup(client);
+		}
+
 		if (RyanMqttTrue == client->config.cleanSessionFlag)
 		{
 			RyanMqttPurgeSession(client);
 		}
 		break;
+	}
 
 	case RyanMqttEventReconnectBefore: // 重连前回调
+		platformCriticalEnter(client->config.userData, &client->criticalLock);
+		client->reconnectFlag = RyanMqttFalse;
+		platformCriticalExit(client->config.userData, &client->criticalLock);
 		RyanMqttSetClientState(client, RyanMqttReconnectState);
 		break;
 
@@ -443,69 +767,421 @@ void RyanMqttEventMachine(RyanMqttClient_t *client, RyanMqttEventId_e eventId, v
 		return;
 	}
 
-	platformCriticalEnter(client->config.userData, &client->criticalLock);
-	RyanMqttEventId_e eventFlag = client->eventFlag;
-	platformCriticalExit(client->config.userData, &client->criticalLock);
+	RyanMqttEventId_e eventFlag = RyanMqttGetEventFlag(client);
 
 	if (eventFlag & eventId)
 	{
+		// 使能回调工作线程时事件拷贝后放入回调队列。重连前和销毁前事件需要同步执行，入队失败时也直接回调
+		if (NULL != client->dispatchPool && RyanMqttEventReconnectBefore != eventId &&
+		    RyanMqttEventDestroyBefore != eventId &&
+		    RyanMqttSuccessError == RyanMqttDispatchEvent(client, eventId, eventData))
+		{
+			return;
+		}
+
 		client->config.mqttEventHandle(client, eventId, eventData);
 	}
 }
 
 /**
- * @brief mqtt运行线程
+ * @brief 释放客户端占用的资源，不释放客户端本身和mqtt线程
  *
- * @param argument
+ * @param client
  */
-void RyanMqttThread(void *argument)
+void RyanMqttPurgeClient(RyanMqttClient_t *client)
 {
-	RyanMqttClient_t *client = (RyanMqttClient_t *)argument;
-	RyanMqttAssert(NULL != client); // RyanMqttStart前没有调用RyanMqttInit
+	RyanMqttEventMachine(client, RyanMqttEventDestroyBefore, (void *)NULL);
 
-	while (1)
+	// 等待工作线程执行完当前回调，销毁前事件回调中可能在等待客户端销毁，所以放在事件之后
+	RyanMqttDispatchDestroy(client);
+	RyanMqttRecvRingDestroy(client);
+	RyanMqttOfflineQueueDestroy(client);
+
+	// 关闭连接
+	RyanMqttTransportClose(client);
+
+	// 销毁网络组件
+	platformNetworkDestroy(client->config.userData, &client->network);
+
+	// 清除config信息
+	RyanMqttPurgeConfig(&client->config);
+
+	// 清除遗嘱相关配置
+	if (NULL != client->lwtOptions)
 	{
-		// 销毁客户端
-		if (RyanMqttTrue == client->destroyFlag)
+		if (NULL != client->lwtOptions->payload)
 		{
-			RyanMqttEventMachine(client, RyanMqttEventDestroyBefore, (void *)NULL);
+			platformMemoryFree(client->lwtOptions->payload);
+		}
 
-			// 关闭网络组件
-			platformNetworkClose(client->config.userData, &client->network);
+		if (NULL != client->lwtOptions->topic)
+		{
+			platformMemoryFree(client->lwtOptions->topic);
+		}
 
-			// 销毁网络组件
-			platformNetworkDestroy(client->config.userData, &client->network);
+		platformMemoryFree(client->lwtOptions);
+	}
 
-			// 清除config信息
-			RyanMqttPurgeConfig(&client->config);
+	// 销毁客户端不代表会话结束，先停止持久化，保留未完成的会话供下次启动恢复
+	if (NULL != client->persist)
+	{
+		client->persist->sync(client->persist->userData, RyanMqttTrue);
+		client->persist = NULL;
+	}
 
-			// 清除遗嘱相关配置
-			if (NULL != client->lwtOptions)
-			{
-				if (NULL != client->lwtOptions->payload)
-				{
-					platformMemoryFree(client->lwtOptions->payload);
-				}
+	// 清除session  ack链表和msg链表
+	RyanMqttPurgeSession(client);
+	RyanMqttMsgSnapshotDestroy(client);
 
-				if (NULL != client->lwtOptions->topic)
-				{
-					platformMemoryFree(client->lwtOptions->topic);
-				}
+	// 清除互斥锁
+	platformMutexDestroy(client->config.userData, &client->sendLock);
+	platformMutexDestroy(client->config.userData, &client->msgHandleLock);
+	platformMutexDestroy(client->config.userData, &client->ackHandleLock);
+	platformMutexDestroy(client->config.userData, &client->userSessionLock);
 
-				platformMemoryFree(client->lwtOptions);
-			}
+	if (NULL != client->connectPacket)
+	{
+		platformMemoryFree(client->connectPacket);
+	}
 
-			// 清除session  ack链表和msg链表
-			RyanMqttPurgeSession(client);
+	if (NULL != client->stepConnectPacket)
+	{
+		platformMemoryFree(client->stepConnectPacket);
+	}
+
+	platformSemaphoreDestroy(client->config.userData, &client->wakeSem);
+
+	// 清除临界区
+	platformCriticalDestroy(client->config.userData, &client->criticalLock);
+}
+
+/**
+ * @brief 根据连接结果触发对应事件，连接成功后立即补发离线队列
+ *
+ * @param client
+ * @param result
+ * @param connectState
+ */
+static void RyanMqttConnectDone(RyanMqttClient_t *client, RyanMqttError_e result, RyanMqttConnectStatus_e connectState)
+{
+	if (RyanMqttSuccessError == result)
+	{
+		RyanMqttEventMachine(client, RyanMqttEventConnected, (void *)&connectState);
+		RyanMqttOfflineQueueDrain(client, RyanMqttTrue);
+	}
+	else
+	{
+		RyanMqttEventMachine(client, RyanMqttEventDisconnected, (void *)&connectState);
+	}
+}
+
+/**
+ * @brief 连接mqtt服务器并触发对应事件
+ *
+ * @param client
+ */
+static void RyanMqttConnectOnce(RyanMqttClient_t *client)
+{
+	RyanMqttLog_d("开始连接");
+	RyanMqttConnectStatus_e connectState;
+	RyanMqttError_e result = RyanMqttConnectBroker(client, &connectState);
+	RyanMqttConnectDone(client, result, connectState);
+}
+
+/**
+ * @brief 单步模式下结束连接流程，放回connect报文并触发对应事件
+ *
+ * @param client
+ * @param result
+ * @param connectState
+ */
+static void RyanMqttStepConnectFinish(RyanMqttClient_t *client, RyanMqttError_e result,
+				      RyanMqttConnectStatus_e connectState)
+{
+	client->stepConnectState = RyanMqttStepConnectIdle;
+	RyanMqttConnectPacketRestore(client, client->stepConnectPacket, client->stepConnectPacketLen,
+				     client->stepConnectPacketVersion);
+	client->stepConnectPacket = NULL;
 
-			// 清除互斥锁
-			platformMutexDestroy(client->config.userData, &client->sendLock);
-			platformMutexDestroy(client->config.userData, &client->msgHandleLock);
-			platformMutexDestroy(client->config.userData, &client->ackHandleLock);
-			platformMutexDestroy(client->config.userData, &client->userSessionLock);
+	// 读取CONNACK时连接断开已经触发过断开事件
+	if (RyanMqttDisconnectState != RyanMqttGetClientState(client))
+	{
+		RyanMqttConnectDone(client, result, connectState);
+	}
+}
 
-			// 清除临界区
-			platformCriticalDestroy(client->config.userData, &client->criticalLock);
+/**
+ * @brief 单步模式下推进一次连接流程，不等待
+ * 传输层连接中、connect报文没有发送完时等待socket可写，发送完成后等待socket可读再读取CONNACK，
+ * 每个阶段的截止时间由 RyanMqttGetNextDeadline 返回，超时后连接失败
+ *
+ * @param client
+ * @param readable
+ * @param writable
+ */
+static void RyanMqttStepConnect(RyanMqttClient_t *client, RyanMqttBool_e readable, RyanMqttBool_e writable)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttConnectStatus_e connectState = RyanMqttConnectNetWorkFail;
+	uint32_t pendingMs = 0;
+
+	if (RyanMqttStepConnectIdle == client->stepConnectState)
+	{
+		RyanMqttLog_d("开始连接");
+		result = RyanMqttConnectPacketTake(client, &client->stepConnectPacket, &client->stepConnectPacketLen,
+						   &client->stepConnectPacketVersion);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+			connectState = RyanMqttConnectFailedError;
+			goto __exit;
+		});
+
+		client->stepConnectState = RyanMqttStepConnectTransport;
+		result = RyanMqttTransportConnectStart(client, &pendingMs);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanSocketFailedError, RyanMqttLog_d,
+					  { goto __exit; });
+	}
+	else if (RyanMqttStepConnectTransport == client->stepConnectState)
+	{
+		// 连接结果在socket可写时就绪，到达截止时间时也要推进，可能需要尝试下一个地址
+		result = RyanMqttTransportConnectPoll(client, &pendingMs);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanSocketFailedError, RyanMqttLog_d,
+					  { goto __exit; });
+	}
+
+	if (RyanMqttStepConnectTransport == client->stepConnectState)
+	{
+		if (0 != pendingMs)
+		{
+			RyanMqttTimerCutdown(&client->stepConnectTimer, pendingMs);
+			return;
+		}
+
+		// 刚建立的连接发送缓冲区为空，直接开始发送
+		client->stepConnectState = RyanMqttStepConnectSend;
+		client->stepConnectOffset = 0;
+		RyanMqttTimerCutdown(&client->stepConnectTimer, client->config.sendTimeout);
+		writable = RyanMqttTrue;
+	}
+
+	if (RyanMqttStepConnectSend == client->stepConnectState)
+	{
+		if (RyanMqttTrue == writable)
+		{
+			uint32_t sendLen = 0;
+			uint32_t offset = client->stepConnectOffset;
+			result = RyanMqttSendAvailable(client, client->stepConnectPacket + offset,
+						       client->stepConnectPacketLen - offset, &sendLen);
+			RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d,
+						  { goto __exit; });
+			client->stepConnectOffset += sendLen;
+		}
+
+		if (client->stepConnectOffset < client->stepConnectPacketLen)
+		{
+			RyanMqttCheckCodeNoReturn(0 != RyanMqttTimerRemain(&client->stepConnectTimer),
+						  RyanMqttSendPacketTimeOutError, RyanMqttLog_d, {
+							  result = RyanMqttSendPacketTimeOutError;
+							  goto __exit;
+						  });
+			return;
+		}
+
+		RyanMqttRefreshKeepaliveSendTime(client);
+		client->stepConnectState = RyanMqttStepConnectConnack;
+		RyanMqttTimerCutdown(&client->stepConnectTimer, client->config.recvTimeout);
+		return;
+	}
+
+	// 等待CONNACK，报文没有全部到达时保存已经读取的部分
+	if (RyanMqttTrue == readable)
+	{
+		MQTTPacketInfo_t pIncomingPacket = {0};
+		result = RyanMqttGetPacketInfoPartial(client, &pIncomingPacket);
+		if (RyanMqttSuccessError == result)
+		{
+			result = RyanMqttConnackHandle(client, &pIncomingPacket, &connectState);
+			platformMemoryFree(pIncomingPacket.pRemainingData);
+			goto __exit;
+		}
+
+		RyanMqttCheckCodeNoReturn(RyanMqttRecvPacketTimeOutError == result, RyanMqttSerializePacketError,
+					  RyanMqttLog_d, {
+						  connectState = RyanMqttConnectInvalidPacketError;
+						  goto __exit;
+					  });
+	}
+
+	RyanMqttCheckCodeNoReturn(0 != RyanMqttTimerRemain(&client->stepConnectTimer), RyanMqttRecvPacketTimeOutError,
+				  RyanMqttLog_d, {
+					  result = RyanMqttRecvPacketTimeOutError;
+					  connectState = RyanMqttConnectInvalidPacketError;
+					  goto __exit;
+				  });
+	return;
+
+__exit:
+	RyanMqttStepConnectFinish(client, result, connectState);
+}
+
+/**
+ * @brief 单步模式下执行一次状态机，不会主动等待
+ *
+ * @param client
+ * @param readable socket可读时才读取报文
+ * @param writable socket可写时才继续连接中的发送
+ */
+void RyanMqttStepOnce(RyanMqttClient_t *client, RyanMqttBool_e readable, RyanMqttBool_e writable)
+{
+	switch (RyanMqttGetClientState(client))
+	{
+	case RyanMqttStartState:
+	case RyanMqttReconnectState: RyanMqttStepConnect(client, readable, writable); break;
+
+	case RyanMqttConnectState:
+		// socket可读说明至少有报文的一部分已经到达，每次只处理一个报文，依赖事件循环的水平触发继续读取
+		// 报文没有全部到达时保存已经读取的部分，不等待剩余部分
+		if (RyanMqttTrue == readable && RyanMqttTrue == RyanMqttRecvRingWaitSpace(client, 0))
+		{
+			RyanMqttProcessPacketHandler(client, 0);
+		}
+		RyanMqttAckListScan(client, RyanMqttTrue);
+		RyanMqttKeepalive(client);
+		RyanMqttOfflineQueueDrain(client, RyanMqttFalse);
+		RyanMqttPersistSync(client);
+		break;
+
+	case RyanMqttDisconnectState:
+		// 断开连接时已经启动重连定时器，不使能自动重连时由 RyanMqttReconnect 请求重连
+		if (RyanMqttTrue == RyanMqttReconnectIsDue(client))
+		{
+			RyanMqttEventMachine(client, RyanMqttEventReconnectBefore, NULL);
+		}
+		break;
+
+	default: break;
+	}
+}
+
+/**
+ * @brief 获取距离下一次需要执行状态机的时间，取心跳发送、心跳超时、ack超时、离线补发、重连和连接中最近的一个
+ *
+ * @param client
+ * @return uint32_t 单位ms，为0时需要立即调用 RyanMqttStep
+ */
+uint32_t RyanMqttGetNextDeadline(RyanMqttClient_t *client)
+{
+	uint32_t deadline = client->config.recvTimeout;
+
+	switch (RyanMqttGetClientState(client))
+	{
+	case RyanMqttStartState:
+	case RyanMqttReconnectState:
+		// 单步模式连接中等到当前阶段的截止时间，期间socket就绪时由事件循环提前调用
+		deadline = (RyanMqttStepConnectIdle == client->stepConnectState)
+				   ? 0
+				   : RyanMqttTimerRemain(&client->stepConnectTimer);
+		break;
+
+	case RyanMqttConnectState: {
+		// 到达心跳发送时间后发送心跳，已经发送心跳还没有收到回复时到达心跳超时后断开
+		deadline = RyanMqttKeepaliveSendRemain(client);
+		uint32_t keepaliveRemain = RyanMqttKeepaliveRemain(client);
+		if (keepaliveRemain < deadline)
+		{
+			deadline = keepaliveRemain;
+		}
+
+		// 上次没有扫描完ack链表时需要立即继续
+		uint32_t ackRemain =
+			(RyanMqttTrue == client->pendingAckFlag) ? 0 : RyanMqttTimerRemain(&client->ackExpireTimer);
+		if (ackRemain < deadline)
+		{
+			deadline = ackRemain;
+		}
+
+		// 离线队列限速补发时等到下一条消息可以发送
+		uint32_t drainRemain = RyanMqttOfflineQueueDrainRemain(client);
+		if (drainRemain < deadline)
+		{
+			deadline = drainRemain;
+		}
+		break;
+	}
+
+	case RyanMqttDisconnectState:
+		if (RyanMqttTrue == RyanMqttReconnectIsDue(client))
+		{
+			deadline = 0;
+		}
+		else if (RyanMqttTrue == client->config.autoReconnectFlag)
+		{
+			deadline = RyanMqttTimerRemain(&client->reconnectTimer);
+		}
+		break;
+
+	default: break;
+	}
+
+	return deadline;
+}
+
+/**
+ * @brief 唤醒正在等待重连或新报文的mqtt线程，让它立即处理销毁请求或按新的截止时间重新等待
+ * 截止时间提前、需要mqtt线程处理的请求都需要调用。单步模式下没有mqtt线程，直接返回
+ *
+ * @param client
+ */
+void RyanMqttThreadWakeup(RyanMqttClient_t *client)
+{
+	if (RyanMqttTrue == client->config.stepModeFlag)
+	{
+		return;
+	}
+
+	platformSemaphoreGive(client->config.userData, &client->wakeSem);
+	RyanMqttTransportWakeup(client);
+}
+
+/**
+ * @brief 连接状态下mqtt线程等待新报文的时间，等到最近的截止时间
+ * 传输层不能打断接收等待时最长为 recvTimeout，保证销毁请求能及时处理。
+ * 至少为1ms，部分平台的超时时间为0时会一直阻塞
+ *
+ * @param client
+ * @return uint32_t 单位ms
+ */
+static uint32_t RyanMqttThreadWaitTime(RyanMqttClient_t *client)
+{
+	uint32_t waitTime = RyanMqttGetNextDeadline(client);
+
+	if (RyanMqttTrue != RyanMqttTransportCanWakeup(client) && waitTime > client->config.recvTimeout)
+	{
+		waitTime = client->config.recvTimeout;
+	}
+
+	return (0 == waitTime) ? 1 : waitTime;
+}
+
+/**
+ * @brief mqtt运行线程
+ *
+ * @param argument
+ */
+void RyanMqttThread(void *argument)
+{
+	RyanMqttClient_t *client = (RyanMqttClient_t *)argument;
+	RyanMqttAssert(NULL != client); // RyanMqttStart前没有调用RyanMqttInit
+
+	while (1)
+	{
+		platformCriticalEnter(client->config.userData, &client->criticalLock);
+		RyanMqttBool_e destroyFlag = client->destroyFlag;
+		platformCriticalExit(client->config.userData, &client->criticalLock);
+
+		// 销毁客户端
+		if (RyanMqttTrue == destroyFlag)
+		{
+			RyanMqttPurgeClient(client);
 
 			// 清除掉线程动态资源
 			platformThread_t mqttThread;
@@ -524,45 +1200,40 @@ void RyanMqttThread(void *argument)
 		switch (RyanMqttGetClientState(client))
 		{
 		case RyanMqttStartState: // 开始状态状态
-		case RyanMqttReconnectState: {
-			RyanMqttLog_d("开始连接");
-			RyanMqttConnectStatus_e connectState;
-			RyanMqttError_e result = RyanMqttConnectBroker(client, &connectState);
-			if (RyanMqttSuccessError == result)
-			{
-				RyanMqttEventMachine(client, RyanMqttEventConnected, (void *)&connectState);
-			}
-			else
-			{
-				RyanMqttEventMachine(client, RyanMqttEventDisconnected, (void *)&connectState);
-			}
-		}
-		break;
+		case RyanMqttReconnectState: RyanMqttConnectOnce(client); break;
 
-		case RyanMqttConnectState: // 连接状态
+		case RyanMqttConnectState: { // 连接状态
 			RyanMqttLog_d("连接状态");
-            // 不对返回值进行处理
-			RyanMqttProcessPacketHandler(client);
+			uint32_t waitTime = RyanMqttThreadWaitTime(client);
+			uint32_t spaceWaitTime = (waitTime < client->config.recvTimeout) ? waitTime
+											  : client->config.recvTimeout;
+
+			// 拉取模式接收队列已满时不再读取socket，让tcp背压传递到broker。等待空位最长 recvTimeout
+			if (RyanMqttTrue == RyanMqttRecvRingWaitSpace(client, spaceWaitTime))
+			{
+				// 不对返回值进行处理
+				RyanMqttProcessPacketHandler(client, waitTime);
+			}
 			RyanMqttAckListScan(client, RyanMqttTrue);
 			RyanMqttKeepalive(client);
+			RyanMqttOfflineQueueDrain(client, RyanMqttFalse);
+			RyanMqttPersistSync(client);
 			break;
+		}
 
 		case RyanMqttDisconnectState: // 断开连接状态
 			RyanMqttLog_d("断开连接状态");
-			if (RyanMqttTrue != client->config.autoReconnectFlag) // 没有使能自动连接就休眠线程
+			if (RyanMqttTrue == RyanMqttReconnectIsDue(client))
 			{
-				platformThreadStop(client->config.userData, &client->mqttThread);
-
-				// 断连的时候会暂停线程，线程重新启动就是用户手动连接了
-				RyanMqttLog_d("手动重新连接\r\n");
-				RyanMqttEventMachine(client, RyanMqttEventReconnectBefore, NULL);
+				RyanMqttEventMachine(client, RyanMqttEventReconnectBefore,
+						     NULL); // 给上层触发重新连接前事件
 			}
 			else
 			{
-				RyanMqttLog_d("触发自动连接，%dms后开始连接\r\n", client->config.reconnectTimeout);
-				platformDelay(client->config.reconnectTimeout);
-				RyanMqttEventMachine(client, RyanMqttEventReconnectBefore,
-						     NULL); // 给上层触发重新连接前事件
+				// 等待重连定时器到期，RyanMqttReconnect 和 RyanMqttDestroy 会立即唤醒
+				uint32_t waitTime = RyanMqttGetNextDeadline(client);
+				RyanMqttLog_d("等待重连，最长%dms\r\n", waitTime);
+				platformSemaphoreTake(client->config.userData, &client->wakeSem, waitTime);
 			}
 			break;
 
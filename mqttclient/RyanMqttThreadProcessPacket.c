@@ -142,6 +142,50 @@ __next:
 	return result;
 }
 
+/**
+ * @brief 将publish消息分发给匹配的订阅，未设置回调函数的订阅通过 RyanMqttEventData 事件分发
+ * 使能回调工作线程时回调和消息拷贝一起放入回调队列，使能拉取模式时由调用者放入接收队列
+ *
+ * @param client
+ * @param msgData
+ * @param ackFlag qos1消息由工作线程在回调执行完成后回复PUBACK
+ * @param pRecvFlag 消息需要放入拉取模式的接收队列
+ * @return RyanMqttError_e 没有匹配的订阅、内存不足或消息被丢弃时返回失败
+ */
+static RyanMqttError_e RyanMqttPublishDispatch(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData,
+					       RyanMqttBool_e ackFlag, RyanMqttBool_e *pRecvFlag)
+{
+	RyanMqttBool_e eventFlag;
+
+	RyanMqttError_e result = RyanMqttMsgHandlerDispatch(client, msgData, &eventFlag);
+
+	// 订阅快照内存不足，qos1/qos2不回复ack，等待broker重发
+	RyanMqttCheck(RyanMqttNotEnoughMemError != result, result, RyanMqttLog_d);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+		RyanMqttLog_w("主题不匹配: %.*s", msgData->topicLen, msgData->topic);
+		RyanMqttEventMachine(client, RyanMqttEventUnsubscribedData, (void *)msgData);
+	});
+
+	// 拉取模式下消息放入接收队列，不再触发 RyanMqttEventData 事件
+	if (RyanMqttTrue == eventFlag && NULL != client->recvRing)
+	{
+		*pRecvFlag = RyanMqttTrue;
+		eventFlag = RyanMqttFalse;
+	}
+
+	if (NULL != client->dispatchPool)
+	{
+		return RyanMqttDispatchMsg(client, msgData, eventFlag, ackFlag);
+	}
+
+	if (RyanMqttTrue == eventFlag)
+	{
+		RyanMqttEventMachine(client, RyanMqttEventData, (void *)msgData);
+	}
+
+	return RyanMqttSuccessError;
+}
+
 /**
  * @brief 收到服务器发布消息处理函数
  *
@@ -154,6 +198,7 @@ static RyanMqttError_e RyanMqttPublishPacketHandler(RyanMqttClient_t *client, MQ
 	uint16_t packetId;
 	RyanMqttMsgData_t msgData;
 	RyanMqttMsgHandler_t *msgHandler;
+	RyanMqttBool_e recvFlag = RyanMqttFalse;
 
 	RyanMqttAssert(NULL != client);
 
@@ -171,23 +216,27 @@ static RyanMqttError_e RyanMqttPublishPacketHandler(RyanMqttClient_t *client, MQ
 		msgData.qos = (RyanMqttQos_e)publishInfo.qos;
 		msgData.retained = publishInfo.retain;
 		msgData.dup = publishInfo.dup;
-
-		// 查看订阅列表是否包含此消息主题,进行通配符匹配
-		RyanMqttMsgHandler_t msgMatchCriteria = {.topic = msgData.topic, .topicLen = msgData.topicLen};
-		result = RyanMqttMsgHandlerFind(client, &msgMatchCriteria, RyanMqttTrue, &msgHandler, RyanMqttFalse);
-		RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
-			RyanMqttLog_w("主题不匹配: %.*s", msgData.topicLen, msgData.topic);
-			RyanMqttEventMachine(client, RyanMqttEventUnsubscribedData, (void *)&msgData);
-		});
+		msgData.packetBuf = NULL;
 	}
 
+	// 分发时查看订阅列表是否包含此消息主题,进行通配符匹配
 	switch (msgData.qos)
 	{
-	case RyanMqttQos0: RyanMqttEventMachine(client, RyanMqttEventData, (void *)&msgData); break;
+	case RyanMqttQos0: result = RyanMqttPublishDispatch(client, &msgData, RyanMqttFalse, &recvFlag); break;
 
 	case RyanMqttQos1: {
-		// 先分发消息，再回答ack
-		RyanMqttEventMachine(client, RyanMqttEventData, (void *)&msgData);
+		// 先分发消息，再回答ack。配置为回调执行完成后回复ack时由工作线程回复
+		RyanMqttBool_e ackFlag = RyanMqttFalse;
+		if (NULL != client->dispatchPool && RyanMqttTrue == client->dispatchPool->ackAfterHandleFlag)
+		{
+			ackFlag = RyanMqttTrue;
+		}
+		result = RyanMqttPublishDispatch(client, &msgData, ackFlag, &recvFlag);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+		if (RyanMqttTrue == ackFlag)
+		{
+			break;
+		}
 
 		uint8_t buffer[MQTT_PUBLISH_ACK_PACKET_SIZE];
 		MQTTFixedBuffer_t fixedBuffer = {.pBuffer = buffer, .size = sizeof(buffer)};
@@ -220,7 +269,8 @@ static RyanMqttError_e RyanMqttPublishPacketHandler(RyanMqttClient_t *client, MQ
 		if (RyanMqttSuccessError != result)
 		{
 			// 第一次收到 PUBREL 报文
-			RyanMqttEventMachine(client, RyanMqttEventData, (void *)&msgData);
+			result = RyanMqttPublishDispatch(client, &msgData, RyanMqttFalse, &recvFlag);
+			RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
 
 			// 期望下一次收到 PUBREL 报文
 			result = RyanMqttMsgHandlerCreate(client, msgData.topic, msgData.topicLen,
@@ -250,6 +300,15 @@ static RyanMqttError_e RyanMqttPublishPacketHandler(RyanMqttClient_t *client, MQ
 	default: RyanMqttLog_w("Unhandled QoS level: %d", msgData.qos); break;
 	}
 
+	// 接收缓冲区的所有权转移给接收队列，入队后用户线程随时可能释放缓冲区，必须放在最后
+	if (RyanMqttSuccessError == result && RyanMqttTrue == recvFlag)
+	{
+		msgData.packetBuf = pIncomingPacket->pRemainingData;
+		result = RyanMqttRecvRingPush(client, &msgData);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+		pIncomingPacket->pRemainingData = NULL;
+	}
+
 	return result;
 }
 
@@ -280,7 +339,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 		uint32_t ackMsgCount = 0;
 
 		// ?使用ack或msg遍历都行，使用msg更容易测试出问题，遍历性能也会更好一些
-		platformMutexLock(client->config.userData, &client->msgHandleLock);
+		RyanMqttMsgListLock(client);
 		RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
 		{
 			msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
@@ -289,7 +348,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 				ackMsgCount++;
 			}
 		}
-		platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+		RyanMqttMsgListUnLock(client);
 
 		// 服务器回复的ack数和记录的ack数不一致就清除所有ack
 		RyanMqttCheckCode(ackMsgCount == statusCount, RyanMqttNoRescourceError, RyanMqttLog_d, {
@@ -297,7 +356,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 			RyanMqttClearAckSession(client, MQTT_PACKET_TYPE_SUBACK, packetId);
 
 			// 清除所有msg
-			platformMutexLock(client->config.userData, &client->msgHandleLock);
+			RyanMqttMsgListLock(client);
 			RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
 			{
 				msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
@@ -307,7 +366,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 					RyanMqttMsgHandlerDestroy(client, msgHandler);
 				}
 			}
-			platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+			RyanMqttMsgListUnLock(client);
 		});
 	}
 
@@ -317,8 +376,12 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 	const uint8_t *pStatusStart = &pIncomingPacket->pRemainingData[sizeof(uint16_t)];
 
 	// todo 这里效率非常低，订阅属于用的少的功能，暂时可以接受
-	// 查找ack句柄
+	// 外层持有msg链表锁，同一个suback的所有主题处理完成后只发布一次订阅快照
+	// 与 RyanMqttAckListScan 相同，先获取ack链表锁再获取msg链表锁
 	platformMutexLock(client->config.userData, &client->ackHandleLock);
+	RyanMqttMsgListLock(client);
+
+	// 查找ack句柄
 	RyanMqttListForEachSafe(curr, next, &client->ackHandlerList)
 	{
 		ackHandler = RyanMqttListEntry(curr, RyanMqttAckHandler_t, list);
@@ -335,7 +398,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 			goto __next;
 		}
 
-		platformMutexLock(client->config.userData, &client->msgHandleLock);
+		RyanMqttMsgListLock(client);
 		// 查找同名订阅但是packetid不一样的进行删除,保证订阅主题列表只有一个最新的
 		RyanMqttMsgHandlerFindAndDestroyByPacketId(client, ackHandler->msgHandler, RyanMqttTrue);
 
@@ -345,7 +408,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 		RyanMqttError_e result = RyanMqttMsgHandlerFind(client, ackHandler->msgHandler, RyanMqttFalse,
 								&msgHandler, RyanMqttFalse);
 		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
-			platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+			RyanMqttMsgListUnLock(client);
 			goto __next;
 		});
 
@@ -360,7 +423,8 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 			// 到这里说明订阅成功，更新 QoS 并清除临时 packetId
 			msgHandler->qos = subscriptionQos;
 			msgHandler->packetId = RyanMqttMsgInvalidPacketId;
-			platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+			RyanMqttMsgListMarkDirty(client);
+			RyanMqttMsgListUnLock(client);
 
 			// mqtt回调函数
 			RyanMqttEventMachine(client, RyanMqttEventSubscribed, (void *)ackHandler->msgHandler);
@@ -371,7 +435,7 @@ static RyanMqttError_e RyanMqttSubackHandler(RyanMqttClient_t *client, MQTTPacke
 			// 订阅失败，服务器拒绝；删除并通知失败
 			RyanMqttMsgHandlerRemoveToMsgList(client, msgHandler);
 			RyanMqttMsgHandlerDestroy(client, msgHandler);
-			platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+			RyanMqttMsgListUnLock(client);
 
 			// mqtt事件回调
 			RyanMqttEventMachine(client, RyanMqttEventSubscribedFailed, (void *)ackHandler->msgHandler);
@@ -382,6 +446,7 @@ __next:
 		RyanMqttAckListRemoveToAckList(client, ackHandler);
 		RyanMqttAckHandlerDestroy(client, ackHandler); // 销毁ackHandler
 	}
+	RyanMqttMsgListUnLock(client);
 	platformMutexUnLock(client->config.userData, &client->ackHandleLock);
 
 	return RyanMqttSuccessError;
@@ -408,7 +473,9 @@ static RyanMqttError_e RyanMqttUnSubackHandler(RyanMqttClient_t *client, MQTTPac
 	RyanMqttCheck(MQTTSuccess == status, RyanMqttSerializePacketError, RyanMqttLog_d);
 
 	// todo 这里效率低，取消订阅属于用的少的功能，暂时可以接受
+	// 外层持有msg链表锁，同一个unsuback的所有主题处理完成后只发布一次订阅快照，锁顺序与suback相同
 	platformMutexLock(client->config.userData, &client->ackHandleLock);
+	RyanMqttMsgListLock(client);
 	RyanMqttListForEachSafe(curr, next, &client->ackHandlerList)
 	{
 		ackHandler = RyanMqttListEntry(curr, RyanMqttAckHandler_t, list);
@@ -440,6 +507,7 @@ __next:
 		RyanMqttAckListRemoveToAckList(client, ackHandler);
 		RyanMqttAckHandlerDestroy(client, ackHandler); // 销毁ackHandler
 	}
+	RyanMqttMsgListUnLock(client);
 	platformMutexUnLock(client->config.userData, &client->ackHandleLock);
 
 	return RyanMqttSuccessError;
@@ -466,7 +534,15 @@ static void RyanMqttSyncUserAckHandle(RyanMqttClient_t *client)
 	platformMutexUnLock(client->config.userData, &client->userSessionLock);
 }
 
-RyanMqttError_e RyanMqttGetPacketInfo(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket)
+/**
+ * @brief 读取一个完整的报文
+ *
+ * @param client
+ * @param pIncomingPacket
+ * @param timeout 等待报文开始到达的最长时间，报文剩余部分按 recvTimeout 读取。单位ms
+ * @return RyanMqttError_e 没有报文到达时返回 RyanMqttRecvPacketTimeOutError
+ */
+RyanMqttError_e RyanMqttGetPacketInfo(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket, uint32_t timeout)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
 	RyanMqttAssert(NULL != client);
@@ -482,7 +558,9 @@ RyanMqttError_e RyanMqttGetPacketInfo(RyanMqttClient_t *client, MQTTPacketInfo_t
 	do
 	{
 		// 第一次直接读取 2 个字节
-		result = RyanMqttRecvPacket(client, pBuffer + readIndex, needReadSize);
+		result = RyanMqttRecvPacket(client, pBuffer + readIndex, needReadSize,
+					    0 == readIndex ? timeout : client->config.recvTimeout,
+					    0 == readIndex ? RyanMqttTrue : RyanMqttFalse);
 		if (RyanMqttRecvPacketTimeOutError == result)
 		{
 			goto __next; // 超时直接退出
@@ -548,7 +626,8 @@ RyanMqttError_e RyanMqttGetPacketInfo(RyanMqttClient_t *client, MQTTPacketInfo_t
 		if (alreadyRead < pIncomingPacket->remainingLength)
 		{
 			result = RyanMqttRecvPacket(client, pIncomingPacket->pRemainingData + alreadyRead,
-						    pIncomingPacket->remainingLength - alreadyRead);
+						    pIncomingPacket->remainingLength - alreadyRead,
+						    client->config.recvTimeout, RyanMqttFalse);
 			// 返回 result 没错
 			RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
 				platformMemoryFree(pIncomingPacket->pRemainingData);
@@ -566,20 +645,138 @@ __next:
 	return result;
 }
 
+/**
+ * @brief 单步模式下读取报文，只读取已经到达的数据，没有读完的部分保存在client中由下一次调用继续读取
+ *
+ * @param client
+ * @param pIncomingPacket
+ * @return RyanMqttError_e 报文还没有读完时返回 RyanMqttRecvPacketTimeOutError
+ */
+RyanMqttError_e RyanMqttGetPacketInfoPartial(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttAssert(NULL != client);
+	uint32_t recvLen = 0;
+	size_t readIndex = client->partialHeaderLen;
+	MQTTStatus_t status;
+
+	// 上一次已经读取的固定报头重新解析一次，没有数据时返回 MQTTNoDataAvailable
+	status = MQTT_ProcessIncomingPacketTypeAndLength(client->partialHeader, &readIndex, pIncomingPacket);
+	while (MQTTNeedMoreBytes == status || MQTTNoDataAvailable == status)
+	{
+		// 剩余长度最多 4 字节，理论上不会发生
+		if (client->partialHeaderLen >= sizeof(client->partialHeader))
+		{
+			status = MQTTBadResponse;
+			break;
+		}
+
+		// 第一次读取 2 个字节，剩余长度没有结束时最多再读取 3 个字节
+		uint8_t needReadSize = (client->partialHeaderLen < 2 ? 2 : sizeof(client->partialHeader)) -
+				       client->partialHeaderLen;
+		result = RyanMqttRecvAvailable(client, client->partialHeader + client->partialHeaderLen, needReadSize,
+					       &recvLen);
+		if (RyanSocketFailedError == result)
+		{
+			goto __next; // 连接已经关闭，没有读完的报文已经丢弃
+		}
+
+		client->partialHeaderLen += recvLen;
+		readIndex = client->partialHeaderLen;
+		status = MQTT_ProcessIncomingPacketTypeAndLength(client->partialHeader, &readIndex, pIncomingPacket);
+		if ((MQTTNeedMoreBytes == status || MQTTNoDataAvailable == status) && RyanMqttSuccessError != result)
+		{
+			goto __next; // 报头还没有到达，下一次继续读取
+		}
+	}
+
+	if (MQTTSuccess != status)
+	{
+		RyanMqttLog_e("解析固定报头失败 %d", status);
+		client->partialHeaderLen = 0;
+		result = RyanMqttDeserializePacketError;
+		goto __next;
+	}
+
+	if (pIncomingPacket->remainingLength <= 0)
+	{
+		client->partialHeaderLen = 0;
+		result = RyanMqttSuccessError;
+		goto __next; // 不包含可变长度报文
+	}
+
+	if (NULL == client->partialData)
+	{
+		// 申请 payload 的空间
+		client->partialData = platformMemoryMalloc(pIncomingPacket->remainingLength);
+		RyanMqttCheckCode(NULL != client->partialData, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+			client->partialHeaderLen = 0;
+			result = RyanMqttNotEnoughMemError;
+			goto __next;
+		});
+
+		// 如果固定报头解析时已经多读了 payload 的一部分
+		client->partialDataLen = client->partialHeaderLen - pIncomingPacket->headerLength;
+		if (client->partialDataLen > 0)
+		{
+			RyanMqttMemcpy(client->partialData, client->partialHeader + pIncomingPacket->headerLength,
+				       client->partialDataLen);
+		}
+	}
+
+	// 读取剩余 payload
+	if (client->partialDataLen < pIncomingPacket->remainingLength)
+	{
+		result = RyanMqttRecvAvailable(client, client->partialData + client->partialDataLen,
+					       pIncomingPacket->remainingLength - client->partialDataLen, &recvLen);
+		if (RyanSocketFailedError == result)
+		{
+			goto __next; // 连接已经关闭，没有读完的报文已经丢弃
+		}
+
+		client->partialDataLen += recvLen;
+		if (RyanMqttSuccessError != result)
+		{
+			goto __next; // payload 还没有全部到达，下一次继续读取
+		}
+	}
+
+	// 报文读取完成，payload 交给调用者释放
+	pIncomingPacket->pRemainingData = client->partialData;
+	client->partialData = NULL;
+	client->partialDataLen = 0;
+	client->partialHeaderLen = 0;
+	result = RyanMqttSuccessError;
+
+__next:
+	// 先同步用户接口的ack链表
+	RyanMqttSyncUserAckHandle(client);
+	return result;
+}
+
 /**
  * @brief mqtt数据包处理函数
  *
  * @param client
+ * @param timeout 等待新报文的最长时间，单步模式下不等待。单位ms
  * @return RyanMqttError_e
  */
-RyanMqttError_e RyanMqttProcessPacketHandler(RyanMqttClient_t *client)
+RyanMqttError_e RyanMqttProcessPacketHandler(RyanMqttClient_t *client, uint32_t timeout)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
 	MQTTPacketInfo_t pIncomingPacket = {0}; // 下面有非空判断
 
 	RyanMqttAssert(NULL != client);
 
-	result = RyanMqttGetPacketInfo(client, &pIncomingPacket);
+	// 单步模式不能阻塞事件循环，报文没有读完时由下一次调用继续读取
+	if (RyanMqttTrue == client->config.stepModeFlag)
+	{
+		result = RyanMqttGetPacketInfoPartial(client, &pIncomingPacket);
+	}
+	else
+	{
+		result = RyanMqttGetPacketInfo(client, &pIncomingPacket, timeout);
+	}
 	if (RyanMqttRecvPacketTimeOutError == result)
 	{
 		RyanMqttLog_d("没有待处理的数据包");
@@ -588,6 +785,9 @@ RyanMqttError_e RyanMqttProcessPacketHandler(RyanMqttClient_t *client)
 	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttSerializePacketError, RyanMqttLog_d,
 				  { goto __exit; });
 
+	// 收到任何完整的报文都说明连接正常，不只是心跳响应
+	RyanMqttRefreshKeepaliveRecvTime(client);
+
 	RyanMqttLog_d("pIncomingPacket.type: %x ", pIncomingPacket.type & 0xF0U);
 
 	// 控制报文类型
@@ -600,8 +800,7 @@ RyanMqttError_e RyanMqttProcessPacketHandler(RyanMqttClient_t *client)
 		result = RyanMqttPublishPacketHandler(client, &pIncomingPacket);
 		break;
 
-	case MQTT_PACKET_TYPE_PINGRESP: // 心跳响应
-		RyanMqttRefreshKeepaliveTime(client);
+	case MQTT_PACKET_TYPE_PINGRESP: // 心跳响应，接收时间已经在上面刷新
 		result = RyanMqttSuccessError;
 		break;
 
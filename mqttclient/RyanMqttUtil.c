@@ -38,51 +38,267 @@ RyanMqttError_e RyanMqttDupString(char **dest, const char *src, uint32_t strLen)
 	return RyanMqttSuccessError;
 }
 
+/**
+ * @brief 使用配置的传输层连接服务器，没有配置时使用平台层的网络组件
+ * 连接期间使用的传输层保存在客户端中，连接期间修改配置不影响当前连接的收发和关闭
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttTransportConnect(RyanMqttClient_t *client)
+{
+	RyanMqttAssert(NULL != client);
+	RyanMqttTransport_t *transport = client->config.transport;
+
+	client->transport = transport;
+	if (NULL == transport)
+	{
+		// socket选项在创建socket后、连接前应用
+		platformNetworkSetOption(client->config.userData, &client->network, &client->config.socketOption);
+		return platformNetworkConnect(client->config.userData, &client->network, client->config.host,
+					      client->config.port);
+	}
+
+	if (NULL != transport->setOption)
+	{
+		transport->setOption(transport->userData, &client->config.socketOption);
+	}
+
+	return transport->connect(transport->userData, client->config.host, client->config.port);
+}
+
+/**
+ * @brief 单步模式下发起非阻塞连接，传输层没有实现非阻塞连接时阻塞连接
+ *
+ * @param client
+ * @param pendingMs 连接完成时为0，否则为需要调用 RyanMqttTransportConnectPoll 的最长等待时间
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttTransportConnectStart(RyanMqttClient_t *client, uint32_t *pendingMs)
+{
+	RyanMqttAssert(NULL != client);
+	RyanMqttTransport_t *transport = client->config.transport;
+
+	*pendingMs = 0;
+	client->transport = transport;
+	if (NULL == transport)
+	{
+		platformNetworkSetOption(client->config.userData, &client->network, &client->config.socketOption);
+		return platformNetworkConnectAsync(client->config.userData, &client->network, client->config.host,
+						   client->config.port, pendingMs);
+	}
+
+	if (NULL == transport->connectStart || NULL == transport->connectPoll)
+	{
+		return RyanMqttTransportConnect(client);
+	}
+
+	if (NULL != transport->setOption)
+	{
+		transport->setOption(transport->userData, &client->config.socketOption);
+	}
+
+	return transport->connectStart(transport->userData, client->config.host, client->config.port, pendingMs);
+}
+
+/**
+ * @brief 继续进行中的非阻塞连接，不等待
+ *
+ * @param client
+ * @param pendingMs 连接完成时为0
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttTransportConnectPoll(RyanMqttClient_t *client, uint32_t *pendingMs)
+{
+	RyanMqttTransport_t *transport = client->transport;
+
+	*pendingMs = 0;
+	if (NULL == transport)
+	{
+		return platformNetworkConnectPoll(client->config.userData, &client->network, pendingMs);
+	}
+
+	if (NULL == transport->connectPoll)
+	{
+		return RyanMqttSuccessError;
+	}
+
+	return transport->connectPoll(transport->userData, pendingMs);
+}
+
+/**
+ * @brief 从当前连接的传输层读取数据
+ *
+ * @param client
+ * @param recvBuf
+ * @param recvLen
+ * @param timeout
+ * @return int32_t 读取的字节数，超时返回0，出错返回-1
+ */
+int32_t RyanMqttTransportRecv(RyanMqttClient_t *client, char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	if (NULL == client->transport)
+	{
+		return platformNetworkRecvAsync(client->config.userData, &client->network, recvBuf, recvLen, timeout);
+	}
+
+	return client->transport->recv(client->transport->userData, recvBuf, recvLen, timeout);
+}
+
+/**
+ * @brief 向当前连接的传输层发送数据
+ *
+ * @param client
+ * @param sendBuf
+ * @param sendLen
+ * @param timeout
+ * @return int32_t 发送的字节数，超时返回0，出错返回-1
+ */
+int32_t RyanMqttTransportSend(RyanMqttClient_t *client, char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	if (NULL == client->transport)
+	{
+		return platformNetworkSendAsync(client->config.userData, &client->network, sendBuf, sendLen, timeout);
+	}
+
+	return client->transport->send(client->transport->userData, sendBuf, sendLen, timeout);
+}
+
+/**
+ * @brief 关闭当前连接，没有连接时直接返回
+ *
+ * @param client
+ */
+void RyanMqttTransportClose(RyanMqttClient_t *client)
+{
+	if (NULL == client->transport)
+	{
+		platformNetworkClose(client->config.userData, &client->network);
+	}
+	else
+	{
+		client->transport->close(client->transport->userData);
+	}
+
+	// 单步模式下没有读完的报文属于这个连接，一起丢弃
+	if (NULL != client->partialData)
+	{
+		platformMemoryFree(client->partialData);
+		client->partialData = NULL;
+	}
+	client->partialDataLen = 0;
+	client->partialHeaderLen = 0;
+}
+
+/**
+ * @brief 打断mqtt线程在当前传输层上的接收等待，传输层不支持时直接返回
+ *
+ * @param client
+ */
+void RyanMqttTransportWakeup(RyanMqttClient_t *client)
+{
+	RyanMqttTransport_t *transport = client->transport;
+
+	if (NULL == transport)
+	{
+		platformNetworkWakeup(client->config.userData, &client->network);
+	}
+	else if (NULL != transport->wakeup)
+	{
+		transport->wakeup(transport->userData);
+	}
+}
+
+/**
+ * @brief 当前传输层的接收等待能否被 RyanMqttTransportWakeup 打断
+ *
+ * @param client
+ * @return RyanMqttBool_e
+ */
+RyanMqttBool_e RyanMqttTransportCanWakeup(RyanMqttClient_t *client)
+{
+	if (NULL == client->transport)
+	{
+#if platformNetworkWakeupEnable
+		return RyanMqttTrue;
+#else
+		return RyanMqttFalse;
+#endif
+	}
+
+	return (NULL != client->transport->wakeup) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 获取当前连接的描述符
+ *
+ * @param client
+ * @return int32_t 没有连接或传输层没有描述符时返回-1
+ */
+int32_t RyanMqttTransportGetFd(RyanMqttClient_t *client)
+{
+	if (NULL == client->transport)
+	{
+		return platformNetworkGetFd(client->config.userData, &client->network);
+	}
+
+	if (NULL == client->transport->getFd)
+	{
+		return -1;
+	}
+
+	return client->transport->getFd(client->transport->userData);
+}
+
 /**
  * @brief mqtt读取报文,此函数仅Mqtt线程进行调用
  *
  * @param client
  * @param buf
  * @param length
+ * @param timeout 等待数据的最长时间。单位ms
+ * @param startFlag 是否在等待新报文开始到达。是时收到部分数据后剩余部分按 recvTimeout 读取，
+ * 被唤醒或没有数据到达时立即返回超时，由mqtt线程重新计算截止时间
  * @return RyanMqttError_e
  */
-RyanMqttError_e RyanMqttRecvPacket(RyanMqttClient_t *client, uint8_t *recvBuf, uint32_t recvLen)
+RyanMqttError_e RyanMqttRecvPacket(RyanMqttClient_t *client, uint8_t *recvBuf, uint32_t recvLen, uint32_t timeout,
+				   RyanMqttBool_e startFlag)
 {
 	uint32_t offset = 0;
 	int32_t recvResult = 0;
-	uint32_t timeOut = client->config.recvTimeout;
+	uint32_t timeOut = timeout;
 	RyanMqttTimer_t timer;
 	RyanMqttAssert(NULL != client);
 	RyanMqttAssert(NULL != recvBuf);
 	RyanMqttAssert(0 != recvLen);
 
-	// 如果需要处理ack，就缩短读取超时时间，避免阻塞太久（保留用户配置的上限）
-	if (RyanMqttTrue == client->pendingAckFlag)
-	{
-		if (client->config.recvTimeout > 100)
-		{
-			timeOut = 100;
-		}
-		else
-		{
-			timeOut = client->config.recvTimeout;
-		}
-	}
-
+	RyanMqttBool_e extendFlag = startFlag;
 	RyanMqttTimerCutdown(&timer, timeOut);
 
 	while ((offset < recvLen) && (timeOut > 0))
 	{
-		recvResult =
-			platformNetworkRecvAsync(client->config.userData, &client->network, (char *)(recvBuf + offset),
-						 (size_t)(recvLen - offset), (int32_t)timeOut);
+		recvResult = RyanMqttTransportRecv(client, (char *)(recvBuf + offset), (size_t)(recvLen - offset),
+						   (int32_t)timeOut);
 
 		if (recvResult < 0)
 		{
 			break;
 		}
 
+		// 等待报文开始时被唤醒
+		if (RyanMqttTrue == extendFlag && 0 == recvResult)
+		{
+			break;
+		}
+
 		offset += recvResult;
+
+		// 报文已经开始到达，剩余部分按 recvTimeout 读完，不会只读到半个报文，也不会在半个报文上一直等待
+		if (RyanMqttTrue == extendFlag)
+		{
+			RyanMqttTimerCutdown(&timer, client->config.recvTimeout);
+			extendFlag = RyanMqttFalse;
+		}
 		timeOut = RyanMqttTimerRemain(&timer);
 	}
 
@@ -122,6 +338,91 @@ RyanMqttError_e RyanMqttRecvPacket(RyanMqttClient_t *client, uint8_t *recvBuf, u
 	return RyanMqttSuccessError;
 }
 
+/**
+ * @brief 只发送socket缓冲区能立即接收的数据，不等待，单步模式连接时使用
+ *
+ * @param client
+ * @param sendBuf
+ * @param sendLen
+ * @param pSendLen 本次发送的字节数
+ * @return RyanMqttError_e 连接出错时返回 RyanSocketFailedError
+ */
+RyanMqttError_e RyanMqttSendAvailable(RyanMqttClient_t *client, uint8_t *sendBuf, uint32_t sendLen,
+				      uint32_t *pSendLen)
+{
+	uint32_t offset = 0;
+	int32_t sendResult = 0;
+	RyanMqttAssert(NULL != client);
+	RyanMqttAssert(NULL != sendBuf);
+	RyanMqttAssert(NULL != pSendLen);
+
+	platformMutexLock(client->config.userData, &client->sendLock);
+	while (offset < sendLen)
+	{
+		// 超时时间为0时部分传输层会一直阻塞，使用最短的1ms
+		sendResult = RyanMqttTransportSend(client, (char *)(sendBuf + offset), (size_t)(sendLen - offset), 1);
+		if (sendResult <= 0)
+		{
+			break;
+		}
+
+		offset += sendResult;
+	}
+	platformMutexUnLock(client->config.userData, &client->sendLock);
+
+	*pSendLen = offset;
+	return (sendResult < 0) ? RyanSocketFailedError : RyanMqttSuccessError;
+}
+
+/**
+ * @brief 只读取已经到达的数据，不等待报文剩余部分,此函数仅Mqtt线程进行调用
+ *
+ * @param client
+ * @param recvBuf
+ * @param recvLen
+ * @param pRecvLen 本次读取到的字节数
+ * @return RyanMqttError_e 没有读满 recvLen 时返回 RyanMqttRecvPacketTimeOutError
+ */
+RyanMqttError_e RyanMqttRecvAvailable(RyanMqttClient_t *client, uint8_t *recvBuf, uint32_t recvLen,
+				      uint32_t *pRecvLen)
+{
+	uint32_t offset = 0;
+	int32_t recvResult = 0;
+	RyanMqttAssert(NULL != client);
+	RyanMqttAssert(NULL != recvBuf);
+	RyanMqttAssert(NULL != pRecvLen);
+
+	while (offset < recvLen)
+	{
+		// 超时时间为0时部分传输层会一直阻塞，使用最短的1ms
+		recvResult = RyanMqttTransportRecv(client, (char *)(recvBuf + offset), (size_t)(recvLen - offset), 1);
+		if (recvResult <= 0)
+		{
+			break;
+		}
+
+		offset += recvResult;
+	}
+
+	*pRecvLen = offset;
+
+	// 错误
+	if (recvResult < 0)
+	{
+		RyanMqttConnectStatus_e connectState = RyanMqttConnectNetWorkFail;
+		RyanMqttEventMachine(client, RyanMqttEventDisconnected, &connectState);
+		RyanMqttLog_d("recv错误, result: %d", recvResult);
+		return RyanSocketFailedError;
+	}
+
+	if (offset != recvLen)
+	{
+		return RyanMqttRecvPacketTimeOutError;
+	}
+
+	return RyanMqttSuccessError;
+}
+
 /**
  * @brief mqtt发送报文
  *
@@ -162,9 +463,8 @@ RyanMqttError_e RyanMqttSendPacket(RyanMqttClient_t *client, uint8_t *sendBuf, u
 	platformMutexLock(client->config.userData, &client->sendLock); // 获取互斥锁
 	while ((offset < sendLen) && (timeOut > 0))
 	{
-		sendResult =
-			platformNetworkSendAsync(client->config.userData, &client->network, (char *)(sendBuf + offset),
-						 (size_t)(sendLen - offset), (int32_t)timeOut);
+		sendResult = RyanMqttTransportSend(client, (char *)(sendBuf + offset), (size_t)(sendLen - offset),
+						   (int32_t)timeOut);
 		if (-1 == sendResult)
 		{
 			break;
@@ -188,8 +488,8 @@ RyanMqttError_e RyanMqttSendPacket(RyanMqttClient_t *client, uint8_t *sendBuf, u
 		return RyanMqttSendPacketTimeOutError;
 	}
 
-	// 发送数据成功就刷新 keepalive 时间
-	RyanMqttRefreshKeepaliveTime(client);
+	// 发送数据成功就刷新 keepalive 发送时间
+	RyanMqttRefreshKeepaliveSendTime(client);
 	return RyanMqttSuccessError;
 }
 
@@ -203,9 +503,13 @@ void RyanMqttSetClientState(RyanMqttClient_t *client, RyanMqttState_e state)
 {
 	RyanMqttAssert(NULL != client);
 
+#if RyanMqttAtomicEnable
+	atomic_store_explicit(&client->clientState, state, memory_order_release);
+#else
 	platformCriticalEnter(client->config.userData, &client->criticalLock);
 	client->clientState = state;
 	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
 }
 
 /**
@@ -217,10 +521,34 @@ void RyanMqttSetClientState(RyanMqttClient_t *client, RyanMqttState_e state)
 RyanMqttState_e RyanMqttGetClientState(RyanMqttClient_t *client)
 {
 	RyanMqttAssert(NULL != client);
+#if RyanMqttAtomicEnable
+	return atomic_load_explicit(&client->clientState, memory_order_acquire);
+#else
 	platformCriticalEnter(client->config.userData, &client->criticalLock);
 	RyanMqttState_e state = client->clientState;
 	platformCriticalExit(client->config.userData, &client->criticalLock);
 	return state;
+#endif
+}
+
+/**
+ * @brief 获取已注册的事件标志位
+ * 标志位之间相互独立，不需要和其他数据同步，原子操作使用relaxed内存序
+ *
+ * @param client
+ * @return uint32_t
+ */
+uint32_t RyanMqttGetEventFlag(RyanMqttClient_t *client)
+{
+	RyanMqttAssert(NULL != client);
+#if RyanMqttAtomicEnable
+	return atomic_load_explicit(&client->eventFlag, memory_order_relaxed);
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	uint32_t eventFlag = client->eventFlag;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+	return eventFlag;
+#endif
 }
 
 /**
@@ -234,7 +562,7 @@ void RyanMqttPurgeSession(RyanMqttClient_t *client)
 	RyanMqttAssert(NULL != client);
 
 	// 释放所有msg_handler_list内存
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListLock(client);
 	RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
 	{
 		RyanMqttMsgHandler_t *msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
@@ -242,7 +570,7 @@ void RyanMqttPurgeSession(RyanMqttClient_t *client)
 		RyanMqttMsgHandlerDestroy(client, msgHandler);
 	}
 	RyanMqttListDelInit(&client->msgHandlerList);
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListUnLock(client);
 
 	// 释放所有ackHandler_list内存
 	platformMutexLock(client->config.userData, &client->ackHandleLock);
@@ -298,6 +626,24 @@ void RyanMqttPurgeConfig(RyanMqttClientConfig_t *clientConfig)
 	}
 }
 
+/**
+ * @brief 释放缓存的connect报文，修改配置或遗嘱后调用，下次连接时重新序列化
+ *
+ * @param client
+ */
+void RyanMqttConnectPacketInvalidate(RyanMqttClient_t *client)
+{
+	platformMutexLock(client->config.userData, &client->userSessionLock);
+	if (NULL != client->connectPacket)
+	{
+		platformMemoryFree(client->connectPacket);
+		client->connectPacket = NULL;
+		client->connectPacketLen = 0;
+	}
+	client->connectPacketVersion++;
+	platformMutexUnLock(client->config.userData, &client->userSessionLock);
+}
+
 /**
  * @brief 初始化计时器
  *
@@ -339,7 +685,19 @@ uint32_t RyanMqttTimerGetConfigTimeout(RyanMqttTimer_t *platformTimer)
  */
 uint32_t RyanMqttTimerRemain(RyanMqttTimer_t *platformTimer)
 {
-	uint32_t elapsed = platformUptimeMs() - platformTimer->time; // 计算内部自动绕回
+	return RyanMqttTimerRemainAt(platformTimer, platformUptimeMs());
+}
+
+/**
+ * @brief 以调用者读取的时间计算time还有多长时间超时，批量检查定时器时只需要读取一次时间
+ *
+ * @param platformTimer
+ * @param now platformUptimeMs 的返回值
+ * @return uint32_t 返回剩余时间，超时返回0
+ */
+uint32_t RyanMqttTimerRemainAt(RyanMqttTimer_t *platformTimer, uint32_t now)
+{
+	uint32_t elapsed = now - platformTimer->time; // 计算内部自动绕回
 
 	// 如果已过超时时间，返回 0
 	if (elapsed >= platformTimer->timeOut)
@@ -5,6 +5,24 @@
 #include "RyanMqttLog.h"
 #include "RyanMqttThread.h"
 
+/**
+ * @brief 是否是需要持久化的ack类型，只持久化qos1/qos2的发布会话，订阅和取消订阅重启后没有意义
+ *
+ * @param packetType
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttAckHandlerIsPersist(uint8_t packetType)
+{
+	switch (packetType)
+	{
+	case MQTT_PACKET_TYPE_PUBACK:
+	case MQTT_PACKET_TYPE_PUBREC:
+	case MQTT_PACKET_TYPE_PUBREL:
+	case MQTT_PACKET_TYPE_PUBCOMP: return RyanMqttTrue;
+	default: return RyanMqttFalse;
+	}
+}
+
 /**
  * @brief 创建ack句柄
  *
@@ -19,7 +37,7 @@
  * @return RyanMqttError_e
  */
 RyanMqttError_e RyanMqttAckHandlerCreate(RyanMqttClient_t *client, uint8_t packetType, uint16_t packetId,
-					 uint16_t packetLen, uint8_t *packet, RyanMqttMsgHandler_t *msgHandler,
+					 uint32_t packetLen, uint8_t *packet, RyanMqttMsgHandler_t *msgHandler,
 					 RyanMqttAckHandler_t **pAckHandler, RyanMqttBool_e packetAllocatedExternally)
 {
 	RyanMqttAssert(NULL != client);
@@ -64,6 +82,20 @@ RyanMqttError_e RyanMqttAckHandlerCreate(RyanMqttClient_t *client, uint8_t packe
 		ackHandler->packet = packet;
 	}
 
+	if (NULL != client->persist && RyanMqttTrue == RyanMqttAckHandlerIsPersist(packetType))
+	{
+		RyanMqttPersistRecord_t record = {.topic = msgHandler->topic,
+						  .packet = ackHandler->packet,
+						  .packetLen = packetLen,
+						  .packetId = packetId,
+						  .topicLen = msgHandler->topicLen,
+						  .packetType = packetType,
+						  .qos = (uint8_t)msgHandler->qos};
+		RyanMqttError_e result = client->persist->put(client->persist->userData, &record);
+		RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d,
+				  { platformMemoryFree(ackHandler); });
+	}
+
 	*pAckHandler = ackHandler;
 
 	return RyanMqttSuccessError;
@@ -81,6 +113,18 @@ void RyanMqttAckHandlerDestroy(RyanMqttClient_t *client, RyanMqttAckHandler_t *a
 	RyanMqttAssert(NULL != ackHandler);
 	RyanMqttAssert(NULL != ackHandler->msgHandler);
 
+	if (NULL != client->persist && RyanMqttTrue == RyanMqttAckHandlerIsPersist(ackHandler->packetType))
+	{
+		RyanMqttError_e result =
+			client->persist->del(client->persist->userData, ackHandler->packetType, ackHandler->packetId);
+		if (RyanMqttSuccessError != result)
+		{
+			// 报文流程已经结束，重启后重新加载的记录按mqtt协议作为重复报文处理
+			RyanMqttLog_w("删除持久化记录失败 packetType: %d, packetId: %d, result: %d",
+				      ackHandler->packetType, ackHandler->packetId, result);
+		}
+	}
+
 	RyanMqttMsgHandlerDestroy(client, ackHandler->msgHandler); // 释放msgHandler
 
 	// 释放用户预提供的缓冲区
@@ -155,6 +199,13 @@ RyanMqttError_e RyanMqttAckListAddToAckList(RyanMqttClient_t *client, RyanMqttAc
 	// 将ack节点添加到链表尾部
 	RyanMqttListAddTail(&ackHandler->list, &client->ackHandlerList);
 	client->ackHandlerCount++;
+
+	// 新ack比下一次扫描更早超时时，提前扫描时间
+	uint32_t ackRemain = RyanMqttTimerRemain(&ackHandler->timer);
+	if (ackRemain < RyanMqttTimerRemain(&client->ackExpireTimer))
+	{
+		RyanMqttTimerCutdown(&client->ackExpireTimer, ackRemain);
+	}
 	tmpAckHandlerCount = client->ackHandlerCount;
 	platformMutexUnLock(client->config.userData, &client->ackHandleLock);
 
@@ -239,10 +290,19 @@ RyanMqttError_e RyanMqttAckListAddToUserAckList(RyanMqttClient_t *client, RyanMq
 	RyanMqttAssert(NULL != client);
 	RyanMqttAssert(NULL != ackHandler);
 
+	RyanMqttBool_e wakeupFlag;
+
 	platformMutexLock(client->config.userData, &client->userSessionLock);
+	wakeupFlag = RyanMqttListIsEmpty(&client->userAckHandlerList) ? RyanMqttTrue : RyanMqttFalse;
 	RyanMqttListAddTail(&ackHandler->list, &client->userAckHandlerList); // 将ack节点添加到链表尾部
 	platformMutexUnLock(client->config.userData, &client->userSessionLock);
 
+	// mqtt线程可能正按更晚的截止时间等待报文，唤醒它同步ack链表。链表非空时前一次添加已经唤醒过
+	if (RyanMqttTrue == wakeupFlag)
+	{
+		RyanMqttThreadWakeup(client);
+	}
+
 	return RyanMqttSuccessError;
 }
 
@@ -284,3 +344,65 @@ void RyanMqttClearAckSession(RyanMqttClient_t *client, uint8_t packetType, uint1
 		break;
 	} while (1);
 }
+
+/**
+ * @brief 把一条持久化记录恢复为ack句柄
+ *
+ * @param ctx
+ * @param record
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttAckListRestoreHandle(void *ctx, const RyanMqttPersistRecord_t *record)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = (RyanMqttClient_t *)ctx;
+	RyanMqttMsgHandler_t *msgHandler;
+	RyanMqttAckHandler_t *ackHandler;
+
+	RyanMqttCheck(RyanMqttTrue == RyanMqttAckHandlerIsPersist(record->packetType), RyanMqttParamInvalidError,
+		      RyanMqttLog_e);
+
+	result = RyanMqttMsgHandlerCreate(client, record->topic, record->topicLen, RyanMqttMsgInvalidPacketId,
+					  (RyanMqttQos_e)record->qos, NULL, &msgHandler);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	result = RyanMqttAckHandlerCreate(client, record->packetType, record->packetId, record->packetLen,
+					  (uint8_t *)record->packet, msgHandler, &ackHandler, RyanMqttFalse);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d,
+			  { RyanMqttMsgHandlerDestroy(client, msgHandler); });
+
+	// 立即超时，连接成功后马上重发
+	RyanMqttTimerCutdown(&ackHandler->timer, 0);
+	RyanMqttAckListAddToAckList(client, ackHandler);
+
+	// 客户端发起的会话从最大的packetId继续分配，避免和未完成的会话冲突
+	if (MQTT_PACKET_TYPE_PUBREL != record->packetType && record->packetId > client->packetId)
+	{
+		client->packetId = record->packetId;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 从持久化后端恢复上次未完成的qos1/qos2会话，在 RyanMqttStart 中mqtt线程启动前调用
+ * 恢复完成后才使能持久化，避免恢复过程重复写入
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttAckListRestore(RyanMqttClient_t *client)
+{
+	RyanMqttPersist_t *persist = client->config.persist;
+
+	if (NULL == persist || RyanMqttTrue == client->config.cleanSessionFlag)
+	{
+		return RyanMqttSuccessError;
+	}
+
+	RyanMqttError_e result = persist->load(persist->userData, RyanMqttAckListRestoreHandle, client);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, { RyanMqttPurgeSession(client); });
+
+	client->persist = persist;
+	return RyanMqttSuccessError;
+}
@@ -0,0 +1,1021 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttUtil.h"
+#include "RyanMqttLog.h"
+#include "RyanMqttThread.h"
+
+// 工作线程和阻塞的mqtt线程等待信号量的超时时间，超时后检查退出标志，单位ms
+#define RyanMqttDispatchWaitTimeout (1000U)
+
+// 收集订阅回调数组的初始容量
+#define RyanMqttDispatchCollectInitCapacity (4U)
+
+/**
+ * @brief 判断事件是否需要回调用户
+ *
+ * @param client
+ * @param eventId
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttDispatchEventIsEnable(RyanMqttClient_t *client, uint32_t eventId)
+{
+	if (NULL == client->config.mqttEventHandle)
+	{
+		return RyanMqttFalse;
+	}
+
+	return (RyanMqttGetEventFlag(client) & eventId) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 拷贝msg句柄和主题到buf，拷贝中的链表节点和预编译层级不可用
+ *
+ * @param buf
+ * @param msgHandler
+ * @return RyanMqttMsgHandler_t*
+ */
+static RyanMqttMsgHandler_t *RyanMqttDispatchCopyMsgHandler(uint8_t *buf, const RyanMqttMsgHandler_t *msgHandler)
+{
+	RyanMqttMsgHandler_t *msgHandlerCopy = (RyanMqttMsgHandler_t *)buf;
+	char *topic = (char *)(msgHandlerCopy + 1);
+
+	RyanMqttMemcpy(msgHandlerCopy, msgHandler, sizeof(RyanMqttMsgHandler_t));
+	RyanMqttListInit(&msgHandlerCopy->list);
+	RyanMqttListInit(&msgHandlerCopy->hashList);
+	msgHandlerCopy->topicLevels = NULL;
+	msgHandlerCopy->topicLevelCount = 0;
+
+	RyanMqttMemcpy(topic, msgHandler->topic, msgHandler->topicLen);
+	topic[msgHandler->topicLen] = '\0';
+	msgHandlerCopy->topic = topic;
+
+	return msgHandlerCopy;
+}
+
+/**
+ * @brief 创建消息节点，订阅回调、主题和payload跟随节点一起申请
+ *
+ * @param msgData
+ * @param handles
+ * @param handleCount
+ * @return RyanMqttDispatchItem_t* 内存不足时返回NULL
+ */
+static RyanMqttDispatchItem_t *RyanMqttDispatchMsgItemCreate(RyanMqttMsgData_t *msgData,
+							     RyanMqttDispatchHandle_t *handles, uint16_t handleCount)
+{
+	RyanMqttDispatchItem_t *item;
+	char *buf;
+
+	item = (RyanMqttDispatchItem_t *)platformMemoryMalloc(sizeof(RyanMqttDispatchItem_t) +
+							      sizeof(RyanMqttDispatchHandle_t) * handleCount +
+							      msgData->topicLen + 1U + msgData->payloadLen + 1U);
+	if (NULL == item)
+	{
+		return NULL;
+	}
+	RyanMqttMemset(item, 0, sizeof(RyanMqttDispatchItem_t));
+
+	item->handles = (RyanMqttDispatchHandle_t *)(item + 1);
+	item->handleCount = handleCount;
+	if (0 != handleCount)
+	{
+		RyanMqttMemcpy(item->handles, handles, sizeof(RyanMqttDispatchHandle_t) * handleCount);
+	}
+
+	// 主题和payload都补充结束符，方便用户按字符串使用
+	buf = (char *)(item->handles + handleCount);
+	RyanMqttMemcpy(&item->msgData, msgData, sizeof(RyanMqttMsgData_t));
+	item->msgData.topic = buf;
+	RyanMqttMemcpy(buf, msgData->topic, msgData->topicLen);
+	buf[msgData->topicLen] = '\0';
+	buf += msgData->topicLen + 1U;
+
+	item->msgData.payload = buf;
+	if (0 != msgData->payloadLen)
+	{
+		RyanMqttMemcpy(buf, msgData->payload, msgData->payloadLen);
+	}
+	buf[msgData->payloadLen] = '\0';
+
+	item->eventData = &item->msgData;
+	item->isMsg = RyanMqttTrue;
+	return item;
+}
+
+/**
+ * @brief 选择节点进入的队列
+ * 保序模式下消息按key分片到固定队列，同一key的消息只会被同一个工作线程按顺序执行。
+ * 其余事件统一进入第一个队列，保持事件之间的顺序
+ *
+ * @param client
+ * @param item
+ * @return RyanMqttDispatchQueue_t*
+ */
+static RyanMqttDispatchQueue_t *RyanMqttDispatchSelectQueue(RyanMqttClient_t *client, RyanMqttDispatchItem_t *item)
+{
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	uint32_t key;
+
+	if (1 == pool->queueCount || RyanMqttTrue != item->isMsg)
+	{
+		return &pool->queues[0];
+	}
+
+	if (NULL != pool->keyHandle)
+	{
+		key = pool->keyHandle(client, &item->msgData);
+	}
+	else
+	{
+		key = RyanMqttTopicHash(item->msgData.topic, item->msgData.topicLen);
+	}
+
+	return &pool->queues[key % pool->queueCount];
+}
+
+/**
+ * @brief 保序模式下将消息节点写入环形队列尾部，只能在mqtt线程中调用
+ *
+ * @param pool
+ * @param queue
+ * @param item
+ * @return RyanMqttBool_e 队列已满时返回 RyanMqttFalse
+ */
+static RyanMqttBool_e RyanMqttDispatchRingPush(RyanMqttDispatchPool_t *pool, RyanMqttDispatchQueue_t *queue,
+					       RyanMqttDispatchItem_t *item)
+{
+#if RyanMqttAtomicEnable
+	uint32_t tail = atomic_load_explicit(&queue->ringTail, memory_order_relaxed);
+
+	if (tail - atomic_load_explicit(&queue->ringHead, memory_order_acquire) >= pool->queueSize)
+	{
+		return RyanMqttFalse;
+	}
+
+	atomic_store_explicit(&queue->ring[tail % pool->queueSize], item, memory_order_relaxed);
+	atomic_store_explicit(&queue->ringTail, tail + 1U, memory_order_release);
+	return RyanMqttTrue;
+#else
+	RyanMqttBool_e pushFlag = RyanMqttFalse;
+
+	platformCriticalEnter(pool->userData, &queue->lock);
+	if (queue->ringTail - queue->ringHead < pool->queueSize)
+	{
+		queue->ring[queue->ringTail % pool->queueSize] = item;
+		queue->ringTail++;
+		pushFlag = RyanMqttTrue;
+	}
+	platformCriticalExit(pool->userData, &queue->lock);
+	return pushFlag;
+#endif
+}
+
+/**
+ * @brief 从环形队列头部取出最旧的消息节点
+ * 工作线程取消息和mqtt线程按 DropOldest 丢弃都从头部取出，通过CAS推进读位置，同一个节点只会被一方取到
+ *
+ * @param pool
+ * @param queue
+ * @return RyanMqttDispatchItem_t* 队列为空时返回NULL
+ */
+static RyanMqttDispatchItem_t *RyanMqttDispatchRingPop(RyanMqttDispatchPool_t *pool, RyanMqttDispatchQueue_t *queue)
+{
+#if RyanMqttAtomicEnable
+	uint32_t head = atomic_load_explicit(&queue->ringHead, memory_order_relaxed);
+
+	// 槽位要等读位置越过后才会被mqtt线程覆盖，CAS成功说明读到的就是该位置的节点
+	while (head != atomic_load_explicit(&queue->ringTail, memory_order_acquire))
+	{
+		RyanMqttDispatchItem_t *item =
+			atomic_load_explicit(&queue->ring[head % pool->queueSize], memory_order_relaxed);
+		if (atomic_compare_exchange_weak_explicit(&queue->ringHead, &head, head + 1U, memory_order_seq_cst,
+							  memory_order_relaxed))
+		{
+			return item;
+		}
+	}
+
+	return NULL;
+#else
+	RyanMqttDispatchItem_t *item = NULL;
+
+	platformCriticalEnter(pool->userData, &queue->lock);
+	if (queue->ringHead != queue->ringTail)
+	{
+		item = queue->ring[queue->ringHead % pool->queueSize];
+		queue->ringHead++;
+	}
+	platformCriticalExit(pool->userData, &queue->lock);
+	return item;
+#endif
+}
+
+/**
+ * @brief 工作线程从环形队列取走消息后检查mqtt线程是否在等待空位，并清除等待标志
+ *
+ * @param pool
+ * @param queue
+ * @return RyanMqttBool_e 需要唤醒mqtt线程时返回 RyanMqttTrue
+ */
+static RyanMqttBool_e RyanMqttDispatchRingTakeSpaceWait(RyanMqttDispatchPool_t *pool, RyanMqttDispatchQueue_t *queue)
+{
+#if RyanMqttAtomicEnable
+	if (RyanMqttTrue != atomic_load_explicit(&queue->spaceWaitFlag, memory_order_seq_cst))
+	{
+		return RyanMqttFalse;
+	}
+
+	return atomic_exchange_explicit(&queue->spaceWaitFlag, RyanMqttFalse, memory_order_seq_cst);
+#else
+	RyanMqttBool_e spaceWaitFlag;
+
+	platformCriticalEnter(pool->userData, &queue->lock);
+	spaceWaitFlag = queue->spaceWaitFlag;
+	queue->spaceWaitFlag = RyanMqttFalse;
+	platformCriticalExit(pool->userData, &queue->lock);
+	return spaceWaitFlag;
+#endif
+}
+
+/**
+ * @brief 保序模式下将消息节点放入环形队列，只能在mqtt线程中调用。
+ * 线程池只会在mqtt线程中销毁，写入环形队列时不需要检查退出标志
+ *
+ * @param client
+ * @param queue
+ * @param item
+ * @return RyanMqttError_e 按溢出策略丢弃时返回 RyanMqttNoRescourceError
+ */
+static RyanMqttError_e RyanMqttDispatchRingPushMsg(RyanMqttClient_t *client, RyanMqttDispatchQueue_t *queue,
+						   RyanMqttDispatchItem_t *item)
+{
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	RyanMqttDispatchItem_t *dropItem;
+	RyanMqttBool_e fullFlag;
+
+	while (RyanMqttTrue != RyanMqttDispatchRingPush(pool, queue, item))
+	{
+		if (RyanMqttDispatchOverflowDropOldest == pool->overflowPolicy)
+		{
+			// 工作线程可能刚好取走了最旧的消息，取不到时队列已有空位，直接重试
+			dropItem = RyanMqttDispatchRingPop(pool, queue);
+			if (NULL != dropItem)
+			{
+				platformCriticalEnter(pool->userData, &queue->lock);
+				queue->dropCount++;
+				platformCriticalExit(pool->userData, &queue->lock);
+
+				RyanMqttLog_w("回调队列已满，丢弃最旧的消息 topic: %s", dropItem->msgData.topic);
+				platformMemoryFree(dropItem);
+			}
+			continue;
+		}
+
+		// 客户端正在销毁时不再阻塞
+		if (RyanMqttDispatchOverflowDropNewest == pool->overflowPolicy || RyanMqttTrue == client->destroyFlag)
+		{
+			platformCriticalEnter(pool->userData, &queue->lock);
+			queue->dropCount++;
+			platformCriticalExit(pool->userData, &queue->lock);
+			return RyanMqttNoRescourceError;
+		}
+
+		// 先置等待标志再检查队列，工作线程先取走消息再检查标志，二者至少有一方能看到对方的修改
+#if RyanMqttAtomicEnable
+		atomic_store_explicit(&queue->spaceWaitFlag, RyanMqttTrue, memory_order_seq_cst);
+		fullFlag = (atomic_load_explicit(&queue->ringTail, memory_order_relaxed) -
+				    atomic_load_explicit(&queue->ringHead, memory_order_seq_cst) >=
+			    pool->queueSize)
+				   ? RyanMqttTrue
+				   : RyanMqttFalse;
+#else
+		platformCriticalEnter(pool->userData, &queue->lock);
+		queue->spaceWaitFlag = RyanMqttTrue;
+		fullFlag = (queue->ringTail - queue->ringHead >= pool->queueSize) ? RyanMqttTrue : RyanMqttFalse;
+		platformCriticalExit(pool->userData, &queue->lock);
+#endif
+
+		// 阻塞等待工作线程取走消息
+		if (RyanMqttTrue == fullFlag)
+		{
+			platformSemaphoreTake(pool->userData, &queue->spaceSem, RyanMqttDispatchWaitTimeout);
+		}
+	}
+
+	platformSemaphoreGive(pool->userData, &queue->itemSem);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 将节点放入回调队列尾部
+ * 只有消息节点受队列长度限制，事件可能在持有ack链表锁时触发，不能阻塞
+ *
+ * @param client
+ * @param item
+ * @return RyanMqttError_e 按溢出策略丢弃时返回 RyanMqttNoRescourceError，线程池正在销毁时返回 RyanMqttFailedError
+ */
+static RyanMqttError_e RyanMqttDispatchQueuePush(RyanMqttClient_t *client, RyanMqttDispatchItem_t *item)
+{
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	RyanMqttDispatchQueue_t *queue = RyanMqttDispatchSelectQueue(client, item);
+	RyanMqttDispatchItem_t *dropItem = NULL;
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	if (NULL != queue->ring && RyanMqttTrue == item->isMsg)
+	{
+		return RyanMqttDispatchRingPushMsg(client, queue, item);
+	}
+
+	platformCriticalEnter(pool->userData, &queue->lock);
+	while (RyanMqttTrue == item->isMsg && queue->msgCount >= pool->queueSize && RyanMqttTrue != queue->exitFlag)
+	{
+		if (RyanMqttDispatchOverflowDropOldest == pool->overflowPolicy)
+		{
+			RyanMqttList_t *curr;
+			RyanMqttListForEach(curr, &queue->itemList)
+			{
+				dropItem = RyanMqttListEntry(curr, RyanMqttDispatchItem_t, list);
+				if (RyanMqttTrue == dropItem->isMsg)
+				{
+					break;
+				}
+			}
+
+			RyanMqttListDel(&dropItem->list);
+			queue->msgCount--;
+			queue->dropCount++;
+			break;
+		}
+
+		// 客户端正在销毁时不再阻塞
+		if (RyanMqttDispatchOverflowDropNewest == pool->overflowPolicy || RyanMqttTrue == client->destroyFlag)
+		{
+			result = RyanMqttNoRescourceError;
+			break;
+		}
+
+		// 阻塞等待工作线程取走消息
+		queue->spaceWaitFlag = RyanMqttTrue;
+		platformCriticalExit(pool->userData, &queue->lock);
+		platformSemaphoreTake(pool->userData, &queue->spaceSem, RyanMqttDispatchWaitTimeout);
+		platformCriticalEnter(pool->userData, &queue->lock);
+	}
+
+	if (RyanMqttTrue == queue->exitFlag)
+	{
+		result = RyanMqttFailedError;
+	}
+	else if (RyanMqttSuccessError == result)
+	{
+		RyanMqttListAddTail(&item->list, &queue->itemList);
+		if (RyanMqttTrue == item->isMsg)
+		{
+			queue->msgCount++;
+		}
+		else
+		{
+			queue->eventCount++;
+		}
+	}
+	else
+	{
+		queue->dropCount++;
+	}
+	platformCriticalExit(pool->userData, &queue->lock);
+
+	if (RyanMqttSuccessError == result)
+	{
+		platformSemaphoreGive(pool->userData, &queue->itemSem);
+	}
+
+	if (NULL != dropItem)
+	{
+		RyanMqttLog_w("回调队列已满，丢弃最旧的消息 topic: %s", dropItem->msgData.topic);
+		platformMemoryFree(dropItem);
+	}
+
+	return result;
+}
+
+/**
+ * @brief 在工作线程中执行节点的订阅回调和事件回调
+ *
+ * @param client
+ * @param item
+ */
+static void RyanMqttDispatchItemRun(RyanMqttClient_t *client, RyanMqttDispatchItem_t *item)
+{
+	for (uint16_t i = 0; i < item->handleCount; i++)
+	{
+		item->handles[i].msgHandle(client, &item->msgData, item->handles[i].userData);
+	}
+
+	// 入队时已经检查过事件注册
+	if (0 != item->eventId && NULL != client->config.mqttEventHandle)
+	{
+		client->config.mqttEventHandle(client, (RyanMqttEventId_e)item->eventId, item->eventData);
+	}
+
+	// 回调执行完成后再回复ack，断线期间不回复，等待broker重发
+	if (RyanMqttTrue == item->ackFlag && RyanMqttConnectState == RyanMqttGetClientState(client))
+	{
+		uint8_t buffer[MQTT_PUBLISH_ACK_PACKET_SIZE];
+		MQTTFixedBuffer_t fixedBuffer = {.pBuffer = buffer, .size = sizeof(buffer)};
+
+		MQTTStatus_t status = MQTT_SerializeAck(&fixedBuffer, MQTT_PACKET_TYPE_PUBACK, item->msgData.packetId);
+		if (MQTTSuccess == status)
+		{
+			RyanMqttSendPacket(client, fixedBuffer.pBuffer, MQTT_PUBLISH_ACK_PACKET_SIZE);
+		}
+	}
+}
+
+/**
+ * @brief 工作线程从队列中取出一个节点
+ * 保序模式下链表中只有事件节点，有事件时优先处理事件，否则从环形队列中无锁取出消息节点
+ *
+ * @param pool
+ * @param queue
+ * @return RyanMqttDispatchItem_t* 队列为空时返回NULL
+ */
+static RyanMqttDispatchItem_t *RyanMqttDispatchQueuePop(RyanMqttDispatchPool_t *pool, RyanMqttDispatchQueue_t *queue)
+{
+	RyanMqttDispatchItem_t *item = NULL;
+	RyanMqttBool_e spaceGiveFlag = RyanMqttFalse;
+	uint32_t eventCount;
+
+	if (NULL != queue->ring)
+	{
+#if RyanMqttAtomicEnable
+		eventCount = atomic_load_explicit(&queue->eventCount, memory_order_acquire);
+#else
+		platformCriticalEnter(pool->userData, &queue->lock);
+		eventCount = queue->eventCount;
+		platformCriticalExit(pool->userData, &queue->lock);
+#endif
+
+		if (0 == eventCount)
+		{
+			item = RyanMqttDispatchRingPop(pool, queue);
+			if (NULL != item)
+			{
+				spaceGiveFlag = RyanMqttDispatchRingTakeSpaceWait(pool, queue);
+			}
+		}
+	}
+
+	if (NULL == item)
+	{
+		platformCriticalEnter(pool->userData, &queue->lock);
+		if (!RyanMqttListIsEmpty(&queue->itemList))
+		{
+			item = RyanMqttListFirstEntry(&queue->itemList, RyanMqttDispatchItem_t, list);
+			RyanMqttListDel(&item->list);
+			if (RyanMqttTrue == item->isMsg)
+			{
+				queue->msgCount--;
+				spaceGiveFlag = queue->spaceWaitFlag;
+				queue->spaceWaitFlag = RyanMqttFalse;
+			}
+			else
+			{
+				queue->eventCount--;
+			}
+		}
+		platformCriticalExit(pool->userData, &queue->lock);
+	}
+
+	if (RyanMqttTrue == spaceGiveFlag)
+	{
+		platformSemaphoreGive(pool->userData, &queue->spaceSem);
+	}
+
+	return item;
+}
+
+/**
+ * @brief 回调工作线程
+ *
+ * @param argument
+ */
+static void RyanMqttDispatchWorkerThread(void *argument)
+{
+	RyanMqttDispatchWorker_t *worker = (RyanMqttDispatchWorker_t *)argument;
+	RyanMqttClient_t *client = worker->client;
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	RyanMqttDispatchQueue_t *queue = worker->queue;
+	void *userData = pool->userData;
+	platformThread_t workerThread;
+
+	while (1)
+	{
+		RyanMqttDispatchItem_t *item;
+		RyanMqttBool_e exitFlag;
+
+		platformSemaphoreTake(userData, &queue->itemSem, RyanMqttDispatchWaitTimeout);
+
+#if RyanMqttAtomicEnable
+		exitFlag = atomic_load_explicit(&queue->exitFlag, memory_order_acquire);
+#else
+		platformCriticalEnter(userData, &queue->lock);
+		exitFlag = queue->exitFlag;
+		platformCriticalExit(userData, &queue->lock);
+#endif
+		if (RyanMqttTrue == exitFlag)
+		{
+			break;
+		}
+
+		item = RyanMqttDispatchQueuePop(pool, queue);
+		if (NULL != item)
+		{
+			RyanMqttDispatchItemRun(client, item);
+			platformMemoryFree(item);
+		}
+	}
+
+	// aliveCount 减到0后线程池随时会被释放，线程句柄需要先拷贝出来
+	RyanMqttMemcpy(&workerThread, &worker->thread, sizeof(platformThread_t));
+	platformCriticalEnter(userData, &pool->aliveLock);
+	pool->aliveCount--;
+	platformCriticalExit(userData, &pool->aliveLock);
+
+	platformThreadDestroy(userData, &workerThread);
+}
+
+/**
+ * @brief 初始化回调队列
+ *
+ * @param userData
+ * @param queue
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDispatchQueueInit(void *userData, RyanMqttDispatchQueue_t *queue)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	RyanMqttListInit(&queue->itemList);
+
+	result = platformCriticalInit(userData, &queue->lock);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	result = platformSemaphoreInit(userData, &queue->itemSem, 0);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d,
+			  { platformCriticalDestroy(userData, &queue->lock); });
+
+	result = platformSemaphoreInit(userData, &queue->spaceSem, 0);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+		platformSemaphoreDestroy(userData, &queue->itemSem);
+		platformCriticalDestroy(userData, &queue->lock);
+	});
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 释放回调队列，队列中未执行的节点直接丢弃
+ *
+ * @param pool
+ * @param queue
+ */
+static void RyanMqttDispatchQueueDeInit(RyanMqttDispatchPool_t *pool, RyanMqttDispatchQueue_t *queue)
+{
+	void *userData = pool->userData;
+	RyanMqttDispatchItem_t *item;
+	RyanMqttList_t *curr, *next;
+
+	if (NULL != queue->ring)
+	{
+		while (NULL != (item = RyanMqttDispatchRingPop(pool, queue)))
+		{
+			platformMemoryFree(item);
+		}
+	}
+
+	RyanMqttListForEachSafe(curr, next, &queue->itemList)
+	{
+		RyanMqttListDel(curr);
+		platformMemoryFree(RyanMqttListEntry(curr, RyanMqttDispatchItem_t, list));
+	}
+
+	platformSemaphoreDestroy(userData, &queue->spaceSem);
+	platformSemaphoreDestroy(userData, &queue->itemSem);
+	platformCriticalDestroy(userData, &queue->lock);
+}
+
+/**
+ * @brief 创建回调工作线程池，在 RyanMqttStart 中mqtt线程启动前调用
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttDispatchCreate(RyanMqttClient_t *client)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t *config = &client->config;
+	RyanMqttDispatchPool_t *pool;
+	RyanMqttBool_e aliveLockIsOk = RyanMqttFalse;
+	uint8_t queueInitCount = 0;
+	uint8_t queueCount;
+	uint16_t queueSize;
+	uint32_t ringSize = 0;
+	uint32_t poolSize;
+
+	RyanMqttAssert(NULL == client->dispatchPool);
+	RyanMqttAssert(0 != config->dispatchWorkerCount);
+
+	// 保序模式下每个工作线程独占一个队列
+	queueCount = (RyanMqttTrue == config->dispatchOrderedFlag) ? config->dispatchWorkerCount : 1U;
+	queueSize = (0 != config->dispatchQueueSize) ? config->dispatchQueueSize
+						     : (uint16_t)RyanMqttDispatchDefaultQueueSize;
+	if (RyanMqttTrue == config->dispatchOrderedFlag)
+	{
+		ringSize = sizeof(RyanMqttAtomic(RyanMqttDispatchItem_t *)) * queueSize;
+	}
+
+	// 工作线程数组、队列数组和保序模式的环形队列跟随线程池一起申请
+	poolSize = sizeof(RyanMqttDispatchPool_t) + sizeof(RyanMqttDispatchWorker_t) * config->dispatchWorkerCount +
+		   (sizeof(RyanMqttDispatchQueue_t) + ringSize) * queueCount;
+	pool = (RyanMqttDispatchPool_t *)platformMemoryMalloc(poolSize);
+	RyanMqttCheck(NULL != pool, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemset(pool, 0, poolSize);
+
+	pool->workers = (RyanMqttDispatchWorker_t *)(pool + 1);
+	pool->queues = (RyanMqttDispatchQueue_t *)(pool->workers + config->dispatchWorkerCount);
+	pool->keyHandle = config->dispatchKeyHandle;
+	pool->userData = config->userData;
+	pool->queueSize = queueSize;
+	pool->workerCount = config->dispatchWorkerCount;
+	pool->queueCount = queueCount;
+	pool->overflowPolicy = config->dispatchOverflowPolicy;
+	pool->ackAfterHandleFlag = config->dispatchAckAfterHandleFlag;
+
+	pool->collectHandles = (RyanMqttDispatchHandle_t *)platformMemoryMalloc(
+		sizeof(RyanMqttDispatchHandle_t) * RyanMqttDispatchCollectInitCapacity);
+	RyanMqttCheckCodeNoReturn(NULL != pool->collectHandles, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+	pool->collectCapacity = RyanMqttDispatchCollectInitCapacity;
+
+	result = platformCriticalInit(pool->userData, &pool->aliveLock);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+	aliveLockIsOk = RyanMqttTrue;
+
+	for (; queueInitCount < queueCount; queueInitCount++)
+	{
+		result = RyanMqttDispatchQueueInit(pool->userData, &pool->queues[queueInitCount]);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+
+		if (0 != ringSize)
+		{
+			pool->queues[queueInitCount].ring =
+				(RyanMqttAtomic(RyanMqttDispatchItem_t *) *)((uint8_t *)(pool->queues + queueCount) +
+									      ringSize * queueInitCount);
+		}
+	}
+
+	// 工作线程从客户端获取线程池，需要在创建线程前赋值
+	client->dispatchPool = pool;
+	for (uint8_t i = 0; i < pool->workerCount; i++)
+	{
+		pool->workers[i].client = client;
+		pool->workers[i].queue = &pool->queues[i % queueCount];
+		result = platformThreadInit(pool->userData, &pool->workers[i].thread, "mqttDispatch",
+					    RyanMqttDispatchWorkerThread, &pool->workers[i],
+					    (0 != config->dispatchTaskStack) ? config->dispatchTaskStack
+									     : config->taskStack,
+					    (0 != config->dispatchTaskPrio) ? config->dispatchTaskPrio
+									    : config->taskPrio);
+		RyanMqttCheckCode(RyanMqttSuccessError == result, RyanMqttNoRescourceError, RyanMqttLog_d,
+				  { RyanMqttDispatchDestroy(client); });
+
+		platformCriticalEnter(pool->userData, &pool->aliveLock);
+		pool->aliveCount++;
+		platformCriticalExit(pool->userData, &pool->aliveLock);
+	}
+
+	return RyanMqttSuccessError;
+
+__exit:
+	for (uint8_t i = 0; i < queueInitCount; i++)
+	{
+		RyanMqttDispatchQueueDeInit(pool, &pool->queues[i]);
+	}
+
+	if (aliveLockIsOk)
+	{
+		platformCriticalDestroy(pool->userData, &pool->aliveLock);
+	}
+
+	if (NULL != pool->collectHandles)
+	{
+		platformMemoryFree(pool->collectHandles);
+	}
+
+	platformMemoryFree(pool);
+	return result;
+}
+
+/**
+ * @brief 销毁回调工作线程池，等待工作线程执行完当前回调后退出，队列中未执行的回调直接丢弃
+ * 不能在工作线程中调用
+ *
+ * @param client
+ */
+void RyanMqttDispatchDestroy(RyanMqttClient_t *client)
+{
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	uint8_t aliveCount;
+
+	if (NULL == pool)
+	{
+		return;
+	}
+
+	for (uint8_t i = 0; i < pool->queueCount; i++)
+	{
+		platformCriticalEnter(pool->userData, &pool->queues[i].lock);
+		pool->queues[i].exitFlag = RyanMqttTrue;
+		platformCriticalExit(pool->userData, &pool->queues[i].lock);
+	}
+
+	for (uint8_t i = 0; i < pool->workerCount; i++)
+	{
+		platformSemaphoreGive(pool->userData, &pool->workers[i].queue->itemSem);
+	}
+
+	while (1)
+	{
+		platformCriticalEnter(pool->userData, &pool->aliveLock);
+		aliveCount = pool->aliveCount;
+		platformCriticalExit(pool->userData, &pool->aliveLock);
+
+		if (0 == aliveCount)
+		{
+			break;
+		}
+		platformDelay(10);
+	}
+
+	for (uint8_t i = 0; i < pool->queueCount; i++)
+	{
+		RyanMqttDispatchQueueDeInit(pool, &pool->queues[i]);
+	}
+
+	platformCriticalDestroy(pool->userData, &pool->aliveLock);
+	platformMemoryFree(pool->collectHandles);
+	platformMemoryFree(pool);
+	client->dispatchPool = NULL;
+}
+
+/**
+ * @brief 获取所有队列因溢出策略丢弃的消息总数
+ *
+ * @param pool
+ * @return uint32_t
+ */
+uint32_t RyanMqttDispatchGetDropCount(RyanMqttDispatchPool_t *pool)
+{
+	uint32_t dropCount = 0;
+
+	for (uint8_t i = 0; i < pool->queueCount; i++)
+	{
+		platformCriticalEnter(pool->userData, &pool->queues[i].lock);
+		dropCount += pool->queues[i].dropCount;
+		platformCriticalExit(pool->userData, &pool->queues[i].lock);
+	}
+
+	return dropCount;
+}
+
+/**
+ * @brief 分发消息时收集匹配订阅的回调，只能在mqtt线程中调用
+ *
+ * @param client
+ * @param msgHandle
+ * @param userData
+ */
+void RyanMqttDispatchCollect(RyanMqttClient_t *client, RyanMqttMsgHandle msgHandle, void *userData)
+{
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	RyanMqttAssert(NULL != pool);
+
+	if (pool->collectCount >= pool->collectCapacity)
+	{
+		uint32_t capacity = (uint32_t)pool->collectCapacity * 2U;
+		RyanMqttDispatchHandle_t *handles;
+
+		if (capacity > UINT16_MAX)
+		{
+			capacity = UINT16_MAX;
+		}
+
+		handles = (RyanMqttDispatchHandle_t *)platformMemoryMalloc(sizeof(RyanMqttDispatchHandle_t) * capacity);
+		if (NULL == handles || capacity == pool->collectCapacity)
+		{
+			if (NULL != handles)
+			{
+				platformMemoryFree(handles);
+			}
+			pool->collectFailedFlag = RyanMqttTrue;
+			return;
+		}
+
+		RyanMqttMemcpy(handles, pool->collectHandles, sizeof(RyanMqttDispatchHandle_t) * pool->collectCount);
+		platformMemoryFree(pool->collectHandles);
+		pool->collectHandles = handles;
+		pool->collectCapacity = (uint16_t)capacity;
+	}
+
+	pool->collectHandles[pool->collectCount].msgHandle = msgHandle;
+	pool->collectHandles[pool->collectCount].userData = userData;
+	pool->collectCount++;
+}
+
+/**
+ * @brief 将收集到的订阅回调和消息拷贝一起放入回调队列，只能在mqtt线程中调用
+ *
+ * @param client
+ * @param msgData
+ * @param eventFlag 需要触发 RyanMqttEventData 事件
+ * @param ackFlag qos1消息在回调执行完成后回复PUBACK
+ * @return RyanMqttError_e 内存不足或按溢出策略丢弃时返回失败，qos1 / qos2不回复ack
+ */
+RyanMqttError_e RyanMqttDispatchMsg(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData, RyanMqttBool_e eventFlag,
+				    RyanMqttBool_e ackFlag)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttDispatchPool_t *pool = client->dispatchPool;
+	RyanMqttDispatchItem_t *item;
+	uint32_t eventId = 0;
+
+	RyanMqttAssert(NULL != pool);
+
+	// 收集订阅回调时内存不足，不回复ack等待broker重发
+	RyanMqttCheckCodeNoReturn(RyanMqttTrue != pool->collectFailedFlag, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+
+	if (RyanMqttTrue == eventFlag && RyanMqttTrue == RyanMqttDispatchEventIsEnable(client, RyanMqttEventData))
+	{
+		eventId = RyanMqttEventData;
+	}
+
+	// 没有需要在工作线程中执行的内容
+	if (0 == pool->collectCount && 0 == eventId && RyanMqttTrue != ackFlag)
+	{
+		goto __exit;
+	}
+
+	item = RyanMqttDispatchMsgItemCreate(msgData, pool->collectHandles, pool->collectCount);
+	RyanMqttCheckCodeNoReturn(NULL != item, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+	item->eventId = eventId;
+	item->ackFlag = ackFlag;
+
+	result = RyanMqttDispatchQueuePush(client, item);
+	if (RyanMqttSuccessError != result)
+	{
+		platformMemoryFree(item);
+	}
+
+__exit:
+	pool->collectCount = 0;
+	pool->collectFailedFlag = RyanMqttFalse;
+	return result;
+}
+
+/**
+ * @brief 拷贝事件数据后放入回调队列，调用前需要检查事件已注册
+ * 消息事件按溢出策略处理，其余事件不受队列长度限制，也不会阻塞
+ *
+ * @param client
+ * @param eventId
+ * @param eventData
+ * @return RyanMqttError_e 内存不足或线程池正在销毁时返回失败，由调用者直接回调
+ */
+RyanMqttError_e RyanMqttDispatchEvent(RyanMqttClient_t *client, RyanMqttEventId_e eventId, void *eventData)
+{
+	RyanMqttDispatchItem_t *item;
+	RyanMqttError_e result;
+	uint32_t dataLen = 0;
+
+	RyanMqttAssert(NULL != client->dispatchPool);
+
+	switch (eventId)
+	{
+	case RyanMqttEventData:
+	case RyanMqttEventUnsubscribedData:
+		item = RyanMqttDispatchMsgItemCreate((RyanMqttMsgData_t *)eventData, NULL, 0);
+		RyanMqttCheck(NULL != item, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+		item->eventId = eventId;
+		goto __push;
+
+	case RyanMqttEventConnected:
+	case RyanMqttEventDisconnected: dataLen = sizeof(int32_t); break;
+
+	case RyanMqttEventAckCountWarning: dataLen = sizeof(uint16_t); break;
+
+	case RyanMqttEventSubscribed:
+	case RyanMqttEventSubscribedFailed:
+	case RyanMqttEventUnSubscribed:
+	case RyanMqttEventUnSubscribedFailed: {
+		RyanMqttMsgHandler_t *msgHandler = (RyanMqttMsgHandler_t *)eventData;
+		dataLen = sizeof(RyanMqttMsgHandler_t) + msgHandler->topicLen + 1U;
+		break;
+	}
+
+	case RyanMqttEventPublished:
+	case RyanMqttEventRepeatPublishPacket:
+	case RyanMqttEventAckRepeatCountWarning:
+	case RyanMqttEventAckHandlerDiscard: {
+		RyanMqttAckHandler_t *ackHandler = (RyanMqttAckHandler_t *)eventData;
+		dataLen = sizeof(RyanMqttAckHandler_t) + ackHandler->packetLen;
+		if (NULL != ackHandler->msgHandler)
+		{
+			dataLen += sizeof(RyanMqttMsgHandler_t) + ackHandler->msgHandler->topicLen + 1U;
+		}
+		break;
+	}
+
+	case RyanMqttEventOfflineDiscard: dataLen = ((RyanMqttOfflineMsg_t *)eventData)->size; break;
+
+	default: eventData = NULL; break;
+	}
+
+	item = (RyanMqttDispatchItem_t *)platformMemoryMalloc(sizeof(RyanMqttDispatchItem_t) + dataLen);
+	RyanMqttCheck(NULL != item, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemset(item, 0, sizeof(RyanMqttDispatchItem_t));
+	item->eventId = eventId;
+
+	if (NULL != eventData)
+	{
+		uint8_t *buf = (uint8_t *)(item + 1);
+		item->eventData = buf;
+
+		switch (eventId)
+		{
+		case RyanMqttEventSubscribed:
+		case RyanMqttEventSubscribedFailed:
+		case RyanMqttEventUnSubscribed:
+		case RyanMqttEventUnSubscribedFailed:
+			RyanMqttDispatchCopyMsgHandler(buf, (RyanMqttMsgHandler_t *)eventData);
+			break;
+
+		case RyanMqttEventPublished:
+		case RyanMqttEventRepeatPublishPacket:
+		case RyanMqttEventAckRepeatCountWarning:
+		case RyanMqttEventAckHandlerDiscard: {
+			RyanMqttAckHandler_t *ackHandler = (RyanMqttAckHandler_t *)eventData;
+			RyanMqttAckHandler_t *ackHandlerCopy = (RyanMqttAckHandler_t *)buf;
+
+			RyanMqttMemcpy(ackHandlerCopy, ackHandler, sizeof(RyanMqttAckHandler_t));
+			RyanMqttListInit(&ackHandlerCopy->list);
+			buf += sizeof(RyanMqttAckHandler_t);
+
+			if (NULL != ackHandler->msgHandler)
+			{
+				ackHandlerCopy->msgHandler =
+					RyanMqttDispatchCopyMsgHandler(buf, ackHandler->msgHandler);
+				buf += sizeof(RyanMqttMsgHandler_t) + ackHandler->msgHandler->topicLen + 1U;
+			}
+
+			if (0 != ackHandler->packetLen)
+			{
+				RyanMqttMemcpy(buf, ackHandler->packet, ackHandler->packetLen);
+				ackHandlerCopy->packet = buf;
+			}
+			break;
+		}
+
+		// 离线消息的主题和数据跟随消息在同一块内存中，整体拷贝后修正指针
+		case RyanMqttEventOfflineDiscard: {
+			RyanMqttOfflineMsg_t *offlineMsg = (RyanMqttOfflineMsg_t *)eventData;
+			RyanMqttOfflineMsg_t *offlineMsgCopy = (RyanMqttOfflineMsg_t *)buf;
+
+			RyanMqttMemcpy(offlineMsgCopy, offlineMsg, offlineMsg->size);
+			RyanMqttListInit(&offlineMsgCopy->list);
+			offlineMsgCopy->topic = (char *)buf + (offlineMsg->topic - (char *)offlineMsg);
+			offlineMsgCopy->payload = (char *)buf + (offlineMsg->payload - (char *)offlineMsg);
+			break;
+		}
+
+		default: RyanMqttMemcpy(buf, eventData, dataLen); break;
+		}
+	}
+
+__push:
+	result = RyanMqttDispatchQueuePush(client, item);
+	if (RyanMqttSuccessError != result)
+	{
+		platformMemoryFree(item);
+	}
+
+	// 按溢出策略丢弃的消息不再回调
+	return (RyanMqttNoRescourceError == result) ? RyanMqttSuccessError : result;
+}
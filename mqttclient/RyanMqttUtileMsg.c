@@ -6,206 +6,621 @@
 #include "RyanMqttThread.h"
 
 /**
- * @brief 根据 MQTT 3.1.1 协议规范确定传递的主题过滤器和主题名称是否匹配的实用程序函数，
- *          应仅在strcmp / strncmp不相等时再进行通配符匹配
+ * @brief 检查消息处理程序的主题是否与给定主题匹配
  *
- * @param topic 要检查的主题名称
- * @param topicLength 主题名称的长度。
- * @param topicFilter 要检查的主题过滤器。
- * @param topicFilterLength 要检查的主题过滤器长度
+ * @param msgHandler
+ * @param topic
+ * @param topicLen
+ * @param isTopicMatchedFlag
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttMsgTopicIsMatch(RyanMqttMsgHandler_t *msgHandler, const char *topic, uint16_t topicLen,
+					      RyanMqttBool_e isTopicMatchedFlag)
+{
+	// 不进行通配符匹配
+	if (RyanMqttTrue != isTopicMatchedFlag)
+	{
+		// 不相等跳过
+		if (topicLen != msgHandler->topicLen)
+		{
+			return RyanMqttFalse;
+		}
+
+		// 主题名称不相等且没有使能通配符匹配
+		if (RyanMqttTrue != RyanMqttTopicEqual(topic, msgHandler->topic, topicLen))
+		{
+			return RyanMqttFalse;
+		}
+	}
+	else
+	{
+		// 进行通配符匹配
+		if (RyanMqttTrue != RyanMqttMatchTopic(topic, topicLen, msgHandler->topic, msgHandler->topicLen))
+		{
+			return RyanMqttFalse;
+		}
+	}
+
+	return RyanMqttTrue;
+}
+
+/**
+ * @brief 使用订阅时预编译的主题过滤器层级和拆分后的报文主题进行通配符匹配
+ *
+ * @param msgHandler
+ * @param topicSplit
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttMsgTopicIsMatchLevels(RyanMqttMsgHandler_t *msgHandler,
+						    const RyanMqttTopicSplit_t *topicSplit)
+{
+	return RyanMqttMatchTopicLevels(topicSplit, msgHandler->topic, msgHandler->topicLen, msgHandler->topicLevels,
+					msgHandler->topicLevelCount);
+}
+
+/**
+ * @brief 判断主题过滤器是否包含通配符
+ *
+ * @param topic
+ * @param topicLen
  * @return RyanMqttBool_e
  */
-static RyanMqttBool_e RyanMqttMatchTopic(const char *topic, const uint16_t topicLength, const char *topicFilter,
-					 const uint16_t topicFilterLength)
+static RyanMqttBool_e RyanMqttTopicHasWildcard(const char *topic, uint16_t topicLen)
+{
+	for (uint16_t i = 0; i < topicLen; i++)
+	{
+		if ('+' == topic[i] || '#' == topic[i])
+		{
+			return RyanMqttTrue;
+		}
+	}
+
+	return RyanMqttFalse;
+}
+
+/**
+ * @brief 获取主题所在的索引链表，不含通配符的主题按哈希值分桶，含通配符的统一放入通配符链表
+ *
+ * @param client
+ * @param topic
+ * @param topicLen
+ * @param topicHash
+ * @return RyanMqttList_t*
+ */
+static RyanMqttList_t *RyanMqttMsgIndexList(RyanMqttClient_t *client, const char *topic, uint16_t topicLen,
+					    uint32_t topicHash)
+{
+	if (RyanMqttTrue == RyanMqttTopicHasWildcard(topic, topicLen))
+	{
+		return &client->msgWildcardList;
+	}
+
+	return &client->msgHashList[topicHash & (RyanMqttMsgHashBucketCount - 1U)];
+}
+
+/**
+ * @brief 在指定索引链表中精确查找同名主题
+ *
+ * @param indexList
+ * @param topic
+ * @param topicLen
+ * @param topicHash
+ * @return RyanMqttMsgHandler_t*
+ */
+static RyanMqttMsgHandler_t *RyanMqttMsgIndexFindExact(RyanMqttList_t *indexList, const char *topic,
+							uint16_t topicLen, uint32_t topicHash)
+{
+	RyanMqttList_t *curr;
+	RyanMqttMsgHandler_t *msgHandler;
+
+	RyanMqttListForEach(curr, indexList)
+	{
+		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, hashList);
+		if (topicHash == msgHandler->topicHash &&
+		    RyanMqttTrue == RyanMqttMsgTopicIsMatch(msgHandler, topic, topicLen, RyanMqttFalse))
+		{
+			return msgHandler;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief 在订阅快照中精确查找同名主题
+ *
+ * @param snapshot
+ * @param topic
+ * @param topicLen
+ * @param topicHash
+ * @return RyanMqttMsgHandler_t*
+ */
+static RyanMqttMsgHandler_t *RyanMqttMsgSnapshotFindExact(RyanMqttMsgSnapshot_t *snapshot, const char *topic,
+							  uint16_t topicLen, uint32_t topicHash)
+{
+	uint16_t index = snapshot->bucketHead[topicHash & (RyanMqttMsgHashBucketCount - 1U)];
+
+	while (RyanMqttMsgSnapshotInvalidIndex != index)
+	{
+		RyanMqttMsgHandler_t *msgHandler = &snapshot->msgHandlers[index];
+		if (topicHash == msgHandler->topicHash &&
+		    RyanMqttTrue == RyanMqttMsgTopicIsMatch(msgHandler, topic, topicLen, RyanMqttFalse))
+		{
+			return msgHandler;
+		}
+
+		index = snapshot->bucketNext[index];
+	}
+
+	return NULL;
+}
+
+#if RyanMqttMsgMatchCacheCount > 0
+/**
+ * @brief 从最近匹配缓存中查找主题对应的msg句柄，命中后会再次校验匹配关系，防止哈希冲突
+ * 缓存只在mqtt线程中使用，保存的是 msgSnapshotLocal 中的订阅
+ *
+ * @param client
+ * @param topic
+ * @param topicLen
+ * @param topicHash
+ * @return RyanMqttMsgHandler_t*
+ */
+static RyanMqttMsgHandler_t *RyanMqttMsgMatchCacheFind(RyanMqttClient_t *client, const char *topic, uint16_t topicLen,
+							uint32_t topicHash)
+{
+	for (uint32_t i = 0; i < RyanMqttMsgMatchCacheCount; i++)
+	{
+		RyanMqttMsgMatchCache_t *cache = &client->msgMatchCache[i];
+		if (NULL == cache->msgHandler || topicHash != cache->topicHash || topicLen != cache->topicLen)
+		{
+			continue;
+		}
+
+		if (RyanMqttTrue == RyanMqttMsgTopicIsMatch(cache->msgHandler, topic, topicLen, RyanMqttTrue))
+		{
+			cache->lastUseTick = ++client->msgMatchCacheTick;
+			return cache->msgHandler;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief 将匹配结果存入最近匹配缓存，缓存满时淘汰最久未使用的条目
+ *
+ * @param client
+ * @param topicLen
+ * @param topicHash
+ * @param msgHandler
+ */
+static void RyanMqttMsgMatchCacheAdd(RyanMqttClient_t *client, uint16_t topicLen, uint32_t topicHash,
+				     RyanMqttMsgHandler_t *msgHandler)
+{
+	RyanMqttMsgMatchCache_t *cache = &client->msgMatchCache[0];
+
+	for (uint32_t i = 0; i < RyanMqttMsgMatchCacheCount; i++)
+	{
+		if (NULL == client->msgMatchCache[i].msgHandler)
+		{
+			cache = &client->msgMatchCache[i];
+			break;
+		}
+
+		// 使用差值比较，计数回绕后依然可以正确淘汰
+		if ((int32_t)(client->msgMatchCache[i].lastUseTick - cache->lastUseTick) < 0)
+		{
+			cache = &client->msgMatchCache[i];
+		}
+	}
+
+	cache->msgHandler = msgHandler;
+	cache->topicHash = topicHash;
+	cache->topicLen = topicLen;
+	cache->lastUseTick = ++client->msgMatchCacheTick;
+}
+#endif
+
+/**
+ * @brief mqtt线程切换了订阅快照，清空最近匹配缓存
+ *
+ * @param client
+ */
+static void RyanMqttMsgMatchCacheInvalidate(RyanMqttClient_t *client)
+{
+#if RyanMqttMsgMatchCacheCount > 0
+	RyanMqttMemset(client->msgMatchCache, 0, sizeof(client->msgMatchCache));
+#else
+	(void)client;
+#endif
+}
+
+/**
+ * @brief 查找第一个与报文主题匹配的订阅，依次查找精确主题哈希索引、通配符订阅链表
+ * 调用者需持有 msgHandleLock
+ *
+ * @param client
+ * @param topic
+ * @param topicLen
+ * @param topicHash
+ * @return RyanMqttMsgHandler_t*
+ */
+static RyanMqttMsgHandler_t *RyanMqttMsgMatchFirst(RyanMqttClient_t *client, const char *topic, uint16_t topicLen,
+						   uint32_t topicHash)
 {
+	RyanMqttList_t *curr;
+	RyanMqttMsgHandler_t *msgHandler;
+	RyanMqttTopicSplit_t topicSplit;
+
+	// 接收到的报文主题不含通配符，先查找精确订阅
+	msgHandler = RyanMqttMsgIndexFindExact(&client->msgHashList[topicHash & (RyanMqttMsgHashBucketCount - 1U)],
+					       topic, topicLen, topicHash);
+	if (NULL != msgHandler || RyanMqttListIsEmpty(&client->msgWildcardList))
+	{
+		return msgHandler;
+	}
 
-	RyanMqttBool_e topicFilterStartsWithWildcard = RyanMqttFalse, matchFound = RyanMqttFalse,
-		       shouldStopMatching = RyanMqttFalse;
-	uint16_t topicIndex = 0, topicFilterIndex = 0;
+	RyanMqttTopicSplit(&topicSplit, topic, topicLen);
+	RyanMqttListForEach(curr, &client->msgWildcardList)
+	{
+		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, hashList);
+		if (RyanMqttTrue == RyanMqttMsgTopicIsMatchLevels(msgHandler, &topicSplit))
+		{
+			return msgHandler;
+		}
+	}
 
-	RyanMqttAssert((NULL != topic) && (topicLength != 0u));
-	RyanMqttAssert((NULL != topicFilter) && (topicFilterLength != 0u));
+	return NULL;
+}
 
-	// 确定主题过滤器是否以通配符开头。
-	topicFilterStartsWithWildcard = (RyanMqttBool_e)((topicFilter[0] == '+') || (topicFilter[0] == '#'));
+/**
+ * @brief 在订阅快照中查找第一个与报文主题匹配的订阅，依次查找最近匹配缓存、精确主题哈希索引、通配符订阅
+ * 只能在mqtt线程中对 msgSnapshotLocal 调用
+ *
+ * @param client
+ * @param snapshot
+ * @param topic
+ * @param topicLen
+ * @param topicHash
+ * @return RyanMqttMsgHandler_t*
+ */
+static RyanMqttMsgHandler_t *RyanMqttMsgSnapshotMatchFirst(RyanMqttClient_t *client, RyanMqttMsgSnapshot_t *snapshot,
+							   const char *topic, uint16_t topicLen, uint32_t topicHash)
+{
+	RyanMqttMsgHandler_t *msgHandler;
 
-	// 不能将 $ 字符开头的主题名匹配通配符 (#或+) 开头的主题过滤器
-	if ((topic[0] == '$') && (topicFilterStartsWithWildcard == RyanMqttTrue))
+#if RyanMqttMsgMatchCacheCount > 0
+	msgHandler = RyanMqttMsgMatchCacheFind(client, topic, topicLen, topicHash);
+	if (NULL != msgHandler)
 	{
-		return RyanMqttFalse;
+		return msgHandler;
 	}
+#endif
 
-	// 匹配主题名称和主题过滤器，允许使用通配符。
-	while ((topicIndex < topicLength) && (topicFilterIndex < topicFilterLength))
+	msgHandler = RyanMqttMsgSnapshotFindExact(snapshot, topic, topicLen, topicHash);
+	if (NULL == msgHandler && 0 != snapshot->wildcardCount)
 	{
-		// 检查主题名称中的字符是否与主题筛选器字符串中的对应字符匹配。
-		if (topic[topicIndex] == topicFilter[topicFilterIndex])
+		RyanMqttTopicSplit_t topicSplit;
+		RyanMqttTopicSplit(&topicSplit, topic, topicLen);
+
+		for (uint16_t i = 0; NULL == msgHandler && i < snapshot->wildcardCount; i++)
 		{
-			// 当主题名称已被消耗但主题过滤器中还有剩余字符需要匹配时，此功能处理以下两种情况：
-			// -当主题过滤器以"/+"或"/#"字符结尾时，主题名称以"/"结尾。
-			// -当主题过滤器以"/#"字符结尾时，主题名称以父级别结尾。
-			if (topicIndex == (topicLength - 1U))
+			RyanMqttMsgHandler_t *wildcardHandler = &snapshot->msgHandlers[snapshot->wildcardIndex[i]];
+			if (RyanMqttTrue == RyanMqttMsgTopicIsMatchLevels(wildcardHandler, &topicSplit))
 			{
-				// 检查主题筛选器是否有2个剩余字符，并且以"/#"结尾。
-				// 此检查处理将筛选器"sport/#"与主题"sport"匹配的情况。
-				// 原因是"#"通配符表示主题名称中的父级和任意数量的子级。
-				if ((topicFilterLength >= 3U) && (topicFilterIndex == (topicFilterLength - 3U)) &&
-				    (topicFilter[topicFilterIndex + 1U] == '/') &&
-				    (topicFilter[topicFilterIndex + 2U] == '#'))
-				{
-					matchFound = RyanMqttTrue;
-				}
-
-				// 检查下一个字符是否为"#"或"+"，主题过滤器以"/#"或"/+"结尾。
-				// 此检查处理要匹配的情况：
-				// -主题过滤器"sport/+"与主题"sport/"。
-				// -主题过滤器"sport/#"，主题为"sport/"。
-				if ((topicFilterIndex == (topicFilterLength - 2U)) &&
-				    (topicFilter[topicFilterIndex] == '/'))
-				{
-					// 检查最后一个字符是否为通配符
-					matchFound = (RyanMqttBool_e)((topicFilter[topicFilterIndex + 1U] == '+') ||
-								      (topicFilter[topicFilterIndex + 1U] == '#'));
-				}
+				msgHandler = wildcardHandler;
 			}
 		}
-		else
-		{
-			// 检查是否匹配通配符
-			RyanMqttBool_e locationIsValidForWildcard;
+	}
+
+#if RyanMqttMsgMatchCacheCount > 0
+	if (NULL != msgHandler)
+	{
+		RyanMqttMsgMatchCacheAdd(client, topicLen, topicHash, msgHandler);
+	}
+#else
+	(void)client;
+#endif
 
-			// 主题过滤器中的通配符仅在起始位置或前面有"/"时有效。
-			locationIsValidForWildcard = (RyanMqttBool_e)((topicFilterIndex == 0u) ||
-								      (topicFilter[topicFilterIndex - 1U] == '/'));
+	return msgHandler;
+}
 
-			if ((topicFilter[topicFilterIndex] == '+') && (locationIsValidForWildcard == RyanMqttTrue))
+/**
+ * @brief 根据msg链表重新生成订阅快照并发布，旧快照在最后一个读者释放后销毁
+ * 调用者需持有 msgHandleLock
+ *
+ * @param client
+ */
+static void RyanMqttMsgSnapshotPublish(RyanMqttClient_t *client)
+{
+	RyanMqttList_t *curr;
+	RyanMqttMsgHandler_t *msgHandler;
+	RyanMqttMsgSnapshot_t *snapshot = NULL;
+	RyanMqttMsgSnapshot_t *oldSnapshot;
+	uint32_t count = 0;
+	uint32_t wildcardCount = 0;
+	uint32_t levelTotalCount = 0;
+	uint32_t topicTotalLen = 0;
+
+	RyanMqttListForEach(curr, &client->msgHandlerList)
+	{
+		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
+		levelTotalCount += msgHandler->topicLevelCount;
+		topicTotalLen += msgHandler->topicLen + 1U;
+		count++;
+	}
+
+	RyanMqttListForEach(curr, &client->msgWildcardList)
+	{
+		wildcardCount++;
+	}
+
+	// 快照使用 uint16_t 保存下标
+	if (count < RyanMqttMsgSnapshotInvalidIndex)
+	{
+		uint32_t mallocSize = sizeof(RyanMqttMsgSnapshot_t) + sizeof(RyanMqttMsgHandler_t) * count +
+				      sizeof(RyanMqttTopicLevel_t) * levelTotalCount +
+				      sizeof(uint16_t) * (RyanMqttMsgHashBucketCount + count + wildcardCount) +
+				      topicTotalLen;
+		snapshot = (RyanMqttMsgSnapshot_t *)platformMemoryMalloc(mallocSize);
+	}
+
+	if (NULL != snapshot)
+	{
+		snapshot->refCount = 1; // 发布者持有的引用
+		snapshot->count = (uint16_t)count;
+		snapshot->wildcardCount = (uint16_t)wildcardCount;
+		snapshot->msgHandlers = (RyanMqttMsgHandler_t *)((uint8_t *)snapshot + sizeof(RyanMqttMsgSnapshot_t));
+		RyanMqttTopicLevel_t *levelPool = (RyanMqttTopicLevel_t *)&snapshot->msgHandlers[count];
+		snapshot->bucketHead = (uint16_t *)&levelPool[levelTotalCount];
+		snapshot->bucketNext = &snapshot->bucketHead[RyanMqttMsgHashBucketCount];
+		snapshot->wildcardIndex = &snapshot->bucketNext[count];
+		char *topicPool = (char *)&snapshot->wildcardIndex[wildcardCount];
+
+		uint16_t index = 0;
+		uint16_t wildcardIndex = 0;
+		RyanMqttListForEach(curr, &client->msgHandlerList)
+		{
+			msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
+
+			RyanMqttMsgHandler_t *snapshotHandler = &snapshot->msgHandlers[index];
+			RyanMqttMemcpy(snapshotHandler, msgHandler, sizeof(RyanMqttMsgHandler_t));
+			RyanMqttListInit(&snapshotHandler->list);
+			RyanMqttListInit(&snapshotHandler->hashList);
+			snapshotHandler->topic = topicPool;
+			RyanMqttMemcpy(topicPool, msgHandler->topic, msgHandler->topicLen);
+			topicPool[msgHandler->topicLen] = '\0';
+			topicPool += msgHandler->topicLen + 1U;
+
+			// 预编译的层级只保存偏移，直接拷贝即可
+			if (0 != msgHandler->topicLevelCount)
 			{
-				RyanMqttBool_e nextLevelExistsInTopicName = RyanMqttFalse;
-				RyanMqttBool_e nextLevelExistsinTopicFilter = RyanMqttFalse;
-
-				// 将主题名称索引移动到当前级别的末尾,
-				// 当前级别的结束由下一个级别分隔符"/"之前的最后一个字符标识。
-				while (topicIndex < topicLength)
-				{
-					// 如果我们碰到级别分隔符，则退出循环
-					if (topic[topicIndex] == '/')
-					{
-						nextLevelExistsInTopicName = RyanMqttTrue;
-						break;
-					}
-
-					(topicIndex)++;
-				}
-
-				// 确定主题过滤器是否包含在由"+"通配符表示的当前级别之后的子级别。
-				if ((topicFilterIndex < (topicFilterLength - 1U)) &&
-				    (topicFilter[topicFilterIndex + 1U] == '/'))
-				{
-					nextLevelExistsinTopicFilter = RyanMqttTrue;
-				}
-
-				// 如果主题名称包含子级别但主题过滤器在当前级别结束，则不存在匹配项。
-				if ((nextLevelExistsInTopicName == RyanMqttTrue) &&
-				    (nextLevelExistsinTopicFilter == RyanMqttFalse))
-				{
-					matchFound = RyanMqttFalse;
-					shouldStopMatching = RyanMqttTrue;
-				}
-				// 如果主题名称和主题过滤器有子级别，则将过滤器索引推进到主题过滤器中的级别分隔符，以便在下一个级别进行匹配。
-				// 注意：名称索引已经指向主题名称中的级别分隔符。
-				else if (nextLevelExistsInTopicName == RyanMqttTrue)
-				{
-					(topicFilterIndex)++;
-				}
-
-				// 如果我们已经到达这里，循环以（*pNameIndex <
-				// topicLength）条件终止，
-				// 这意味着已经超过主题名称的末尾，因此，我们将索引缩减为主题名称中的最后一个字符。
-				else
-				{
-					(topicIndex)--;
-				}
+				snapshotHandler->topicLevels = levelPool;
+				RyanMqttMemcpy(levelPool, msgHandler->topicLevels,
+					       sizeof(RyanMqttTopicLevel_t) * msgHandler->topicLevelCount);
+				levelPool += msgHandler->topicLevelCount;
 			}
 
-			// "#"匹配主题名称中剩余的所有内容。它必须是主题过滤器中的最后一个字符。
-			else if ((topicFilter[topicFilterIndex] == '#') &&
-				 (topicFilterIndex == (topicFilterLength - 1U)) &&
-				 (locationIsValidForWildcard == RyanMqttTrue))
+			snapshot->bucketNext[index] = RyanMqttMsgSnapshotInvalidIndex;
+			if (RyanMqttTrue == RyanMqttTopicHasWildcard(msgHandler->topic, msgHandler->topicLen))
 			{
-				// 后续字符不需要检查多级通配符。
-				matchFound = RyanMqttTrue;
-				shouldStopMatching = RyanMqttTrue;
+				snapshot->wildcardIndex[wildcardIndex++] = index;
 			}
-			else
+			index++;
+		}
+
+		// 逆序头插，保证同一哈希桶内的顺序与msg链表一致
+		RyanMqttMemset(snapshot->bucketHead, 0xFF, sizeof(uint16_t) * RyanMqttMsgHashBucketCount);
+		for (uint32_t i = count; i > 0; i--)
+		{
+			msgHandler = &snapshot->msgHandlers[i - 1U];
+			if (RyanMqttTrue == RyanMqttTopicHasWildcard(msgHandler->topic, msgHandler->topicLen))
 			{
-				// 除"+"或"#"以外的任何字符不匹配均表示主题名称与主题过滤器不匹配。
-				matchFound = RyanMqttFalse;
-				shouldStopMatching = RyanMqttTrue;
+				continue;
 			}
+
+			uint16_t *bucketHead =
+				&snapshot->bucketHead[msgHandler->topicHash & (RyanMqttMsgHashBucketCount - 1U)];
+			snapshot->bucketNext[i - 1U] = *bucketHead;
+			*bucketHead = (uint16_t)(i - 1U);
+		}
+	}
+	else
+	{
+		RyanMqttLog_e("订阅快照创建失败, count: %u", (unsigned int)count);
+	}
+
+	// 内存不足时发布空快照，读者会按无可用订阅处理，等待下次订阅变化或读者获取时重试
+#if RyanMqttAtomicEnable
+	// 交换包含release语义，读者acquire读取到新指针时快照内容已经完整可见
+	oldSnapshot = atomic_exchange_explicit(&client->msgSnapshot, snapshot, memory_order_seq_cst);
+
+	// 等待已经读取到旧指针的读者完成引用计数递增，之后释放发布者的引用不会提前销毁旧快照
+	while (0 != atomic_load_explicit(&client->msgSnapshotPin, memory_order_seq_cst))
+	{
+		platformDelay(1);
+	}
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	oldSnapshot = client->msgSnapshot;
+	client->msgSnapshot = snapshot;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+
+	client->msgSnapshotDirty = (NULL == snapshot) ? RyanMqttTrue : RyanMqttFalse;
+	RyanMqttMsgSnapshotRelease(client, oldSnapshot);
+}
+
+/**
+ * @brief 获取msg链表锁，支持嵌套
+ *
+ * @param client
+ */
+void RyanMqttMsgListLock(RyanMqttClient_t *client)
+{
+	RyanMqttAssert(NULL != client);
+
+	platformMutexLock(client->config.userData, &client->msgHandleLock);
+	client->msgLockDepth++;
+}
+
+/**
+ * @brief 释放msg链表锁，释放最外层锁时如果订阅发生过变化就发布新的订阅快照
+ * 批量修改订阅时在外层持有锁，只会生成一次快照
+ *
+ * @param client
+ */
+void RyanMqttMsgListUnLock(RyanMqttClient_t *client)
+{
+	RyanMqttAssert(NULL != client);
+	RyanMqttAssert(client->msgLockDepth > 0);
+
+	if (1 == client->msgLockDepth && RyanMqttTrue == client->msgSnapshotDirty)
+	{
+		RyanMqttMsgSnapshotPublish(client);
+	}
+
+	client->msgLockDepth--;
+	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+}
+
+/**
+ * @brief 标记订阅已修改，用于直接修改msg句柄内容的场景
+ * 调用者需持有 msgHandleLock
+ *
+ * @param client
+ */
+void RyanMqttMsgListMarkDirty(RyanMqttClient_t *client)
+{
+	RyanMqttAssert(NULL != client);
+	client->msgSnapshotDirty = RyanMqttTrue;
+}
+
+/**
+ * @brief 获取最新订阅快照的引用，使用完毕后需调用 RyanMqttMsgSnapshotRelease 释放
+ * 快照尚未发布或上次发布失败时会持有msg链表锁重新发布一次
+ *
+ * @param client
+ * @return RyanMqttMsgSnapshot_t* 内存不足时返回NULL
+ */
+RyanMqttMsgSnapshot_t *RyanMqttMsgSnapshotAcquire(RyanMqttClient_t *client)
+{
+	RyanMqttMsgSnapshot_t *snapshot;
+	RyanMqttAssert(NULL != client);
+
+	for (uint8_t retry = 0; retry < 2; retry++)
+	{
+#if RyanMqttAtomicEnable
+		// 读取指针和递增引用计数之间发布者可能替换快照，读者计数让发布者等待引用计数递增完成
+		atomic_fetch_add_explicit(&client->msgSnapshotPin, 1, memory_order_seq_cst);
+		snapshot = atomic_load_explicit(&client->msgSnapshot, memory_order_seq_cst);
+		if (NULL != snapshot)
+		{
+			atomic_fetch_add_explicit(&snapshot->refCount, 1, memory_order_relaxed);
 		}
+		atomic_fetch_sub_explicit(&client->msgSnapshotPin, 1, memory_order_release);
+#else
+		platformCriticalEnter(client->config.userData, &client->criticalLock);
+		snapshot = client->msgSnapshot;
+		if (NULL != snapshot)
+		{
+			snapshot->refCount++;
+		}
+		platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
 
-		if ((matchFound == RyanMqttTrue) || (shouldStopMatching == RyanMqttTrue))
+		if (NULL != snapshot || 0 != retry)
 		{
 			break;
 		}
 
-		// 增量索引
-		topicIndex++;
-		topicFilterIndex++;
+		RyanMqttMsgListLock(client);
+		client->msgSnapshotDirty = RyanMqttTrue;
+		RyanMqttMsgListUnLock(client);
 	}
 
-	// 如果已到达两个字符串的末尾，则它们匹配。这表示当主题过滤器在非起始位置包含 "+"
-	// 通配符时的情况。 例如，当将 "sport/+/player" 或 "sport/hockey/+" 主题过滤器与
-	// "sport/hockey/player" 主题名称匹配时。
-	if (matchFound == RyanMqttFalse)
+	return snapshot;
+}
+
+/**
+ * @brief 释放订阅快照引用，最后一个引用释放时销毁快照
+ *
+ * @param client
+ * @param snapshot 可以为NULL
+ */
+void RyanMqttMsgSnapshotRelease(RyanMqttClient_t *client, RyanMqttMsgSnapshot_t *snapshot)
+{
+	uint32_t refCount;
+	RyanMqttAssert(NULL != client);
+
+	if (NULL == snapshot)
 	{
-		matchFound = (RyanMqttBool_e)((topicIndex == topicLength) && (topicFilterIndex == topicFilterLength));
+		return;
 	}
 
-	return matchFound;
+#if RyanMqttAtomicEnable
+	refCount = atomic_fetch_sub_explicit(&snapshot->refCount, 1, memory_order_acq_rel) - 1U;
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	refCount = --snapshot->refCount;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+
+	if (0 == refCount)
+	{
+		platformMemoryFree(snapshot);
+	}
 }
 
 /**
- * @brief 检查消息处理程序的主题是否与给定主题匹配
+ * @brief 销毁客户端时释放mqtt线程和发布者持有的订阅快照
  *
+ * @param client
+ */
+void RyanMqttMsgSnapshotDestroy(RyanMqttClient_t *client)
+{
+	RyanMqttAssert(NULL != client);
+
+	RyanMqttMsgSnapshotRelease(client, client->msgSnapshotLocal);
+	client->msgSnapshotLocal = NULL;
+	RyanMqttMsgMatchCacheInvalidate(client);
+
+	RyanMqttMsgSnapshotRelease(client, client->msgSnapshot);
+	client->msgSnapshot = NULL;
+}
+
+/**
+ * @brief 将消息交给单个订阅处理，有回调函数时直接调用，否则标记需要触发 RyanMqttEventData 事件
+ *
+ * @param client
  * @param msgHandler
- * @param topic
- * @param topicLen
- * @param isTopicMatchedFlag
- * @return RyanMqttBool_e
+ * @param msgData
+ * @param pEventFlag
  */
-static RyanMqttBool_e RyanMqttMsgTopicIsMatch(RyanMqttMsgHandler_t *msgHandler, const char *topic, uint16_t topicLen,
-					      RyanMqttBool_e isTopicMatchedFlag)
+static void RyanMqttMsgDeliver(RyanMqttClient_t *client, RyanMqttMsgHandler_t *msgHandler, RyanMqttMsgData_t *msgData,
+			       RyanMqttBool_e *pEventFlag)
 {
-	// 不进行通配符匹配
-	if (RyanMqttTrue != isTopicMatchedFlag)
+	if (NULL != msgHandler->msgHandle)
 	{
-		// 不相等跳过
-		if (topicLen != msgHandler->topicLen)
+		// 使能回调工作线程时只收集回调，由 RyanMqttDispatchMsg 和消息拷贝一起入队
+		if (NULL != client->dispatchPool)
 		{
-			return RyanMqttFalse;
+			RyanMqttDispatchCollect(client, msgHandler->msgHandle, msgHandler->userData);
 		}
-
-		// 主题名称不相等且没有使能通配符匹配
-		if (0 != RyanMqttStrncmp(topic, msgHandler->topic, topicLen))
+		else
 		{
-			return RyanMqttFalse;
+			msgHandler->msgHandle(client, msgData, msgHandler->userData);
 		}
 	}
 	else
 	{
-		// 进行通配符匹配
-		if (RyanMqttTrue != RyanMqttMatchTopic(topic, topicLen, msgHandler->topic, msgHandler->topicLen))
-		{
-			return RyanMqttFalse;
-		}
+		*pEventFlag = RyanMqttTrue;
 	}
-
-	return RyanMqttTrue;
 }
 
 /**
- * @brief 创建msg句柄
+ * @brief 创建msg句柄，通配符订阅同时预编译主题过滤器层级
  *
  * @param topic
  * @param topicLen
@@ -222,18 +637,47 @@ RyanMqttError_e RyanMqttMsgHandlerCreate(RyanMqttClient_t *client, const char *t
 	RyanMqttAssert(NULL != pMsgHandler);
 	RyanMqttAssert(RyanMqttQos0 == qos || RyanMqttQos1 == qos || RyanMqttQos2 == qos || RyanMqttSubFail == qos);
 
-	uint32_t mallocSize = sizeof(RyanMqttMsgHandler_t) + topicLen + 1;
+	// 只有通配符订阅需要按层级匹配，层级信息和主题跟随msg句柄一起申请
+	uint32_t levelCount = 0;
+	if (RyanMqttTrue == RyanMqttTopicHasWildcard(topic, topicLen))
+	{
+		levelCount = RyanMqttTopicLevelCount(topic, topicLen);
+		if (levelCount > UINT16_MAX)
+		{
+			levelCount = 0;
+		}
+	}
+
+	uint32_t mallocSize = sizeof(RyanMqttMsgHandler_t) + sizeof(RyanMqttTopicLevel_t) * levelCount + topicLen + 1;
 	RyanMqttMsgHandler_t *msgHandler = (RyanMqttMsgHandler_t *)platformMemoryMalloc(mallocSize);
 	RyanMqttCheck(NULL != msgHandler, RyanMqttNotEnoughMemError, RyanMqttLog_d);
 
 	msgHandler->packetId = packetId;
 	msgHandler->topicLen = topicLen;
 	msgHandler->qos = qos;
-	RyanMqttListInit(&msgHandler->list); // 初始化链表
+	RyanMqttListInit(&msgHandler->list);     // 初始化链表
+	RyanMqttListInit(&msgHandler->hashList); // 初始化索引链表
 	msgHandler->userData = userData;
-	msgHandler->topic = (char *)msgHandler + sizeof(RyanMqttMsgHandler_t);
+	msgHandler->msgHandle = NULL;
+	msgHandler->topicLevels = (RyanMqttTopicLevel_t *)((uint8_t *)msgHandler + sizeof(RyanMqttMsgHandler_t));
+	msgHandler->topic = (char *)&msgHandler->topicLevels[levelCount];
 	RyanMqttMemcpy(msgHandler->topic, topic, topicLen);
 	msgHandler->topic[topicLen] = '\0'; // 兼容旧版本
+	msgHandler->topicHash = RyanMqttTopicHash(topic, topicLen);
+
+	// 不符合规范的主题过滤器不进行预编译，匹配时使用逐字节匹配
+	msgHandler->topicLevelCount = (uint16_t)levelCount;
+	if (0 != levelCount && RyanMqttTrue != RyanMqttTopicFilterCompile(msgHandler->topic, topicLen,
+									  msgHandler->topicLevels,
+									  msgHandler->topicLevelCount))
+	{
+		msgHandler->topicLevelCount = 0;
+	}
+
+	if (0 == msgHandler->topicLevelCount)
+	{
+		msgHandler->topicLevels = NULL;
+	}
 
 	*pMsgHandler = msgHandler;
 	return RyanMqttSuccessError;
@@ -253,6 +697,7 @@ void RyanMqttMsgHandlerDestroy(RyanMqttClient_t *client, RyanMqttMsgHandler_t *m
 
 /**
  * @brief 查找msg句柄
+ * 精确查找只遍历同一索引链表，通配符匹配返回第一个匹配的订阅
  *
  * @param client
  * @param msgMatchCriteria
@@ -266,7 +711,6 @@ RyanMqttError_e RyanMqttMsgHandlerFind(RyanMqttClient_t *client, RyanMqttMsgHand
 				       RyanMqttBool_e removeOnMatch)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
-	RyanMqttList_t *curr, *next;
 	RyanMqttMsgHandler_t *msgHandler;
 
 	RyanMqttAssert(NULL != client);
@@ -274,31 +718,144 @@ RyanMqttError_e RyanMqttMsgHandlerFind(RyanMqttClient_t *client, RyanMqttMsgHand
 	RyanMqttAssert(NULL != msgMatchCriteria->topic && 0 != msgMatchCriteria->topicLen);
 	RyanMqttAssert(NULL != pMsgHandler);
 
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
-	RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
+	const char *topic = msgMatchCriteria->topic;
+	uint16_t topicLen = msgMatchCriteria->topicLen;
+	uint32_t topicHash = RyanMqttTopicHash(topic, topicLen);
+
+	RyanMqttMsgListLock(client);
+
+	if (RyanMqttTrue != isTopicMatchedFlag)
 	{
-		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
+		msgHandler = RyanMqttMsgIndexFindExact(RyanMqttMsgIndexList(client, topic, topicLen, topicHash), topic,
+						       topicLen, topicHash);
+	}
+	else
+	{
+		msgHandler = RyanMqttMsgMatchFirst(client, topic, topicLen, topicHash);
+	}
+
+	if (NULL == msgHandler)
+	{
+		result = RyanMqttNoRescourceError;
+		goto __exit;
+	}
+
+	if (RyanMqttTrue == removeOnMatch)
+	{
+		RyanMqttMsgHandlerRemoveToMsgList(client, msgHandler);
+	}
+	*pMsgHandler = msgHandler;
+	result = RyanMqttSuccessError;
+
+__exit:
+	RyanMqttMsgListUnLock(client);
+	return result;
+}
 
-		if (RyanMqttFalse == RyanMqttMsgTopicIsMatch(msgHandler, msgMatchCriteria->topic,
-							     msgMatchCriteria->topicLen, isTopicMatchedFlag))
+/**
+ * @brief 将接收到的消息分发给匹配的订阅，只能在mqtt线程中调用
+ * 默认分发给所有匹配的订阅，使能 msgFirstMatchFlag 后只分发给第一个匹配的订阅。同名订阅只分发一次。
+ * 匹配过程只读取订阅快照，不获取 msgHandleLock，订阅修改不会阻塞消息分发。
+ * 订阅刚修改时可能还会按旧快照分发一次，回调收到的msg句柄是快照中的拷贝
+ *
+ * @param client
+ * @param msgData
+ * @param pEventFlag 匹配的订阅中存在未设置回调函数的，需要触发 RyanMqttEventData 事件
+ * @return RyanMqttError_e 没有匹配的订阅时返回 RyanMqttNoRescourceError，快照内存不足时返回 RyanMqttNotEnoughMemError
+ */
+RyanMqttError_e RyanMqttMsgHandlerDispatch(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData,
+					   RyanMqttBool_e *pEventFlag)
+{
+	RyanMqttMsgSnapshot_t *snapshot;
+	RyanMqttMsgHandler_t *msgHandler;
+	RyanMqttTopicSplit_t topicSplit;
+	uint32_t matchCount = 0;
+
+	RyanMqttAssert(NULL != client);
+	RyanMqttAssert(NULL != msgData);
+	RyanMqttAssert(NULL != msgData->topic && 0 != msgData->topicLen);
+	RyanMqttAssert(NULL != pEventFlag);
+
+	const char *topic = msgData->topic;
+	uint16_t topicLen = (uint16_t)msgData->topicLen;
+	uint32_t topicHash = RyanMqttTopicHash(topic, topicLen);
+	*pEventFlag = RyanMqttFalse;
+
+	// 订阅没有变化时只需要读取一次快照指针，发生变化时切换到最新快照
+	// msgSnapshotLocal 持有旧快照引用，旧快照地址不会被复用
+#if RyanMqttAtomicEnable
+	snapshot = atomic_load_explicit(&client->msgSnapshot, memory_order_acquire);
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	snapshot = client->msgSnapshot;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+	if (NULL == client->msgSnapshotLocal || client->msgSnapshotLocal != snapshot)
+	{
+		snapshot = RyanMqttMsgSnapshotAcquire(client);
+		RyanMqttMsgSnapshotRelease(client, client->msgSnapshotLocal);
+		client->msgSnapshotLocal = snapshot;
+		RyanMqttMsgMatchCacheInvalidate(client);
+	}
+
+	snapshot = client->msgSnapshotLocal;
+	RyanMqttCheck(NULL != snapshot, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+
+	if (RyanMqttTrue == client->config.msgFirstMatchFlag)
+	{
+		msgHandler = RyanMqttMsgSnapshotMatchFirst(client, snapshot, topic, topicLen, topicHash);
+		if (NULL != msgHandler)
+		{
+			RyanMqttMsgDeliver(client, msgHandler, msgData, pEventFlag);
+			matchCount++;
+		}
+		goto __exit;
+	}
+
+	// 精确订阅，同名订阅只取第一个
+	msgHandler = RyanMqttMsgSnapshotFindExact(snapshot, topic, topicLen, topicHash);
+	if (NULL != msgHandler)
+	{
+		RyanMqttMsgDeliver(client, msgHandler, msgData, pEventFlag);
+		matchCount++;
+	}
+
+	// 通配符订阅，报文主题只拆分一次
+	if (0 != snapshot->wildcardCount)
+	{
+		RyanMqttTopicSplit(&topicSplit, topic, topicLen);
+	}
+
+	for (uint16_t i = 0; i < snapshot->wildcardCount; i++)
+	{
+		uint16_t prev;
+		msgHandler = &snapshot->msgHandlers[snapshot->wildcardIndex[i]];
+		if (RyanMqttTrue != RyanMqttMsgTopicIsMatchLevels(msgHandler, &topicSplit))
 		{
 			continue;
 		}
 
-		if (RyanMqttTrue == removeOnMatch)
+		// 前面已经有同名订阅处理过了,比如重复订阅还未收到suback时
+		for (prev = 0; prev < i; prev++)
 		{
-			RyanMqttMsgHandlerRemoveToMsgList(client, msgHandler);
+			RyanMqttMsgHandler_t *prevHandler = &snapshot->msgHandlers[snapshot->wildcardIndex[prev]];
+			if (prevHandler->topicHash == msgHandler->topicHash &&
+			    RyanMqttTrue == RyanMqttMsgTopicIsMatch(prevHandler, msgHandler->topic, msgHandler->topicLen,
+								    RyanMqttFalse))
+			{
+				break;
+			}
 		}
-		*pMsgHandler = msgHandler;
-		result = RyanMqttSuccessError;
-		goto __exit;
-	}
 
-	result = RyanMqttNoRescourceError;
+		if (prev == i)
+		{
+			RyanMqttMsgDeliver(client, msgHandler, msgData, pEventFlag);
+			matchCount++;
+		}
+	}
 
 __exit:
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
-	return result;
+	return (0 == matchCount) ? RyanMqttNoRescourceError : RyanMqttSuccessError;
 }
 
 /**
@@ -319,10 +876,15 @@ void RyanMqttMsgHandlerFindAndDestroyByPacketId(RyanMqttClient_t *client, RyanMq
 	RyanMqttAssert(NULL != msgMatchCriteria);
 	RyanMqttAssert(NULL != msgMatchCriteria->topic && 0 != msgMatchCriteria->topicLen);
 
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
-	RyanMqttListForEachSafe(curr, next, &client->msgHandlerList)
+	uint32_t topicHash = RyanMqttTopicHash(msgMatchCriteria->topic, msgMatchCriteria->topicLen);
+
+	RyanMqttMsgListLock(client);
+	// 同名订阅一定在同一个索引链表中
+	RyanMqttListForEachSafe(curr, next,
+				RyanMqttMsgIndexList(client, msgMatchCriteria->topic, msgMatchCriteria->topicLen,
+						     topicHash))
 	{
-		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, list);
+		msgHandler = RyanMqttListEntry(curr, RyanMqttMsgHandler_t, hashList);
 
 		if (RyanMqttFalse == skipSamePacketId)
 		{
@@ -339,7 +901,8 @@ void RyanMqttMsgHandlerFindAndDestroyByPacketId(RyanMqttClient_t *client, RyanMq
 			}
 		}
 
-		if (RyanMqttFalse == RyanMqttMsgTopicIsMatch(msgHandler, msgMatchCriteria->topic,
+		if (topicHash != msgHandler->topicHash ||
+		    RyanMqttFalse == RyanMqttMsgTopicIsMatch(msgHandler, msgMatchCriteria->topic,
 							     msgMatchCriteria->topicLen, RyanMqttFalse))
 		{
 			continue;
@@ -352,7 +915,7 @@ void RyanMqttMsgHandlerFindAndDestroyByPacketId(RyanMqttClient_t *client, RyanMq
 		// ?理论上最多只会有一个同名订阅，或许也不好说？ 比如订阅的时侯数组内部有同名的？
 		// break;
 	}
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListUnLock(client);
 }
 
 /**
@@ -367,9 +930,19 @@ RyanMqttError_e RyanMqttMsgHandlerAddToMsgList(RyanMqttClient_t *client, RyanMqt
 	RyanMqttAssert(NULL != client);
 	RyanMqttAssert(NULL != msgHandler);
 
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListLock(client);
 	RyanMqttListAddTail(&msgHandler->list, &client->msgHandlerList); // 将msgHandler节点添加到链表尾部
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttListAddTail(&msgHandler->hashList, RyanMqttMsgIndexList(client, msgHandler->topic, msgHandler->topicLen,
+									 msgHandler->topicHash));
+#if RyanMqttAtomicEnable
+	atomic_fetch_add_explicit(&client->msgHandlerCount, 1, memory_order_relaxed);
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	client->msgHandlerCount++;
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+	RyanMqttMsgListMarkDirty(client);
+	RyanMqttMsgListUnLock(client);
 
 	return RyanMqttSuccessError;
 }
@@ -386,9 +959,25 @@ RyanMqttError_e RyanMqttMsgHandlerRemoveToMsgList(RyanMqttClient_t *client, Ryan
 	RyanMqttAssert(NULL != client);
 	RyanMqttAssert(NULL != msgHandler);
 
-	platformMutexLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttMsgListLock(client);
 	RyanMqttListDel(&msgHandler->list);
-	platformMutexUnLock(client->config.userData, &client->msgHandleLock);
+	RyanMqttListDel(&msgHandler->hashList);
+	// 修改都在msg链表锁内进行，先判断再减少不会和其他修改交错
+#if RyanMqttAtomicEnable
+	if (atomic_load_explicit(&client->msgHandlerCount, memory_order_relaxed) > 0)
+	{
+		atomic_fetch_sub_explicit(&client->msgHandlerCount, 1, memory_order_relaxed);
+	}
+#else
+	platformCriticalEnter(client->config.userData, &client->criticalLock);
+	if (client->msgHandlerCount > 0)
+	{
+		client->msgHandlerCount--;
+	}
+	platformCriticalExit(client->config.userData, &client->criticalLock);
+#endif
+	RyanMqttMsgListMarkDirty(client);
+	RyanMqttMsgListUnLock(client);
 
 	return RyanMqttSuccessError;
 }
@@ -0,0 +1,463 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttUtil.h"
+#include "RyanMqttLog.h"
+#include "RyanMqttThread.h"
+
+// 离线消息占用的内存大小，消息结构后面依次是溢出存储记录头部、主题、'\0'和数据内容
+#define RyanMqttOfflineMsgSize(topicLen, payloadLen)                                                                   \
+	(sizeof(RyanMqttOfflineMsg_t) + sizeof(RyanMqttOfflineSpillHead_t) + (uint32_t)(topicLen) + 1U +              \
+	 (uint32_t)(payloadLen))
+
+/**
+ * @brief 根据消息后面的溢出存储记录头部填充消息结构
+ *
+ * @param msg
+ * @param size
+ */
+static void RyanMqttOfflineMsgInit(RyanMqttOfflineMsg_t *msg, uint32_t size)
+{
+	RyanMqttOfflineSpillHead_t *head = (RyanMqttOfflineSpillHead_t *)(msg + 1);
+
+	RyanMqttListInit(&msg->list);
+	msg->userData = head->userData;
+	msg->topic = (char *)(head + 1);
+	msg->payload = msg->topic + head->topicLen + 1;
+	msg->payloadLen = head->payloadLen;
+	msg->size = size;
+	msg->topicLen = head->topicLen;
+	msg->qos = (RyanMqttQos_e)head->qos;
+	msg->retain = (0 != head->retain) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 创建离线消息，主题和数据跟随消息一起申请
+ *
+ * @return RyanMqttOfflineMsg_t* 内存不足时返回NULL
+ */
+static RyanMqttOfflineMsg_t *RyanMqttOfflineMsgCreate(char *topic, uint16_t topicLen, char *payload,
+						       uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain,
+						       void *userData)
+{
+	uint32_t size = RyanMqttOfflineMsgSize(topicLen, payloadLen);
+	RyanMqttOfflineMsg_t *msg = (RyanMqttOfflineMsg_t *)platformMemoryMalloc(size);
+	if (NULL == msg)
+	{
+		return NULL;
+	}
+
+	RyanMqttOfflineSpillHead_t *head = (RyanMqttOfflineSpillHead_t *)(msg + 1);
+	head->userData = userData;
+	head->payloadLen = payloadLen;
+	head->topicLen = topicLen;
+	head->qos = (uint8_t)qos;
+	head->retain = (uint8_t)retain;
+
+	char *buf = (char *)(head + 1);
+	RyanMqttMemcpy(buf, topic, topicLen);
+	buf[topicLen] = '\0';
+	if (payloadLen > 0)
+	{
+		RyanMqttMemcpy(buf + topicLen + 1, payload, payloadLen);
+	}
+
+	RyanMqttOfflineMsgInit(msg, size);
+	return msg;
+}
+
+/**
+ * @brief 从内存链表中移除消息，调用前需要持有队列锁
+ *
+ * @param queue
+ * @param msg
+ */
+static void RyanMqttOfflineQueueRemove(RyanMqttOfflineQueue_t *queue, RyanMqttOfflineMsg_t *msg)
+{
+	RyanMqttListDel(&msg->list);
+	queue->memBytes -= msg->size;
+	queue->memCount--;
+}
+
+/**
+ * @brief 内存链表有空间时按顺序从溢出存储中读回消息，调用前需要持有队列锁
+ * 内存链表为空时至少读回一条，保证溢出存储不为空时内存链表一定不为空
+ *
+ * @param queue
+ */
+static void RyanMqttOfflineQueueRefill(RyanMqttOfflineQueue_t *queue)
+{
+	RyanMqttOfflineSpill_t *spill = queue->spill;
+
+	while (0 != queue->spillCount)
+	{
+		uint32_t len = spill->peek(spill->userData);
+		if (0 == len)
+		{
+			RyanMqttLog_e("溢出存储中的记录数和离线队列不一致, spillCount: %d", queue->spillCount);
+			queue->spillCount = 0;
+			break;
+		}
+
+		uint32_t size = sizeof(RyanMqttOfflineMsg_t) + len;
+		if (0 != queue->memCount && queue->memBytes + size > queue->maxBytes)
+		{
+			break;
+		}
+
+		RyanMqttOfflineMsg_t *msg = (RyanMqttOfflineMsg_t *)platformMemoryMalloc(size);
+		if (NULL == msg)
+		{
+			break;
+		}
+
+		// 读取失败或长度不匹配的记录直接丢弃
+		RyanMqttOfflineSpillHead_t *head = (RyanMqttOfflineSpillHead_t *)(msg + 1);
+		RyanMqttError_e result = RyanMqttFailedError;
+		if (len >= sizeof(RyanMqttOfflineSpillHead_t))
+		{
+			result = spill->read(spill->userData, head, len);
+		}
+
+		if (RyanMqttSuccessError != result)
+		{
+			spill->read(spill->userData, NULL, len);
+		}
+
+		queue->spillCount--;
+		if (RyanMqttSuccessError != result || RyanMqttOfflineMsgSize(head->topicLen, head->payloadLen) != size)
+		{
+			RyanMqttLog_e("溢出存储中的记录无效, len: %d", len);
+			platformMemoryFree(msg);
+			continue;
+		}
+
+		RyanMqttOfflineMsgInit(msg, size);
+		RyanMqttListAddTail(&msg->list, &queue->msgList);
+		queue->memBytes += size;
+		queue->memCount++;
+	}
+}
+
+/**
+ * @brief 消息放入队尾，内存缓存已满或溢出存储不为空时写入溢出存储，调用前需要持有队列锁
+ *
+ * @param queue
+ * @param msg 成功后所有权转移给队列
+ * @return RyanMqttError_e 队列已满时返回 RyanMqttNoRescourceError
+ */
+static RyanMqttError_e RyanMqttOfflineQueueAppend(RyanMqttOfflineQueue_t *queue, RyanMqttOfflineMsg_t *msg)
+{
+	if ((uint32_t)queue->memCount + queue->spillCount >= queue->maxCount)
+	{
+		return RyanMqttNoRescourceError;
+	}
+
+	if (0 == queue->spillCount && queue->memBytes + msg->size <= queue->maxBytes)
+	{
+		RyanMqttListAddTail(&msg->list, &queue->msgList);
+		queue->memBytes += msg->size;
+		queue->memCount++;
+		return RyanMqttSuccessError;
+	}
+
+	if (NULL == queue->spill ||
+	    RyanMqttSuccessError !=
+		    queue->spill->write(queue->spill->userData, msg + 1, msg->size - sizeof(RyanMqttOfflineMsg_t)))
+	{
+		return RyanMqttNoRescourceError;
+	}
+
+	queue->spillCount++;
+	platformMemoryFree(msg);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 丢弃队列中最早的一条自身qos策略为 RyanMqttOfflineDropOldest 的消息并触发事件，调用前需要持有队列锁
+ * 溢出存储中的消息比内存中的晚，只在内存链表中查找
+ *
+ * @param client
+ * @param queue
+ * @return RyanMqttBool_e 没有可以丢弃的消息时返回 RyanMqttFalse
+ */
+static RyanMqttBool_e RyanMqttOfflineQueueDiscardOldest(RyanMqttClient_t *client, RyanMqttOfflineQueue_t *queue)
+{
+	RyanMqttList_t *curr, *next;
+
+	RyanMqttOfflineQueueRefill(queue);
+
+	RyanMqttListForEachSafe(curr, next, &queue->msgList)
+	{
+		RyanMqttOfflineMsg_t *msg = RyanMqttListEntry(curr, RyanMqttOfflineMsg_t, list);
+
+		// 其他策略的消息不能为新消息让出空位
+		if (RyanMqttOfflineDropOldest != queue->policy[msg->qos])
+		{
+			continue;
+		}
+
+		RyanMqttOfflineQueueRemove(queue, msg);
+		RyanMqttEventMachine(client, RyanMqttEventOfflineDiscard, (void *)msg);
+		platformMemoryFree(msg);
+
+		RyanMqttOfflineQueueRefill(queue);
+		return RyanMqttTrue;
+	}
+
+	return RyanMqttFalse;
+}
+
+/**
+ * @brief 创建离线发布队列，在 RyanMqttStart 中mqtt线程启动前调用
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttOfflineQueueCreate(RyanMqttClient_t *client)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttOfflineQueue_t *queue;
+
+	RyanMqttAssert(NULL == client->offlineQueue);
+	RyanMqttAssert(0 != client->config.offlineQueueMaxCount);
+
+	queue = (RyanMqttOfflineQueue_t *)platformMemoryMalloc(sizeof(RyanMqttOfflineQueue_t));
+	RyanMqttCheck(NULL != queue, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemset(queue, 0, sizeof(RyanMqttOfflineQueue_t));
+
+	RyanMqttListInit(&queue->msgList);
+	queue->spill = client->config.offlineSpill;
+	queue->userData = client->config.userData;
+	queue->maxBytes = client->config.offlineQueueMaxBytes;
+	if (0 == queue->maxBytes)
+	{
+		queue->maxBytes = RyanMqttOfflineDefaultMaxBytes;
+	}
+	queue->maxCount = client->config.offlineQueueMaxCount;
+	queue->drainRate = client->config.offlineDrainRate;
+	RyanMqttMemcpy(queue->policy, client->config.offlinePolicy, sizeof(queue->policy));
+
+	result = platformMutexInit(queue->userData, &queue->lock);
+	RyanMqttCheckCode(RyanMqttSuccessError == result, result, RyanMqttLog_d, { platformMemoryFree(queue); });
+
+	client->offlineQueue = queue;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 销毁离线发布队列，没有补发的消息直接释放，不触发事件
+ *
+ * @param client
+ */
+void RyanMqttOfflineQueueDestroy(RyanMqttClient_t *client)
+{
+	RyanMqttOfflineQueue_t *queue = client->offlineQueue;
+	RyanMqttList_t *curr, *next;
+
+	if (NULL == queue)
+	{
+		return;
+	}
+
+	client->offlineQueue = NULL;
+
+	RyanMqttListForEachSafe(curr, next, &queue->msgList)
+	{
+		RyanMqttOfflineMsg_t *msg = RyanMqttListEntry(curr, RyanMqttOfflineMsg_t, list);
+		RyanMqttListDel(&msg->list);
+		platformMemoryFree(msg);
+	}
+
+	// 溢出存储中的记录只在当前进程内有效，随队列一起丢弃
+	for (; 0 != queue->spillCount; queue->spillCount--)
+	{
+		queue->spill->read(queue->spill->userData, NULL, 0);
+	}
+
+	platformMutexDestroy(queue->userData, &queue->lock);
+	platformMemoryFree(queue);
+}
+
+/**
+ * @brief 使能离线队列时的发布接口。已连接且队列为空时直接发送，否则按qos对应的策略缓存
+ *
+ * @param client
+ * @param topic
+ * @param topicLen
+ * @param payload
+ * @param payloadLen
+ * @param qos
+ * @param retain
+ * @param userData
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttOfflineQueuePublish(RyanMqttClient_t *client, char *topic, uint16_t topicLen, char *payload,
+					    uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain,
+					    void *userData)
+{
+	RyanMqttOfflineQueue_t *queue = client->offlineQueue;
+	RyanMqttOfflinePolicy_e policy = queue->policy[qos];
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttOfflineMsg_t *msg;
+
+	platformMutexLock(queue->userData, &queue->lock);
+
+	// 队列不为空时新消息排到队尾，保证补发的消息和新消息的先后顺序
+	if (RyanMqttConnectState == RyanMqttGetClientState(client) &&
+	    (0 == queue->memCount + queue->spillCount || RyanMqttOfflineNotQueue == policy))
+	{
+		result = RyanMqttPublishPacket(client, topic, topicLen, payload, payloadLen, qos, retain, userData);
+		if (RyanMqttNotConnectError != result)
+		{
+			goto __exit;
+		}
+	}
+
+	if (RyanMqttOfflineNotQueue == policy)
+	{
+		result = RyanMqttNotConnectError;
+		goto __exit;
+	}
+
+	// 超过内存缓存上限的消息无法缓存
+	RyanMqttCheckCodeNoReturn(RyanMqttOfflineMsgSize(topicLen, payloadLen) <= queue->maxBytes,
+				  RyanMqttNoRescourceError, RyanMqttLog_d, {
+					  result = RyanMqttNoRescourceError;
+					  goto __exit;
+				  });
+
+	msg = RyanMqttOfflineMsgCreate(topic, topicLen, payload, payloadLen, qos, retain, userData);
+	RyanMqttCheckCodeNoReturn(NULL != msg, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+
+	// 队列已满时按策略丢弃最早的同策略消息，直到新消息放得下
+	while (RyanMqttSuccessError != (result = RyanMqttOfflineQueueAppend(queue, msg)))
+	{
+		if (RyanMqttOfflineDropOldest != policy ||
+		    RyanMqttTrue != RyanMqttOfflineQueueDiscardOldest(client, queue))
+		{
+			platformMemoryFree(msg);
+			break;
+		}
+	}
+
+__exit:
+	platformMutexUnLock(queue->userData, &queue->lock);
+	return result;
+}
+
+/**
+ * @brief 按发布顺序补发离线队列中的消息，只能在mqtt线程中调用
+ * 补发期间持有队列锁，用户线程的新发布会等待补发完成后排到队尾
+ *
+ * @param client
+ * @param connectedFlag 刚连接成功，重新开始限速计时
+ */
+void RyanMqttOfflineQueueDrain(RyanMqttClient_t *client, RyanMqttBool_e connectedFlag)
+{
+	RyanMqttOfflineQueue_t *queue = client->offlineQueue;
+	RyanMqttError_e result;
+
+	if (NULL == queue)
+	{
+		return;
+	}
+
+	platformMutexLock(queue->userData, &queue->lock);
+	uint32_t now = platformUptimeMs();
+
+	// 之前内存不足时可能没有读回溢出存储中的消息
+	RyanMqttOfflineQueueRefill(queue);
+
+	if (RyanMqttTrue == connectedFlag || 0 == queue->memCount)
+	{
+		queue->drainTime = now;
+		queue->drainCount = 0;
+	}
+
+	while (0 != queue->memCount && RyanMqttConnectState == RyanMqttGetClientState(client))
+	{
+		// 限速时第一条消息立即发送，之后每 1000 / drainRate ms 发送一条
+		if (0 != queue->drainRate &&
+		    queue->drainCount >= (uint64_t)(now - queue->drainTime) * queue->drainRate / 1000 + 1)
+		{
+			break;
+		}
+
+		RyanMqttOfflineMsg_t *msg = RyanMqttListFirstEntry(&queue->msgList, RyanMqttOfflineMsg_t, list);
+		result = RyanMqttPublishPacket(client, msg->topic, msg->topicLen, msg->payload, msg->payloadLen,
+					       msg->qos, msg->retain, msg->userData);
+
+		// 连接已断开或内存不足时保留在队列中，下次继续补发
+		if (RyanMqttNotConnectError == result || RyanMqttNotEnoughMemError == result)
+		{
+			break;
+		}
+
+		RyanMqttOfflineQueueRemove(queue, msg);
+		platformMemoryFree(msg);
+		RyanMqttOfflineQueueRefill(queue);
+		queue->drainCount++;
+	}
+
+	platformMutexUnLock(queue->userData, &queue->lock);
+}
+
+/**
+ * @brief 获取距离下一条离线消息可以补发的时间
+ *
+ * @param client
+ * @return uint32_t 单位ms，队列为空时返回 UINT32_MAX
+ */
+uint32_t RyanMqttOfflineQueueDrainRemain(RyanMqttClient_t *client)
+{
+	RyanMqttOfflineQueue_t *queue = client->offlineQueue;
+	uint32_t remain = 0;
+
+	if (NULL == queue)
+	{
+		return UINT32_MAX;
+	}
+
+	platformMutexLock(queue->userData, &queue->lock);
+	if (0 == queue->memCount + queue->spillCount)
+	{
+		remain = UINT32_MAX;
+	}
+	else if (0 != queue->drainRate)
+	{
+		uint32_t elapsed = platformUptimeMs() - queue->drainTime;
+		uint32_t sendTime =
+			(uint32_t)(((uint64_t)queue->drainCount * 1000 + queue->drainRate - 1) / queue->drainRate);
+		remain = (sendTime > elapsed) ? sendTime - elapsed : 0;
+	}
+	platformMutexUnLock(queue->userData, &queue->lock);
+
+	return remain;
+}
+
+/**
+ * @brief 获取离线队列中的消息数
+ *
+ * @param client
+ * @return uint32_t
+ */
+uint32_t RyanMqttOfflineQueueGetCount(RyanMqttClient_t *client)
+{
+	RyanMqttOfflineQueue_t *queue = client->offlineQueue;
+	uint32_t count;
+
+	if (NULL == queue)
+	{
+		return 0;
+	}
+
+	platformMutexLock(queue->userData, &queue->lock);
+	count = (uint32_t)queue->memCount + queue->spillCount;
+	platformMutexUnLock(queue->userData, &queue->lock);
+
+	return count;
+}
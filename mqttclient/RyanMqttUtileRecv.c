@@ -0,0 +1,256 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttUtil.h"
+#include "RyanMqttLog.h"
+
+/**
+ * @brief 创建拉取模式接收队列，在 RyanMqttStart 中mqtt线程启动前调用
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttRecvRingCreate(RyanMqttClient_t *client)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttRecvRing_t *ring;
+	RyanMqttBool_e lockIsOk = RyanMqttFalse;
+	RyanMqttBool_e itemSemIsOk = RyanMqttFalse;
+
+	RyanMqttAssert(NULL == client->recvRing);
+	RyanMqttAssert(0 != client->config.recvQueueSize);
+
+	// 环形缓冲区跟随队列一起申请
+	ring = (RyanMqttRecvRing_t *)platformMemoryMalloc(sizeof(RyanMqttRecvRing_t) +
+							  sizeof(RyanMqttMsgData_t) * client->config.recvQueueSize);
+	RyanMqttCheck(NULL != ring, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemset(ring, 0, sizeof(RyanMqttRecvRing_t));
+
+	ring->items = (RyanMqttMsgData_t *)(ring + 1);
+	ring->userData = client->config.userData;
+	ring->size = client->config.recvQueueSize;
+
+	result = platformCriticalInit(ring->userData, &ring->lock);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+	lockIsOk = RyanMqttTrue;
+
+	result = platformSemaphoreInit(ring->userData, &ring->itemSem, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+	itemSemIsOk = RyanMqttTrue;
+
+	result = platformSemaphoreInit(ring->userData, &ring->spaceSem, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+
+	client->recvRing = ring;
+	return RyanMqttSuccessError;
+
+__exit:
+	if (itemSemIsOk)
+	{
+		platformSemaphoreDestroy(ring->userData, &ring->itemSem);
+	}
+
+	if (lockIsOk)
+	{
+		platformCriticalDestroy(ring->userData, &ring->lock);
+	}
+
+	platformMemoryFree(ring);
+	return result;
+}
+
+/**
+ * @brief 销毁拉取模式接收队列，队列中未读取的消息直接释放
+ * 先关闭队列并唤醒所有阻塞的读取线程，等它们全部退出后再释放。用户已经读取但还没释放的消息不受影响
+ *
+ * @param client
+ */
+void RyanMqttRecvRingDestroy(RyanMqttClient_t *client)
+{
+	RyanMqttRecvRing_t *ring = client->recvRing;
+
+	if (NULL == ring)
+	{
+		return;
+	}
+
+	while (1)
+	{
+		platformCriticalEnter(ring->userData, &ring->lock);
+		ring->closeFlag = RyanMqttTrue;
+		uint16_t readerCount = ring->readerCount;
+		platformCriticalExit(ring->userData, &ring->lock);
+
+		if (0 == readerCount)
+		{
+			break;
+		}
+
+		// 每个阻塞的读取线程都需要一次唤醒，被唤醒后看到关闭标志就退出
+		for (uint16_t i = 0; i < readerCount; i++)
+		{
+			platformSemaphoreGive(ring->userData, &ring->itemSem);
+		}
+		platformDelay(1);
+	}
+
+	for (uint16_t i = 0; i < ring->count; i++)
+	{
+		platformMemoryFree(ring->items[(ring->head + i) % ring->size].packetBuf);
+	}
+
+	platformSemaphoreDestroy(ring->userData, &ring->spaceSem);
+	platformSemaphoreDestroy(ring->userData, &ring->itemSem);
+	platformCriticalDestroy(ring->userData, &ring->lock);
+	platformMemoryFree(ring);
+	client->recvRing = NULL;
+}
+
+/**
+ * @brief 消息放入接收队列，只能在mqtt线程中调用
+ * mqtt线程只在队列有空位时读取socket，正常情况下不会失败
+ *
+ * @param client
+ * @param msgData 成功后接收缓冲区 packetBuf 的所有权转移给队列
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttRecvRingPush(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData)
+{
+	RyanMqttRecvRing_t *ring = client->recvRing;
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	RyanMqttAssert(NULL != ring);
+	RyanMqttAssert(NULL != msgData->packetBuf);
+
+	platformCriticalEnter(ring->userData, &ring->lock);
+	if (ring->count >= ring->size)
+	{
+		result = RyanMqttNoRescourceError;
+	}
+	else
+	{
+		uint16_t tail = (uint16_t)((ring->head + ring->count) % ring->size);
+		RyanMqttMemcpy(&ring->items[tail], msgData, sizeof(RyanMqttMsgData_t));
+		ring->count++;
+	}
+	platformCriticalExit(ring->userData, &ring->lock);
+
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+	platformSemaphoreGive(ring->userData, &ring->itemSem);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 等待接收队列出现空位，队列已满时mqtt线程不再读取socket，让tcp背压传递到broker
+ *
+ * @param client
+ * @param timeoutMs
+ * @return RyanMqttBool_e 没有使能拉取模式或队列有空位时返回 RyanMqttTrue
+ */
+RyanMqttBool_e RyanMqttRecvRingWaitSpace(RyanMqttClient_t *client, uint32_t timeoutMs)
+{
+	RyanMqttRecvRing_t *ring = client->recvRing;
+	RyanMqttBool_e spaceFlag;
+
+	if (NULL == ring)
+	{
+		return RyanMqttTrue;
+	}
+
+	platformCriticalEnter(ring->userData, &ring->lock);
+	spaceFlag = (ring->count < ring->size) ? RyanMqttTrue : RyanMqttFalse;
+	if (RyanMqttTrue != spaceFlag)
+	{
+		ring->spaceWaitFlag = RyanMqttTrue;
+	}
+	platformCriticalExit(ring->userData, &ring->lock);
+
+	if (RyanMqttTrue == spaceFlag)
+	{
+		return RyanMqttTrue;
+	}
+
+	platformSemaphoreTake(ring->userData, &ring->spaceSem, timeoutMs);
+
+	platformCriticalEnter(ring->userData, &ring->lock);
+	spaceFlag = (ring->count < ring->size) ? RyanMqttTrue : RyanMqttFalse;
+	platformCriticalExit(ring->userData, &ring->lock);
+
+	return spaceFlag;
+}
+
+/**
+ * @brief 从接收队列读取消息，队列为空时等待，读取到至少一条消息后立即返回
+ * 支持多个线程同时读取。读取期间记录在 readerCount 中，队列销毁时会等待读取线程退出
+ *
+ * @param client
+ * @param msgDatas
+ * @param maxCount
+ * @param timeoutMs
+ * @return int32_t 读取到的消息数，超时返回0，队列已关闭返回-1
+ */
+int32_t RyanMqttRecvRingPop(RyanMqttClient_t *client, RyanMqttMsgData_t msgDatas[], int32_t maxCount,
+			    uint32_t timeoutMs)
+{
+	RyanMqttRecvRing_t *ring = client->recvRing;
+	RyanMqttTimer_t timer;
+	int32_t count;
+
+	RyanMqttAssert(NULL != ring);
+	RyanMqttTimerCutdown(&timer, timeoutMs);
+
+	platformCriticalEnter(ring->userData, &ring->lock);
+	if (RyanMqttTrue == ring->closeFlag)
+	{
+		platformCriticalExit(ring->userData, &ring->lock);
+		return -1;
+	}
+	ring->readerCount++;
+	platformCriticalExit(ring->userData, &ring->lock);
+
+	while (1)
+	{
+		RyanMqttBool_e spaceGiveFlag = RyanMqttFalse;
+
+		count = 0;
+		platformCriticalEnter(ring->userData, &ring->lock);
+		if (RyanMqttTrue == ring->closeFlag)
+		{
+			count = -1;
+		}
+
+		while (count >= 0 && count < maxCount && 0 != ring->count)
+		{
+			RyanMqttMemcpy(&msgDatas[count], &ring->items[ring->head], sizeof(RyanMqttMsgData_t));
+			ring->head = (uint16_t)((ring->head + 1U) % ring->size);
+			ring->count--;
+			count++;
+		}
+
+		if (count > 0 && RyanMqttTrue == ring->spaceWaitFlag)
+		{
+			ring->spaceWaitFlag = RyanMqttFalse;
+			spaceGiveFlag = RyanMqttTrue;
+		}
+		platformCriticalExit(ring->userData, &ring->lock);
+
+		if (RyanMqttTrue == spaceGiveFlag)
+		{
+			platformSemaphoreGive(ring->userData, &ring->spaceSem);
+		}
+
+		// itemSem 只用于唤醒，批量读取后可能残留计数，被唤醒后需要重新检查队列
+		uint32_t timeRemain = RyanMqttTimerRemain(&timer);
+		if (0 != count || 0 == timeRemain)
+		{
+			break;
+		}
+		platformSemaphoreTake(ring->userData, &ring->itemSem, timeRemain);
+	}
+
+	// 退出后不能再访问队列，销毁线程看到读取线程数为0后就会释放
+	platformCriticalEnter(ring->userData, &ring->lock);
+	ring->readerCount--;
+	platformCriticalExit(ring->userData, &ring->lock);
+	return count;
+}
@@ -0,0 +1,643 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttUtil.h"
+#include "RyanMqttLog.h"
+
+// 根据编译器预定义宏选择指令集，编译时添加 -mavx2 使用AVX2，x86_64默认使用SSE2，其余平台使用通用实现
+// 可以定义 RyanMqttTopicMatchDisableSimd 强制使用通用实现
+#if !defined(RyanMqttTopicMatchDisableSimd) && defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#define RyanMqttTopicMatchAvx2
+#define RyanMqttTopicMatchSse2
+#elif !defined(RyanMqttTopicMatchDisableSimd) && defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define RyanMqttTopicMatchSse2
+#endif
+
+/**
+ * @brief 计算主题哈希值(FNV-1a)，用于订阅索引和匹配缓存
+ *
+ * @param topic
+ * @param topicLen
+ * @return uint32_t
+ */
+uint32_t RyanMqttTopicHash(const char *topic, uint16_t topicLen)
+{
+	uint32_t hash = 2166136261U;
+
+	for (uint16_t i = 0; i < topicLen; i++)
+	{
+		hash ^= (uint8_t)topic[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief 获取主题匹配使用的实现名称，用于测试和日志
+ *
+ * @return const char*
+ */
+const char *RyanMqttTopicMatchImplName(void)
+{
+#if defined(RyanMqttTopicMatchAvx2)
+	return "avx2";
+#elif defined(RyanMqttTopicMatchSse2)
+	return "sse2";
+#else
+	return "generic";
+#endif
+}
+
+/**
+ * @brief 查找第一个层级分隔符'/'，按块比较，剩余不足一个块的部分逐字节比较
+ *
+ * @param str
+ * @param len
+ * @return uint16_t 分隔符下标，没有分隔符时返回 len
+ */
+uint16_t RyanMqttTopicFindSeparator(const char *str, uint16_t len)
+{
+	uint32_t index = 0;
+
+#if defined(RyanMqttTopicMatchAvx2)
+	const __m256i separator32 = _mm256_set1_epi8('/');
+	for (; index + 32U <= len; index += 32U)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)(const void *)(str + index));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, separator32));
+		if (0U != mask)
+		{
+			return (uint16_t)(index + (uint32_t)__builtin_ctz(mask));
+		}
+	}
+#endif
+
+#if defined(RyanMqttTopicMatchSse2)
+	const __m128i separator16 = _mm_set1_epi8('/');
+	for (; index + 16U <= len; index += 16U)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)(const void *)(str + index));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, separator16));
+		if (0U != mask)
+		{
+			return (uint16_t)(index + (uint32_t)__builtin_ctz(mask));
+		}
+	}
+#endif
+
+	for (; index < len; index++)
+	{
+		if ('/' == str[index])
+		{
+			break;
+		}
+	}
+
+	return (uint16_t)index;
+}
+
+/**
+ * @brief 查找两段内容第一个不相同的字节，按块比较，剩余不足一个块的部分逐字节比较
+ *
+ * @param str1
+ * @param str2
+ * @param len
+ * @return uint16_t 第一个不相同字节的下标，完全相同时返回 len
+ */
+uint16_t RyanMqttTopicMismatch(const char *str1, const char *str2, uint16_t len)
+{
+	uint32_t index = 0;
+
+#if defined(RyanMqttTopicMatchAvx2)
+	for (; index + 32U <= len; index += 32U)
+	{
+		__m256i block1 = _mm256_loadu_si256((const __m256i *)(const void *)(str1 + index));
+		__m256i block2 = _mm256_loadu_si256((const __m256i *)(const void *)(str2 + index));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block1, block2));
+		if (0U != mask)
+		{
+			return (uint16_t)(index + (uint32_t)__builtin_ctz(mask));
+		}
+	}
+#endif
+
+#if defined(RyanMqttTopicMatchSse2)
+	for (; index + 16U <= len; index += 16U)
+	{
+		__m128i block1 = _mm_loadu_si128((const __m128i *)(const void *)(str1 + index));
+		__m128i block2 = _mm_loadu_si128((const __m128i *)(const void *)(str2 + index));
+		uint32_t mask = 0xFFFFU & ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block1, block2));
+		if (0U != mask)
+		{
+			return (uint16_t)(index + (uint32_t)__builtin_ctz(mask));
+		}
+	}
+#endif
+
+	for (; index < len; index++)
+	{
+		if (str1[index] != str2[index])
+		{
+			break;
+		}
+	}
+
+	return (uint16_t)index;
+}
+
+/**
+ * @brief 按字节比较两段主题内容是否相同，和strncmp不同，不会在'\0'处停止
+ *
+ * @param str1
+ * @param str2
+ * @param len
+ * @return RyanMqttBool_e
+ */
+RyanMqttBool_e RyanMqttTopicEqual(const char *str1, const char *str2, uint16_t len)
+{
+	return (RyanMqttBool_e)(len == RyanMqttTopicMismatch(str1, str2, len));
+}
+
+/**
+ * @brief 根据 MQTT 3.1.1 协议规范确定传递的主题过滤器和主题名称是否匹配的实用程序函数，
+ *          应仅在strcmp / strncmp不相等时再进行通配符匹配
+ * 相同的部分按块跳过(可以跨越多个层级)，只在第一个不相同的位置处理通配符，"+"通配符按块查找分隔符。
+ * 匹配结果与逐字节比较的实现完全一致
+ *
+ * @param topic 要检查的主题名称
+ * @param topicLength 主题名称的长度。
+ * @param topicFilter 要检查的主题过滤器。
+ * @param topicFilterLength 要检查的主题过滤器长度
+ * @return RyanMqttBool_e
+ */
+RyanMqttBool_e RyanMqttMatchTopic(const char *topic, const uint16_t topicLength, const char *topicFilter,
+				  const uint16_t topicFilterLength)
+{
+	uint16_t topicIndex = 0, topicFilterIndex = 0, sameLen;
+
+	RyanMqttAssert((NULL != topic) && (topicLength != 0u));
+	RyanMqttAssert((NULL != topicFilter) && (topicFilterLength != 0u));
+
+	// 不能将 $ 字符开头的主题名匹配通配符 (#或+) 开头的主题过滤器
+	if ((topic[0] == '$') && ((topicFilter[0] == '+') || (topicFilter[0] == '#')))
+	{
+		return RyanMqttFalse;
+	}
+
+	while ((topicIndex < topicLength) && (topicFilterIndex < topicFilterLength))
+	{
+		// 跳过相同的部分
+		sameLen = (uint16_t)(topicLength - topicIndex);
+		if (sameLen > topicFilterLength - topicFilterIndex)
+		{
+			sameLen = (uint16_t)(topicFilterLength - topicFilterIndex);
+		}
+		sameLen = RyanMqttTopicMismatch(&topic[topicIndex], &topicFilter[topicFilterIndex], sameLen);
+		topicIndex = (uint16_t)(topicIndex + sameLen);
+		topicFilterIndex = (uint16_t)(topicFilterIndex + sameLen);
+
+		// 主题名称已被消耗，最后一个字符是相同的
+		if (topicIndex == topicLength)
+		{
+			uint16_t lastFilterIndex = (uint16_t)(topicFilterIndex - 1U);
+
+			// 检查主题筛选器是否有2个剩余字符，并且以"/#"结尾。
+			// 此检查处理将筛选器"sport/#"与主题"sport"匹配的情况。
+			// 原因是"#"通配符表示主题名称中的父级和任意数量的子级。
+			if ((lastFilterIndex + 3U == topicFilterLength) && (topicFilter[lastFilterIndex + 1U] == '/') &&
+			    (topicFilter[lastFilterIndex + 2U] == '#'))
+			{
+				return RyanMqttTrue;
+			}
+
+			// 检查下一个字符是否为"#"或"+"，主题过滤器以"/#"或"/+"结尾。
+			// 此检查处理要匹配的情况：
+			// -主题过滤器"sport/+"与主题"sport/"。
+			// -主题过滤器"sport/#"，主题为"sport/"。
+			if ((lastFilterIndex + 2U == topicFilterLength) && (topicFilter[lastFilterIndex] == '/'))
+			{
+				return (RyanMqttBool_e)((topicFilter[lastFilterIndex + 1U] == '+') ||
+							(topicFilter[lastFilterIndex + 1U] == '#'));
+			}
+			break;
+		}
+
+		if (topicFilterIndex == topicFilterLength)
+		{
+			break;
+		}
+
+		// 主题过滤器中的通配符仅在起始位置或前面有"/"时有效。
+		RyanMqttBool_e locationIsValidForWildcard =
+			(RyanMqttBool_e)((topicFilterIndex == 0u) || (topicFilter[topicFilterIndex - 1U] == '/'));
+
+		if ((topicFilter[topicFilterIndex] == '+') && (locationIsValidForWildcard == RyanMqttTrue))
+		{
+			// 将主题名称索引移动到当前级别的末尾
+			topicIndex = (uint16_t)(topicIndex + RyanMqttTopicFindSeparator(&topic[topicIndex],
+											(uint16_t)(topicLength - topicIndex)));
+
+			RyanMqttBool_e nextLevelExistsinTopicFilter =
+				(RyanMqttBool_e)((topicFilterIndex + 1U < topicFilterLength) &&
+						 (topicFilter[topicFilterIndex + 1U] == '/'));
+
+			// 主题名称已经是最后一个层级，"+"必须是主题过滤器的最后一个字符
+			if (topicIndex == topicLength)
+			{
+				return (RyanMqttBool_e)(topicFilterIndex + 1U == topicFilterLength);
+			}
+
+			// 如果主题名称包含子级别但主题过滤器在当前级别结束，则不存在匹配项。
+			if (RyanMqttTrue != nextLevelExistsinTopicFilter)
+			{
+				return RyanMqttFalse;
+			}
+
+			// 跳过主题名称和主题过滤器中的级别分隔符，在下一个级别继续匹配
+			topicIndex++;
+			topicFilterIndex = (uint16_t)(topicFilterIndex + 2U);
+		}
+		// "#"匹配主题名称中剩余的所有内容。它必须是主题过滤器中的最后一个字符。
+		else if ((topicFilter[topicFilterIndex] == '#') && (topicFilterIndex + 1U == topicFilterLength) &&
+			 (locationIsValidForWildcard == RyanMqttTrue))
+		{
+			return RyanMqttTrue;
+		}
+		else
+		{
+			// 除"+"或"#"以外的任何字符不匹配均表示主题名称与主题过滤器不匹配。
+			return RyanMqttFalse;
+		}
+	}
+
+	// 如果已到达两个字符串的末尾，则它们匹配。这表示当主题过滤器在非起始位置包含 "+"
+	// 通配符时的情况。 例如，当将 "sport/+/player" 或 "sport/hockey/+" 主题过滤器与
+	// "sport/hockey/player" 主题名称匹配时。
+	return (RyanMqttBool_e)((topicIndex == topicLength) && (topicFilterIndex == topicFilterLength));
+}
+
+/**
+ * @brief 计算主题的层级个数
+ *
+ * @param topic
+ * @param topicLen
+ * @return uint32_t
+ */
+uint32_t RyanMqttTopicLevelCount(const char *topic, uint16_t topicLen)
+{
+	uint32_t levelCount = 1;
+
+	for (uint32_t index = RyanMqttTopicFindSeparator(topic, topicLen); index < topicLen; levelCount++)
+	{
+		index += 1U + RyanMqttTopicFindSeparator(&topic[index + 1U], (uint16_t)(topicLen - index - 1U));
+	}
+
+	return levelCount;
+}
+
+/**
+ * @brief 计算层级哈希值，只取层级首尾各4个字节，不需要遍历整个层级。
+ * 只用于快速排除不相同的层级，哈希值相同时还需要比较内容
+ *
+ * @param level
+ * @param len
+ * @return uint32_t
+ */
+static uint32_t RyanMqttTopicLevelQuickHash(const char *level, uint16_t len)
+{
+	uint32_t head, tail;
+
+	if (len >= 4U)
+	{
+		RyanMqttMemcpy(&head, level, sizeof(head));
+		RyanMqttMemcpy(&tail, level + len - 4U, sizeof(tail));
+	}
+	else if (0U != len)
+	{
+		head = (uint32_t)(uint8_t)level[0] | ((uint32_t)(uint8_t)level[len / 2U] << 8);
+		tail = (uint8_t)level[len - 1U];
+	}
+	else
+	{
+		return 0;
+	}
+
+	return (head * 2654435761U) ^ tail;
+}
+
+/**
+ * @brief 解析主题过滤器中从offset开始的一个层级，计算层级哈希值并判断层级类型
+ *
+ * @param topicFilter
+ * @param topicFilterLength
+ * @param offset 层级起始偏移
+ * @param level
+ * @return RyanMqttBool_e 通配符没有独占一个层级时返回 RyanMqttFalse
+ */
+static RyanMqttBool_e RyanMqttTopicLevelParse(const char *topicFilter, uint16_t topicFilterLength, uint16_t offset,
+					      RyanMqttTopicLevel_t *level)
+{
+	uint16_t len = RyanMqttTopicFindSeparator(&topicFilter[offset], (uint16_t)(topicFilterLength - offset));
+
+	level->offset = offset;
+	level->len = len;
+	level->hash = RyanMqttTopicLevelQuickHash(&topicFilter[offset], len);
+	level->type = RyanMqttTopicLevelLiteral;
+
+	for (uint16_t i = 0; i < len; i++)
+	{
+		if ('+' != topicFilter[offset + i] && '#' != topicFilter[offset + i])
+		{
+			continue;
+		}
+
+		// 通配符必须独占一个层级
+		if (1U != len)
+		{
+			return RyanMqttFalse;
+		}
+
+		level->hash = 0;
+		level->type = ('+' == topicFilter[offset]) ? RyanMqttTopicLevelPlus : RyanMqttTopicLevelHash;
+	}
+
+	return RyanMqttTrue;
+}
+
+/**
+ * @brief 预编译主题过滤器，记录每个层级的偏移、长度、哈希值、通配符类型和连续普通层级个数
+ *
+ * @param topicFilter
+ * @param topicFilterLength
+ * @param levels 层级数组，大小为 RyanMqttTopicLevelCount 的返回值
+ * @param levelCount
+ * @return RyanMqttBool_e 主题过滤器不符合规范时返回 RyanMqttFalse，此时只能使用逐字节匹配
+ */
+RyanMqttBool_e RyanMqttTopicFilterCompile(const char *topicFilter, uint16_t topicFilterLength,
+					  RyanMqttTopicLevel_t *levels, uint16_t levelCount)
+{
+	uint32_t offset = 0;
+
+	RyanMqttAssert(NULL != topicFilter && 0 != topicFilterLength);
+	RyanMqttAssert(NULL != levels && 0 != levelCount);
+
+	for (uint16_t i = 0; i < levelCount; i++)
+	{
+		if (RyanMqttTrue != RyanMqttTopicLevelParse(topicFilter, topicFilterLength, (uint16_t)offset, &levels[i]))
+		{
+			return RyanMqttFalse;
+		}
+
+		// "#"必须是主题过滤器的最后一个层级
+		if (RyanMqttTopicLevelHash == levels[i].type && i + 1U != levelCount)
+		{
+			return RyanMqttFalse;
+		}
+
+		offset += levels[i].len + 1U;
+	}
+
+	// 连续的普通层级匹配时可以一次比较整段内容
+	for (uint16_t i = levelCount; i > 0; i--)
+	{
+		RyanMqttTopicLevel_t *level = &levels[i - 1U];
+		if (RyanMqttTopicLevelLiteral != level->type)
+		{
+			level->literalCount = 0;
+		}
+		else
+		{
+			level->literalCount = (uint16_t)((i < levelCount) ? levels[i].literalCount + 1U : 1U);
+		}
+	}
+
+	return RyanMqttTrue;
+}
+
+/**
+ * @brief 添加一个报文主题层级
+ *
+ * @param topicSplit
+ * @param levelStart
+ * @param levelEnd
+ * @return RyanMqttBool_e 超过 RyanMqttTopicLevelMaxCount 时返回 RyanMqttFalse
+ */
+static RyanMqttBool_e RyanMqttTopicSplitAddLevel(RyanMqttTopicSplit_t *topicSplit, uint32_t levelStart,
+						 uint32_t levelEnd)
+{
+	if (topicSplit->levelCount >= RyanMqttTopicLevelMaxCount)
+	{
+		return RyanMqttFalse;
+	}
+
+	RyanMqttTopicLevel_t *level = &topicSplit->levels[topicSplit->levelCount++];
+	level->offset = (uint16_t)levelStart;
+	level->len = (uint16_t)(levelEnd - levelStart);
+	level->hash = RyanMqttTopicLevelQuickHash(&topicSplit->topic[levelStart], level->len);
+	level->type = RyanMqttTopicLevelLiteral;
+	return RyanMqttTrue;
+}
+
+/**
+ * @brief 将报文主题拆分为层级，每个报文只拆分一次，和所有预编译的主题过滤器匹配。
+ * 按块同时查找分隔符和通配符字符，整个主题只扫描一遍。
+ * 层级数超过 RyanMqttTopicLevelMaxCount 或包含通配符字符时 levelCount 为0
+ *
+ * @param topicSplit
+ * @param topic
+ * @param topicLen
+ */
+void RyanMqttTopicSplit(RyanMqttTopicSplit_t *topicSplit, const char *topic, uint16_t topicLen)
+{
+	uint32_t index = 0, levelStart = 0;
+
+	RyanMqttAssert(NULL != topicSplit);
+	RyanMqttAssert(NULL != topic && 0 != topicLen);
+
+	topicSplit->topic = topic;
+	topicSplit->topicLen = topicLen;
+	topicSplit->levelCount = 0;
+
+#if defined(RyanMqttTopicMatchAvx2)
+	const __m256i separator32 = _mm256_set1_epi8('/');
+	const __m256i plus32 = _mm256_set1_epi8('+');
+	const __m256i hash32 = _mm256_set1_epi8('#');
+	for (; index + 32U <= topicLen; index += 32U)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)(const void *)(topic + index));
+		uint32_t wildcardMask = (uint32_t)_mm256_movemask_epi8(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, plus32), _mm256_cmpeq_epi8(block, hash32)));
+		uint32_t separatorMask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, separator32));
+
+		if (0U != wildcardMask)
+		{
+			goto __fallback;
+		}
+
+		for (; 0U != separatorMask; separatorMask &= separatorMask - 1U)
+		{
+			uint32_t levelEnd = index + (uint32_t)__builtin_ctz(separatorMask);
+			if (RyanMqttTrue != RyanMqttTopicSplitAddLevel(topicSplit, levelStart, levelEnd))
+			{
+				goto __fallback;
+			}
+			levelStart = levelEnd + 1U;
+		}
+	}
+#endif
+
+#if defined(RyanMqttTopicMatchSse2)
+	const __m128i separator16 = _mm_set1_epi8('/');
+	const __m128i plus16 = _mm_set1_epi8('+');
+	const __m128i hash16 = _mm_set1_epi8('#');
+	for (; index + 16U <= topicLen; index += 16U)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)(const void *)(topic + index));
+		uint32_t wildcardMask = (uint32_t)_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(block, plus16), _mm_cmpeq_epi8(block, hash16)));
+		uint32_t separatorMask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, separator16));
+
+		if (0U != wildcardMask)
+		{
+			goto __fallback;
+		}
+
+		for (; 0U != separatorMask; separatorMask &= separatorMask - 1U)
+		{
+			uint32_t levelEnd = index + (uint32_t)__builtin_ctz(separatorMask);
+			if (RyanMqttTrue != RyanMqttTopicSplitAddLevel(topicSplit, levelStart, levelEnd))
+			{
+				goto __fallback;
+			}
+			levelStart = levelEnd + 1U;
+		}
+	}
+#endif
+
+	for (; index < topicLen; index++)
+	{
+		// 报文主题不应该包含通配符字符，包含时交给逐字节匹配处理
+		if ('+' == topic[index] || '#' == topic[index])
+		{
+			goto __fallback;
+		}
+
+		if ('/' == topic[index])
+		{
+			if (RyanMqttTrue != RyanMqttTopicSplitAddLevel(topicSplit, levelStart, index))
+			{
+				goto __fallback;
+			}
+			levelStart = index + 1U;
+		}
+	}
+
+	// 最后一个层级，主题以"/"结尾时为空层级
+	if (RyanMqttTrue == RyanMqttTopicSplitAddLevel(topicSplit, levelStart, topicLen))
+	{
+		return;
+	}
+
+__fallback:
+	topicSplit->levelCount = 0;
+}
+
+/**
+ * @brief 按层级匹配报文主题和预编译的主题过滤器，普通层级先比较长度和哈希值，相同时才比较内容，
+ * 连续的普通层级一次比较整段内容。
+ * 匹配结果与 RyanMqttMatchTopic 完全一致，任意一方无法按层级匹配时使用 RyanMqttMatchTopic
+ *
+ * @param topicSplit 拆分后的报文主题
+ * @param topicFilter
+ * @param topicFilterLength
+ * @param filterLevels 预编译的主题过滤器层级
+ * @param filterLevelCount
+ * @return RyanMqttBool_e
+ */
+RyanMqttBool_e RyanMqttMatchTopicLevels(const RyanMqttTopicSplit_t *topicSplit, const char *topicFilter,
+					uint16_t topicFilterLength, const RyanMqttTopicLevel_t *filterLevels,
+					uint16_t filterLevelCount)
+{
+	const RyanMqttTopicLevel_t *topicLevels = topicSplit->levels;
+	uint16_t topicLevelCount = topicSplit->levelCount;
+	uint16_t i;
+
+	if (0 == topicLevelCount || 0 == filterLevelCount)
+	{
+		return RyanMqttMatchTopic(topicSplit->topic, topicSplit->topicLen, topicFilter, topicFilterLength);
+	}
+
+	// 不能将 $ 字符开头的主题名匹配通配符 (#或+) 开头的主题过滤器
+	if ('$' == topicSplit->topic[0] && RyanMqttTopicLevelLiteral != filterLevels[0].type)
+	{
+		return RyanMqttFalse;
+	}
+
+	// 层级数不可能匹配的直接跳过。以"#"结尾的过滤器可以匹配父级，层级数最多比主题多一个
+	if (RyanMqttTopicLevelHash == filterLevels[filterLevelCount - 1U].type)
+	{
+		if (topicLevelCount + 1U < filterLevelCount)
+		{
+			return RyanMqttFalse;
+		}
+	}
+	else if (topicLevelCount != filterLevelCount)
+	{
+		return RyanMqttFalse;
+	}
+
+	for (i = 0; i < topicLevelCount && i < filterLevelCount;)
+	{
+		const RyanMqttTopicLevel_t *topicLevel = &topicLevels[i];
+		const RyanMqttTopicLevel_t *filterLevel = &filterLevels[i];
+
+		// 主题以"/"结尾且上一层级由"+"匹配时，逐字节实现中"+"已经消耗了最后的分隔符，
+		// 此时只有以"+/"结尾的过滤器能匹配，"+/+"、"+/#"均不匹配
+		if (i + 1U == topicLevelCount && 0 == topicLevel->len && 0 != i &&
+		    RyanMqttTopicLevelPlus == filterLevels[i - 1U].type)
+		{
+			return (RyanMqttBool_e)(filterLevelCount == topicLevelCount &&
+						RyanMqttTopicLevelLiteral == filterLevel->type && 0 == filterLevel->len);
+		}
+
+		if (RyanMqttTopicLevelHash == filterLevel->type)
+		{
+			return RyanMqttTrue;
+		}
+
+		if (RyanMqttTopicLevelPlus == filterLevel->type)
+		{
+			i++;
+			continue;
+		}
+
+		// 连续普通层级的最后一个层级，经过层级数检查后一定在报文主题层级范围内
+		const RyanMqttTopicLevel_t *topicRunEnd = &topicLevels[i + filterLevel->literalCount - 1U];
+		const RyanMqttTopicLevel_t *filterRunEnd = &filterLevels[i + filterLevel->literalCount - 1U];
+		uint16_t runLen = (uint16_t)(filterRunEnd->offset + filterRunEnd->len - filterLevel->offset);
+
+		if (topicLevel->len != filterLevel->len || topicLevel->hash != filterLevel->hash ||
+		    topicRunEnd->offset + topicRunEnd->len - topicLevel->offset != runLen ||
+		    RyanMqttTrue != RyanMqttTopicEqual(&topicSplit->topic[topicLevel->offset],
+						       &topicFilter[filterLevel->offset], runLen))
+		{
+			return RyanMqttFalse;
+		}
+
+		i = (uint16_t)(i + filterLevel->literalCount);
+	}
+
+	if (i == filterLevelCount)
+	{
+		return (RyanMqttBool_e)(i == topicLevelCount);
+	}
+
+	// 主题层级已经用完，过滤器只剩下"#"时匹配父级，例如"sport/#"匹配"sport"。
+	// 与逐字节实现保持一致，父级由"+"匹配时不成立，例如"+/#"不匹配"sport"
+	return (RyanMqttBool_e)(filterLevelCount == topicLevelCount + 1U &&
+				RyanMqttTopicLevelHash == filterLevels[topicLevelCount].type &&
+				RyanMqttTopicLevelPlus != filterLevels[topicLevelCount - 1U].type);
+}
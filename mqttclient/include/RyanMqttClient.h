@@ -15,6 +15,15 @@ typedef void (*RyanMqttEventHandle)(void *client, RyanMqttEventId_e event, const
 
 // 定义枚举类型
 
+// 单步模式下非阻塞连接的阶段
+typedef enum
+{
+	RyanMqttStepConnectIdle = 0,  // 没有进行中的连接
+	RyanMqttStepConnectTransport, // 传输层连接中，等待socket可写
+	RyanMqttStepConnectSend,      // connect报文没有发送完，等待socket可写
+	RyanMqttStepConnectConnack,   // 等待CONNACK，socket可读时读取
+} RyanMqttStepConnect_e;
+
 // 定义结构体类型
 typedef struct
 {
@@ -28,19 +37,56 @@ typedef struct
 
 	RyanMqttBool_e retained; // retained 标志位
 	RyanMqttBool_e dup;      // 重发标志
+
+	void *packetBuf; // 拉取模式下topic和payload所在的接收缓冲区，由 RyanMqttReleaseMessage 释放，用户勿动
 } RyanMqttMsgData_t;
 
+// 订阅消息回调函数类型，userData为订阅时传入的用户数据。msgData用户不要进行修改
+typedef void (*RyanMqttMsgHandle)(void *client, RyanMqttMsgData_t *msgData, void *userData);
+
+// 预编译的主题层级，结构定义见 RyanMqttUtil.h
+typedef struct RyanMqttTopicLevel RyanMqttTopicLevel_t;
+
 typedef struct
 {
-	RyanMqttList_t list; // 链表节点，用户勿动
-	void *userData;      // 用户自定义数据
-	char *topic;         // 主题
-	RyanMqttQos_e qos;   // qos等级
-
-	uint16_t packetId; // 关联的packetId
-	uint16_t topicLen; // 主题长度
+	RyanMqttList_t list;               // 链表节点，用户勿动
+	RyanMqttList_t hashList;           // 主题索引链表节点，用户勿动
+	void *userData;                    // 用户自定义数据
+	RyanMqttMsgHandle msgHandle;       // 订阅消息回调函数，为NULL时通过 RyanMqttEventData 事件分发
+	char *topic;                       // 主题
+	RyanMqttTopicLevel_t *topicLevels; // 预编译的主题过滤器层级，用户勿动
+	RyanMqttQos_e qos;                 // qos等级
+	uint32_t topicHash;                // 主题哈希值，用户勿动
+
+	uint16_t packetId;        // 关联的packetId
+	uint16_t topicLen;        // 主题长度
+	uint16_t topicLevelCount; // 预编译的层级个数，为0时使用逐字节匹配，用户勿动
 } RyanMqttMsgHandler_t;
 
+// 订阅遍历回调函数类型，msgHandler只在回调期间有效，用户不要进行修改。返回 RyanMqttFalse 时停止遍历
+typedef RyanMqttBool_e (*RyanMqttSubscribeIterateHandle)(void *client, const RyanMqttMsgHandler_t *msgHandler,
+							 void *userData);
+
+typedef struct
+{
+	RyanMqttMsgHandler_t *msgHandler; // 最近匹配到的msg句柄
+	uint32_t topicHash;               // 报文主题哈希值
+	uint32_t lastUseTick;             // 最近使用计数，用于LRU淘汰
+	uint16_t topicLen;                // 报文主题长度
+} RyanMqttMsgMatchCache_t;
+
+// 订阅快照，只读且带引用计数，结构定义见 RyanMqttUtil.h
+typedef struct RyanMqttMsgSnapshot RyanMqttMsgSnapshot_t;
+
+// 保序分发时计算消息分片key的函数类型，key相同的消息在同一个工作线程中按到达顺序执行
+typedef uint32_t (*RyanMqttDispatchKeyHandle)(void *client, const RyanMqttMsgData_t *msgData);
+
+// 回调工作线程池，结构定义见 RyanMqttUtil.h
+typedef struct RyanMqttDispatchPool RyanMqttDispatchPool_t;
+
+// 拉取模式接收队列，结构定义见 RyanMqttUtil.h
+typedef struct RyanMqttRecvRing RyanMqttRecvRing_t;
+
 typedef struct
 {
 	RyanMqttList_t list;   // 链表节点，用户勿动
@@ -57,6 +103,104 @@ typedef struct
 	RyanMqttBool_e packetAllocatedExternally; // packet 是外部分配的
 } RyanMqttAckHandler_t;
 
+// 持久化的ack记录，只在接口调用期间有效，持久化后端需要自行拷贝
+typedef struct
+{
+	const char *topic;     // 消息主题
+	const uint8_t *packet; // 没有收到期望ack时重新发送的原始报文，可能为NULL
+	uint32_t packetLen;    // 报文长度
+	uint16_t packetId;     // 报文标识符
+	uint16_t topicLen;     // 主题长度
+	uint8_t packetType;    // 期望接收到的ack报文类型
+	uint8_t qos;           // 消息qos等级
+} RyanMqttPersistRecord_t;
+
+// 加载持久化记录的回调函数类型，返回非 RyanMqttSuccessError 时停止加载
+typedef RyanMqttError_e (*RyanMqttPersistLoadHandle)(void *ctx, const RyanMqttPersistRecord_t *record);
+
+// 会话持久化后端，packetType 和 packetId 唯一确定一条记录
+// 接口可能在用户线程和mqtt线程中同时调用，后端需要自行保证线程安全
+typedef struct
+{
+	void *userData; // 持久化后端的私有数据，作为各接口的第一个参数
+
+	// 保存一条记录，已存在相同记录时覆盖。失败时对应的qos1/qos2操作也会失败
+	RyanMqttError_e (*put)(void *userData, const RyanMqttPersistRecord_t *record);
+
+	// 删除一条记录，记录不存在时直接返回成功。失败时记录仍然保留，重启后会重新加载
+	RyanMqttError_e (*del)(void *userData, uint8_t packetType, uint16_t packetId);
+
+	// 按保存的先后顺序遍历所有记录，只在 RyanMqttStart 中调用
+	RyanMqttError_e (*load)(void *userData, RyanMqttPersistLoadHandle loadHandle, void *ctx);
+
+	// mqtt线程每处理一次报文调用一次，后端可以在这里批量刷盘。forceFlag 为 RyanMqttTrue 时必须立即刷盘
+	void (*sync)(void *userData, RyanMqttBool_e forceFlag);
+} RyanMqttPersist_t;
+
+// 离线发布队列中缓存的消息，作为事件数据时用户不要进行修改
+typedef struct
+{
+	RyanMqttList_t list;   // 链表节点，用户勿动
+	void *userData;        // 发布时传入的用户数据
+	char *topic;           // 主题，以'\0'结尾
+	char *payload;         // 数据内容
+	uint32_t payloadLen;   // 数据长度
+	uint32_t size;         // 消息占用的内存大小，用户勿动
+	uint16_t topicLen;     // 主题长度
+	RyanMqttQos_e qos;     // qos等级
+	RyanMqttBool_e retain; // retain 标志位
+} RyanMqttOfflineMsg_t;
+
+// 离线发布队列的溢出存储，内存中缓存已满时新消息按顺序写入，记录只在当前进程内有效
+// 接口都在离线队列锁内调用，后端不需要考虑线程安全
+typedef struct
+{
+	void *userData; // 溢出存储的私有数据，作为各接口的第一个参数
+
+	// 追加一条记录，空间不足时返回失败
+	RyanMqttError_e (*write)(void *userData, const void *data, uint32_t len);
+
+	// 返回最早一条记录的长度，没有记录时返回0
+	uint32_t (*peek)(void *userData);
+
+	// 读取并删除最早一条记录，buffer 为NULL时只删除
+	RyanMqttError_e (*read)(void *userData, void *buffer, uint32_t len);
+} RyanMqttOfflineSpill_t;
+
+// 离线发布队列，结构定义见 RyanMqttUtil.h
+typedef struct RyanMqttOfflineQueue RyanMqttOfflineQueue_t;
+
+// 传输层接口，每个客户端可以使用不同的传输层，例如tcp、tls、unix domain socket 或内存管道
+// recv 和 send 返回实际收发的字节数，超时返回0，连接断开或出错返回-1，语义与 platformNetworkRecvAsync 相同
+// 接口只在连接期间使用，connect 之前和 close 之后不会调用 recv 和 send
+typedef struct
+{
+	void *userData; // 传输层的私有数据，作为各接口的第一个参数
+
+	// 设置下一次连接使用的socket选项，可为NULL
+	RyanMqttError_e (*setOption)(void *userData, const RyanMqttSocketOption_t *option);
+
+	RyanMqttError_e (*connect)(void *userData, const char *host, uint16_t port);
+
+	// 非阻塞连接，仅单步模式使用。*pendingMs 为0时连接完成，否则 getFd 返回的描述符可写或等待 *pendingMs 后
+	// 调用 connectPoll 继续。可为NULL，为NULL时单步模式下调用 connect 阻塞连接
+	RyanMqttError_e (*connectStart)(void *userData, const char *host, uint16_t port, uint32_t *pendingMs);
+	RyanMqttError_e (*connectPoll)(void *userData, uint32_t *pendingMs);
+
+	int32_t (*recv)(void *userData, char *recvBuf, size_t recvLen, int32_t timeout);
+	int32_t (*send)(void *userData, char *sendBuf, size_t sendLen, int32_t timeout);
+
+	// 关闭连接，没有连接时直接返回
+	RyanMqttError_e (*close)(void *userData);
+
+	// 返回可以被 select/poll/epoll 监听的描述符，没有描述符时返回-1，可为NULL
+	int32_t (*getFd)(void *userData);
+
+	// 打断正在等待数据的 recv 使其立即返回0，没有正在等待时下一次 recv 立即返回，可以在任意线程中调用。
+	// 可为NULL，为NULL时mqtt线程空闲时最长等待 recvTimeout 后检查销毁等请求
+	RyanMqttError_e (*wakeup)(void *userData);
+} RyanMqttTransport_t;
+
 typedef struct
 {
 	char *topic;   // 遗嘱主题
@@ -107,11 +251,54 @@ typedef struct
 	uint16_t sendTimeout;       // mqtt发送命令超时时间, 根据实际硬件选择。单位ms
 	uint16_t ackTimeout;        // mqtt ack 等待回复的超时时间, 典型值为5 - 60秒。单位ms
 	uint16_t keepaliveTimeoutS; // mqtt心跳时间间隔。单位S
-	uint16_t reconnectTimeout;  // mqtt重连间隔时间。单位ms
+	uint16_t keepaliveJitter;   // 心跳随机提前0到该值的时间发送，分散大量客户端的心跳，为0时不使能(默认)。单位ms
+	uint16_t reconnectTimeout;  // mqtt重连间隔时间，使能指数退避时为最小间隔。单位ms
+
+	// 重连指数退避配置，reconnectMaxTimeout 为0时使用固定的 reconnectTimeout 重连间隔(默认)
+	// 每次重连前间隔上限乘以 reconnectMultiplier，实际等待时间在 reconnectTimeout 到上限之间随机，
+	// 第一次重连在 reconnectTimeout 到 reconnectTimeout * reconnectMultiplier 之间，避免大量客户端同时重连
+	uint32_t reconnectMaxTimeout;  // 最大重连间隔。单位ms
+	uint16_t reconnectStableTimeS; // 连接保持超过该时间后重连间隔恢复为最小值，为0时连接成功即恢复。单位S
+	uint8_t reconnectMultiplier;   // 重连间隔倍数，为0时为2
+
+	// 回调工作线程配置，只在 RyanMqttStart 时读取一次
+	uint16_t dispatchQueueSize; // 每个回调队列能缓存的最大消息数，为0时使用 RyanMqttDispatchDefaultQueueSize
+	uint16_t dispatchTaskPrio;  // 回调工作线程优先级，为0时与mqtt线程相同
+	uint16_t dispatchTaskStack; // 回调工作线程栈大小，为0时与mqtt线程相同
+
+	// 拉取模式接收队列长度，只在 RyanMqttStart 时读取一次。为0时不使能(默认)
+	// 使能后没有设置订阅回调的消息不再触发 RyanMqttEventData 事件，由 RyanMqttRecvMessage 读取
+	uint16_t recvQueueSize;
 
 	uint8_t mqttVersion;              // mqtt版本 3.1.1是4, 3.1是3
+	uint8_t dispatchWorkerCount;      // 回调工作线程个数，为0时在mqtt线程中直接执行回调(默认)
 	RyanMqttBool_e autoReconnectFlag; // 自动重连标志位
 	RyanMqttBool_e cleanSessionFlag;  // 清除会话标志位
+	RyanMqttBool_e msgFirstMatchFlag; // 消息只分发给第一个匹配的订阅，默认分发给所有匹配的订阅
+	RyanMqttBool_e stepModeFlag;      // 不创建mqtt线程，由用户事件循环调用 RyanMqttStep 驱动
+
+	RyanMqttDispatchOverflow_e dispatchOverflowPolicy; // 回调队列已满时的处理策略
+	RyanMqttBool_e dispatchAckAfterHandleFlag;         // qos1消息在回调执行完成后再回复PUBACK，默认入队后立即回复
+	RyanMqttBool_e dispatchOrderedFlag;                // 每个工作线程独占一个队列，消息按key分片，同一key保持顺序
+	RyanMqttDispatchKeyHandle dispatchKeyHandle;       // 保序模式下计算消息分片key，为NULL时使用主题哈希
+
+	// 会话持久化后端，只在 cleanSessionFlag 为 RyanMqttFalse 时使用，为NULL时不持久化(默认)
+	// RyanMqttStart 时加载上次进程退出前未完成的qos1/qos2会话，连接成功后立即重发。用户需要保证指针的持久性
+	RyanMqttPersist_t *persist;
+
+	// 离线发布队列，只在 RyanMqttStart 时读取一次。offlineQueueMaxCount 为0时不使能(默认)
+	// 没有连接时的发布先缓存，连接成功后按发布顺序补发。队列不为空时新的发布也排到队尾
+	uint32_t offlineQueueMaxBytes;            // 内存中缓存的最大字节数，为0时使用 RyanMqttOfflineDefaultMaxBytes
+	uint16_t offlineQueueMaxCount;            // 最多缓存的消息数，包括溢出存储中的消息
+	uint16_t offlineDrainRate;                // 连接成功后每秒最多补发的消息数，为0时不限速
+	RyanMqttOfflinePolicy_e offlinePolicy[3]; // 按qos索引的缓存策略，默认队列已满时丢弃新消息
+	RyanMqttOfflineSpill_t *offlineSpill;     // 内存中缓存已满时的溢出存储，为NULL时不溢出(默认)
+
+	// socket选项，每次连接时传给平台层，全部为0时不修改系统默认值(默认)
+	RyanMqttSocketOption_t socketOption;
+
+	// 传输层接口，为NULL时使用平台层的 platformNetwork 接口(默认)。每次连接时读取，用户需要保证指针的持久性
+	RyanMqttTransport_t *transport;
 } RyanMqttClientConfig_t;
 
 typedef struct
@@ -120,28 +307,66 @@ typedef struct
 
 	// 维护消息处理列表，这是mqtt协议必须实现的内容，所有来自服务器的publish报文都会被处理（前提是订阅了对应的消息，或者设置了拦截器）
 	RyanMqttList_t msgHandlerList;
+	RyanMqttList_t msgHashList[RyanMqttMsgHashBucketCount]; // 不含通配符的订阅按主题哈希索引
+	RyanMqttList_t msgWildcardList;                         // 含通配符的订阅索引
+	RyanMqttAtomic(RyanMqttMsgSnapshot_t *) msgSnapshot;    // 最新发布的订阅快照，订阅变化时整体替换
+	RyanMqttMsgSnapshot_t *msgSnapshotLocal;                // mqtt线程正在使用的订阅快照
+	RyanMqttDispatchPool_t *dispatchPool;                   // 回调工作线程池，未使能时为NULL
+	RyanMqttRecvRing_t *recvRing;                           // 拉取模式接收队列，未使能时为NULL
+	RyanMqttPersist_t *persist;                             // 加载完成后生效的持久化后端，未使能时为NULL
+	RyanMqttOfflineQueue_t *offlineQueue;                   // 离线发布队列，未使能时为NULL
+#if RyanMqttMsgMatchCacheCount > 0
+	RyanMqttMsgMatchCache_t msgMatchCache[RyanMqttMsgMatchCacheCount]; // 最近匹配主题缓存，仅mqtt线程使用，快照切换时失效
+	uint32_t msgMatchCacheTick;                                        // 匹配缓存使用计数
+#endif
 	RyanMqttList_t ackHandlerList;          // 维护ack链表
 	RyanMqttList_t userAckHandlerList;      // 用户接口的ack链表,会由mqtt线程移动到ack链表
-	RyanMqttTimer_t ackScanThrottleTimer;   // ack链表检查节流定时器
-	RyanMqttTimer_t keepaliveTimer;         // 保活定时器
-	RyanMqttTimer_t keepaliveThrottleTimer; // 保活检查节流定时器
+	RyanMqttTimer_t ackExpireTimer;         // ack链表中最近一个ack的超时时间，即下一次扫描ack链表的时间
+	RyanMqttTimer_t reconnectTimer;         // 自动重连间隔定时器
+	platformSemaphore_t wakeSem;            // 打断mqtt线程的重连等待，接收等待由传输层的唤醒接口打断
 	platformMutex_t sendLock;               // 写缓冲区锁
 	platformMutex_t msgHandleLock;          // msg链表锁
 	platformMutex_t ackHandleLock;          // ack链表锁
 	platformMutex_t userSessionLock;        // 用户接口的锁
 	platformCritical_t criticalLock;        // 临界区锁
 	platformNetwork_t network;              // 网络组件
+	RyanMqttTransport_t *transport;         // 当前连接使用的传输层，为NULL时使用网络组件
 	platformThread_t mqttThread;            // mqtt线程
 	lwtOptions_t *lwtOptions;               // 遗嘱相关配置
 
-	uint32_t eventFlag;          // 事件标志位
-	RyanMqttState_e clientState; // mqtt客户端的状态
+	RyanMqttAtomic(uint32_t) eventFlag;          // 事件标志位
+	RyanMqttAtomic(uint32_t) keepaliveSendTime;  // 最近一次发送报文的时间，单位ms
+	RyanMqttAtomic(uint32_t) keepaliveRecvTime;  // 最近一次收到报文的时间，单位ms
+	RyanMqttAtomic(RyanMqttState_e) clientState; // mqtt客户端的状态
+	RyanMqttAtomic(uint32_t) msgSnapshotPin;     // 正在获取快照引用的读者个数，发布者等待为0后释放旧快照
+	RyanMqttAtomic(uint32_t) msgHandlerCount;    // 订阅个数，在msg链表锁内修改，未使能原子操作时在临界区内读写
+	uint32_t keepaliveJitterTime;                // 本轮心跳提前发送的随机时间，单位ms
+	uint32_t keepalivePingTime;                  // 最近一次发送心跳包的时间，单位ms
+	uint32_t reconnectBackoff;                   // 下一次重连等待时间的上限，单位ms
+	uint32_t connectedTime;                      // 最近一次连接成功的时间，单位ms
+	uint32_t randomSeed;                         // 重连和心跳抖动使用的随机数状态
+	uint8_t *connectPacket;                      // 缓存的connect报文，在userSessionLock内读写
+	uint32_t connectPacketLen;                   // 缓存的connect报文长度
+	uint32_t connectPacketVersion;               // 配置或遗嘱修改时递增，使缓存的connect报文失效
+	uint8_t *partialData;                        // 单步模式下没有读完的报文剩余部分，连接关闭时释放
+	uint32_t partialDataLen;                     // 报文剩余部分已经读取的长度
+	uint8_t *stepConnectPacket;                  // 单步模式下连接期间取走的connect报文，连接结束后放回缓存
+	uint32_t stepConnectPacketLen;               // connect报文长度
+	uint32_t stepConnectPacketVersion;           // 取走时的connect报文版本
+	uint32_t stepConnectOffset;                  // connect报文已经发送的长度
+	RyanMqttTimer_t stepConnectTimer;            // 单步模式下当前连接阶段的截止时间
+	RyanMqttStepConnect_e stepConnectState;      // 单步模式下非阻塞连接的阶段
 
 	uint16_t ackHandlerCount; // 等待ack的记录个数
 	uint16_t packetId;        // mqtt报文标识符,控制报文必须包含一个非零的 16 位报文标识符
-
-	RyanMqttBool_e destroyFlag;    // 销毁标志位
-	RyanMqttBool_e pendingAckFlag; // 需要处理ack, 缩短recv超时时间，避免阻塞太久
+	uint16_t msgLockDepth;    // msg链表锁重入深度
+	uint8_t partialHeader[5]; // 单步模式下没有读完的固定报头，下一次 RyanMqttStep 继续读取
+	uint8_t partialHeaderLen; // 固定报头已经读取的长度
+
+	RyanMqttBool_e msgSnapshotDirty; // 订阅已修改，释放最外层msg链表锁时重新发布快照
+	RyanMqttBool_e destroyFlag;      // 销毁标志位
+	RyanMqttBool_e pendingAckFlag;   // ack链表没有扫描完，mqtt线程不等待新报文立即继续扫描
+	RyanMqttBool_e reconnectFlag;    // 用户请求立即重连，在临界区内读写
 } RyanMqttClient_t;
 
 /* extern variables-----------------------------------------------------------*/
@@ -151,6 +376,10 @@ extern RyanMqttError_e RyanMqttDestroy(RyanMqttClient_t *client);
 extern RyanMqttError_e RyanMqttStart(RyanMqttClient_t *client);
 extern RyanMqttError_e RyanMqttDisconnect(RyanMqttClient_t *client, RyanMqttBool_e sendDiscFlag);
 extern RyanMqttError_e RyanMqttReconnect(RyanMqttClient_t *client);
+extern RyanMqttError_e RyanMqttStep(RyanMqttClient_t *client, RyanMqttBool_e readable, RyanMqttBool_e writable);
+extern RyanMqttError_e RyanMqttGetFd(RyanMqttClient_t *client, int32_t *fd);
+extern RyanMqttError_e RyanMqttGetWantWrite(RyanMqttClient_t *client, RyanMqttBool_e *wantWrite);
+extern RyanMqttError_e RyanMqttGetNextTimeoutMs(RyanMqttClient_t *client, uint32_t *timeoutMs);
 
 extern RyanMqttError_e RyanMqttPublishWithUserData(RyanMqttClient_t *client, char *topic, uint16_t topicLen,
 						   char *payload, uint32_t payloadLen, RyanMqttQos_e qos,
@@ -159,11 +388,17 @@ extern RyanMqttError_e RyanMqttPublishWithUserData(RyanMqttClient_t *client, cha
 extern RyanMqttError_e RyanMqttPublish(RyanMqttClient_t *client, char *topic, char *payload, uint32_t payloadLen,
 				       RyanMqttQos_e qos, RyanMqttBool_e retain);
 #define RyanMqttPublishAndUserData RyanMqttPublishWithUserData // 兼容旧版本
+extern RyanMqttError_e RyanMqttGetOfflineCount(RyanMqttClient_t *client, uint32_t *count);
 
 // !推荐使用 RyanMqttSubscribeMany , RyanMqttSubscribe不能正确处理topic结尾为0的情况
 extern RyanMqttError_e RyanMqttSubscribe(RyanMqttClient_t *client, char *topic, RyanMqttQos_e qos);
 extern RyanMqttError_e RyanMqttSubscribeMany(RyanMqttClient_t *client, int32_t count,
 					     RyanMqttSubscribeData_t subscribeManyData[]);
+extern RyanMqttError_e RyanMqttSubscribeWithMsgHandle(RyanMqttClient_t *client, char *topic, uint16_t topicLen,
+						      RyanMqttQos_e qos, RyanMqttMsgHandle msgHandle, void *userData);
+extern RyanMqttError_e RyanMqttSubscribeManyWithMsgHandle(RyanMqttClient_t *client, int32_t count,
+							  RyanMqttSubscribeData_t subscribeManyData[],
+							  RyanMqttMsgHandle msgHandle, void *userData);
 // !推荐使用 RyanMqttUnSubscribeMany , RyanMqttUnSubscribe不能正确处理topic结尾为0的情况
 extern RyanMqttError_e RyanMqttUnSubscribe(RyanMqttClient_t *client, char *topic);
 extern RyanMqttError_e RyanMqttUnSubscribeMany(RyanMqttClient_t *client, int32_t count,
@@ -171,6 +406,8 @@ extern RyanMqttError_e RyanMqttUnSubscribeMany(RyanMqttClient_t *client, int32_t
 extern RyanMqttError_e RyanMqttGetSubscribeSafe(RyanMqttClient_t *client, RyanMqttMsgHandler_t **msgHandles,
 						int32_t *subscribeNum);
 extern RyanMqttError_e RyanMqttSafeFreeSubscribeResources(RyanMqttMsgHandler_t *msgHandles, int32_t subscribeNum);
+extern RyanMqttError_e RyanMqttIterateSubscribe(RyanMqttClient_t *client, RyanMqttSubscribeIterateHandle iterateHandle,
+						void *userData);
 // !此函数是非线程安全的，已不推荐！ 请使用 RyanMqttGetSubscribeSafe 代替
 extern RyanMqttError_e RyanMqttGetSubscribe(RyanMqttClient_t *client, RyanMqttMsgHandler_t *msgHandles,
 					    int32_t msgHandleSize, int32_t *subscribeNum);
@@ -178,6 +415,11 @@ extern RyanMqttError_e RyanMqttGetSubscribeTotalCount(RyanMqttClient_t *client,
 
 extern RyanMqttState_e RyanMqttGetState(RyanMqttClient_t *client);
 extern RyanMqttError_e RyanMqttGetKeepAliveRemain(RyanMqttClient_t *client, uint32_t *keepAliveRemain);
+extern RyanMqttError_e RyanMqttGetDispatchDropCount(RyanMqttClient_t *client, uint32_t *dropCount);
+extern RyanMqttError_e RyanMqttRecvMessage(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData, uint32_t timeoutMs);
+extern RyanMqttError_e RyanMqttRecvMessages(RyanMqttClient_t *client, RyanMqttMsgData_t msgDatas[], int32_t maxCount,
+					    int32_t *count, uint32_t timeoutMs);
+extern RyanMqttError_e RyanMqttReleaseMessage(RyanMqttMsgData_t *msgData);
 extern RyanMqttError_e RyanMqttGetConfig(RyanMqttClient_t *client, RyanMqttClientConfig_t **pclientConfig);
 extern RyanMqttError_e RyanMqttFreeConfigFromGet(RyanMqttClientConfig_t *clientConfig);
 extern RyanMqttError_e RyanMqttSetConfig(RyanMqttClient_t *client, RyanMqttClientConfig_t *clientConfig);
@@ -0,0 +1,57 @@
+#ifndef __RyanMqttPipe__
+#define __RyanMqttPipe__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "RyanMqttClient.h"
+
+// 内存管道每个方向的默认缓冲区大小
+#ifndef RyanMqttPipeDefaultBufSize
+#define RyanMqttPipeDefaultBufSize (16 * 1024U)
+#endif
+
+// 内存管道的单向环形缓冲区
+typedef struct
+{
+	uint8_t *buf;                    // 缓冲区
+	uint32_t size;                   // 缓冲区大小
+	uint32_t head;                   // 读位置
+	uint32_t count;                  // 缓冲区中的字节数
+	RyanMqttBool_e readWaitFlag;     // 有读者在等待数据
+	RyanMqttBool_e writeWaitFlag;    // 有写者在等待空间
+	platformSemaphore_t readableSem; // 写入数据后唤醒读者
+	platformSemaphore_t writableSem; // 读出数据后唤醒写者
+} RyanMqttPipeRing_t;
+
+// 内存管道，一端作为客户端的传输层，另一端由用户代码通过 RyanMqttPipePeer 接口读写，例如模拟broker
+// 不经过socket和协议栈，用于在内存速度下测试和评估完整的客户端流程。一个管道同时只服务一个客户端连接
+typedef struct
+{
+	RyanMqttTransport_t transport; // 客户端一端的传输层，userData 指向管道自身
+	RyanMqttPipeRing_t toPeer;     // 客户端发给对端的数据
+	RyanMqttPipeRing_t toClient;   // 对端发给客户端的数据
+	platformMutex_t lock;          // 保护管道状态和缓冲区
+	platformSemaphore_t acceptSem; // 客户端连接后唤醒对端
+	uint32_t connectId;            // 客户端每次连接递增
+	uint32_t peerConnectId;        // 对端接受的连接，与 connectId 不同时对端的读写都失败
+	RyanMqttBool_e closeFlag;      // 当前连接已被任意一端关闭
+	RyanMqttBool_e wakeupFlag;     // 客户端的接收等待被打断，下一次没有数据时立即返回0
+} RyanMqttPipe_t;
+
+/* extern variables-----------------------------------------------------------*/
+extern RyanMqttError_e RyanMqttPipeCreate(RyanMqttPipe_t **pPipe, uint32_t bufSize);
+extern void RyanMqttPipeDestroy(RyanMqttPipe_t *pipe);
+extern RyanMqttTransport_t *RyanMqttPipeGetTransport(RyanMqttPipe_t *pipe);
+
+extern RyanMqttError_e RyanMqttPipePeerAccept(RyanMqttPipe_t *pipe, uint32_t timeout);
+extern int32_t RyanMqttPipePeerRecv(RyanMqttPipe_t *pipe, char *recvBuf, size_t recvLen, int32_t timeout);
+extern int32_t RyanMqttPipePeerSend(RyanMqttPipe_t *pipe, char *sendBuf, size_t sendLen, int32_t timeout);
+extern void RyanMqttPipePeerClose(RyanMqttPipe_t *pipe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -37,6 +37,12 @@ extern "C" {
 #define RyanMqttVsnprintf vsnprintf
 #endif
 
+// 平台的 platformNetworkWakeup 可以打断正在等待数据的 platformNetworkRecvAsync 时在 platformNetwork.h 中定义为1，
+// mqtt线程空闲时一直等到下一个截止时间；否则最长等待 recvTimeout 后检查销毁等请求
+#ifndef platformNetworkWakeupEnable
+#define platformNetworkWakeupEnable (0)
+#endif
+
 // RyanMqtt内部 timer 接口
 typedef struct
 {
@@ -48,17 +54,27 @@ extern void RyanMqttTimerInit(RyanMqttTimer_t *platformTimer);
 extern void RyanMqttTimerCutdown(RyanMqttTimer_t *platformTimer, uint32_t timeout);
 extern uint32_t RyanMqttTimerGetConfigTimeout(RyanMqttTimer_t *platformTimer);
 extern uint32_t RyanMqttTimerRemain(RyanMqttTimer_t *platformTimer);
+extern uint32_t RyanMqttTimerRemainAt(RyanMqttTimer_t *platformTimer, uint32_t now);
 
 // 需用户实现的网络接口
 extern RyanMqttError_e platformNetworkInit(void *userData, platformNetwork_t *platformNetwork);
 extern RyanMqttError_e platformNetworkDestroy(void *userData, platformNetwork_t *platformNetwork);
+extern RyanMqttError_e platformNetworkSetOption(void *userData, platformNetwork_t *platformNetwork,
+						const RyanMqttSocketOption_t *option);
 extern RyanMqttError_e platformNetworkConnect(void *userData, platformNetwork_t *platformNetwork, const char *host,
 					      uint16_t port);
+// 非阻塞连接，仅单步模式使用。*pendingMs 为0时连接完成，否则socket可写或等待 *pendingMs 后调用 Poll 继续
+extern RyanMqttError_e platformNetworkConnectAsync(void *userData, platformNetwork_t *platformNetwork,
+						   const char *host, uint16_t port, uint32_t *pendingMs);
+extern RyanMqttError_e platformNetworkConnectPoll(void *userData, platformNetwork_t *platformNetwork,
+						  uint32_t *pendingMs);
 extern int32_t platformNetworkRecvAsync(void *userData, platformNetwork_t *platformNetwork, char *recvBuf,
 					size_t recvLen, int32_t timeout);
 extern int32_t platformNetworkSendAsync(void *userData, platformNetwork_t *platformNetwork, char *sendBuf,
 					size_t sendLen, int32_t timeout);
 extern RyanMqttError_e platformNetworkClose(void *userData, platformNetwork_t *platformNetwork);
+extern RyanMqttError_e platformNetworkWakeup(void *userData, platformNetwork_t *platformNetwork);
+extern int32_t platformNetworkGetFd(void *userData, platformNetwork_t *platformNetwork);
 
 // 需用户实现的内存接口
 extern void *platformMemoryMalloc(size_t size);
@@ -89,6 +105,13 @@ extern RyanMqttError_e platformCriticalInit(void *userData, platformCritical_t *
 extern RyanMqttError_e platformCriticalDestroy(void *userData, platformCritical_t *platformCritical);
 extern RyanMqttError_e platformCriticalEnter(void *userData, platformCritical_t *platformCritical);
 extern RyanMqttError_e platformCriticalExit(void *userData, platformCritical_t *platformCritical);
+
+// 计数信号量，仅在使能回调工作线程时使用，timeout单位ms
+extern RyanMqttError_e platformSemaphoreInit(void *userData, platformSemaphore_t *platformSemaphore,
+					     uint32_t initCount);
+extern RyanMqttError_e platformSemaphoreDestroy(void *userData, platformSemaphore_t *platformSemaphore);
+extern RyanMqttError_e platformSemaphoreTake(void *userData, platformSemaphore_t *platformSemaphore, uint32_t timeout);
+extern RyanMqttError_e platformSemaphoreGive(void *userData, platformSemaphore_t *platformSemaphore);
 #ifdef __cplusplus
 }
 #endif
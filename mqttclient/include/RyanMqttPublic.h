@@ -16,6 +16,49 @@ extern "C" {
 
 #define RyanMqttMsgInvalidPacketId (UINT16_MAX)
 
+// 不含通配符的订阅主题哈希索引桶数量，必须为2的幂。订阅数量较多时可适当增大
+#ifndef RyanMqttMsgHashBucketCount
+#define RyanMqttMsgHashBucketCount (16U)
+#endif
+
+// 最近匹配主题缓存条目数量，用于加速通配符订阅的重复匹配。为0时不启用
+#ifndef RyanMqttMsgMatchCacheCount
+#define RyanMqttMsgMatchCacheCount (8U)
+#endif
+
+// 通配符订阅按层级匹配时报文主题支持的最大层级数，占用mqtt线程栈空间，超过时退化为逐字节匹配
+#ifndef RyanMqttTopicLevelMaxCount
+#define RyanMqttTopicLevelMaxCount (16U)
+#endif
+
+// 使能离线发布队列且 offlineQueueMaxBytes 为0时，内存中缓存消息的默认最大字节数
+#ifndef RyanMqttOfflineDefaultMaxBytes
+#define RyanMqttOfflineDefaultMaxBytes (16U * 1024U)
+#endif
+
+// 使能回调工作线程且 dispatchQueueSize 为0时，回调队列能缓存的默认消息数
+#ifndef RyanMqttDispatchDefaultQueueSize
+#define RyanMqttDispatchDefaultQueueSize (32U)
+#endif
+
+// 客户端状态、事件标志位和心跳刷新时间使用C11原子操作读写，不再进入临界区。
+// 默认根据编译器自动判断，不支持 stdatomic.h 的平台定义为0时退化为临界区保护
+#ifndef RyanMqttAtomicEnable
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#define RyanMqttAtomicEnable (1)
+#else
+#define RyanMqttAtomicEnable (0)
+#endif
+#endif
+
+// C++ 中没有 _Atomic 限定符，按普通类型声明，主流编译器下两者内存布局一致
+#if RyanMqttAtomicEnable && !defined(__cplusplus)
+#include <stdatomic.h>
+#define RyanMqttAtomic(type) _Atomic(type)
+#else
+#define RyanMqttAtomic(type) type
+#endif
+
 /* MQTT packet types. */
 
 /**
@@ -97,6 +140,38 @@ typedef enum
 	RyanMqttReconnectState,    // 重新连接状态
 } RyanMqttState_e;
 
+// 回调队列已满时新消息的处理策略
+typedef enum
+{
+	RyanMqttDispatchOverflowBlock = 0,  // 阻塞mqtt线程直到队列有空位，不丢消息
+	RyanMqttDispatchOverflowDropNewest, // 丢弃新消息，qos1 / qos2不回复ack，等待broker重发
+	RyanMqttDispatchOverflowDropOldest, // 丢弃队列中最旧的消息，为新消息腾出空位
+} RyanMqttDispatchOverflow_e;
+
+// 离线发布队列按qos设置的缓存策略
+typedef enum
+{
+	RyanMqttOfflineDropNewest = 0, // 队列已满时丢弃新消息，发布接口返回 RyanMqttNoRescourceError
+	RyanMqttOfflineDropOldest,     // 队列已满时丢弃同样是该策略的最旧消息，没有可丢弃的消息时丢弃新消息
+	RyanMqttOfflineNotQueue,       // 不缓存，没有连接时发布接口返回 RyanMqttNotConnectError
+} RyanMqttOfflinePolicy_e;
+
+// 建立tcp连接时设置的socket选项，由平台层在连接前应用。所有字段为0时使用系统默认值
+// 平台不支持的选项会被忽略，选项设置失败不影响连接
+typedef struct
+{
+	RyanMqttBool_e noDelayFlag;   // TCP_NODELAY, 关闭Nagle算法，小报文立即发送
+	RyanMqttBool_e keepaliveFlag; // SO_KEEPALIVE, 使能tcp保活
+	uint16_t keepaliveIdleS;      // TCP_KEEPIDLE, 连接空闲多久后开始发送保活探测。单位S
+	uint16_t keepaliveIntervalS;  // TCP_KEEPINTVL, 保活探测间隔。单位S
+	uint16_t keepaliveCount;      // TCP_KEEPCNT, 保活探测失败多少次后断开
+	uint8_t tos;                  // IP_TOS / IPV6_TCLASS, 例如 0x10 低延迟
+	uint32_t sendBufSize;         // SO_SNDBUF, 发送缓冲区大小。单位字节
+	uint32_t recvBufSize;         // SO_RCVBUF, 接收缓冲区大小。单位字节
+	uint32_t userTimeoutMs;       // TCP_USER_TIMEOUT, 已发送数据多久没有确认时断开。单位ms
+	uint32_t busyPollUs;          // SO_BUSY_POLL, 阻塞接收时忙等网卡队列的时间。单位us
+} RyanMqttSocketOption_t;
+
 typedef enum
 {
 	/**
@@ -208,6 +283,12 @@ typedef enum
 	 */
 	RyanMqttEventUnsubscribedData = RyanMqttBit15,
 
+	/**
+	 * @brief 离线发布队列已满，按 RyanMqttOfflineDropOldest 策略丢弃了最旧的消息
+	 * @eventData RyanMqttOfflineMsg_t*
+	 */
+	RyanMqttEventOfflineDiscard = RyanMqttBit16,
+
 	RyanMqttEventAnyId = UINT32_MAX,
 } RyanMqttEventId_e;
 
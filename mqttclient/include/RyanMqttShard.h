@@ -0,0 +1,77 @@
+#ifndef __RyanMqttShard__
+#define __RyanMqttShard__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "RyanMqttClient.h"
+
+// 分片客户端最多打开的连接数
+#ifndef RyanMqttShardMaxCount
+#define RyanMqttShardMaxCount (32U)
+#endif
+
+// 发布消息选择连接的方式
+typedef enum
+{
+	RyanMqttShardRouteTopicHash = 0, // 按主题哈希选择连接，同一主题的消息保持顺序
+	RyanMqttShardRouteRoundRobin,    // 轮询所有连接，不保证同一主题的消息顺序
+} RyanMqttShardRoute_e;
+
+// 所有连接汇总后的统计信息
+typedef struct
+{
+	uint32_t shardCount;        // 连接个数
+	uint32_t connectedCount;    // 处于连接状态的连接个数
+	uint32_t publishCount;      // 通过分片客户端发布成功的消息个数
+	uint32_t ackHandlerCount;   // 等待ack的记录个数
+	uint32_t offlineCount;      // 离线队列中的消息个数
+	uint32_t dispatchDropCount; // 分发线程池丢弃的消息个数
+	int32_t subscribeCount;     // 订阅个数
+} RyanMqttShardStatistics_t;
+
+// 多个mqtt连接组成的分片客户端，突破单个tcp连接和单个发送锁的发布吞吐上限
+// 每个连接都是普通的 RyanMqttClient_t，客户端id为 "配置的clientId-连接序号"
+typedef struct
+{
+	RyanMqttClient_t **clients;            // 连接数组
+	uint32_t shardCount;                   // 连接个数
+	RyanMqttShardRoute_e route;            // 发布消息选择连接的方式
+	RyanMqttAtomic(uint32_t) nextShard;    // 轮询发布的下一个连接
+	RyanMqttAtomic(uint32_t) publishCount; // 发布成功的消息个数
+	platformCritical_t criticalLock;       // 不支持原子操作时保护计数
+} RyanMqttShardClient_t;
+
+/* extern variables-----------------------------------------------------------*/
+extern RyanMqttError_e RyanMqttShardInit(RyanMqttShardClient_t **pShard, uint32_t shardCount,
+					 RyanMqttShardRoute_e route);
+extern RyanMqttError_e RyanMqttShardDestroy(RyanMqttShardClient_t *shard);
+extern RyanMqttError_e RyanMqttShardSetConfig(RyanMqttShardClient_t *shard, RyanMqttClientConfig_t *clientConfig);
+extern RyanMqttError_e RyanMqttShardStart(RyanMqttShardClient_t *shard);
+extern RyanMqttError_e RyanMqttShardRegisterEventId(RyanMqttShardClient_t *shard, RyanMqttEventId_e eventId);
+
+extern RyanMqttError_e RyanMqttShardPublishWithUserData(RyanMqttShardClient_t *shard, char *topic, uint16_t topicLen,
+							char *payload, uint32_t payloadLen, RyanMqttQos_e qos,
+							RyanMqttBool_e retain, void *userData);
+extern RyanMqttError_e RyanMqttShardPublish(RyanMqttShardClient_t *shard, char *topic, char *payload,
+					    uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain);
+extern RyanMqttError_e RyanMqttShardSubscribe(RyanMqttShardClient_t *shard, char *topic, RyanMqttQos_e qos);
+extern RyanMqttError_e RyanMqttShardSubscribeWithMsgHandle(RyanMqttShardClient_t *shard, char *topic,
+							   uint16_t topicLen, RyanMqttQos_e qos,
+							   RyanMqttMsgHandle msgHandle, void *userData);
+extern RyanMqttError_e RyanMqttShardUnSubscribe(RyanMqttShardClient_t *shard, char *topic);
+
+extern RyanMqttError_e RyanMqttShardGetClient(RyanMqttShardClient_t *shard, uint32_t index,
+					      RyanMqttClient_t **pClient);
+extern RyanMqttError_e RyanMqttShardGetIndex(RyanMqttShardClient_t *shard, char *topic, uint16_t topicLen,
+					     uint32_t *index);
+extern RyanMqttState_e RyanMqttShardGetState(RyanMqttShardClient_t *shard);
+extern RyanMqttError_e RyanMqttShardGetStatistics(RyanMqttShardClient_t *shard,
+						  RyanMqttShardStatistics_t *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,11 +13,19 @@ extern "C" {
 
 /* extern variables-----------------------------------------------------------*/
 extern void RyanMqttThread(void *argument);
+extern void RyanMqttStepOnce(RyanMqttClient_t *client, RyanMqttBool_e readable, RyanMqttBool_e writable);
+extern uint32_t RyanMqttGetNextDeadline(RyanMqttClient_t *client);
+extern void RyanMqttThreadWakeup(RyanMqttClient_t *client);
+extern void RyanMqttPurgeClient(RyanMqttClient_t *client);
 extern void RyanMqttEventMachine(RyanMqttClient_t *client, RyanMqttEventId_e eventId, void *eventData);
-extern void RyanMqttRefreshKeepaliveTime(RyanMqttClient_t *client);
+extern void RyanMqttRefreshKeepaliveSendTime(RyanMqttClient_t *client);
+extern void RyanMqttRefreshKeepaliveRecvTime(RyanMqttClient_t *client);
+extern uint32_t RyanMqttKeepaliveRemain(RyanMqttClient_t *client);
 
-extern RyanMqttError_e RyanMqttGetPacketInfo(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket);
-extern RyanMqttError_e RyanMqttProcessPacketHandler(RyanMqttClient_t *client);
+extern RyanMqttError_e RyanMqttGetPacketInfo(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket,
+					     uint32_t timeout);
+extern RyanMqttError_e RyanMqttGetPacketInfoPartial(RyanMqttClient_t *client, MQTTPacketInfo_t *pIncomingPacket);
+extern RyanMqttError_e RyanMqttProcessPacketHandler(RyanMqttClient_t *client, uint32_t timeout);
 
 #ifdef __cplusplus
 }
@@ -15,19 +15,204 @@ extern "C" {
 #endif
 
 // 定义枚举类型
+typedef enum
+{
+	RyanMqttTopicLevelLiteral = 0, // 普通层级
+	RyanMqttTopicLevelPlus,        // 单层通配符"+"
+	RyanMqttTopicLevelHash,        // 多层通配符"#"
+} RyanMqttTopicLevelType_e;
 
 // 定义结构体类型
 
+// 主题层级，订阅时预编译主题过滤器，收到报文时拆分报文主题
+struct RyanMqttTopicLevel
+{
+	uint32_t hash;         // 层级哈希值，由首尾字节计算，通配符层级为0
+	uint16_t offset;       // 层级在主题中的偏移
+	uint16_t len;          // 层级长度
+	uint16_t literalCount; // 主题过滤器从当前层级开始连续普通层级的个数，报文主题不使用
+	uint8_t type;          // 层级类型 RyanMqttTopicLevelType_e
+};
+
+// 按层级拆分后的报文主题，只在栈上使用
+typedef struct
+{
+	const char *topic;   // 报文主题
+	uint16_t topicLen;   // 报文主题长度
+	uint16_t levelCount; // 层级个数，为0时表示层级过多或包含通配符字符，使用逐字节匹配
+	RyanMqttTopicLevel_t levels[RyanMqttTopicLevelMaxCount];
+} RyanMqttTopicSplit_t;
+
+// 订阅快照，一次申请内存，发布后只读。读者持有引用期间快照不会被释放
+struct RyanMqttMsgSnapshot
+{
+	RyanMqttAtomic(uint32_t) refCount; // 引用计数，未使能原子操作时在临界区内修改
+	uint16_t count;                    // 订阅个数
+	uint16_t wildcardCount;            // 通配符订阅个数
+	RyanMqttMsgHandler_t *msgHandlers; // 订阅拷贝，顺序与msg链表一致
+	uint16_t *bucketHead;              // 精确订阅哈希桶，保存订阅下标
+	uint16_t *bucketNext;              // 同一哈希桶的下一个订阅下标
+	uint16_t *wildcardIndex;           // 通配符订阅下标
+};
+
+#define RyanMqttMsgSnapshotInvalidIndex (0xFFFFU)
+
+// 回调工作线程中执行的订阅回调
+typedef struct
+{
+	RyanMqttMsgHandle msgHandle; // 订阅回调函数
+	void *userData;              // 订阅时传入的用户数据
+} RyanMqttDispatchHandle_t;
+
+// 回调队列节点，事件数据和消息内容拷贝到节点后面，一次申请内存
+typedef struct
+{
+	RyanMqttList_t list;               // 队列链表节点
+	uint32_t eventId;                  // 需要触发的事件，为0时只执行订阅回调
+	void *eventData;                   // 事件数据，指向节点内的拷贝
+	RyanMqttMsgData_t msgData;         // 消息拷贝，只有消息节点使用
+	RyanMqttDispatchHandle_t *handles; // 订阅回调
+	uint16_t handleCount;              // 订阅回调个数
+	RyanMqttBool_e isMsg;              // 消息节点受队列长度和溢出策略限制，其余事件节点不受限制
+	RyanMqttBool_e ackFlag;            // 回调执行完成后回复PUBACK
+} RyanMqttDispatchItem_t;
+
+// 回调队列，共享模式下所有工作线程共用一个，保序模式下每个工作线程独占一个。
+// 保序模式下消息节点放入有界环形队列，只有mqtt线程写入、只有所属工作线程取出，链表中只剩事件节点
+typedef struct
+{
+	RyanMqttList_t itemList;                        // 回调节点链表
+	RyanMqttAtomic(RyanMqttDispatchItem_t *) *ring; // 保序模式下的消息环形队列，容量为 queueSize，其余模式为NULL
+	RyanMqttAtomic(uint32_t) ringHead;              // 环形队列读位置，只增不减，取模得到下标
+	RyanMqttAtomic(uint32_t) ringTail;              // 环形队列写位置，只有mqtt线程修改
+	RyanMqttAtomic(uint32_t) eventCount;            // 链表中的事件节点数，在队列锁内修改
+	platformCritical_t lock;                        // 队列锁，未使能原子操作时环形队列也在锁内读写
+	platformSemaphore_t itemSem;                    // 唤醒工作线程
+	platformSemaphore_t spaceSem;                   // 队列出现空位时唤醒阻塞的mqtt线程
+	uint32_t dropCount;                             // 队列已满时丢弃的消息数
+	uint16_t msgCount;                              // 链表中的消息节点数
+	RyanMqttAtomic(RyanMqttBool_e) spaceWaitFlag;   // mqtt线程正在等待队列空位
+	RyanMqttAtomic(RyanMqttBool_e) exitFlag;        // 工作线程退出标志，在队列锁内修改
+} RyanMqttDispatchQueue_t;
+
+typedef struct
+{
+	platformThread_t thread;        // 工作线程
+	RyanMqttClient_t *client;       // 所属客户端
+	RyanMqttDispatchQueue_t *queue; // 工作线程消费的队列
+} RyanMqttDispatchWorker_t;
+
+// 回调工作线程池，mqtt线程只负责收发报文，用户回调在工作线程中执行
+struct RyanMqttDispatchPool
+{
+	RyanMqttDispatchQueue_t *queues;           // 回调队列
+	RyanMqttDispatchWorker_t *workers;         // 工作线程
+	RyanMqttDispatchHandle_t *collectHandles;  // 分发消息时收集的订阅回调，仅mqtt线程使用
+	RyanMqttDispatchKeyHandle keyHandle;       // 保序模式下计算消息的分片key，为NULL时使用主题哈希
+	void *userData;                            // 平台接口的用户数据
+	platformCritical_t aliveLock;              // 保护 aliveCount
+	uint16_t collectCount;                     // 已收集的订阅回调个数
+	uint16_t collectCapacity;                  // 收集数组容量
+	uint16_t queueSize;                        // 每个队列能缓存的最大消息数
+	uint8_t workerCount;                       // 工作线程个数
+	uint8_t queueCount;                        // 队列个数，保序模式下等于工作线程个数
+	uint8_t aliveCount;                        // 仍在运行的工作线程个数
+	RyanMqttDispatchOverflow_e overflowPolicy; // 队列已满时的处理策略
+	RyanMqttBool_e ackAfterHandleFlag;         // qos1消息回调执行完成后再回复PUBACK
+	RyanMqttBool_e collectFailedFlag;          // 收集订阅回调时内存不足
+};
+
+// 拉取模式的接收队列，mqtt线程写入，用户线程读取。消息不拷贝，直接持有接收缓冲区
+struct RyanMqttRecvRing
+{
+	RyanMqttMsgData_t *items;     // 环形缓冲区
+	platformCritical_t lock;      // 队列锁
+	platformSemaphore_t itemSem;  // 有新消息时唤醒读取线程
+	platformSemaphore_t spaceSem; // 队列出现空位时唤醒等待的mqtt线程
+	void *userData;               // 平台接口的用户数据
+	uint16_t size;                // 队列长度
+	uint16_t head;                // 最早一条消息的下标
+	uint16_t count;               // 队列中的消息数
+	uint16_t readerCount;         // 正在读取队列的用户线程数，销毁时等待全部退出
+	RyanMqttBool_e spaceWaitFlag; // mqtt线程正在等待队列空位
+	RyanMqttBool_e closeFlag;     // 客户端正在销毁，读取线程立即返回
+};
+
+// 离线消息写入溢出存储时的头部，后面依次是主题、'\0'和数据内容
+typedef struct
+{
+	void *userData;      // 发布时传入的用户数据，溢出存储只在当前进程内有效
+	uint32_t payloadLen; // 数据长度
+	uint16_t topicLen;   // 主题长度
+	uint8_t qos;         // qos等级
+	uint8_t retain;      // retain 标志位
+} RyanMqttOfflineSpillHead_t;
+
+// 离线发布队列，消息先进入内存链表，内存缓存已满时进入溢出存储。溢出存储不为空时内存链表一定不为空
+struct RyanMqttOfflineQueue
+{
+	RyanMqttList_t msgList;            // 内存中的消息，链表头是最早的消息
+	RyanMqttOfflineSpill_t *spill;     // 溢出存储，为NULL时不溢出
+	platformMutex_t lock;              // 队列锁，补发期间一直持有，保证补发和新发布的顺序
+	void *userData;                    // 平台接口的用户数据
+	uint32_t maxBytes;                 // 内存中缓存的最大字节数
+	uint32_t memBytes;                 // 内存中消息占用的字节数
+	uint32_t drainTime;                // 本轮补发开始的时间，单位ms
+	uint32_t drainCount;               // 本轮补发已发送的消息数，用于限速
+	uint16_t maxCount;                 // 最多缓存的消息数
+	uint16_t memCount;                 // 内存中的消息数
+	uint16_t spillCount;               // 溢出存储中的消息数
+	uint16_t drainRate;                // 每秒最多补发的消息数，为0时不限速
+	RyanMqttOfflinePolicy_e policy[3]; // 按qos索引的缓存策略
+};
+
 /* extern variables-----------------------------------------------------------*/
 
 extern void RyanMqttSetClientState(RyanMqttClient_t *client, RyanMqttState_e state);
 extern RyanMqttState_e RyanMqttGetClientState(RyanMqttClient_t *client);
+extern uint32_t RyanMqttGetEventFlag(RyanMqttClient_t *client);
 extern RyanMqttError_e RyanMqttDupString(char **dest, const char *src, uint32_t strLen);
 extern void RyanMqttPurgeSession(RyanMqttClient_t *client);
 extern void RyanMqttPurgeConfig(RyanMqttClientConfig_t *clientConfig);
+extern void RyanMqttConnectPacketInvalidate(RyanMqttClient_t *client);
 
+extern RyanMqttError_e RyanMqttPublishPacket(RyanMqttClient_t *client, char *topic, uint16_t topicLen, char *payload,
+					     uint32_t payloadLen, RyanMqttQos_e qos, RyanMqttBool_e retain,
+					     void *userData);
 extern RyanMqttError_e RyanMqttSendPacket(RyanMqttClient_t *client, uint8_t *buf, uint32_t length);
-extern RyanMqttError_e RyanMqttRecvPacket(RyanMqttClient_t *client, uint8_t *buf, uint32_t length);
+extern RyanMqttError_e RyanMqttRecvPacket(RyanMqttClient_t *client, uint8_t *buf, uint32_t length, uint32_t timeout,
+					  RyanMqttBool_e startFlag);
+extern RyanMqttError_e RyanMqttRecvAvailable(RyanMqttClient_t *client, uint8_t *buf, uint32_t length,
+					     uint32_t *pRecvLen);
+extern RyanMqttError_e RyanMqttSendAvailable(RyanMqttClient_t *client, uint8_t *buf, uint32_t length,
+					     uint32_t *pSendLen);
+
+// transport
+extern RyanMqttError_e RyanMqttTransportConnect(RyanMqttClient_t *client);
+extern RyanMqttError_e RyanMqttTransportConnectStart(RyanMqttClient_t *client, uint32_t *pendingMs);
+extern RyanMqttError_e RyanMqttTransportConnectPoll(RyanMqttClient_t *client, uint32_t *pendingMs);
+extern int32_t RyanMqttTransportRecv(RyanMqttClient_t *client, char *recvBuf, size_t recvLen, int32_t timeout);
+extern int32_t RyanMqttTransportSend(RyanMqttClient_t *client, char *sendBuf, size_t sendLen, int32_t timeout);
+extern void RyanMqttTransportClose(RyanMqttClient_t *client);
+extern int32_t RyanMqttTransportGetFd(RyanMqttClient_t *client);
+extern void RyanMqttTransportWakeup(RyanMqttClient_t *client);
+extern RyanMqttBool_e RyanMqttTransportCanWakeup(RyanMqttClient_t *client);
+
+// topic
+extern uint32_t RyanMqttTopicHash(const char *topic, uint16_t topicLen);
+extern const char *RyanMqttTopicMatchImplName(void);
+extern uint16_t RyanMqttTopicFindSeparator(const char *str, uint16_t len);
+extern uint16_t RyanMqttTopicMismatch(const char *str1, const char *str2, uint16_t len);
+extern RyanMqttBool_e RyanMqttTopicEqual(const char *str1, const char *str2, uint16_t len);
+extern RyanMqttBool_e RyanMqttMatchTopic(const char *topic, const uint16_t topicLength, const char *topicFilter,
+					 const uint16_t topicFilterLength);
+extern uint32_t RyanMqttTopicLevelCount(const char *topic, uint16_t topicLen);
+extern RyanMqttBool_e RyanMqttTopicFilterCompile(const char *topicFilter, uint16_t topicFilterLength,
+						 RyanMqttTopicLevel_t *levels, uint16_t levelCount);
+extern void RyanMqttTopicSplit(RyanMqttTopicSplit_t *topicSplit, const char *topic, uint16_t topicLen);
+extern RyanMqttBool_e RyanMqttMatchTopicLevels(const RyanMqttTopicSplit_t *topicSplit, const char *topicFilter,
+					       uint16_t topicFilterLength, const RyanMqttTopicLevel_t *filterLevels,
+					       uint16_t filterLevelCount);
 
 // msg
 extern RyanMqttError_e RyanMqttMsgHandlerCreate(RyanMqttClient_t *client, const char *topic, uint16_t topicLen,
@@ -37,14 +222,49 @@ extern void RyanMqttMsgHandlerDestroy(RyanMqttClient_t *client, RyanMqttMsgHandl
 extern RyanMqttError_e RyanMqttMsgHandlerFind(RyanMqttClient_t *client, RyanMqttMsgHandler_t *msgMatchCriteria,
 					      RyanMqttBool_e isTopicMatchedFlag, RyanMqttMsgHandler_t **pMsgHandler,
 					      RyanMqttBool_e removeOnMatch);
+extern RyanMqttError_e RyanMqttMsgHandlerDispatch(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData,
+						  RyanMqttBool_e *pEventFlag);
 extern void RyanMqttMsgHandlerFindAndDestroyByPacketId(RyanMqttClient_t *client, RyanMqttMsgHandler_t *msgMatchCriteria,
 						     RyanMqttBool_e skipSamePacketId);
 extern RyanMqttError_e RyanMqttMsgHandlerAddToMsgList(RyanMqttClient_t *client, RyanMqttMsgHandler_t *msgHandler);
 extern RyanMqttError_e RyanMqttMsgHandlerRemoveToMsgList(RyanMqttClient_t *client, RyanMqttMsgHandler_t *msgHandler);
+extern void RyanMqttMsgListLock(RyanMqttClient_t *client);
+extern void RyanMqttMsgListUnLock(RyanMqttClient_t *client);
+extern void RyanMqttMsgListMarkDirty(RyanMqttClient_t *client);
+extern RyanMqttMsgSnapshot_t *RyanMqttMsgSnapshotAcquire(RyanMqttClient_t *client);
+extern void RyanMqttMsgSnapshotRelease(RyanMqttClient_t *client, RyanMqttMsgSnapshot_t *snapshot);
+extern void RyanMqttMsgSnapshotDestroy(RyanMqttClient_t *client);
+
+// dispatch
+extern RyanMqttError_e RyanMqttDispatchCreate(RyanMqttClient_t *client);
+extern void RyanMqttDispatchDestroy(RyanMqttClient_t *client);
+extern void RyanMqttDispatchCollect(RyanMqttClient_t *client, RyanMqttMsgHandle msgHandle, void *userData);
+extern RyanMqttError_e RyanMqttDispatchMsg(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData,
+					   RyanMqttBool_e eventFlag, RyanMqttBool_e ackFlag);
+extern RyanMqttError_e RyanMqttDispatchEvent(RyanMqttClient_t *client, RyanMqttEventId_e eventId, void *eventData);
+extern uint32_t RyanMqttDispatchGetDropCount(RyanMqttDispatchPool_t *pool);
+
+// recv
+extern RyanMqttError_e RyanMqttRecvRingCreate(RyanMqttClient_t *client);
+extern void RyanMqttRecvRingDestroy(RyanMqttClient_t *client);
+extern RyanMqttError_e RyanMqttRecvRingPush(RyanMqttClient_t *client, RyanMqttMsgData_t *msgData);
+extern RyanMqttBool_e RyanMqttRecvRingWaitSpace(RyanMqttClient_t *client, uint32_t timeoutMs);
+extern int32_t RyanMqttRecvRingPop(RyanMqttClient_t *client, RyanMqttMsgData_t msgDatas[], int32_t maxCount,
+				   uint32_t timeoutMs);
+
+// offline
+extern RyanMqttError_e RyanMqttOfflineQueueCreate(RyanMqttClient_t *client);
+extern void RyanMqttOfflineQueueDestroy(RyanMqttClient_t *client);
+extern RyanMqttError_e RyanMqttOfflineQueuePublish(RyanMqttClient_t *client, char *topic, uint16_t topicLen,
+						   char *payload, uint32_t payloadLen, RyanMqttQos_e qos,
+						   RyanMqttBool_e retain, void *userData);
+extern void RyanMqttOfflineQueueDrain(RyanMqttClient_t *client, RyanMqttBool_e connectedFlag);
+extern uint32_t RyanMqttOfflineQueueDrainRemain(RyanMqttClient_t *client);
+extern uint32_t RyanMqttOfflineQueueGetCount(RyanMqttClient_t *client);
 
 // ack
 extern RyanMqttError_e RyanMqttAckHandlerCreate(RyanMqttClient_t *client, uint8_t packetType, uint16_t packetId,
-						uint16_t packetLen, uint8_t *packet, RyanMqttMsgHandler_t *msgHandler,
+						uint32_t packetLen, uint8_t *packet, RyanMqttMsgHandler_t *msgHandler,
 						RyanMqttAckHandler_t **pAckHandler,
 						RyanMqttBool_e packetAllocatedExternally);
 extern void RyanMqttAckHandlerDestroy(RyanMqttClient_t *client, RyanMqttAckHandler_t *ackHandler);
@@ -58,6 +278,7 @@ extern RyanMqttError_e RyanMqttAckListNodeFindByUserAckList(RyanMqttClient_t *cl
 extern RyanMqttError_e RyanMqttAckListAddToUserAckList(RyanMqttClient_t *client, RyanMqttAckHandler_t *ackHandler);
 extern RyanMqttError_e RyanMqttAckListRemoveToUserAckList(RyanMqttClient_t *client, RyanMqttAckHandler_t *ackHandler);
 extern void RyanMqttClearAckSession(RyanMqttClient_t *client, uint8_t packetType, uint16_t packetId);
+extern RyanMqttError_e RyanMqttAckListRestore(RyanMqttClient_t *client);
 
 extern uint16_t RyanMqttGetNextPacketId(RyanMqttClient_t *client);
 
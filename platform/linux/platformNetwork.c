@@ -14,6 +14,15 @@
 RyanMqttError_e platformNetworkInit(void *userData, platformNetwork_t *platformNetwork)
 {
 	platformNetwork->socket = -1;
+	platformNetwork->connecting = NULL;
+	RyanMqttMemset(&platformNetwork->option, 0, sizeof(platformNetwork->option));
+
+	platformNetwork->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (platformNetwork->wakeFd < 0)
+	{
+		return RyanMqttNoRescourceError;
+	}
+
 	return RyanMqttSuccessError;
 }
 
@@ -27,126 +36,1014 @@ RyanMqttError_e platformNetworkInit(void *userData, platformNetwork_t *platformN
 RyanMqttError_e platformNetworkDestroy(void *userData, platformNetwork_t *platformNetwork)
 {
 	platformNetwork->socket = -1;
+
+	if (platformNetwork->wakeFd >= 0)
+	{
+		close(platformNetwork->wakeFd);
+		platformNetwork->wakeFd = -1;
+	}
+
 	return RyanMqttSuccessError;
 }
 
+typedef struct
+{
+	int family;
+	socklen_t addrLen;
+	struct sockaddr_storage addr;
+} platformNetworkAddr_t;
+
+typedef struct
+{
+	uint64_t expireTime;                                        // 过期时间，platformUptimeMs64
+	int32_t addrCount;                                          // 为0时表示解析失败的负缓存
+	char host[platformDnsCacheHostLen];                         // 域名，为空时表示无效记录
+	platformNetworkAddr_t addrs[platformNetworkConnectMaxAddr]; // 解析结果，端口为0
+} platformDnsRecord_t;
+
+typedef struct
+{
+	RyanMqttAtomic(uint32_t) seq;                // 顺序锁序号，奇数表示正在写入
+	platformDnsRecord_t record;                  // 缓存的解析结果
+	char resolvingHost[platformDnsCacheHostLen]; // 正在解析的域名，为空时没有进行中的解析，在锁内读写
+} platformDnsCacheEntry_t;
+
+// 进程内所有客户端共享的dns缓存，按域名哈希直接映射
+// 锁只保护缓存本身，解析时不持有，解析完成后广播唤醒等待同一域名的线程
+static platformDnsCacheEntry_t platformDnsCache[platformDnsCacheCount];
+static pthread_mutex_t platformDnsCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t platformDnsCacheCond = PTHREAD_COND_INITIALIZER;
+
+static uint32_t platformDnsCacheIndex(const char *host)
+{
+	uint32_t hash = 2166136261U; // FNV-1a
+	for (; '\0' != *host; host++)
+	{
+		hash = (hash ^ (uint8_t)*host) * 16777619U;
+	}
+	return hash % platformDnsCacheCount;
+}
+
+static RyanMqttBool_e platformDnsRecordIsValid(const platformDnsRecord_t *record, const char *host)
+{
+	if (0 != strcmp(record->host, host))
+	{
+		return RyanMqttFalse;
+	}
+
+	// 使用64位时间，长时间没有刷新的记录不会因为32位绕回重新变为有效
+	return (record->expireTime > platformUptimeMs64()) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+#if RyanMqttAtomicEnable
 /**
- * @brief 连接mqtt服务器
+ * @brief 无锁读取dns缓存，读取期间记录被修改时视为未命中
+ *
+ * @param entry
+ * @param host
+ * @param record
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e platformDnsCacheRead(platformDnsCacheEntry_t *entry, const char *host,
+					   platformDnsRecord_t *record)
+{
+	uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+	if (seq & 1U)
+	{
+		return RyanMqttFalse;
+	}
+
+	RyanMqttMemcpy(record, &entry->record, sizeof(platformDnsRecord_t));
+	atomic_thread_fence(memory_order_acquire);
+	if (seq != atomic_load_explicit(&entry->seq, memory_order_relaxed))
+	{
+		return RyanMqttFalse;
+	}
+
+	return platformDnsRecordIsValid(record, host);
+}
+#endif
+
+/**
+ * @brief 写入dns缓存，需要持有 platformDnsCacheLock
+ *
+ * @param entry
+ * @param record
+ */
+static void platformDnsCacheWrite(platformDnsCacheEntry_t *entry, const platformDnsRecord_t *record)
+{
+#if RyanMqttAtomicEnable
+	uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_relaxed);
+	atomic_store_explicit(&entry->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	RyanMqttMemcpy(&entry->record, record, sizeof(platformDnsRecord_t));
+	atomic_store_explicit(&entry->seq, seq + 2, memory_order_release);
+#else
+	RyanMqttMemcpy(&entry->record, record, sizeof(platformDnsRecord_t));
+#endif
+}
+
+/**
+ * @brief 调用 getaddrinfo 解析域名，ip地址不会进行dns查询
+ *
+ * @param host
+ * @param record
+ */
+static void platformDnsLookup(const char *host, platformDnsRecord_t *record)
+{
+	struct addrinfo *addrList = NULL;
+	struct addrinfo hints = {0};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	RyanMqttMemset(record, 0, sizeof(platformDnsRecord_t));
+
+	// 域名过长时不缓存，不需要记录域名
+	size_t hostLen = RyanMqttStrlen(host);
+	if (hostLen < platformDnsCacheHostLen)
+	{
+		RyanMqttMemcpy(record->host, host, hostLen + 1);
+	}
+
+	int gaiResult = getaddrinfo(host, NULL, &hints, &addrList);
+	if (0 != gaiResult)
+	{
+		RyanMqttLog_e("dns解析失败 host: %s, %s", host, gai_strerror(gaiResult));
+	}
+	else
+	{
+		for (struct addrinfo *ai = addrList; NULL != ai && record->addrCount < platformNetworkConnectMaxAddr;
+		     ai = ai->ai_next)
+		{
+			if (ai->ai_addrlen > sizeof(struct sockaddr_storage))
+			{
+				continue;
+			}
+
+			platformNetworkAddr_t *addr = &record->addrs[record->addrCount++];
+			addr->family = ai->ai_family;
+			addr->addrLen = ai->ai_addrlen;
+			RyanMqttMemcpy(&addr->addr, ai->ai_addr, ai->ai_addrlen);
+		}
+		freeaddrinfo(addrList);
+	}
+
+	record->expireTime = platformUptimeMs64() +
+			     ((0 != record->addrCount) ? platformDnsCacheTtl : platformDnsCacheNegativeTtl);
+}
+
+typedef struct
+{
+	uint32_t refCount;               // 解析线程和发起解析的线程各持有一个引用，在锁内修改，为0时释放
+	RyanMqttBool_e doneFlag;         // 解析完成，在锁内读写
+	platformDnsCacheEntry_t *entry;  // 解析结果写入的缓存条目，为NULL时不写入缓存
+	platformDnsRecord_t record;      // 解析结果
+	char host[];                     // 需要解析的域名
+} platformDnsJob_t;
+
+/**
+ * @brief 释放解析任务的一个引用，需要持有 platformDnsCacheLock
+ *
+ * @param job
+ */
+static void platformDnsJobRelease(platformDnsJob_t *job)
+{
+	job->refCount--;
+	if (0 == job->refCount)
+	{
+		platformMemoryFree(job);
+	}
+}
+
+/**
+ * @brief 解析线程，getaddrinfo 无法取消，发起解析的线程超时返回后解析结果仍然写入缓存
+ *
+ * @param arg
+ * @return void*
+ */
+static void *platformDnsJobThread(void *arg)
+{
+	platformDnsJob_t *job = (platformDnsJob_t *)arg;
+
+	platformDnsLookup(job->host, &job->record);
+
+	pthread_mutex_lock(&platformDnsCacheLock);
+	if (NULL != job->entry)
+	{
+		platformDnsCacheWrite(job->entry, &job->record);
+		job->entry->resolvingHost[0] = '\0';
+	}
+	job->doneFlag = RyanMqttTrue;
+	pthread_cond_broadcast(&platformDnsCacheCond);
+	platformDnsJobRelease(job);
+	pthread_mutex_unlock(&platformDnsCacheLock);
+	return NULL;
+}
+
+/**
+ * @brief 创建解析线程，需要持有 platformDnsCacheLock
+ *
+ * @param host
+ * @param entry 为NULL时不写入缓存，否则标记该条目正在解析 host
+ * @return platformDnsJob_t* 失败返回NULL
+ */
+static platformDnsJob_t *platformDnsJobStart(const char *host, platformDnsCacheEntry_t *entry)
+{
+	size_t hostLen = RyanMqttStrlen(host);
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	platformDnsJob_t *job = (platformDnsJob_t *)platformMemoryMalloc(sizeof(platformDnsJob_t) + hostLen + 1);
+	if (NULL == job)
+	{
+		return NULL;
+	}
+
+	RyanMqttMemset(job, 0, sizeof(platformDnsJob_t));
+	RyanMqttMemcpy(job->host, host, hostLen + 1);
+	job->refCount = 2;
+	job->entry = entry;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	int createResult = pthread_create(&thread, &attr, platformDnsJobThread, job);
+	pthread_attr_destroy(&attr);
+	if (0 != createResult)
+	{
+		RyanMqttLog_e("创建dns解析线程失败 host: %s, %d", host, createResult);
+		platformMemoryFree(job);
+		return NULL;
+	}
+
+	if (NULL != entry)
+	{
+		RyanMqttMemcpy(entry->resolvingHost, host, hostLen + 1);
+	}
+	return job;
+}
+
+/**
+ * @brief 解析域名，优先使用缓存
+ * 缓存命中时不加锁。未命中时由独立线程调用 getaddrinfo，当前线程最多等待 timeoutMs，
+ * 超时返回时解析线程继续运行并写入缓存，下一次连接可以直接使用。
+ * 重连风暴中同一域名只会解析一次，其他线程等待解析结果。不同域名的解析互不阻塞
+ *
+ * @param host
+ * @param port
+ * @param record
+ * @param timeoutMs
+ * @param pJob 不为NULL时超时不释放当前线程发起的解析任务，保存在这里由下一次调用继续等待，
+ * 避免非阻塞连接每次检查都发起新的解析。解析完成或失败后置为NULL
+ * @return RyanMqttError_e 超时返回 RyanMqttSocketConnectFailError
+ */
+static RyanMqttError_e platformNetworkResolve(const char *host, uint16_t port, platformDnsRecord_t *record,
+					      uint32_t timeoutMs, platformDnsJob_t **pJob)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformDnsCacheEntry_t *entry = NULL;
+	platformDnsJob_t *job = (NULL != pJob) ? *pJob : NULL;
+	RyanMqttBool_e timeoutFlag = RyanMqttFalse;
+	struct timespec deadline;
+
+	// 域名过长不进行缓存
+	if (RyanMqttStrlen(host) < platformDnsCacheHostLen)
+	{
+		entry = &platformDnsCache[platformDnsCacheIndex(host)];
+#if RyanMqttAtomicEnable
+		if (NULL == job && RyanMqttTrue == platformDnsCacheRead(entry, host, record))
+		{
+			goto __resolved;
+		}
+#endif
+	}
+
+	// pthread_cond_t 默认使用 CLOCK_REALTIME
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeoutMs / 1000;
+	deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&platformDnsCacheLock);
+	while (1)
+	{
+		if (NULL != job)
+		{
+			if (RyanMqttTrue == job->doneFlag)
+			{
+				RyanMqttMemcpy(record, &job->record, sizeof(platformDnsRecord_t));
+				break;
+			}
+		}
+		// 等待期间其他线程可能已经解析完成
+		else if (NULL != entry && RyanMqttTrue == platformDnsRecordIsValid(&entry->record, host))
+		{
+			RyanMqttMemcpy(record, &entry->record, sizeof(platformDnsRecord_t));
+			break;
+		}
+		// 没有进行中的解析时由当前线程发起解析并写入缓存，
+		// 同一个缓存条目正在解析其他域名时不等待，直接解析并且不写入缓存
+		else if (NULL == entry || 0 != strcmp(entry->resolvingHost, host))
+		{
+			if (NULL != entry && '\0' != entry->resolvingHost[0])
+			{
+				entry = NULL;
+			}
+
+			job = platformDnsJobStart(host, entry);
+			if (NULL == job)
+			{
+				result = RyanMqttNoRescourceError;
+				break;
+			}
+			continue;
+		}
+
+		if (ETIMEDOUT == pthread_cond_timedwait(&platformDnsCacheCond, &platformDnsCacheLock, &deadline))
+		{
+			timeoutFlag = RyanMqttTrue;
+			result = RyanMqttSocketConnectFailError;
+			break;
+		}
+	}
+
+	if (NULL != pJob)
+	{
+		*pJob = NULL;
+	}
+
+	if (NULL != job)
+	{
+		if (NULL != pJob && RyanMqttTrue == timeoutFlag)
+		{
+			*pJob = job;
+		}
+		else
+		{
+			platformDnsJobRelease(job);
+		}
+	}
+	pthread_mutex_unlock(&platformDnsCacheLock);
+
+	if (RyanMqttTrue == timeoutFlag && NULL == pJob)
+	{
+		RyanMqttLog_e("dns解析超时 host: %s", host);
+	}
+
+	if (RyanMqttSuccessError != result)
+	{
+		return result;
+	}
+
+#if RyanMqttAtomicEnable
+__resolved:
+#endif
+	if (0 == record->addrCount)
+	{
+		return RyanMqttNoRescourceError;
+	}
+
+	for (int32_t i = 0; i < record->addrCount; i++)
+	{
+		if (AF_INET6 == record->addrs[i].family)
+		{
+			((struct sockaddr_in6 *)&record->addrs[i].addr)->sin6_port = htons(port);
+		}
+		else
+		{
+			((struct sockaddr_in *)&record->addrs[i].addr)->sin_port = htons(port);
+		}
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 把unix domain socket路径转换为只有一个地址的解析结果，复用tcp的连接流程
+ *
+ * @param path socket文件路径
+ * @param record
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformNetworkUnixAddr(const char *path, platformDnsRecord_t *record)
+{
+	struct sockaddr_un *addr = (struct sockaddr_un *)&record->addrs[0].addr;
+	size_t pathLen = RyanMqttStrlen(path);
+
+	RyanMqttMemset(record, 0, sizeof(platformDnsRecord_t));
+	RyanMqttCheck(pathLen > 0 && pathLen < sizeof(addr->sun_path), RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	addr->sun_family = AF_UNIX;
+	RyanMqttMemcpy(addr->sun_path, path, pathLen + 1);
+	record->addrs[0].family = AF_UNIX;
+	record->addrs[0].addrLen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + pathLen + 1);
+	record->addrCount = 1;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 使dns缓存失效，下一次连接时重新解析
+ *
+ * @param host 为NULL时清空所有缓存
+ */
+void platformNetworkDnsRefresh(const char *host)
+{
+	platformDnsRecord_t emptyRecord = {0};
+
+	pthread_mutex_lock(&platformDnsCacheLock);
+	for (uint32_t i = 0; i < platformDnsCacheCount; i++)
+	{
+		if (NULL == host || 0 == strcmp(platformDnsCache[i].record.host, host))
+		{
+			platformDnsCacheWrite(&platformDnsCache[i], &emptyRecord);
+		}
+	}
+	pthread_mutex_unlock(&platformDnsCacheLock);
+}
+
+/**
+ * @brief 设置一个int类型的socket选项，失败只打印警告
+ * 部分选项需要特权或者内核支持 (例如 SO_BUSY_POLL)，不应该导致连接失败
+ *
+ * @param fd
+ * @param level
+ * @param optName
+ * @param value
+ */
+static void platformNetworkSetIntOption(int fd, int level, int optName, int value)
+{
+	if (0 != setsockopt(fd, level, optName, &value, sizeof(value)))
+	{
+		RyanMqttLog_w("setsockopt失败 level: %d, optName: %d, value: %d, errno: %d", level, optName, value,
+			      errno);
+	}
+}
+
+/**
+ * @brief 在连接前应用socket选项，缓冲区大小需要在连接前设置才能影响tcp窗口协商
+ *
+ * @param fd
+ * @param family
+ * @param option
+ */
+static void platformNetworkApplyOption(int fd, int family, const RyanMqttSocketOption_t *option)
+{
+	if (0 != option->sendBufSize)
+	{
+		platformNetworkSetIntOption(fd, SOL_SOCKET, SO_SNDBUF, (int)option->sendBufSize);
+	}
+
+	if (0 != option->recvBufSize)
+	{
+		platformNetworkSetIntOption(fd, SOL_SOCKET, SO_RCVBUF, (int)option->recvBufSize);
+	}
+
+	// unix domain socket 只支持缓冲区大小
+	if (AF_UNIX == family)
+	{
+		return;
+	}
+
+	if (RyanMqttTrue == option->noDelayFlag)
+	{
+		platformNetworkSetIntOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+	}
+
+	if (RyanMqttTrue == option->keepaliveFlag)
+	{
+		platformNetworkSetIntOption(fd, SOL_SOCKET, SO_KEEPALIVE, 1);
+		if (0 != option->keepaliveIdleS)
+		{
+			platformNetworkSetIntOption(fd, IPPROTO_TCP, TCP_KEEPIDLE, option->keepaliveIdleS);
+		}
+		if (0 != option->keepaliveIntervalS)
+		{
+			platformNetworkSetIntOption(fd, IPPROTO_TCP, TCP_KEEPINTVL, option->keepaliveIntervalS);
+		}
+		if (0 != option->keepaliveCount)
+		{
+			platformNetworkSetIntOption(fd, IPPROTO_TCP, TCP_KEEPCNT, option->keepaliveCount);
+		}
+	}
+
+#ifdef TCP_USER_TIMEOUT
+	if (0 != option->userTimeoutMs)
+	{
+		platformNetworkSetIntOption(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, (int)option->userTimeoutMs);
+	}
+#endif
+
+#ifdef SO_BUSY_POLL
+	if (0 != option->busyPollUs)
+	{
+		platformNetworkSetIntOption(fd, SOL_SOCKET, SO_BUSY_POLL, (int)option->busyPollUs);
+	}
+#endif
+
+	if (0 != option->tos)
+	{
+		if (AF_INET6 == family)
+		{
+			platformNetworkSetIntOption(fd, IPPROTO_IPV6, IPV6_TCLASS, option->tos);
+		}
+		else
+		{
+			platformNetworkSetIntOption(fd, IPPROTO_IP, IP_TOS, option->tos);
+		}
+	}
+}
+
+/**
+ * @brief 发起一次非阻塞连接
+ *
+ * @param addr
+ * @param option 连接前应用的socket选项
+ * @param pending 连接正在进行中时为 RyanMqttTrue
+ * @return int 失败返回 -1
+ */
+static int platformNetworkConnectStart(const platformNetworkAddr_t *addr, const RyanMqttSocketOption_t *option,
+				       RyanMqttBool_e *pending)
+{
+	int fd = socket(addr->family, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	platformNetworkApplyOption(fd, addr->family, option);
+
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || 0 != fcntl(fd, F_SETFL, flags | O_NONBLOCK))
+	{
+		close(fd);
+		return -1;
+	}
+
+	if (0 == connect(fd, (const struct sockaddr *)&addr->addr, addr->addrLen))
+	{
+		*pending = RyanMqttFalse;
+		return fd;
+	}
+
+	if (EINPROGRESS != errno)
+	{
+		close(fd);
+		return -1;
+	}
+
+	*pending = RyanMqttTrue;
+	return fd;
+}
+
+/**
+ * @brief 连接成功后恢复为阻塞模式，发送超时由 SO_SNDTIMEO 控制，接收由 poll 控制
+ *
+ * @param fd
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformNetworkConnectFinish(int fd)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || 0 != fcntl(fd, F_SETFL, flags & ~O_NONBLOCK))
+	{
+		return RyanSocketFailedError;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 按地址族交替排序解析结果，第一个地址族优先 (RFC 8305)
+ *
+ * @param record
+ * @param addrs
+ * @return int32_t 地址个数
+ */
+static int32_t platformNetworkSortAddr(const platformDnsRecord_t *record, const platformNetworkAddr_t *addrs[])
+{
+	int32_t primary = 0;
+	int32_t secondary = 0;
+	int32_t count = 0;
+	int firstFamily = record->addrs[0].family;
+
+	while (primary < record->addrCount || secondary < record->addrCount)
+	{
+		// 交替取出首选地址族和其他地址族的下一个地址
+		while (primary < record->addrCount && record->addrs[primary].family != firstFamily)
+		{
+			primary++;
+		}
+		if (primary < record->addrCount)
+		{
+			addrs[count++] = &record->addrs[primary++];
+		}
+
+		while (secondary < record->addrCount && record->addrs[secondary].family == firstFamily)
+		{
+			secondary++;
+		}
+		if (secondary < record->addrCount)
+		{
+			addrs[count++] = &record->addrs[secondary++];
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief 设置下一次连接时应用的socket选项，不影响已经建立的连接
  *
  * @param userData
  * @param platformNetwork
+ * @param option
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkSetOption(void *userData, platformNetwork_t *platformNetwork,
+					 const RyanMqttSocketOption_t *option)
+{
+	platformNetwork->option = *option;
+	return RyanMqttSuccessError;
+}
+
+// 一次进行中的连接，包括dns解析和按 Happy Eyeballs 并行尝试的所有地址
+struct platformNetworkConnecting
+{
+	platformDnsRecord_t record;                                        // 解析结果
+	const platformNetworkAddr_t *addrs[platformNetworkConnectMaxAddr]; // 按地址族交替排序后的地址
+	struct pollfd pollFds[platformNetworkConnectMaxAddr];             // 正在连接中的socket
+	platformDnsJob_t *dnsJob;       // 非阻塞连接时还没有完成的解析任务
+	int32_t addrCount;              // 地址个数，还没有解析完成时为-1
+	int32_t nextAddr;               // 下一个尝试的地址
+	int32_t pendingCount;           // 正在连接中的socket个数
+	RyanMqttTimer_t connectTimer;   // 包括dns解析在内的整体超时
+	RyanMqttTimer_t attemptTimer;   // 开始尝试下一个地址的时间
+	const char *host;
+	uint16_t port;
+};
+
+/**
+ * @brief 初始化一次连接
+ *
+ * @param connecting
  * @param host
  * @param port
- * @return RyanMqttError_e
- * 成功返回RyanMqttSuccessError， 失败返回错误信息
  */
-RyanMqttError_e platformNetworkConnect(void *userData, platformNetwork_t *platformNetwork, const char *host,
-				       uint16_t port)
+static void platformNetworkConnectingInit(platformNetworkConnecting_t *connecting, const char *host, uint16_t port)
+{
+	RyanMqttMemset(connecting, 0, sizeof(platformNetworkConnecting_t));
+	connecting->addrCount = -1;
+	connecting->host = host;
+	connecting->port = port;
+	RyanMqttTimerCutdown(&connecting->connectTimer, platformNetworkConnectTimeout);
+}
+
+/**
+ * @brief 释放连接过程中的资源，关闭还在连接中的socket
+ *
+ * @param connecting
+ */
+static void platformNetworkConnectingDeInit(platformNetworkConnecting_t *connecting)
+{
+	for (int32_t i = 0; i < connecting->pendingCount; i++)
+	{
+		close(connecting->pollFds[i].fd);
+	}
+	connecting->pendingCount = 0;
+
+	if (NULL != connecting->dnsJob)
+	{
+		pthread_mutex_lock(&platformDnsCacheLock);
+		platformDnsJobRelease(connecting->dnsJob);
+		pthread_mutex_unlock(&platformDnsCacheLock);
+		connecting->dnsJob = NULL;
+	}
+}
+
+/**
+ * @brief 是否为IP地址字面量，解析时不需要查询dns，可以直接等待结果
+ *
+ * @param host
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e platformNetworkIsNumericHost(const char *host)
+{
+	struct in6_addr addr;
+
+	if (1 == inet_pton(AF_INET, host, &addr) || 1 == inet_pton(AF_INET6, host, &addr))
+	{
+		return RyanMqttTrue;
+	}
+
+	return RyanMqttFalse;
+}
+
+/**
+ * @brief 推进连接流程，最多等待 waitMs
+ * 第一个连接成功的socket胜出，其他还在连接中的socket被关闭
+ *
+ * @param platformNetwork
+ * @param connecting
+ * @param waitMs 为0时不等待，只处理已经就绪的事件
+ * @param pendingMs 连接还在进行中时为需要再次推进的最长等待时间，连接成功时为0
+ * @return RyanMqttError_e 连接失败或超时返回错误
+ */
+static RyanMqttError_e platformNetworkConnectAdvance(platformNetwork_t *platformNetwork,
+						     platformNetworkConnecting_t *connecting, uint32_t waitMs,
+						     uint32_t *pendingMs)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
-	char *buf = NULL;
-	struct sockaddr_in server_addr = {
-		.sin_family = AF_INET,
-		.sin_port = htons(port), // 指定端口号
-	};
+	RyanMqttTimer_t waitTimer;
+	int winFd = -1;
+
+	*pendingMs = 0;
+	RyanMqttTimerCutdown(&waitTimer, waitMs);
 
-	// 传递的是ip地址，不用进行dns解析，某些情况下调用dns解析反而会错误
-	if (inet_pton(server_addr.sin_family, host, &server_addr.sin_addr))
+	if (connecting->addrCount < 0)
 	{
-		// inet_pton 已经将地址赋值到 server_addr.sin_addr，无需额外处理
+		const char *host = connecting->host;
+		size_t unixPrefixLen = sizeof(platformNetworkUnixPrefix) - 1;
+		if (0 == RyanMqttStrncmp(host, platformNetworkUnixPrefix, unixPrefixLen))
+		{
+			result = platformNetworkUnixAddr(host + unixPrefixLen, &connecting->record);
+		}
+		else
+		{
+			// 非阻塞连接时域名在后台解析，IP地址字面量直接等待解析结果
+			uint32_t resolveMs = RyanMqttTimerRemain(&connecting->connectTimer);
+			RyanMqttBool_e asyncFlag = (0 == waitMs && RyanMqttTrue != platformNetworkIsNumericHost(host))
+							   ? RyanMqttTrue
+							   : RyanMqttFalse;
+			if (RyanMqttTrue == asyncFlag || (0 != waitMs && waitMs < resolveMs))
+			{
+				resolveMs = waitMs;
+			}
+			result = platformNetworkResolve(host, connecting->port, &connecting->record, resolveMs,
+							(RyanMqttTrue == asyncFlag) ? &connecting->dnsJob : NULL);
+		}
+
+		// 非阻塞连接时解析还没有完成，稍后再检查
+		if (0 == waitMs && RyanMqttSocketConnectFailError == result)
+		{
+			uint32_t connectRemain = RyanMqttTimerRemain(&connecting->connectTimer);
+			RyanMqttCheck(0 != connectRemain, RyanMqttSocketConnectFailError, RyanMqttLog_e);
+			*pendingMs = platformNetworkResolvePollInterval;
+			if (connectRemain < *pendingMs)
+			{
+				*pendingMs = connectRemain;
+			}
+			return RyanMqttSuccessError;
+		}
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+		connecting->addrCount = platformNetworkSortAddr(&connecting->record, connecting->addrs);
+		RyanMqttTimerCutdown(&connecting->attemptTimer, 0);
 	}
-	// 解析域名信息
-	else
+
+	while (-1 == winFd)
 	{
-#define dnsBufferSize (384)
-		// RyanMqttLog_d("host: %s, 需要dns解析", host);
-		int h_errnop;
-		struct hostent *phost;
-		struct hostent hostinfo = {0};
+		uint32_t connectRemain = RyanMqttTimerRemain(&connecting->connectTimer);
+		if (0 == connectRemain)
+		{
+			break;
+		}
+
+		// 上一次尝试超过间隔还没有结果，或者已经失败时，开始尝试下一个地址
+		if (connecting->nextAddr < connecting->addrCount && 0 == RyanMqttTimerRemain(&connecting->attemptTimer))
+		{
+			RyanMqttBool_e pending = RyanMqttFalse;
+			int fd = platformNetworkConnectStart(connecting->addrs[connecting->nextAddr++],
+							     &platformNetwork->option, &pending);
+			if (fd >= 0 && RyanMqttTrue != pending)
+			{
+				winFd = fd;
+				break;
+			}
+
+			if (fd >= 0)
+			{
+				connecting->pollFds[connecting->pendingCount].fd = fd;
+				connecting->pollFds[connecting->pendingCount].events = POLLOUT;
+				connecting->pollFds[connecting->pendingCount].revents = 0;
+				connecting->pendingCount++;
+				RyanMqttTimerCutdown(&connecting->attemptTimer, platformNetworkConnectAttemptDelay);
+			}
+			continue;
+		}
+
+		if (0 == connecting->pendingCount)
+		{
+			if (connecting->nextAddr >= connecting->addrCount)
+			{
+				break;
+			}
+			continue;
+		}
 
-		buf = (char *)platformMemoryMalloc(dnsBufferSize);
-		if (NULL == buf)
+		// 下一次需要处理的时间：整体超时或者开始尝试下一个地址
+		uint32_t dueMs = connectRemain;
+		uint32_t attemptRemain = RyanMqttTimerRemain(&connecting->attemptTimer);
+		if (connecting->nextAddr < connecting->addrCount && attemptRemain < dueMs)
 		{
-			result = RyanMqttNoRescourceError;
-			goto __exit;
+			dueMs = attemptRemain;
 		}
 
-		if (0 != gethostbyname_r(host, &hostinfo, buf, dnsBufferSize, &phost, &h_errnop))
+		uint32_t waitRemain = RyanMqttTimerRemain(&waitTimer);
+		int pollResult = poll(connecting->pollFds, (nfds_t)connecting->pendingCount,
+				      (int)((dueMs < waitRemain) ? dueMs : waitRemain));
+		if (pollResult < 0 && EINTR != errno)
 		{
-			RyanMqttLog_w(
-				(char *)"平台可能不支持 gethostbyname_r 函数, 再次尝试使用 gethostbyname 获取域名信息");
+			break;
+		}
 
-			// 非线程安全版本,请根据实际情况选择使用
-			// NOLINTNEXTLINE(concurrency-mt-unsafe)
-			struct hostent *phostinfo = gethostbyname(host);
-			if (NULL == phostinfo)
+		for (int32_t i = 0; pollResult > 0 && i < connecting->pendingCount;)
+		{
+			if (0 == connecting->pollFds[i].revents)
 			{
-				result = RyanMqttNoRescourceError;
-				goto __exit;
+				i++;
+				continue;
+			}
+
+			int soError = 0;
+			socklen_t soErrorLen = sizeof(soError);
+			if (0 == getsockopt(connecting->pollFds[i].fd, SOL_SOCKET, SO_ERROR, &soError, &soErrorLen) &&
+			    0 == soError)
+			{
+				winFd = connecting->pollFds[i].fd;
+			}
+			else
+			{
+				close(connecting->pollFds[i].fd);
+				// 有地址失败时立即尝试下一个地址
+				RyanMqttTimerCutdown(&connecting->attemptTimer, 0);
 			}
 
-			hostinfo = *phostinfo;
+			connecting->pollFds[i] = connecting->pollFds[--connecting->pendingCount];
+			if (-1 != winFd)
+			{
+				break;
+			}
 		}
-		else
+
+		// 等待时间已经用完，没有需要立即处理的事件时返回，由调用者稍后继续
+		if (-1 == winFd && 0 == pollResult && dueMs > waitRemain)
 		{
-			// 成功时也需要校验返回内容有效
-			if (NULL == hostinfo.h_addr_list || NULL == hostinfo.h_addr_list[0])
+			*pendingMs = dueMs - waitRemain;
+			// 有多个socket在连接时，外部只监听其中一个，定期检查其他socket
+			if (connecting->pendingCount > 1 && *pendingMs > platformNetworkConnectAttemptDelay)
 			{
-				result = RyanMqttNoRescourceError;
-				goto __exit;
+				*pendingMs = platformNetworkConnectAttemptDelay;
 			}
+			return RyanMqttSuccessError;
 		}
-		server_addr.sin_addr = *((struct in_addr *)hostinfo.h_addr_list[0]);
 	}
 
-	platformNetwork->socket = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-	if (platformNetwork->socket < 0)
+	// 关闭其他还在连接中的socket
+	platformNetworkConnectingDeInit(connecting);
+
+	if (-1 == winFd)
 	{
-		result = RyanSocketFailedError;
-		goto __exit;
+		RyanMqttLog_e("socket连接失败");
+		return RyanMqttSocketConnectFailError;
 	}
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wanalyzer-fd-leak"
-	// 绑定套接字到主机地址和端口号
-	if (0 != connect(platformNetwork->socket, (struct sockaddr *)&server_addr, sizeof(server_addr)))
+	if (RyanMqttSuccessError != platformNetworkConnectFinish(winFd))
 	{
-		platformNetworkClose(userData, platformNetwork);
-		result = RyanMqttSocketConnectFailError;
-		goto __exit;
+		close(winFd);
+		RyanMqttLog_e("socket连接失败");
+		return RyanSocketFailedError;
 	}
-#pragma GCC diagnostic pop
 
-__exit:
-	if (NULL != buf)
+	platformNetwork->socket = winFd;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 结束进行中的非阻塞连接
+ *
+ * @param platformNetwork
+ */
+static void platformNetworkConnectAbort(platformNetwork_t *platformNetwork)
+{
+	if (NULL != platformNetwork->connecting)
 	{
-		platformMemoryFree(buf);
+		platformNetworkConnectingDeInit(platformNetwork->connecting);
+		platformMemoryFree(platformNetwork->connecting);
+		platformNetwork->connecting = NULL;
 	}
+}
 
-	if (RyanMqttSuccessError != result)
+/**
+ * @brief 连接mqtt服务器
+ * 域名解析结果进程内共享缓存，按 Happy Eyeballs (RFC 8305) 错开时间并行尝试 IPv4 / IPv6 地址，
+ * 第一个连接成功的socket胜出，包括dns解析在内整体耗时不超过 platformNetworkConnectTimeout
+ * host 以 platformNetworkUnixPrefix 开头时连接本机的 unix domain socket，收发接口与tcp相同
+ *
+ * @param userData
+ * @param platformNetwork
+ * @param host
+ * @param port
+ * @return RyanMqttError_e
+ * 成功返回RyanMqttSuccessError， 失败返回错误信息
+ */
+RyanMqttError_e platformNetworkConnect(void *userData, platformNetwork_t *platformNetwork, const char *host,
+				       uint16_t port)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformNetworkConnecting_t connecting;
+	uint32_t pendingMs = 0;
+
+	platformNetworkConnectAbort(platformNetwork);
+	platformNetworkConnectingInit(&connecting, host, port);
+
+	do
+	{
+		result = platformNetworkConnectAdvance(platformNetwork, &connecting,
+						       RyanMqttTimerRemain(&connecting.connectTimer), &pendingMs);
+	} while (RyanMqttSuccessError == result && 0 != pendingMs);
+
+	platformNetworkConnectingDeInit(&connecting);
+	return result;
+}
+
+/**
+ * @brief 发起非阻塞连接，dns解析和tcp握手都不等待
+ * 连接进行中时 platformNetworkGetFd 返回正在连接的socket，socket可写或者等待 *pendingMs 后
+ * 调用 platformNetworkConnectPoll 继续，整体超时与 platformNetworkConnect 相同
+ *
+ * @param userData
+ * @param platformNetwork
+ * @param host 连接进行中会保存一份拷贝
+ * @param port
+ * @param pendingMs 连接成功时为0，否则为需要再次调用 platformNetworkConnectPoll 的最长等待时间
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkConnectAsync(void *userData, platformNetwork_t *platformNetwork, const char *host,
+					    uint16_t port, uint32_t *pendingMs)
+{
+	size_t hostLen = RyanMqttStrlen(host);
+
+	platformNetworkConnectAbort(platformNetwork);
+	platformNetworkConnecting_t *connecting =
+		(platformNetworkConnecting_t *)platformMemoryMalloc(sizeof(platformNetworkConnecting_t) + hostLen + 1);
+	RyanMqttCheck(NULL != connecting, RyanMqttNotEnoughMemError, RyanMqttLog_e);
+
+	char *hostCopy = (char *)(connecting + 1);
+	RyanMqttMemcpy(hostCopy, host, hostLen + 1);
+	platformNetworkConnectingInit(connecting, hostCopy, port);
+	platformNetwork->connecting = connecting;
+
+	return platformNetworkConnectPoll(userData, platformNetwork, pendingMs);
+}
+
+/**
+ * @brief 继续进行中的非阻塞连接，不等待
+ *
+ * @param userData
+ * @param platformNetwork
+ * @param pendingMs 连接成功时为0，否则为需要再次调用的最长等待时间
+ * @return RyanMqttError_e 没有进行中的连接时按当前socket是否有效返回
+ */
+RyanMqttError_e platformNetworkConnectPoll(void *userData, platformNetwork_t *platformNetwork, uint32_t *pendingMs)
+{
+	*pendingMs = 0;
+	if (NULL == platformNetwork->connecting)
+	{
+		return (platformNetwork->socket >= 0) ? RyanMqttSuccessError : RyanMqttSocketConnectFailError;
+	}
+
+	RyanMqttError_e result =
+		platformNetworkConnectAdvance(platformNetwork, platformNetwork->connecting, 0, pendingMs);
+	if (RyanMqttSuccessError != result || 0 == *pendingMs)
 	{
-		RyanMqttLog_e("socket连接失败: %d", result);
+		platformNetworkConnectAbort(platformNetwork);
 	}
+
 	return result;
 }
 
 /**
  * @brief 非阻塞接收数据
+ * socket和唤醒eventfd一起poll，platformNetworkWakeup 会让等待中的接收立即返回0
  *
  * @param userData
  * @param platformNetwork
  * @param recvBuf
  * @param recvLen
  * @param timeout
- * @return int32_t 成功返回接收字节数，错误返回 -1
+ * @return int32_t 成功返回接收字节数，超时或被唤醒返回0，错误返回 -1
  */
 int32_t platformNetworkRecvAsync(void *userData, platformNetwork_t *platformNetwork, char *recvBuf, size_t recvLen,
 				 int32_t timeout)
 {
 	ssize_t recvResult = 0;
-	struct timeval tv = {
-		.tv_sec = timeout / 1000,
-		.tv_usec = (uint32_t)((timeout % 1000) * 1000),
+	struct pollfd pollFds[2] = {
+		{.fd = platformNetwork->socket, .events = POLLIN},
+		{.fd = platformNetwork->wakeFd, .events = POLLIN},
 	};
 
 	if (platformNetwork->socket < 0)
@@ -155,10 +1052,25 @@ int32_t platformNetworkRecvAsync(void *userData, platformNetwork_t *platformNetw
 		return -1;
 	}
 
-	setsockopt(platformNetwork->socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv,
-		   sizeof(struct timeval)); // 设置操作模式为非阻塞
+	int pollResult = poll(pollFds, 2, timeout > 0 ? (int)timeout : 0);
+	if (pollResult <= 0)
+	{
+		return (pollResult < 0 && EINTR != errno) ? -1 : 0;
+	}
 
-	recvResult = recv(platformNetwork->socket, recvBuf, recvLen, 0);
+	// 清空唤醒计数，多次唤醒合并为一次
+	if (0 != pollFds[1].revents)
+	{
+		eventfd_t value;
+		eventfd_read(platformNetwork->wakeFd, &value);
+	}
+
+	if (0 == pollFds[0].revents)
+	{
+		return 0;
+	}
+
+	recvResult = recv(platformNetwork->socket, recvBuf, recvLen, MSG_DONTWAIT);
 	if (0 == recvResult)
 	{
 		RyanMqttLog_e("对端关闭socket连接");
@@ -216,7 +1128,8 @@ int32_t platformNetworkSendAsync(void *userData, platformNetwork_t *platformNetw
 	setsockopt(platformNetwork->socket, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv,
 		   sizeof(struct timeval)); // 设置操作模式为非阻塞
 
-	sendResult = send(platformNetwork->socket, sendBuf, sendLen, 0);
+	// 对端已经关闭时返回 EPIPE 而不是触发SIGPIPE结束进程，不修改进程的信号处理方式
+	sendResult = send(platformNetwork->socket, sendBuf, sendLen, MSG_NOSIGNAL);
 	if (0 == sendResult)
 	{
 		RyanMqttLog_e("对端关闭socket连接");
@@ -255,6 +1168,7 @@ int32_t platformNetworkSendAsync(void *userData, platformNetwork_t *platformNetw
  */
 RyanMqttError_e platformNetworkClose(void *userData, platformNetwork_t *platformNetwork)
 {
+	platformNetworkConnectAbort(platformNetwork);
 
 	if (platformNetwork->socket >= 0)
 	{
@@ -265,3 +1179,40 @@ RyanMqttError_e platformNetworkClose(void *userData, platformNetwork_t *platform
 
 	return RyanMqttSuccessError;
 }
+
+/**
+ * @brief 打断正在等待数据的 platformNetworkRecvAsync，使其立即返回0
+ * 没有正在等待的接收时，下一次接收立即返回，唤醒不会丢失。可以在任意线程中调用
+ *
+ * @param userData
+ * @param platformNetwork
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkWakeup(void *userData, platformNetwork_t *platformNetwork)
+{
+	if (platformNetwork->wakeFd < 0 || 0 != eventfd_write(platformNetwork->wakeFd, 1))
+	{
+		return RyanSocketFailedError;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取socket描述符，供外部事件循环监听
+ * 非阻塞连接进行中时返回其中一个正在连接的socket，连接完成或失败时可写
+ *
+ * @param userData
+ * @param platformNetwork
+ * @return int32_t 没有连接时返回 -1
+ */
+int32_t platformNetworkGetFd(void *userData, platformNetwork_t *platformNetwork)
+{
+	platformNetworkConnecting_t *connecting = platformNetwork->connecting;
+	if (NULL != connecting && connecting->pendingCount > 0)
+	{
+		return connecting->pollFds[connecting->pendingCount - 1].fd;
+	}
+
+	return platformNetwork->socket;
+}
@@ -13,9 +13,11 @@ extern "C" {
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/param.h>
 #include <sys/time.h>
 #include <sys/select.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -23,12 +25,73 @@ extern "C" {
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <poll.h>
+#include "RyanMqttPublic.h"
+
+// 连接服务器的总超时时间，包括dns解析和解析后的所有地址尝试。单位ms
+#ifndef platformNetworkConnectTimeout
+#define platformNetworkConnectTimeout (5000)
+#endif
+
+// 上一个地址还没有连接结果时，开始尝试下一个地址的间隔 (RFC 8305 推荐250ms)。单位ms
+#ifndef platformNetworkConnectAttemptDelay
+#define platformNetworkConnectAttemptDelay (250)
+#endif
+
+// 最多尝试的地址个数
+#ifndef platformNetworkConnectMaxAddr
+#define platformNetworkConnectMaxAddr (8)
+#endif
+
+// 非阻塞连接等待dns解析结果时的检查间隔。单位ms
+#ifndef platformNetworkResolvePollInterval
+#define platformNetworkResolvePollInterval (20)
+#endif
+
+// platformNetworkWakeup 可以打断正在等待数据的 platformNetworkRecvAsync，mqtt线程空闲时一直等到下一个截止时间
+#ifndef platformNetworkWakeupEnable
+#define platformNetworkWakeupEnable (1)
+#endif
+
+// host 以该前缀开头时通过 unix domain socket 连接本机broker，前缀之后是socket文件路径，忽略端口
+// 例如 "unix:/var/run/mosquitto.sock"，省去tcp回环的校验和、状态机和端口分配开销
+#ifndef platformNetworkUnixPrefix
+#define platformNetworkUnixPrefix "unix:"
+#endif
+
+// 进程内共享的dns缓存条目数，按域名哈希直接映射
+#ifndef platformDnsCacheCount
+#define platformDnsCacheCount (16)
+#endif
+
+// 可以缓存的最大域名长度，超过时每次连接都重新解析
+#ifndef platformDnsCacheHostLen
+#define platformDnsCacheHostLen (128)
+#endif
+
+// dns解析成功的缓存时间，getaddrinfo 无法获取记录的TTL。单位ms
+#ifndef platformDnsCacheTtl
+#define platformDnsCacheTtl (60 * 1000)
+#endif
+
+// dns解析失败的缓存时间，避免重连风暴时反复查询。单位ms
+#ifndef platformDnsCacheNegativeTtl
+#define platformDnsCacheNegativeTtl (5 * 1000)
+#endif
+
+typedef struct platformNetworkConnecting platformNetworkConnecting_t;
 
 typedef struct
 {
 	int socket;
+	int wakeFd;                              // 打断接收等待的eventfd，和socket一起poll，生命周期与网络组件相同
+	RyanMqttSocketOption_t option;           // 下一次连接时应用的socket选项
+	platformNetworkConnecting_t *connecting; // 进行中的非阻塞连接，没有时为NULL
 } platformNetwork_t;
 
+// 使dns缓存失效，host为NULL时清空所有缓存
+extern void platformNetworkDnsRefresh(const char *host);
+
 #ifdef __cplusplus
 }
 #endif
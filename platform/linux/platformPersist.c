@@ -0,0 +1,646 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "platformPersist.h"
+#include "RyanMqttLog.h"
+
+#define platformPersistMagic     (0x4A504D52U) // "RMPJ"
+#define platformPersistVersion   (1U)
+#define platformPersistOpPut     (1U)
+#define platformPersistOpDel     (2U)
+#define platformPersistAlign(x)  (((x) + 3U) & ~3U)
+#define platformPersistMinEntry  (64U)
+#define platformPersistTmpSuffix ".tmp"
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t reserved[2];
+} platformPersistFileHead_t;
+
+// 日志记录头，后面紧跟主题和报文。len 最后写入，为0时表示日志结束
+typedef struct
+{
+	uint32_t len;      // 记录总长度，4字节对齐
+	uint32_t checksum; // len 之后所有字节的校验和，检测写了一半的记录
+	uint8_t op;        // platformPersistOpPut / platformPersistOpDel
+	uint8_t packetType;
+	uint16_t packetId;
+	uint8_t qos;
+	uint8_t reserved;
+	uint16_t topicLen;
+	uint32_t packetLen;
+} platformPersistRecordHead_t;
+
+#define platformPersistHeadLen ((uint32_t)sizeof(platformPersistFileHead_t))
+
+static uint32_t platformPersistChecksum(const uint8_t *data, uint32_t len)
+{
+	uint32_t hash = 2166136261U; // FNV-1a
+	for (uint32_t i = 0; i < len; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static uint32_t platformPersistKey(uint8_t packetType, uint16_t packetId)
+{
+	return ((uint32_t)packetType << 16) | packetId;
+}
+
+static platformPersistRecordHead_t *platformPersistRecordAt(platformPersistFile_t *file, uint32_t offset)
+{
+	return (platformPersistRecordHead_t *)(file->base + offset);
+}
+
+/**
+ * @brief 查找有效记录索引
+ *
+ * @param file
+ * @param key
+ * @return platformPersistEntry_t* 不存在时返回NULL
+ */
+static platformPersistEntry_t *platformPersistEntryFind(platformPersistFile_t *file, uint32_t key)
+{
+	uint32_t i = (key * 2654435761U) & file->entryMask;
+	while (0 != file->entries[i].key)
+	{
+		if (key == file->entries[i].key)
+		{
+			return &file->entries[i];
+		}
+		i = (i + 1) & file->entryMask;
+	}
+	return NULL;
+}
+
+/**
+ * @brief 设置有效记录索引，负载超过一半时扩容
+ *
+ * @param file
+ * @param key
+ * @param offset
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformPersistEntrySet(platformPersistFile_t *file, uint32_t key, uint32_t offset)
+{
+	platformPersistEntry_t *entry = platformPersistEntryFind(file, key);
+	if (NULL != entry)
+	{
+		file->liveBytes -= platformPersistRecordAt(file, entry->offset)->len;
+		entry->offset = offset;
+		file->liveBytes += platformPersistRecordAt(file, offset)->len;
+		return RyanMqttSuccessError;
+	}
+
+	if ((file->entryCount + 1) * 2 > file->entryMask + 1)
+	{
+		uint32_t newMask = (file->entryMask << 1) | 1U;
+		platformPersistEntry_t *newEntries =
+			(platformPersistEntry_t *)platformMemoryMalloc(sizeof(platformPersistEntry_t) * (newMask + 1));
+		RyanMqttCheck(NULL != newEntries, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+		RyanMqttMemset(newEntries, 0, sizeof(platformPersistEntry_t) * (newMask + 1));
+
+		for (uint32_t i = 0; i <= file->entryMask; i++)
+		{
+			if (0 == file->entries[i].key)
+			{
+				continue;
+			}
+
+			uint32_t j = (file->entries[i].key * 2654435761U) & newMask;
+			while (0 != newEntries[j].key)
+			{
+				j = (j + 1) & newMask;
+			}
+			newEntries[j] = file->entries[i];
+		}
+
+		platformMemoryFree(file->entries);
+		file->entries = newEntries;
+		file->entryMask = newMask;
+	}
+
+	uint32_t i = (key * 2654435761U) & file->entryMask;
+	while (0 != file->entries[i].key)
+	{
+		i = (i + 1) & file->entryMask;
+	}
+	file->entries[i].key = key;
+	file->entries[i].offset = offset;
+	file->entryCount++;
+	file->liveBytes += platformPersistRecordAt(file, offset)->len;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 删除有效记录索引，线性探测使用后移删除，不需要墓碑
+ *
+ * @param file
+ * @param entry
+ */
+static void platformPersistEntryRemove(platformPersistFile_t *file, platformPersistEntry_t *entry)
+{
+	uint32_t i = (uint32_t)(entry - file->entries);
+	uint32_t j = i;
+
+	file->liveBytes -= platformPersistRecordAt(file, entry->offset)->len;
+	file->entryCount--;
+
+	while (1)
+	{
+		j = (j + 1) & file->entryMask;
+		if (0 == file->entries[j].key)
+		{
+			break;
+		}
+
+		// 后面的记录理想位置不在 (i, j] 之间时，可以移动到空位 i
+		uint32_t home = (file->entries[j].key * 2654435761U) & file->entryMask;
+		if ((j > i && (home <= i || home > j)) || (j < i && (home <= i && home > j)))
+		{
+			file->entries[i] = file->entries[j];
+			i = j;
+		}
+	}
+	file->entries[i].key = 0;
+}
+
+static int platformPersistEntryCompare(const void *a, const void *b)
+{
+	uint32_t offsetA = (*(platformPersistEntry_t *const *)a)->offset;
+	uint32_t offsetB = (*(platformPersistEntry_t *const *)b)->offset;
+	return (offsetA > offsetB) - (offsetA < offsetB);
+}
+
+/**
+ * @brief 获取按日志顺序排列的有效记录，调用者释放
+ *
+ * @param file
+ * @param pSorted
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformPersistEntrySort(platformPersistFile_t *file, platformPersistEntry_t ***pSorted)
+{
+	uint32_t count = 0;
+
+	*pSorted = NULL;
+	if (0 == file->entryCount)
+	{
+		return RyanMqttSuccessError;
+	}
+
+	platformPersistEntry_t **sorted =
+		(platformPersistEntry_t **)platformMemoryMalloc(sizeof(platformPersistEntry_t *) * file->entryCount);
+	RyanMqttCheck(NULL != sorted, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+
+	for (uint32_t i = 0; i <= file->entryMask; i++)
+	{
+		if (0 != file->entries[i].key)
+		{
+			sorted[count++] = &file->entries[i];
+		}
+	}
+	qsort(sorted, count, sizeof(platformPersistEntry_t *), platformPersistEntryCompare);
+
+	*pSorted = sorted;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 打开并映射日志文件，文件不足 capacity 时扩大，新文件写入文件头
+ *
+ * @param path
+ * @param capacity
+ * @param pFd
+ * @param pBase
+ * @param pCapacity
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformPersistMap(const char *path, uint32_t capacity, int *pFd, uint8_t **pBase,
+					  uint32_t *pCapacity)
+{
+	struct stat st;
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	RyanMqttCheck(fd >= 0, RyanMqttFailedError, RyanMqttLog_e);
+
+	if (0 != fstat(fd, &st) || st.st_size > (off_t)UINT32_MAX)
+	{
+		close(fd);
+		return RyanMqttFailedError;
+	}
+
+	RyanMqttBool_e newFlag = (0 == st.st_size) ? RyanMqttTrue : RyanMqttFalse;
+	if ((off_t)capacity < st.st_size)
+	{
+		capacity = (uint32_t)st.st_size;
+	}
+	else if ((off_t)capacity > st.st_size && 0 != ftruncate(fd, (off_t)capacity))
+	{
+		close(fd);
+		return RyanMqttFailedError;
+	}
+
+	uint8_t *base = (uint8_t *)mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == base)
+	{
+		close(fd);
+		return RyanMqttFailedError;
+	}
+
+	platformPersistFileHead_t *head = (platformPersistFileHead_t *)base;
+	if (RyanMqttTrue == newFlag)
+	{
+		head->magic = platformPersistMagic;
+		head->version = platformPersistVersion;
+	}
+	else if (platformPersistMagic != head->magic || platformPersistVersion != head->version)
+	{
+		RyanMqttLog_e("不是有效的持久化日志文件: %s", path);
+		munmap(base, capacity);
+		close(fd);
+		return RyanMqttFailedError;
+	}
+
+	*pFd = fd;
+	*pBase = base;
+	*pCapacity = capacity;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 重放日志建立有效记录索引，遇到无效记录时截断
+ *
+ * @param file
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformPersistReplay(platformPersistFile_t *file)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t offset = platformPersistHeadLen;
+
+	while (offset + sizeof(platformPersistRecordHead_t) <= file->capacity)
+	{
+		platformPersistRecordHead_t *head = platformPersistRecordAt(file, offset);
+		if (0 == head->len)
+		{
+			break;
+		}
+
+		// 进程崩溃或掉电时最后一条记录可能只写了一部分
+		if (head->len < sizeof(platformPersistRecordHead_t) || 0 != head->len % 4 ||
+		    head->len > file->capacity - offset ||
+		    sizeof(platformPersistRecordHead_t) + head->topicLen + head->packetLen > head->len ||
+		    head->checksum != platformPersistChecksum((uint8_t *)head + 2 * sizeof(uint32_t),
+							      head->len - 2 * sizeof(uint32_t)))
+		{
+			RyanMqttLog_w("持久化日志在 %u 处截断", offset);
+			RyanMqttMemset(file->base + offset, 0, file->capacity - offset);
+			break;
+		}
+
+		uint32_t key = platformPersistKey(head->packetType, head->packetId);
+		if (platformPersistOpPut == head->op)
+		{
+			result = platformPersistEntrySet(file, key, offset);
+			RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+		}
+		else
+		{
+			platformPersistEntry_t *entry = platformPersistEntryFind(file, key);
+			if (NULL != entry)
+			{
+				platformPersistEntryRemove(file, entry);
+			}
+		}
+
+		offset += head->len;
+	}
+
+	file->tail = offset;
+	file->syncOffset = offset;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 压缩日志，有效记录按原顺序写入临时文件后替换原文件，过程中崩溃时原文件不受影响
+ * 压缩后有效记录仍超过一半时扩大文件，保证追加写入的均摊开销
+ *
+ * @param file
+ * @param needLen 压缩后需要追加的记录长度
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformPersistCompact(platformPersistFile_t *file, uint32_t needLen)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformPersistEntry_t **sorted = NULL;
+	char *tmpPath = NULL;
+	int fd = -1;
+	uint8_t *base = NULL;
+	uint32_t capacity = file->capacity;
+	uint64_t required = (uint64_t)platformPersistHeadLen + file->liveBytes + needLen + sizeof(uint32_t);
+
+	while ((uint64_t)capacity < required * 2)
+	{
+		RyanMqttCheck(capacity <= UINT32_MAX / 2, RyanMqttNoRescourceError, RyanMqttLog_e);
+		capacity *= 2;
+	}
+
+	result = platformPersistEntrySort(file, &sorted);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	uint32_t pathLen = (uint32_t)RyanMqttStrlen(file->path);
+	tmpPath = (char *)platformMemoryMalloc(pathLen + sizeof(platformPersistTmpSuffix));
+	RyanMqttCheckCodeNoReturn(NULL != tmpPath, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+	RyanMqttMemcpy(tmpPath, file->path, pathLen);
+	RyanMqttMemcpy(tmpPath + pathLen, platformPersistTmpSuffix, sizeof(platformPersistTmpSuffix));
+
+	// 上次压缩中途崩溃可能残留临时文件
+	unlink(tmpPath);
+	result = platformPersistMap(tmpPath, capacity, &fd, &base, &capacity);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+
+	uint32_t offset = platformPersistHeadLen;
+	for (uint32_t i = 0; i < file->entryCount; i++)
+	{
+		platformPersistRecordHead_t *head = platformPersistRecordAt(file, sorted[i]->offset);
+		RyanMqttMemcpy(base + offset, head, head->len);
+		sorted[i]->offset = offset;
+		offset += head->len;
+	}
+
+	RyanMqttCheckCodeNoReturn(0 == msync(base, capacity, MS_SYNC) && 0 == rename(tmpPath, file->path),
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  munmap(base, capacity);
+					  close(fd);
+					  unlink(tmpPath);
+					  goto __exit;
+				  });
+
+	munmap(file->base, file->capacity);
+	close(file->fd);
+	file->fd = fd;
+	file->base = base;
+	file->capacity = capacity;
+	file->tail = offset;
+	file->syncOffset = offset;
+
+__exit:
+	if (NULL != tmpPath)
+	{
+		platformMemoryFree(tmpPath);
+	}
+	if (NULL != sorted)
+	{
+		platformMemoryFree(sorted);
+	}
+	return result;
+}
+
+/**
+ * @brief 追加一条记录，只写入映射内存，由 sync 批量刷盘
+ *
+ * @param file
+ * @param op
+ * @param record 删除记录时只使用 packetType 和 packetId
+ * @param pOffset 记录写入的偏移
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformPersistAppend(platformPersistFile_t *file, uint8_t op,
+					     const RyanMqttPersistRecord_t *record, uint32_t *pOffset)
+{
+	uint32_t topicLen = (platformPersistOpPut == op) ? record->topicLen : 0;
+	uint32_t packetLen = (platformPersistOpPut == op && NULL != record->packet) ? record->packetLen : 0;
+	uint64_t len64 = sizeof(platformPersistRecordHead_t) + (uint64_t)topicLen + packetLen;
+	RyanMqttCheck(len64 <= UINT32_MAX / 4, RyanMqttParamInvalidError, RyanMqttLog_d);
+	uint32_t len = platformPersistAlign((uint32_t)len64);
+
+	// 结尾至少保留4字节的0作为日志结束标志
+	if ((uint64_t)file->tail + len + sizeof(uint32_t) > file->capacity)
+	{
+		RyanMqttError_e result = platformPersistCompact(file, len);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+	}
+
+	platformPersistRecordHead_t *head = platformPersistRecordAt(file, file->tail);
+	uint8_t *data = (uint8_t *)(head + 1);
+	head->op = op;
+	head->packetType = record->packetType;
+	head->packetId = record->packetId;
+	head->qos = (platformPersistOpPut == op) ? record->qos : 0;
+	head->reserved = 0;
+	head->topicLen = (uint16_t)topicLen;
+	head->packetLen = packetLen;
+	if (0 != topicLen)
+	{
+		RyanMqttMemcpy(data, record->topic, topicLen);
+	}
+	if (0 != packetLen)
+	{
+		RyanMqttMemcpy(data + topicLen, record->packet, packetLen);
+	}
+	RyanMqttMemset(data + topicLen + packetLen, 0, len - (uint32_t)len64);
+	head->checksum = platformPersistChecksum((uint8_t *)head + 2 * sizeof(uint32_t), len - 2 * sizeof(uint32_t));
+	__atomic_store_n(&head->len, len, __ATOMIC_RELEASE);
+
+	*pOffset = file->tail;
+	file->tail += len;
+	return RyanMqttSuccessError;
+}
+
+static RyanMqttError_e platformPersistPut(void *userData, const RyanMqttPersistRecord_t *record)
+{
+	platformPersistFile_t *file = (platformPersistFile_t *)userData;
+	uint32_t offset;
+	uint32_t key = platformPersistKey(record->packetType, record->packetId);
+
+	pthread_mutex_lock(&file->lock);
+	RyanMqttError_e result = platformPersistAppend(file, platformPersistOpPut, record, &offset);
+	if (RyanMqttSuccessError == result)
+	{
+		result = platformPersistEntrySet(file, key, offset);
+	}
+	pthread_mutex_unlock(&file->lock);
+
+	return result;
+}
+
+static RyanMqttError_e platformPersistDel(void *userData, uint8_t packetType, uint16_t packetId)
+{
+	platformPersistFile_t *file = (platformPersistFile_t *)userData;
+	RyanMqttPersistRecord_t record = {.packetType = packetType, .packetId = packetId};
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t key = platformPersistKey(packetType, packetId);
+	uint32_t offset;
+
+	pthread_mutex_lock(&file->lock);
+	if (NULL != platformPersistEntryFind(file, key))
+	{
+		// 删除记录写入成功后才删除索引，写入失败时索引和日志保持一致，重启后仍会加载这条记录
+		// 追加时触发的压缩会拷贝这条记录，重放时被之后的删除记录抵消
+		result = platformPersistAppend(file, platformPersistOpDel, &record, &offset);
+		if (RyanMqttSuccessError == result)
+		{
+			platformPersistEntryRemove(file, platformPersistEntryFind(file, key));
+		}
+	}
+	pthread_mutex_unlock(&file->lock);
+
+	return result;
+}
+
+static RyanMqttError_e platformPersistLoad(void *userData, RyanMqttPersistLoadHandle loadHandle, void *ctx)
+{
+	platformPersistFile_t *file = (platformPersistFile_t *)userData;
+	platformPersistEntry_t **sorted;
+
+	pthread_mutex_lock(&file->lock);
+	RyanMqttError_e result = platformPersistEntrySort(file, &sorted);
+	for (uint32_t i = 0; RyanMqttSuccessError == result && i < file->entryCount; i++)
+	{
+		platformPersistRecordHead_t *head = platformPersistRecordAt(file, sorted[i]->offset);
+		const uint8_t *data = (const uint8_t *)(head + 1);
+		RyanMqttPersistRecord_t record = {.topic = (const char *)data,
+						  .packet = (0 != head->packetLen) ? data + head->topicLen : NULL,
+						  .packetLen = head->packetLen,
+						  .packetId = head->packetId,
+						  .topicLen = head->topicLen,
+						  .packetType = head->packetType,
+						  .qos = head->qos};
+		result = loadHandle(ctx, &record);
+	}
+	pthread_mutex_unlock(&file->lock);
+
+	if (NULL != sorted)
+	{
+		platformMemoryFree(sorted);
+	}
+	return result;
+}
+
+static void platformPersistSync(void *userData, RyanMqttBool_e forceFlag)
+{
+	platformPersistFile_t *file = (platformPersistFile_t *)userData;
+	uint32_t now = platformUptimeMs();
+
+	pthread_mutex_lock(&file->lock);
+	if (file->tail != file->syncOffset &&
+	    (RyanMqttTrue == forceFlag || now - file->lastSyncTime >= platformPersistSyncInterval))
+	{
+		// msync 要求地址按页对齐
+		uint32_t pageSize = (uint32_t)sysconf(_SC_PAGESIZE);
+		uint32_t start = file->syncOffset / pageSize * pageSize;
+		msync(file->base + start, file->tail + sizeof(uint32_t) - start, MS_SYNC);
+		file->syncOffset = file->tail;
+		file->lastSyncTime = now;
+	}
+	pthread_mutex_unlock(&file->lock);
+}
+
+/**
+ * @brief 打开持久化日志文件，重放已有记录，成功后把 file->persist 设置到 config.persist
+ *
+ * @param file
+ * @param path 日志文件路径，不存在时创建
+ * @param capacity 初始文件大小，小于 platformPersistMinCapacity 时使用最小值
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformPersistFileInit(platformPersistFile_t *file, const char *path, uint32_t capacity)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttCheck(NULL != file && NULL != path, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttMemset(file, 0, sizeof(platformPersistFile_t));
+	file->fd = -1;
+	if (capacity < platformPersistMinCapacity)
+	{
+		capacity = platformPersistMinCapacity;
+	}
+
+	uint32_t pathLen = (uint32_t)RyanMqttStrlen(path);
+	file->path = (char *)platformMemoryMalloc(pathLen + 1);
+	RyanMqttCheck(NULL != file->path, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemcpy(file->path, path, pathLen + 1);
+
+	file->entryMask = platformPersistMinEntry - 1;
+	file->entries = (platformPersistEntry_t *)platformMemoryMalloc(sizeof(platformPersistEntry_t) *
+								       platformPersistMinEntry);
+	RyanMqttCheckCodeNoReturn(NULL != file->entries, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+	RyanMqttMemset(file->entries, 0, sizeof(platformPersistEntry_t) * platformPersistMinEntry);
+
+	result = platformPersistMap(path, capacity, &file->fd, &file->base, &file->capacity);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+
+	result = platformPersistReplay(file);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, {
+		munmap(file->base, file->capacity);
+		close(file->fd);
+		goto __exit;
+	});
+
+	pthread_mutex_init(&file->lock, NULL);
+	file->lastSyncTime = platformUptimeMs();
+	file->persist.userData = file;
+	file->persist.put = platformPersistPut;
+	file->persist.del = platformPersistDel;
+	file->persist.load = platformPersistLoad;
+	file->persist.sync = platformPersistSync;
+	return RyanMqttSuccessError;
+
+__exit:
+	if (NULL != file->entries)
+	{
+		platformMemoryFree(file->entries);
+	}
+	platformMemoryFree(file->path);
+	RyanMqttMemset(file, 0, sizeof(platformPersistFile_t));
+	return result;
+}
+
+/**
+ * @brief 刷盘并关闭持久化日志文件，使用该文件的客户端需要先销毁
+ *
+ * @param file
+ */
+void platformPersistFileDestroy(platformPersistFile_t *file)
+{
+	if (NULL == file || NULL == file->base)
+	{
+		return;
+	}
+
+	platformPersistSync(file, RyanMqttTrue);
+	munmap(file->base, file->capacity);
+	close(file->fd);
+	pthread_mutex_destroy(&file->lock);
+	platformMemoryFree(file->entries);
+	platformMemoryFree(file->path);
+	RyanMqttMemset(file, 0, sizeof(platformPersistFile_t));
+}
+
+/**
+ * @brief 获取有效记录个数
+ *
+ * @param file
+ * @return uint32_t
+ */
+uint32_t platformPersistFileGetCount(platformPersistFile_t *file)
+{
+	pthread_mutex_lock(&file->lock);
+	uint32_t count = file->entryCount;
+	pthread_mutex_unlock(&file->lock);
+	return count;
+}
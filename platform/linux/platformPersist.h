@@ -0,0 +1,56 @@
+#ifndef __platformPersist__
+#define __platformPersist__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <pthread.h>
+#include "RyanMqttClient.h"
+
+// 两次刷盘的最小间隔，期间的写入只进入映射内存，进程崩溃不会丢失，系统掉电最多丢失这段时间的记录。单位ms
+#ifndef platformPersistSyncInterval
+#define platformPersistSyncInterval (100)
+#endif
+
+// 日志文件的最小大小，写满后压缩，压缩后仍超过一半时扩大一倍
+#ifndef platformPersistMinCapacity
+#define platformPersistMinCapacity (16 * 1024)
+#endif
+
+// 有效记录索引，key 为 packetType << 16 | packetId，为0时表示空位
+typedef struct
+{
+	uint32_t key;
+	uint32_t offset; // 最新一条保存记录在日志中的偏移
+} platformPersistEntry_t;
+
+// 追加写入的内存映射日志文件，作为 RyanMqttPersist_t 的参考实现
+typedef struct
+{
+	RyanMqttPersist_t persist; // 设置到 config.persist 的接口
+
+	pthread_mutex_t lock;            // 保护以下所有成员
+	char *path;                      // 日志文件路径
+	int fd;                          // 日志文件
+	uint8_t *base;                   // 映射地址
+	uint32_t capacity;               // 文件大小
+	uint32_t tail;                   // 下一条记录的写入偏移
+	uint32_t syncOffset;             // 已经刷盘的偏移
+	uint32_t liveBytes;              // 有效记录占用的字节数
+	uint32_t lastSyncTime;           // 最近一次刷盘的时间，platformUptimeMs
+	platformPersistEntry_t *entries; // 有效记录索引，线性探测哈希表
+	uint32_t entryMask;              // 索引容量减一，容量为2的幂
+	uint32_t entryCount;             // 有效记录个数
+} platformPersistFile_t;
+
+extern RyanMqttError_e platformPersistFileInit(platformPersistFile_t *file, const char *path, uint32_t capacity);
+extern void platformPersistFileDestroy(platformPersistFile_t *file);
+extern uint32_t platformPersistFileGetCount(platformPersistFile_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
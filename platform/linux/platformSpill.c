@@ -0,0 +1,172 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "platformSpill.h"
+#include "RyanMqttLog.h"
+
+// 每条记录前面的长度头
+#define platformSpillHeadLen (sizeof(uint32_t))
+
+/**
+ * @brief 在环形数据区的指定偏移读写，跨过文件末尾时分两次
+ *
+ * @param file
+ * @param offset
+ * @param buf
+ * @param len
+ * @param writeFlag
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformSpillIo(platformSpillFile_t *file, uint32_t offset, void *buf, uint32_t len,
+				       RyanMqttBool_e writeFlag)
+{
+	uint8_t *data = (uint8_t *)buf;
+
+	while (len > 0)
+	{
+		offset %= file->capacity;
+		uint32_t chunk = file->capacity - offset;
+		if (chunk > len)
+		{
+			chunk = len;
+		}
+
+		ssize_t ioLen = (RyanMqttTrue == writeFlag) ? pwrite(file->fd, data, chunk, offset)
+							    : pread(file->fd, data, chunk, offset);
+		RyanMqttCheck(ioLen > 0, RyanMqttFailedError, RyanMqttLog_d);
+
+		offset += (uint32_t)ioLen;
+		data += ioLen;
+		len -= (uint32_t)ioLen;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+static RyanMqttError_e platformSpillWrite(void *userData, const void *data, uint32_t len)
+{
+	platformSpillFile_t *file = (platformSpillFile_t *)userData;
+	uint32_t tail = file->head + file->used;
+	RyanMqttError_e result;
+
+	RyanMqttCheck(0 != len && platformSpillHeadLen + len <= file->capacity - file->used, RyanMqttNoRescourceError,
+		      RyanMqttLog_d);
+
+	result = platformSpillIo(file, tail, &len, platformSpillHeadLen, RyanMqttTrue);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	result = platformSpillIo(file, tail + platformSpillHeadLen, (void *)data, len, RyanMqttTrue);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	file->used += platformSpillHeadLen + len;
+	file->count++;
+	return RyanMqttSuccessError;
+}
+
+static uint32_t platformSpillPeek(void *userData)
+{
+	platformSpillFile_t *file = (platformSpillFile_t *)userData;
+	uint32_t len = 0;
+
+	if (0 == file->count || RyanMqttSuccessError != platformSpillIo(file, file->head, &len,
+									platformSpillHeadLen, RyanMqttFalse))
+	{
+		return 0;
+	}
+
+	return len;
+}
+
+static RyanMqttError_e platformSpillRead(void *userData, void *buffer, uint32_t len)
+{
+	platformSpillFile_t *file = (platformSpillFile_t *)userData;
+	uint32_t recordLen = platformSpillPeek(userData);
+
+	RyanMqttCheck(0 != recordLen, RyanMqttNoRescourceError, RyanMqttLog_d);
+
+	if (NULL != buffer)
+	{
+		RyanMqttCheck(len >= recordLen, RyanMqttParamInvalidError, RyanMqttLog_d);
+		RyanMqttError_e result = platformSpillIo(file, file->head + platformSpillHeadLen, buffer, recordLen,
+							 RyanMqttFalse);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+	}
+
+	file->head = (file->head + platformSpillHeadLen + recordLen) % file->capacity;
+	file->used -= platformSpillHeadLen + recordLen;
+	file->count--;
+	if (0 == file->count)
+	{
+		file->head = 0;
+	}
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 创建环形文件，已存在的文件会被清空
+ *
+ * @param file
+ * @param path
+ * @param capacity 数据区大小，小于 platformSpillMinCapacity 时使用最小值
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSpillFileInit(platformSpillFile_t *file, const char *path, uint32_t capacity)
+{
+	RyanMqttCheck(NULL != file && NULL != path, RyanMqttParamInvalidError, RyanMqttLog_d);
+
+	RyanMqttMemset(file, 0, sizeof(platformSpillFile_t));
+	if (capacity < platformSpillMinCapacity)
+	{
+		capacity = platformSpillMinCapacity;
+	}
+
+	uint32_t pathLen = (uint32_t)RyanMqttStrlen(path);
+	file->path = (char *)platformMemoryMalloc(pathLen + 1);
+	RyanMqttCheck(NULL != file->path, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	RyanMqttMemcpy(file->path, path, pathLen + 1);
+
+	file->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	RyanMqttCheckCodeNoReturn(file->fd >= 0, RyanMqttFailedError, RyanMqttLog_d, { goto __exit; });
+
+	// 预先分配磁盘空间，写满时返回失败而不是磁盘空间不足。ftruncate 只生成稀疏文件，不会占用磁盘空间
+	// posix_fallocate 失败时返回错误码而不是设置errno
+	int32_t allocResult = posix_fallocate(file->fd, 0, (off_t)capacity);
+	RyanMqttCheckCodeNoReturn(0 == allocResult, RyanMqttFailedError, RyanMqttLog_d, {
+		RyanMqttLog_e("溢出文件预分配空间失败 %d", allocResult);
+		close(file->fd);
+		unlink(path);
+		goto __exit;
+	});
+
+	file->capacity = capacity;
+	file->spill.userData = file;
+	file->spill.write = platformSpillWrite;
+	file->spill.peek = platformSpillPeek;
+	file->spill.read = platformSpillRead;
+	return RyanMqttSuccessError;
+
+__exit:
+	platformMemoryFree(file->path);
+	RyanMqttMemset(file, 0, sizeof(platformSpillFile_t));
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 关闭并删除环形文件，使用该文件的客户端需要先销毁
+ *
+ * @param file
+ */
+void platformSpillFileDestroy(platformSpillFile_t *file)
+{
+	if (NULL == file || NULL == file->path)
+	{
+		return;
+	}
+
+	close(file->fd);
+	unlink(file->path);
+	platformMemoryFree(file->path);
+	RyanMqttMemset(file, 0, sizeof(platformSpillFile_t));
+}
@@ -0,0 +1,37 @@
+#ifndef __platformSpill__
+#define __platformSpill__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "RyanMqttClient.h"
+
+// 环形文件的最小数据区大小
+#ifndef platformSpillMinCapacity
+#define platformSpillMinCapacity (4 * 1024)
+#endif
+
+// 离线发布队列溢出到的环形文件，作为 RyanMqttOfflineSpill_t 的参考实现
+// 读写位置只保存在内存中，文件内容在进程重启后无效，初始化时清空
+typedef struct
+{
+	RyanMqttOfflineSpill_t spill; // 设置到 config.offlineSpill 的接口
+
+	char *path;        // 文件路径
+	int fd;            // 环形文件
+	uint32_t capacity; // 数据区大小
+	uint32_t head;     // 最早一条记录的偏移
+	uint32_t used;     // 已使用的字节数，包括每条记录的长度头
+	uint32_t count;    // 记录条数
+} platformSpillFile_t;
+
+extern RyanMqttError_e platformSpillFileInit(platformSpillFile_t *file, const char *path, uint32_t capacity);
+extern void platformSpillFileDestroy(platformSpillFile_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -53,14 +53,29 @@ inline void platformDelay(uint32_t ms)
 	usleep(ms * 1000);
 }
 
-uint32_t platformUptimeMs(void)
+/**
+ * @brief 获取开机ms时间戳，64位不会绕回，linux平台内部需要长时间比较的地方使用
+ *
+ * @return uint64_t
+ */
+uint64_t platformUptimeMs64(void)
 {
 	struct timespec ts;
-	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+	if (clock_gettime(platformUptimeClock, &ts) != 0)
 	{
 		return 0;
 	}
-	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 获取开机ms时间戳，截断为32位，RyanMqtt内部只比较时间差，绕回不影响计算
+ *
+ * @return uint32_t
+ */
+uint32_t platformUptimeMs(void)
+{
+	return (uint32_t)platformUptimeMs64();
 }
 
 /**
@@ -258,3 +273,77 @@ inline RyanMqttError_e platformCriticalExit(void *userData, platformCritical_t *
 	pthread_spin_unlock(&platformCritical->spin);
 	return RyanMqttSuccessError;
 }
+
+/**
+ * @brief 计数信号量初始化
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @param initCount 初始计数值
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreInit(void *userData, platformSemaphore_t *platformSemaphore, uint32_t initCount)
+{
+	if (0 != sem_init(&platformSemaphore->sem, 0, initCount))
+	{
+		return RyanMqttNoRescourceError;
+	}
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 销毁计数信号量
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreDestroy(void *userData, platformSemaphore_t *platformSemaphore)
+{
+	sem_destroy(&platformSemaphore->sem);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取信号量，计数为0时阻塞等待
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @param timeout 最长等待时间，单位ms
+ * @return RyanMqttError_e 超时返回 RyanMqttFailedError
+ */
+RyanMqttError_e platformSemaphoreTake(void *userData, platformSemaphore_t *platformSemaphore, uint32_t timeout)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout / 1000;
+	ts.tv_nsec += (long)(timeout % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	while (0 != sem_timedwait(&platformSemaphore->sem, &ts))
+	{
+		if (EINTR != errno)
+		{
+			return RyanMqttFailedError;
+		}
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 释放信号量，计数加1
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreGive(void *userData, platformSemaphore_t *platformSemaphore)
+{
+	sem_post(&platformSemaphore->sem);
+	return RyanMqttSuccessError;
+}
@@ -10,6 +10,8 @@ extern "C" {
 #include <string.h>
 #include <assert.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <time.h>
@@ -30,6 +32,11 @@ extern "C" {
 #define RyanMqttSnprintf   snprintf
 #define RyanMqttVsnprintf  vsnprintf
 
+// platformUptimeMs 使用的时钟。定义为 CLOCK_MONOTONIC_COARSE 时读取开销更低，精度降低到内核时钟节拍(通常1-4ms)
+#ifndef platformUptimeClock
+#define platformUptimeClock CLOCK_MONOTONIC
+#endif
+
 typedef struct
 {
 	pthread_t thread;
@@ -47,6 +54,13 @@ typedef struct
 	pthread_spinlock_t spin;
 } platformCritical_t;
 
+typedef struct
+{
+	sem_t sem;
+} platformSemaphore_t;
+
+extern uint64_t platformUptimeMs64(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,591 @@
+#define RyanMqttLogLevel (RyanMqttLogLevelAssert) // 日志打印等级
+// #define RyanMqttLogLevel (RyanMqttLogLevelDebug) // 日志打印等级
+
+#include "RyanMqttPlatform.h"
+#include "platformTls.h"
+#include "RyanMqttLog.h"
+
+#ifdef RyanMqttLinuxTlsEnable
+
+#include <time.h>
+#include <signal.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+// socket BIO的拷贝，只替换写函数，避免对端关闭时触发SIGPIPE。进程内所有tls传输层共用
+static pthread_once_t platformTlsBioOnce = PTHREAD_ONCE_INIT;
+static BIO_METHOD *platformTlsBioMethod = NULL;
+static int (*platformTlsBioSocketWrite)(BIO *bio, const char *buf, int len) = NULL;
+
+static uint64_t platformTlsNowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+/**
+ * @brief 打印并清空openssl的错误队列
+ *
+ * @param str
+ */
+static void platformTlsLogError(const char *str)
+{
+	unsigned long err = ERR_get_error();
+	char errStr[128] = {0};
+
+	if (0 != err)
+	{
+		ERR_error_string_n(err, errStr, sizeof(errStr));
+	}
+	RyanMqttLog_w("%s: %s", str, errStr);
+	ERR_clear_error();
+}
+
+/**
+ * @brief 服务端下发新的会话票据或会话id时调用，替换缓存的会话
+ * tls1.3的会话票据在握手完成后才下发，由收到CONNACK时的读取触发
+ *
+ * @param ssl
+ * @param session
+ * @return int 返回1表示接管 session 的引用
+ */
+static int platformTlsNewSession(SSL *ssl, SSL_SESSION *session)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+
+	// 回调在读写时触发，调用方已经持有锁
+	if (NULL != tls->session)
+	{
+		SSL_SESSION_free(tls->session);
+	}
+	tls->session = session;
+	return 1;
+}
+
+#if !defined(OPENSSL_NO_KTLS) && defined(BIO_get_ktls_send)
+/**
+ * @brief kTLS的控制记录需要socket BIO通过sendmsg发送，无法使用 MSG_NOSIGNAL。
+ * 只在当前线程屏蔽SIGPIPE，写入期间产生的SIGPIPE在恢复屏蔽字前取出丢弃，不修改进程的信号处理方式
+ *
+ * @param bio
+ * @param buf
+ * @param len
+ * @return int
+ */
+static int platformTlsBioKtlsWrite(BIO *bio, const char *buf, int len)
+{
+	sigset_t pipeSet, oldSet, pendingSet;
+	struct timespec zero = {0};
+
+	sigemptyset(&pipeSet);
+	sigaddset(&pipeSet, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+	// 调用前已经挂起的SIGPIPE不属于这次写入，保留给用户处理
+	sigpending(&pendingSet);
+	int pendingFlag = sigismember(&pendingSet, SIGPIPE);
+
+	int ret = platformTlsBioSocketWrite(bio, buf, len);
+	int savedErrno = errno;
+
+	if (0 == pendingFlag && 0 == sigpending(&pendingSet) && 1 == sigismember(&pendingSet, SIGPIPE))
+	{
+		sigtimedwait(&pipeSet, NULL, &zero);
+	}
+
+	pthread_sigmask(SIG_SETMASK, &oldSet, NULL);
+	errno = savedErrno;
+	return ret;
+}
+#endif
+
+/**
+ * @brief 使用 MSG_NOSIGNAL 发送，对端关闭时返回 EPIPE 而不是触发SIGPIPE，重试标志与socket BIO一致
+ *
+ * @param bio
+ * @param buf
+ * @param len
+ * @return int
+ */
+static int platformTlsBioWrite(BIO *bio, const char *buf, int len)
+{
+#if !defined(OPENSSL_NO_KTLS) && defined(BIO_get_ktls_send)
+	if (BIO_get_ktls_send(bio))
+	{
+		return platformTlsBioKtlsWrite(bio, buf, len);
+	}
+#endif
+
+	errno = 0;
+	int ret = (int)send(BIO_get_fd(bio, NULL), buf, (size_t)len, MSG_NOSIGNAL);
+	BIO_clear_retry_flags(bio);
+	if (ret <= 0 && BIO_sock_should_retry(ret))
+	{
+		BIO_set_retry_write(bio);
+	}
+	return ret;
+}
+
+/**
+ * @brief 创建socket BIO的拷贝，读、控制(包括kTLS)等接口沿用socket BIO的实现
+ */
+static void platformTlsBioMethodInit(void)
+{
+	const BIO_METHOD *socketMethod = BIO_s_socket();
+	BIO_METHOD *method =
+		BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK | BIO_TYPE_DESCRIPTOR, "RyanMqtt socket");
+	if (NULL == method)
+	{
+		return;
+	}
+
+	platformTlsBioSocketWrite = BIO_meth_get_write(socketMethod);
+	BIO_meth_set_write(method, platformTlsBioWrite);
+	BIO_meth_set_read(method, BIO_meth_get_read(socketMethod));
+	BIO_meth_set_puts(method, BIO_meth_get_puts(socketMethod));
+	BIO_meth_set_ctrl(method, BIO_meth_get_ctrl(socketMethod));
+	BIO_meth_set_create(method, BIO_meth_get_create(socketMethod));
+	BIO_meth_set_destroy(method, BIO_meth_get_destroy(socketMethod));
+	platformTlsBioMethod = method;
+}
+
+/**
+ * @brief 等待socket可读或可写，唤醒eventfd可读时提前返回
+ *
+ * @param fd
+ * @param wakeFd 为-1时只等待socket
+ * @param events
+ * @param timeout
+ * @return RyanMqttBool_e 超时或被唤醒返回 RyanMqttFalse
+ */
+static RyanMqttBool_e platformTlsWait(int fd, int wakeFd, short events, uint32_t timeout)
+{
+	struct pollfd pollFds[2] = {{.fd = fd, .events = events}, {.fd = wakeFd, .events = POLLIN}};
+
+	if (poll(pollFds, 2, (int)timeout) <= 0)
+	{
+		return RyanMqttFalse;
+	}
+
+	if (0 != pollFds[1].revents)
+	{
+		eventfd_t value;
+		eventfd_read(wakeFd, &value);
+	}
+
+	return (0 != pollFds[0].revents) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 设置SNI和证书主机名校验，unix domain socket连接不设置
+ *
+ * @param ssl
+ * @param name
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformTlsSetServerName(SSL *ssl, const char *name)
+{
+	struct in6_addr addr;
+
+	if (0 == RyanMqttStrncmp(name, platformNetworkUnixPrefix, sizeof(platformNetworkUnixPrefix) - 1))
+	{
+		return RyanMqttSuccessError;
+	}
+
+	// ip地址不能作为SNI，按ip校验证书
+	if (1 == inet_pton(AF_INET, name, &addr) || 1 == inet_pton(AF_INET6, name, &addr))
+	{
+		X509_VERIFY_PARAM *param = SSL_get0_param(ssl);
+		RyanMqttCheck(1 == X509_VERIFY_PARAM_set1_ip_asc(param, name), RyanMqttFailedError, RyanMqttLog_d);
+		return RyanMqttSuccessError;
+	}
+
+	RyanMqttCheck(1 == SSL_set_tlsext_host_name(ssl, name), RyanMqttFailedError, RyanMqttLog_d);
+	RyanMqttCheck(1 == SSL_set1_host(ssl, name), RyanMqttFailedError, RyanMqttLog_d);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 在非阻塞socket上完成握手
+ *
+ * @param tls
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformTlsHandshake(platformTlsTransport_t *tls)
+{
+	RyanMqttTimer_t timer;
+	RyanMqttTimerCutdown(&timer, platformTlsHandshakeTimeout);
+
+	while (1)
+	{
+		int ret = SSL_connect(tls->ssl);
+		if (1 == ret)
+		{
+			return RyanMqttSuccessError;
+		}
+
+		int err = SSL_get_error(tls->ssl, ret);
+		uint32_t remain = RyanMqttTimerRemain(&timer);
+		if ((SSL_ERROR_WANT_READ != err && SSL_ERROR_WANT_WRITE != err) || 0 == remain)
+		{
+			platformTlsLogError("tls握手失败");
+			return RyanSocketFailedError;
+		}
+
+		if (RyanMqttFalse ==
+		    platformTlsWait(tls->network.socket, -1, SSL_ERROR_WANT_READ == err ? POLLIN : POLLOUT, remain))
+		{
+			RyanMqttLog_w("tls握手超时");
+			return RyanSocketFailedError;
+		}
+	}
+}
+
+static RyanMqttError_e platformTlsSetOption(void *userData, const RyanMqttSocketOption_t *option)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+	return platformNetworkSetOption(NULL, &tls->network, option);
+}
+
+static RyanMqttError_e platformTlsClose(void *userData)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+
+	platformMutexLock(NULL, &tls->lock);
+	if (NULL != tls->ssl)
+	{
+		// 非阻塞socket上只发送一次close_notify，不等待对端回复
+		SSL_shutdown(tls->ssl);
+		SSL_free(tls->ssl);
+		tls->ssl = NULL;
+		ERR_clear_error();
+	}
+	platformMutexUnLock(NULL, &tls->lock);
+
+	return platformNetworkClose(NULL, &tls->network);
+}
+
+/**
+ * @brief 建立tcp连接并完成tls握手，有缓存的会话时尝试恢复
+ *
+ * @param userData
+ * @param host
+ * @param port
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformTlsConnect(void *userData, const char *host, uint16_t port)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+
+	// 上一次连接没有关闭时先关闭
+	platformTlsClose(tls);
+
+	result = platformNetworkConnect(NULL, &tls->network, host, port);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_d);
+
+	// 收发都在非阻塞socket上进行，等待时不持有锁
+	int flags = fcntl(tls->network.socket, F_GETFL, 0);
+	fcntl(tls->network.socket, F_SETFL, flags | O_NONBLOCK);
+
+	platformMutexLock(NULL, &tls->lock);
+	tls->ssl = SSL_new(tls->ctx);
+	RyanMqttCheckCodeNoReturn(NULL != tls->ssl, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+
+	BIO *bio = BIO_new(platformTlsBioMethod);
+	RyanMqttCheckCodeNoReturn(NULL != bio, RyanMqttNotEnoughMemError, RyanMqttLog_d, {
+		result = RyanMqttNotEnoughMemError;
+		goto __exit;
+	});
+	BIO_set_fd(bio, tls->network.socket, BIO_NOCLOSE);
+	SSL_set_bio(tls->ssl, bio, bio);
+
+	result = platformTlsSetServerName(tls->ssl, NULL != tls->serverName ? tls->serverName : host);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+
+	if (RyanMqttTrue == tls->sessionResumeFlag && NULL != tls->session)
+	{
+		SSL_set_session(tls->ssl, tls->session);
+	}
+
+	uint64_t startUs = platformTlsNowUs();
+	result = platformTlsHandshake(tls);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_d, { goto __exit; });
+
+	tls->statistics.lastHandshakeUs = (uint32_t)(platformTlsNowUs() - startUs);
+	tls->statistics.handshakeCount++;
+	if (SSL_session_reused(tls->ssl))
+	{
+		tls->statistics.resumeCount++;
+	}
+
+	tls->statistics.ktlsFlag = RyanMqttFalse;
+#if !defined(OPENSSL_NO_KTLS) && defined(BIO_get_ktls_send)
+	if (BIO_get_ktls_send(SSL_get_wbio(tls->ssl)))
+	{
+		tls->statistics.ktlsFlag = RyanMqttTrue;
+	}
+#endif
+
+__exit:
+	platformMutexUnLock(NULL, &tls->lock);
+	if (RyanMqttSuccessError != result)
+	{
+		platformTlsClose(tls);
+	}
+	return result;
+}
+
+/**
+ * @brief 读取解密后的数据
+ *
+ * @param userData
+ * @param recvBuf
+ * @param recvLen
+ * @param timeout
+ * @return int32_t 读取的字节数，超时返回0，连接断开或出错返回-1
+ */
+static int32_t platformTlsRecv(void *userData, char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+	RyanMqttTimer_t timer;
+	RyanMqttTimerCutdown(&timer, timeout > 0 ? (uint32_t)timeout : 0);
+
+	while (1)
+	{
+		platformMutexLock(NULL, &tls->lock);
+		if (NULL == tls->ssl)
+		{
+			platformMutexUnLock(NULL, &tls->lock);
+			return -1;
+		}
+
+		int ret = SSL_read(tls->ssl, recvBuf, (int)recvLen);
+		int err = ret > 0 ? SSL_ERROR_NONE : SSL_get_error(tls->ssl, ret);
+		int fd = tls->network.socket;
+		platformMutexUnLock(NULL, &tls->lock);
+
+		if (ret > 0)
+		{
+			return ret;
+		}
+
+		if (SSL_ERROR_WANT_READ != err && SSL_ERROR_WANT_WRITE != err)
+		{
+			RyanMqttLog_d("tls读取失败, err: %d", err);
+			ERR_clear_error();
+			return -1;
+		}
+
+		uint32_t remain = RyanMqttTimerRemain(&timer);
+		short events = (SSL_ERROR_WANT_READ == err) ? POLLIN : POLLOUT;
+		if (0 == remain || RyanMqttFalse == platformTlsWait(fd, tls->network.wakeFd, events, remain))
+		{
+			return 0;
+		}
+	}
+}
+
+/**
+ * @brief 打断正在等待数据的 platformTlsRecv
+ *
+ * @param userData
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e platformTlsWakeup(void *userData)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+	return platformNetworkWakeup(NULL, &tls->network);
+}
+
+/**
+ * @brief 加密并发送数据
+ * 用户态加密时 SSL_write 会把报文加密拷贝到openssl的写缓冲区，启用kTLS后明文直接交给内核加密，
+ * 省去用户态的这次拷贝
+ *
+ * @param userData
+ * @param sendBuf
+ * @param sendLen
+ * @param timeout
+ * @return int32_t 发送的字节数，超时返回0，连接断开或出错返回-1
+ */
+static int32_t platformTlsSend(void *userData, char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+	RyanMqttTimer_t timer;
+	RyanMqttTimerCutdown(&timer, timeout > 0 ? (uint32_t)timeout : 0);
+
+	while (1)
+	{
+		platformMutexLock(NULL, &tls->lock);
+		if (NULL == tls->ssl)
+		{
+			platformMutexUnLock(NULL, &tls->lock);
+			return -1;
+		}
+
+		int ret = SSL_write(tls->ssl, sendBuf, (int)sendLen);
+		int err = ret > 0 ? SSL_ERROR_NONE : SSL_get_error(tls->ssl, ret);
+		int fd = tls->network.socket;
+		platformMutexUnLock(NULL, &tls->lock);
+
+		if (ret > 0)
+		{
+			return ret;
+		}
+
+		if (SSL_ERROR_WANT_READ != err && SSL_ERROR_WANT_WRITE != err)
+		{
+			RyanMqttLog_d("tls发送失败, err: %d", err);
+			ERR_clear_error();
+			return -1;
+		}
+
+		uint32_t remain = RyanMqttTimerRemain(&timer);
+		short events = (SSL_ERROR_WANT_READ == err) ? POLLIN : POLLOUT;
+		if (0 == remain || RyanMqttFalse == platformTlsWait(fd, -1, events, remain))
+		{
+			return 0;
+		}
+	}
+}
+
+static int32_t platformTlsGetFd(void *userData)
+{
+	platformTlsTransport_t *tls = (platformTlsTransport_t *)userData;
+	return platformNetworkGetFd(NULL, &tls->network);
+}
+
+/**
+ * @brief 初始化tls传输层，加载证书
+ *
+ * @param tls
+ * @param config
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformTlsTransportInit(platformTlsTransport_t *tls, const platformTlsConfig_t *config)
+{
+	RyanMqttCheck(NULL != tls, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck(NULL != config, RyanMqttParamInvalidError, RyanMqttLog_d);
+	RyanMqttCheck((NULL == config->certFile) == (NULL == config->keyFile), RyanMqttParamInvalidError,
+		      RyanMqttLog_d);
+
+	RyanMqttMemset(tls, 0, sizeof(platformTlsTransport_t));
+
+	// 默认的socket BIO通过write发送，对端先关闭时会触发SIGPIPE结束进程，改用不触发SIGPIPE的BIO
+	pthread_once(&platformTlsBioOnce, platformTlsBioMethodInit);
+	RyanMqttCheck(NULL != platformTlsBioMethod, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+
+	tls->ctx = SSL_CTX_new(TLS_client_method());
+	RyanMqttCheck(NULL != tls->ctx, RyanMqttNotEnoughMemError, RyanMqttLog_d);
+	SSL_CTX_set_min_proto_version(tls->ctx, TLS1_2_VERSION);
+
+	// 允许部分写入，发送缓冲区满时返回已写入的长度，重试时的缓冲区地址由上层决定
+	SSL_CTX_set_mode(tls->ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_ENABLE_KTLS
+	// 内核支持时由内核加密，SSL_write 直接把明文交给内核，不在用户态组装记录
+	SSL_CTX_set_options(tls->ctx, SSL_OP_ENABLE_KTLS);
+#endif
+
+	if (RyanMqttTrue == config->insecureFlag)
+	{
+		SSL_CTX_set_verify(tls->ctx, SSL_VERIFY_NONE, NULL);
+	}
+	else
+	{
+		SSL_CTX_set_verify(tls->ctx, SSL_VERIFY_PEER, NULL);
+		int ret = (NULL != config->caFile) ? SSL_CTX_load_verify_locations(tls->ctx, config->caFile, NULL)
+						   : SSL_CTX_set_default_verify_paths(tls->ctx);
+		if (1 != ret)
+		{
+			platformTlsLogError("加载CA证书失败");
+			goto __exit;
+		}
+	}
+
+	if (NULL != config->certFile)
+	{
+		if (1 != SSL_CTX_use_certificate_chain_file(tls->ctx, config->certFile) ||
+		    1 != SSL_CTX_use_PrivateKey_file(tls->ctx, config->keyFile, SSL_FILETYPE_PEM))
+		{
+			platformTlsLogError("加载客户端证书失败");
+			goto __exit;
+		}
+	}
+
+	// 客户端会话缓存只保存在 tls->session 中，openssl内部不再缓存
+	tls->sessionResumeFlag = config->sessionResumeFlag;
+	if (RyanMqttTrue == tls->sessionResumeFlag)
+	{
+		SSL_CTX_set_session_cache_mode(tls->ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(tls->ctx, platformTlsNewSession);
+	}
+	SSL_CTX_set_app_data(tls->ctx, tls);
+
+	// 网络组件持有唤醒用的eventfd，放在最后一个可能失败的步骤之后初始化
+	if (RyanMqttSuccessError != platformNetworkInit(NULL, &tls->network))
+	{
+		goto __exit;
+	}
+
+	tls->serverName = config->serverName;
+	platformMutexInit(NULL, &tls->lock);
+
+	tls->transport.userData = tls;
+	tls->transport.setOption = platformTlsSetOption;
+	tls->transport.connect = platformTlsConnect;
+	tls->transport.recv = platformTlsRecv;
+	tls->transport.send = platformTlsSend;
+	tls->transport.close = platformTlsClose;
+	tls->transport.getFd = platformTlsGetFd;
+	tls->transport.wakeup = platformTlsWakeup;
+	return RyanMqttSuccessError;
+
+__exit:
+	SSL_CTX_free(tls->ctx);
+	tls->ctx = NULL;
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 销毁tls传输层，调用前使用它的客户端需要已经销毁
+ *
+ * @param tls
+ */
+void platformTlsTransportDestroy(platformTlsTransport_t *tls)
+{
+	if (NULL == tls || NULL == tls->ctx)
+	{
+		return;
+	}
+
+	platformTlsClose(tls);
+	if (NULL != tls->session)
+	{
+		SSL_SESSION_free(tls->session);
+		tls->session = NULL;
+	}
+	SSL_CTX_free(tls->ctx);
+	tls->ctx = NULL;
+	platformMutexDestroy(NULL, &tls->lock);
+	platformNetworkDestroy(NULL, &tls->network);
+}
+
+/**
+ * @brief 获取统计信息
+ *
+ * @param tls
+ * @param statistics
+ */
+void platformTlsTransportGetStatistics(platformTlsTransport_t *tls, platformTlsStatistics_t *statistics)
+{
+	platformMutexLock(NULL, &tls->lock);
+	*statistics = tls->statistics;
+	platformMutexUnLock(NULL, &tls->lock);
+}
+
+#endif
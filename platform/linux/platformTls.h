@@ -0,0 +1,69 @@
+#ifndef __platformTls__
+#define __platformTls__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 构建时找到openssl才定义 RyanMqttLinuxTlsEnable，见 Makefile 和 xmake.lua
+#ifdef RyanMqttLinuxTlsEnable
+
+#include <stdint.h>
+#include <openssl/ssl.h>
+#include "RyanMqttClient.h"
+
+// tls握手的超时时间，在tcp连接成功后开始计算。单位ms
+#ifndef platformTlsHandshakeTimeout
+#define platformTlsHandshakeTimeout (5000)
+#endif
+
+// tls传输层配置，只在 platformTlsTransportInit 时读取证书文件
+typedef struct
+{
+	const char *caFile;   // 校验服务端证书的CA证书文件(PEM)，为NULL时使用系统默认的CA路径
+	const char *certFile; // 双向认证时的客户端证书文件(PEM)，不需要时为NULL
+	const char *keyFile;  // 双向认证时的客户端私钥文件(PEM)，不需要时为NULL
+
+	// SNI和证书主机名校验使用的名字，为NULL时使用 config.host。每次连接时读取，用户需要保证指针的持久性
+	const char *serverName;
+
+	RyanMqttBool_e insecureFlag;      // 不校验服务端证书，只能用于测试
+	RyanMqttBool_e sessionResumeFlag; // 缓存服务端下发的会话票据或会话id，重连时恢复会话，省去完整握手
+} platformTlsConfig_t;
+
+// tls传输层统计信息
+typedef struct
+{
+	uint32_t handshakeCount;  // 成功的握手次数
+	uint32_t resumeCount;     // 其中恢复会话的次数
+	uint32_t lastHandshakeUs; // 最近一次握手的耗时，不包括tcp连接。单位us
+	RyanMqttBool_e ktlsFlag;  // 当前连接的发送方向由内核完成加密(kTLS)
+} platformTlsStatistics_t;
+
+// 基于openssl的tls传输层，作为 RyanMqttTransport_t 的参考实现，底层tcp连接复用 platformNetwork 接口
+// openssl的同一个连接不能在多个线程中同时读写，收发在锁内进行，等待可读可写时不持有锁
+typedef struct
+{
+	RyanMqttTransport_t transport; // 设置到 config.transport 的接口
+
+	platformNetwork_t network;          // 底层tcp连接
+	platformMutex_t lock;               // 保护ssl连接和缓存的会话
+	SSL_CTX *ctx;                       // 所有连接共用的上下文
+	SSL *ssl;                           // 当前连接，没有连接时为NULL
+	SSL_SESSION *session;               // 缓存的会话，下次连接时恢复
+	const char *serverName;             // 配置的服务端名字
+	RyanMqttBool_e sessionResumeFlag;   // 是否恢复会话
+	platformTlsStatistics_t statistics; // 统计信息
+} platformTlsTransport_t;
+
+extern RyanMqttError_e platformTlsTransportInit(platformTlsTransport_t *tls, const platformTlsConfig_t *config);
+extern void platformTlsTransportDestroy(platformTlsTransport_t *tls);
+extern void platformTlsTransportGetStatistics(platformTlsTransport_t *tls, platformTlsStatistics_t *statistics);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,6 +29,20 @@ RyanMqttError_e platformNetworkDestroy(void *userData, platformNetwork_t *platfo
 	return RyanMqttSuccessError;
 }
 
+/**
+ * @brief 设置socket选项，该平台暂不支持，忽略所有选项
+ *
+ * @param userData
+ * @param platformNetwork
+ * @param option
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkSetOption(void *userData, platformNetwork_t *platformNetwork,
+					 const RyanMqttSocketOption_t *option)
+{
+	return RyanMqttSuccessError;
+}
+
 /**
  * @brief 连接mqtt服务器
  *
@@ -261,3 +275,60 @@ RyanMqttError_e platformNetworkClose(void *userData, platformNetwork_t *platform
 
 	return RyanMqttSuccessError;
 }
+
+/**
+ * @brief 发起非阻塞连接
+ * 该平台没有实现非阻塞连接，直接阻塞连接完成，*pendingMs 始终为0
+ *
+ * @param userData
+ * @param platformNetwork
+ * @param host
+ * @param port
+ * @param pendingMs
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkConnectAsync(void *userData, platformNetwork_t *platformNetwork, const char *host,
+					    uint16_t port, uint32_t *pendingMs)
+{
+	*pendingMs = 0;
+	return platformNetworkConnect(userData, platformNetwork, host, port);
+}
+
+/**
+ * @brief 继续进行中的非阻塞连接，该平台的连接总是已经完成
+ *
+ * @param userData
+ * @param platformNetwork
+ * @param pendingMs
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkConnectPoll(void *userData, platformNetwork_t *platformNetwork, uint32_t *pendingMs)
+{
+	*pendingMs = 0;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 打断正在等待数据的 platformNetworkRecvAsync
+ * 该平台不支持打断接收，未定义 platformNetworkWakeupEnable，mqtt线程空闲时最长等待 recvTimeout
+ *
+ * @param userData
+ * @param platformNetwork
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformNetworkWakeup(void *userData, platformNetwork_t *platformNetwork)
+{
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取socket描述符，供外部事件循环监听
+ *
+ * @param userData
+ * @param platformNetwork
+ * @return int32_t 没有连接时返回 -1
+ */
+int32_t platformNetworkGetFd(void *userData, platformNetwork_t *platformNetwork)
+{
+	return platformNetwork->socket;
+}
@@ -228,3 +228,63 @@ inline RyanMqttError_e platformCriticalExit(void *userData, platformCritical_t *
 	luat_rtos_exit_critical(platformCritical->level);
 	return RyanMqttSuccessError;
 }
+
+/**
+ * @brief 计数信号量初始化
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @param initCount 初始计数值
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreInit(void *userData, platformSemaphore_t *platformSemaphore, uint32_t initCount)
+{
+	if (0 != luat_rtos_semaphore_create(&platformSemaphore->sem, initCount))
+	{
+		return RyanMqttNoRescourceError;
+	}
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 销毁计数信号量
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreDestroy(void *userData, platformSemaphore_t *platformSemaphore)
+{
+	luat_rtos_semaphore_delete(platformSemaphore->sem);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取信号量，计数为0时阻塞等待
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @param timeout 最长等待时间，单位ms
+ * @return RyanMqttError_e 超时返回 RyanMqttFailedError
+ */
+RyanMqttError_e platformSemaphoreTake(void *userData, platformSemaphore_t *platformSemaphore, uint32_t timeout)
+{
+	if (0 != luat_rtos_semaphore_take(platformSemaphore->sem, timeout))
+	{
+		return RyanMqttFailedError;
+	}
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 释放信号量，计数加1
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreGive(void *userData, platformSemaphore_t *platformSemaphore)
+{
+	luat_rtos_semaphore_release(platformSemaphore->sem);
+	return RyanMqttSuccessError;
+}
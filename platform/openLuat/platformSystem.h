@@ -36,6 +36,11 @@ typedef struct
 	uint32_t level;
 } platformCritical_t;
 
+typedef struct
+{
+	luat_rtos_semaphore_t sem;
+} platformSemaphore_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -228,3 +228,63 @@ RyanMqttError_e platformCriticalExit(void *userData, platformCritical_t *platfor
 	rt_hw_interrupt_enable(platformCritical->level);
 	return RyanMqttSuccessError;
 }
+
+/**
+ * @brief 计数信号量初始化
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @param initCount 初始计数值
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreInit(void *userData, platformSemaphore_t *platformSemaphore, uint32_t initCount)
+{
+	if (RT_EOK != rt_sem_init(&platformSemaphore->sem, "mqttSem", initCount, RT_IPC_FLAG_PRIO))
+	{
+		return RyanMqttNoRescourceError;
+	}
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 销毁计数信号量
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreDestroy(void *userData, platformSemaphore_t *platformSemaphore)
+{
+	rt_sem_detach(&platformSemaphore->sem);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 获取信号量，计数为0时阻塞等待
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @param timeout 最长等待时间，单位ms
+ * @return RyanMqttError_e 超时返回 RyanMqttFailedError
+ */
+RyanMqttError_e platformSemaphoreTake(void *userData, platformSemaphore_t *platformSemaphore, uint32_t timeout)
+{
+	if (RT_EOK != rt_sem_take(&platformSemaphore->sem, rt_tick_from_millisecond(timeout)))
+	{
+		return RyanMqttFailedError;
+	}
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 释放信号量，计数加1
+ *
+ * @param userData
+ * @param platformSemaphore
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e platformSemaphoreGive(void *userData, platformSemaphore_t *platformSemaphore)
+{
+	rt_sem_release(&platformSemaphore->sem);
+	return RyanMqttSuccessError;
+}
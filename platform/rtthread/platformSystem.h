@@ -33,6 +33,11 @@ typedef struct
 	rt_base_t level;
 } platformCritical_t;
 
+typedef struct
+{
+	struct rt_semaphore sem;
+} platformSemaphore_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,596 @@
+#include "RyanMqttTest.h"
+
+#define RyanMqttDeadlineTestTopic     "testDeadline/ack"
+#define RyanMqttDeadlineDownTestTopic "testDeadline/down"
+#define RyanMqttDeadlineTestMaxDelay  (10 * 1000)
+
+// recvTimeout 远大于 ackTimeout，ack重发和心跳依然应该按时进行
+#define RyanMqttDeadlineRecvTimeout (1000)
+#define RyanMqttDeadlineAckTimeout  (300)
+#define RyanMqttDeadlineKeepaliveS  (2)
+
+// 允许的唤醒误差，单位ms
+#define RyanMqttDeadlineSlack (150)
+
+// 心跳抖动测试使用的抖动时间，单位ms
+#define RyanMqttDeadlineKeepaliveJitter (600)
+
+// 记录收发时间的tcp传输层，可以丢弃publish报文模拟broker没有收到
+typedef struct
+{
+	RyanMqttTransport_t transport;
+	platformNetwork_t network;
+	uint32_t recvCount;        // recv调用次数，即mqtt线程的唤醒次数
+	uint32_t publishCount;     // 发送的publish报文数
+	uint32_t publishTime[8];   // 前几个publish报文的发送时间
+	uint32_t pingCount;        // 发送的心跳报文数
+	uint32_t pingTime[8];      // 前几个心跳报文的发送时间
+	RyanMqttBool_e dropFlag;   // 丢弃publish报文
+	RyanMqttBool_e deadFlag;   // 模拟broker失去响应，丢弃所有发送的报文，接收不到任何报文
+} RyanMqttDeadlineTransport_t;
+
+static RyanMqttError_e RyanMqttDeadlineConnect(void *userData, const char *host, uint16_t port)
+{
+	RyanMqttDeadlineTransport_t *dt = (RyanMqttDeadlineTransport_t *)userData;
+	return platformNetworkConnect(NULL, &dt->network, host, port);
+}
+
+static int32_t RyanMqttDeadlineRecv(void *userData, char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	RyanMqttDeadlineTransport_t *dt = (RyanMqttDeadlineTransport_t *)userData;
+
+	RyanMqttTestEnableCritical();
+	dt->recvCount++;
+	RyanMqttBool_e deadFlag = dt->deadFlag;
+	RyanMqttTestExitCritical();
+
+	if (RyanMqttTrue == deadFlag)
+	{
+		delay(timeout);
+		return 0;
+	}
+
+	return platformNetworkRecvAsync(NULL, &dt->network, recvBuf, recvLen, timeout);
+}
+
+static int32_t RyanMqttDeadlineSend(void *userData, char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	RyanMqttDeadlineTransport_t *dt = (RyanMqttDeadlineTransport_t *)userData;
+	uint8_t packetType = (uint8_t)sendBuf[0] & 0xF0U;
+
+	RyanMqttTestEnableCritical();
+	RyanMqttBool_e dropFlag = dt->dropFlag;
+	RyanMqttBool_e deadFlag = dt->deadFlag;
+	if (MQTT_PACKET_TYPE_PUBLISH == packetType)
+	{
+		if (dt->publishCount < sizeof(dt->publishTime) / sizeof(dt->publishTime[0]))
+		{
+			dt->publishTime[dt->publishCount] = platformUptimeMs();
+		}
+		dt->publishCount++;
+	}
+	else if (MQTT_PACKET_TYPE_PINGREQ == packetType)
+	{
+		if (dt->pingCount < sizeof(dt->pingTime) / sizeof(dt->pingTime[0]))
+		{
+			dt->pingTime[dt->pingCount] = platformUptimeMs();
+		}
+		dt->pingCount++;
+	}
+	RyanMqttTestExitCritical();
+
+	if (RyanMqttTrue == deadFlag || (RyanMqttTrue == dropFlag && MQTT_PACKET_TYPE_PUBLISH == packetType))
+	{
+		return (int32_t)sendLen;
+	}
+
+	return platformNetworkSendAsync(NULL, &dt->network, sendBuf, sendLen, timeout);
+}
+
+static RyanMqttError_e RyanMqttDeadlineClose(void *userData)
+{
+	RyanMqttDeadlineTransport_t *dt = (RyanMqttDeadlineTransport_t *)userData;
+	return platformNetworkClose(NULL, &dt->network);
+}
+
+static RyanMqttError_e RyanMqttDeadlineWakeup(void *userData)
+{
+	RyanMqttDeadlineTransport_t *dt = (RyanMqttDeadlineTransport_t *)userData;
+	return platformNetworkWakeup(NULL, &dt->network);
+}
+
+static RyanMqttError_e RyanMqttDeadlineTestInit(RyanMqttClient_t **client, RyanMqttDeadlineTransport_t *dt,
+					       uint16_t keepaliveJitter)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttDeadlineTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = RyanMqttHost,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttFalse,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttDeadlineRecvTimeout,
+					     .sendTimeout = RyanMqttDeadlineRecvTimeout,
+					     .ackTimeout = RyanMqttDeadlineAckTimeout,
+					     .keepaliveTimeoutS = RyanMqttDeadlineKeepaliveS,
+					     .keepaliveJitter = keepaliveJitter,
+					     .mqttEventHandle = mqttEventBaseHandle,
+					     .userData = eventUserData,
+					     .transport = &dt->transport};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDeadlineTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(10);
+	}
+
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 检查相邻两次发送的间隔是否在期望值和允许误差之间
+ *
+ * @param name
+ * @param time
+ * @param count
+ * @param expect
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineCheckInterval(const char *name, const uint32_t *time, uint32_t count,
+						     uint32_t expect)
+{
+	for (uint32_t i = 1; i < count; i++)
+	{
+		uint32_t interval = time[i] - time[i - 1];
+		RyanMqttLog_raw("%s 第%u次间隔: %u ms, 期望: %u ms\r\n", name, i, interval, expect);
+		RyanMqttCheck(interval + 5 >= expect && interval <= expect + RyanMqttDeadlineSlack, RyanMqttFailedError,
+			      RyanMqttLog_e);
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 初始化记录收发时间的传输层
+ *
+ * @param dt
+ */
+static void RyanMqttDeadlineTransportInit(RyanMqttDeadlineTransport_t *dt)
+{
+	RyanMqttMemset(dt, 0, sizeof(RyanMqttDeadlineTransport_t));
+	dt->transport = (RyanMqttTransport_t){.userData = dt,
+					      .connect = RyanMqttDeadlineConnect,
+					      .recv = RyanMqttDeadlineRecv,
+					      .send = RyanMqttDeadlineSend,
+					      .close = RyanMqttDeadlineClose,
+					      .wakeup = RyanMqttDeadlineWakeup};
+	platformNetworkInit(NULL, &dt->network);
+}
+
+/**
+ * @brief 等待从 pingStart 开始的 count 个心跳报文发送完成，复制它们的发送时间
+ *
+ * @param dt
+ * @param pingStart
+ * @param count
+ * @param time
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineWaitPing(RyanMqttDeadlineTransport_t *dt, uint32_t pingStart, uint32_t count,
+						uint32_t *time)
+{
+	uint32_t pingCount = 0;
+
+	RyanMqttCheck(pingStart + count <= sizeof(dt->pingTime) / sizeof(dt->pingTime[0]), RyanMqttFailedError,
+		      RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDeadlineTestMaxDelay && pingCount < count; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttTestEnableCritical();
+		pingCount = dt->pingCount - pingStart;
+		RyanMqttTestExitCritical();
+	}
+	RyanMqttCheck(pingCount >= count, RyanMqttFailedError, RyanMqttLog_e);
+
+	RyanMqttTestEnableCritical();
+	RyanMqttMemcpy(time, dt->pingTime + pingStart, sizeof(uint32_t) * count);
+	RyanMqttTestExitCritical();
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief recvTimeout 大于 ackTimeout 时，ack超时重发和心跳依然按时进行，空闲时不频繁唤醒
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineAckTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttDeadlineTransport_t dt;
+	uint32_t time[8];
+
+	RyanMqttDeadlineTransportInit(&dt);
+
+	result = RyanMqttDeadlineTestInit(&client, &dt, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// broker收不到publish，每 ackTimeout 重发一次
+	RyanMqttTestEnableCritical();
+	dt.dropFlag = RyanMqttTrue;
+	RyanMqttTestExitCritical();
+	result = RyanMqttPublish(client, RyanMqttDeadlineTestTopic, "deadline", 8, RyanMqttQos1, RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	uint32_t publishCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDeadlineTestMaxDelay && publishCount < 4; elapsed += 5)
+	{
+		delay(5);
+		RyanMqttTestEnableCritical();
+		publishCount = dt.publishCount;
+		RyanMqttTestExitCritical();
+	}
+
+	RyanMqttTestEnableCritical();
+	dt.dropFlag = RyanMqttFalse;
+	RyanMqttMemcpy(time, dt.publishTime, sizeof(time));
+	RyanMqttTestExitCritical();
+
+	// 用户线程新加入的ack会唤醒正在等待的mqtt线程，第一次重发也按ack超时时间准时进行，不受 recvTimeout 影响
+	RyanMqttCheckCodeNoReturn(publishCount >= 4, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	result = RyanMqttDeadlineCheckInterval("ack重发", time, 4, RyanMqttDeadlineAckTimeout);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 下一次重发到达broker后ack链表清空，之后保持空闲，只有心跳。测试代码可以临时访问ack链表
+	RyanMqttBool_e ackEmptyFlag = RyanMqttFalse;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDeadlineTestMaxDelay && RyanMqttTrue != ackEmptyFlag;
+	     elapsed += 10)
+	{
+		delay(10);
+		platformMutexLock(client->config.userData, &client->ackHandleLock);
+		ackEmptyFlag = RyanMqttListIsEmpty(&client->ackHandlerList) ? RyanMqttTrue : RyanMqttFalse;
+		platformMutexUnLock(client->config.userData, &client->ackHandleLock);
+	}
+	RyanMqttCheckCodeNoReturn(RyanMqttTrue == ackEmptyFlag, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// 收发都空闲时心跳在 keepaliveTimeoutS 的 0.9 倍时间发送，pingresp刷新接收时间后等待相同间隔
+	uint32_t pingInterval = (uint32_t)(RyanMqttDeadlineKeepaliveS * 1000 * 0.9);
+	RyanMqttTestEnableCritical();
+	uint32_t pingStart = dt.pingCount;
+	uint32_t recvStart = dt.recvCount;
+	RyanMqttTestExitCritical();
+
+	delay(pingInterval * 3 + pingInterval / 2);
+	RyanMqttTestEnableCritical();
+	uint32_t pingCount = dt.pingCount - pingStart;
+	uint32_t recvCount = dt.recvCount - recvStart;
+	RyanMqttMemcpy(time, dt.pingTime + pingStart, sizeof(uint32_t) * 3);
+	RyanMqttTestExitCritical();
+
+	RyanMqttLog_raw("空闲 %u ms: 心跳 %u 次, 唤醒 %u 次\r\n", pingInterval * 3 + pingInterval / 2, pingCount,
+			recvCount);
+	RyanMqttCheckCodeNoReturn(3 == pingCount && pingStart + 3 <= 8, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	result = RyanMqttDeadlineCheckInterval("心跳", time, pingCount, pingInterval);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 空闲时不再按 recvTimeout 唤醒，每个心跳间隔内只在心跳发送和收到pingresp时各唤醒一次
+	uint32_t maxRecvCount = (pingCount + 1) * 2;
+	RyanMqttCheckCodeNoReturn(recvCount <= maxRecvCount, RyanMqttFailedError, RyanMqttLog_e, {
+		RyanMqttLog_e("唤醒 %u 次，最多 %u 次", recvCount, maxRecvCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &dt.network);
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
+
+/**
+ * @brief 只有接收方向有报文时，收到的报文已经证明连接正常，心跳推迟到标准要求的发送时间
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineInboundTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttClient_t *pubClient = NULL;
+	RyanMqttDeadlineTransport_t dt;
+	uint32_t time[4];
+
+	RyanMqttDeadlineTransportInit(&dt);
+
+	result = RyanMqttDeadlineTestInit(&client, &dt, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttTestInit(&pubClient, RyanMqttTrue, RyanMqttTrue, 120, NULL, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttSubscribe(client, RyanMqttDeadlineDownTestTopic, RyanMqttQos0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	delay(200);
+
+	// 另一个客户端持续发布qos0消息，被测客户端只接收不发送
+	RyanMqttTestEnableCritical();
+	uint32_t pingStart = dt.pingCount;
+	RyanMqttTestExitCritical();
+	uint32_t pingCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDeadlineTestMaxDelay && pingCount < 3; elapsed += 100)
+	{
+		result = RyanMqttPublish(pubClient, RyanMqttDeadlineDownTestTopic, "down", 4, RyanMqttQos0,
+					 RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+		delay(100);
+
+		RyanMqttTestEnableCritical();
+		pingCount = dt.pingCount - pingStart;
+		RyanMqttTestExitCritical();
+	}
+
+	result = RyanMqttDeadlineWaitPing(&dt, pingStart, 3, time);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 发送方向空闲到 keepaliveTimeoutS 的 0.95 倍时间才发送心跳，而不是收发都空闲时的 0.9 倍
+	result = RyanMqttDeadlineCheckInterval("接收繁忙时心跳", time, 3,
+					       (uint32_t)(RyanMqttDeadlineKeepaliveS * 1000 * 0.95));
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != pubClient)
+	{
+		RyanMqttTestDestroyClient(pubClient);
+	}
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &dt.network);
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
+
+/**
+ * @brief 配置心跳抖动后，每轮心跳提前0到 keepaliveJitter 之间的随机时间发送
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineJitterTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttDeadlineTransport_t dt;
+	uint32_t time[5];
+
+	RyanMqttDeadlineTransportInit(&dt);
+
+	result = RyanMqttDeadlineTestInit(&client, &dt, RyanMqttDeadlineKeepaliveJitter);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttDeadlineWaitPing(&dt, 0, 5, time);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	uint32_t pingInterval = (uint32_t)(RyanMqttDeadlineKeepaliveS * 1000 * 0.9);
+	uint32_t minInterval = UINT32_MAX;
+	uint32_t maxInterval = 0;
+	for (uint32_t i = 1; i < 5; i++)
+	{
+		uint32_t interval = time[i] - time[i - 1];
+		RyanMqttLog_raw("抖动心跳 第%u次间隔: %u ms\r\n", i, interval);
+		minInterval = (interval < minInterval) ? interval : minInterval;
+		maxInterval = (interval > maxInterval) ? interval : maxInterval;
+	}
+
+	// 间隔在 [0.9倍心跳周期 - 抖动时间, 0.9倍心跳周期] 之间，并且每轮不同
+	RyanMqttCheckCodeNoReturn(minInterval + 5 >= pingInterval - RyanMqttDeadlineKeepaliveJitter &&
+					  maxInterval <= pingInterval + RyanMqttDeadlineSlack &&
+					  maxInterval - minInterval > 10,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &dt.network);
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
+
+/**
+ * @brief broker失去响应但发送依然成功时，心跳发送不会推迟超时判断，1.5倍心跳周期没有收到报文后断开连接
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineDeadBrokerTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttDeadlineTransport_t dt;
+
+	RyanMqttDeadlineTransportInit(&dt);
+
+	result = RyanMqttDeadlineTestInit(&client, &dt, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttTestEnableCritical();
+	dt.deadFlag = RyanMqttTrue;
+	uint32_t pingStart = dt.pingCount;
+	RyanMqttTestExitCritical();
+	uint32_t deadTime = platformUptimeMs();
+
+	uint32_t elapsed = 0;
+	while (elapsed < RyanMqttDeadlineTestMaxDelay && RyanMqttConnectState == RyanMqttGetState(client))
+	{
+		delay(10);
+		elapsed = platformUptimeMs() - deadTime;
+	}
+
+	RyanMqttTestEnableCritical();
+	uint32_t pingCount = dt.pingCount - pingStart;
+	RyanMqttTestExitCritical();
+
+	// 最近一次收到报文在开始丢弃之前，所以最晚在 1.5 倍心跳周期后断开
+	uint32_t timeout = (uint32_t)(RyanMqttDeadlineKeepaliveS * 1000 * 1.5);
+	RyanMqttLog_raw("broker失去响应后 %u ms 断开连接, 期间发送心跳 %u 次\r\n", elapsed, pingCount);
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState != RyanMqttGetState(client) &&
+					  elapsed <= timeout + RyanMqttDeadlineSlack && pingCount >= 1,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &dt.network);
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
+
+/**
+ * @brief 空闲的mqtt线程一直等到下一个截止时间，销毁时被立即唤醒，不需要等到截止时间或 recvTimeout
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDeadlineWakeupTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttDeadlineTransport_t dt;
+
+	RyanMqttDeadlineTransportInit(&dt);
+
+	result = RyanMqttDeadlineTestInit(&client, &dt, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 连接后的第一轮报文处理完成，mqtt线程开始等待下一次心跳
+	delay(300);
+
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)client->config.userData;
+	uint32_t destroyTime = platformUptimeMs();
+	RyanMqttDestroy(client);
+	client = NULL;
+
+	sem_wait(&eventUserData->sem);
+	uint32_t elapsed = platformUptimeMs() - destroyTime;
+	sem_destroy(&eventUserData->sem);
+	delay(20); // 等待mqtt线程回收资源
+	free(eventUserData);
+
+	RyanMqttLog_raw("空闲时销毁客户端, mqtt线程 %u ms 后响应\r\n", elapsed);
+	RyanMqttCheckCodeNoReturn(elapsed <= RyanMqttDeadlineSlack, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &dt.network);
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
+
+/**
+ * @brief mqtt线程按最近的截止时间唤醒，ack重发和心跳准时进行
+ *
+ * @return RyanMqttError_e
+ */
+RyanMqttError_e RyanMqttDeadlineTest(void)
+{
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == RyanMqttDeadlineAckTest(), RyanMqttFailedError,
+				  RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == RyanMqttDeadlineInboundTest(), RyanMqttFailedError,
+				  RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == RyanMqttDeadlineJitterTest(), RyanMqttFailedError,
+				  RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == RyanMqttDeadlineDeadBrokerTest(), RyanMqttFailedError,
+				  RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == RyanMqttDeadlineWakeupTest(), RyanMqttFailedError,
+				  RyanMqttLog_e, { goto __exit; });
+
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
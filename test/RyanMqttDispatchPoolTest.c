@@ -0,0 +1,553 @@
+#include "RyanMqttTest.h"
+
+#define RyanMqttDispatchTestTopic      "testDispatch/"
+#define RyanMqttDispatchTestTopicAll   "testDispatch/#"
+#define RyanMqttDispatchTestCount      (100)
+#define RyanMqttDispatchTestDropCount  (30)
+#define RyanMqttDispatchTestMaxDelayMs (10 * 1000)
+
+// 保序测试使用的主题个数和每个主题的消息数
+#define RyanMqttDispatchTestOrderTopicCount (8)
+#define RyanMqttDispatchTestOrderMsgCount   (25)
+
+// 性能测试使用的主题个数、消息数和每条消息的模拟计算量
+#define RyanMqttDispatchBenchTopic      "benchDispatch/"
+#define RyanMqttDispatchBenchTopicCount (64)
+#define RyanMqttDispatchBenchMsgCount   (20000)
+#define RyanMqttDispatchBenchWorkLoop   (2000)
+
+static RyanMqttClient_t *dispatchTestClient = NULL;
+static uint32_t dispatchTestRecvCount = 0;
+static uint32_t dispatchTestPublishedCount = 0;
+static uint32_t dispatchTestOnMqttThreadCount = 0;
+static uint32_t dispatchTestHandleDelayMs = 0;
+static uint32_t dispatchTestOrderErrorCount = 0;
+static RyanMqttBool_e dispatchTestCheckOrderFlag = RyanMqttFalse;
+static uint32_t dispatchTestNextSeq[RyanMqttDispatchBenchTopicCount];
+
+static RyanMqttBool_e RyanMqttDispatchTestIsMqttThread(void)
+{
+	return pthread_equal(pthread_self(), dispatchTestClient->mqttThread.thread) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 检查消息序号，主题和payload都是十进制数字，同一主题的序号必须连续递增
+ * 同一主题只会在同一个工作线程中执行，序号数组不需要加锁
+ *
+ * @param msgData
+ * @param prefixLen 主题前缀长度
+ */
+static void RyanMqttDispatchTestCheckOrder(RyanMqttMsgData_t *msgData, uint32_t prefixLen)
+{
+	uint32_t index = (uint32_t)atoi(msgData->topic + prefixLen);
+	uint32_t seq = (uint32_t)atoi(msgData->payload);
+
+	if (index >= RyanMqttDispatchBenchTopicCount || seq != dispatchTestNextSeq[index])
+	{
+		RyanMqttTestEnableCritical();
+		dispatchTestOrderErrorCount++;
+		RyanMqttTestExitCritical();
+	}
+
+	if (index < RyanMqttDispatchBenchTopicCount)
+	{
+		dispatchTestNextSeq[index] = seq + 1;
+	}
+}
+
+static void RyanMqttDispatchTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	if (RyanMqttDispatchTestIsMqttThread())
+	{
+		RyanMqttTestEnableCritical();
+		dispatchTestOnMqttThreadCount++;
+		RyanMqttTestExitCritical();
+	}
+
+	if (RyanMqttTrue == dispatchTestCheckOrderFlag)
+	{
+		RyanMqttDispatchTestCheckOrder(msgData, RyanMqttStrlen(RyanMqttDispatchTestTopic));
+	}
+
+	if (0 != dispatchTestHandleDelayMs)
+	{
+		delay(dispatchTestHandleDelayMs);
+	}
+
+	RyanMqttTestEnableCritical();
+	dispatchTestRecvCount++;
+	RyanMqttTestExitCritical();
+}
+
+static void RyanMqttDispatchTestEventHandle(void *pclient, RyanMqttEventId_e event, const void *eventData)
+{
+	switch (event)
+	{
+	case RyanMqttEventPublished:
+		if (RyanMqttDispatchTestIsMqttThread())
+		{
+			RyanMqttTestEnableCritical();
+			dispatchTestOnMqttThreadCount++;
+			RyanMqttTestExitCritical();
+		}
+
+		RyanMqttTestEnableCritical();
+		dispatchTestPublishedCount++;
+		RyanMqttTestExitCritical();
+		break;
+
+	// 订阅时注册了消息回调，这里不再处理数据事件
+	case RyanMqttEventData: break;
+
+	default: mqttEventBaseHandle(pclient, event, eventData); break;
+	}
+}
+
+/**
+ * @brief 保序测试的分片key，直接使用主题中的序号，让不同主题均匀分布到各个工作线程
+ *
+ */
+static uint32_t RyanMqttDispatchTestKeyHandle(void *pclient, const RyanMqttMsgData_t *msgData)
+{
+	return (uint32_t)atoi(msgData->topic + RyanMqttStrlen(RyanMqttDispatchTestTopic));
+}
+
+/**
+ * @brief 使能回调工作线程池的客户端初始化
+ *
+ * @param client
+ * @param workerCount
+ * @param queueSize
+ * @param overflowPolicy
+ * @param ackAfterHandleFlag
+ * @param keyHandle 不为NULL时使能保序模式
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDispatchTestInit(RyanMqttClient_t **client, uint8_t workerCount, uint16_t queueSize,
+						RyanMqttDispatchOverflow_e overflowPolicy,
+						RyanMqttBool_e ackAfterHandleFlag, RyanMqttDispatchKeyHandle keyHandle)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttDispatchTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = RyanMqttHost,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .dispatchQueueSize = queueSize,
+					     .dispatchWorkerCount = workerCount,
+					     .dispatchOverflowPolicy = overflowPolicy,
+					     .dispatchAckAfterHandleFlag = ackAfterHandleFlag,
+					     .dispatchOrderedFlag = (NULL != keyHandle) ? RyanMqttTrue : RyanMqttFalse,
+					     .dispatchKeyHandle = keyHandle,
+					     .mqttEventHandle = RyanMqttDispatchTestEventHandle,
+					     .userData = eventUserData};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+	RyanMqttCheck(NULL != (*client)->dispatchPool, RyanMqttFailedError, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < 30000; elapsed += 100)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			break;
+		}
+		delay(100);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	dispatchTestClient = *client;
+	result = RyanMqttSubscribeWithMsgHandle(*client, RyanMqttDispatchTestTopicAll,
+						RyanMqttStrlen(RyanMqttDispatchTestTopicAll), RyanMqttQos1,
+						RyanMqttDispatchTestMsgHandle, NULL);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	int32_t subscribeTotalCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDispatchTestMaxDelayMs; elapsed += 10)
+	{
+		RyanMqttGetSubscribeTotalCount(*client, &subscribeTotalCount);
+		if (1 == subscribeTotalCount)
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	return RyanMqttSuccessError;
+}
+
+static void RyanMqttDispatchTestReset(uint32_t handleDelayMs)
+{
+	RyanMqttTestEnableCritical();
+	dispatchTestRecvCount = 0;
+	dispatchTestPublishedCount = 0;
+	dispatchTestOnMqttThreadCount = 0;
+	dispatchTestHandleDelayMs = handleDelayMs;
+	dispatchTestOrderErrorCount = 0;
+	dispatchTestCheckOrderFlag = RyanMqttFalse;
+	RyanMqttMemset(dispatchTestNextSeq, 0, sizeof(dispatchTestNextSeq));
+	RyanMqttTestExitCritical();
+}
+
+/**
+ * @brief 多工作线程 + 回调后回复PUBACK，所有消息都必须在工作线程中收到
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDispatchWorkerTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	char topic[64];
+	uint32_t recvCount = 0;
+	uint32_t publishedCount = 0;
+
+	RyanMqttDispatchTestReset(2);
+	result = RyanMqttDispatchTestInit(&client, 2, 8, RyanMqttDispatchOverflowBlock, RyanMqttTrue, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	for (int32_t i = 0; i < RyanMqttDispatchTestCount; i++)
+	{
+		RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttDispatchTestTopic, (int)i);
+		result = RyanMqttPublish(client, topic, "dispatch", RyanMqttStrlen("dispatch"), RyanMqttQos1,
+					 RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDispatchTestMaxDelayMs; elapsed += 10)
+	{
+		RyanMqttTestEnableCritical();
+		recvCount = dispatchTestRecvCount;
+		publishedCount = dispatchTestPublishedCount;
+		RyanMqttTestExitCritical();
+		if (RyanMqttDispatchTestCount == recvCount && RyanMqttDispatchTestCount == publishedCount)
+		{
+			break;
+		}
+		delay(10);
+	}
+
+	if (RyanMqttDispatchTestCount != recvCount || RyanMqttDispatchTestCount != publishedCount)
+	{
+		RyanMqttLog_e("回调线程池消息数量不一致 recv: %u, published: %u", recvCount,
+			      publishedCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	if (0 != dispatchTestOnMqttThreadCount)
+	{
+		RyanMqttLog_e("有 %u 次回调在mqtt线程中执行", dispatchTestOnMqttThreadCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	uint32_t dropCount = 0;
+	RyanMqttGetDispatchDropCount(client, &dropCount);
+	RyanMqttCheckCodeNoReturn(0 == dropCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttUnSubscribe(client, RyanMqttDispatchTestTopicAll);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = checkAckList(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 单个慢速工作线程 + 小队列，验证队列满时的丢弃策略
+ *
+ * @param overflowPolicy
+ * @param keyHandle 不为NULL时验证保序模式的环形队列
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDispatchDropTest(RyanMqttDispatchOverflow_e overflowPolicy,
+						RyanMqttDispatchKeyHandle keyHandle)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	char topic[64];
+	uint32_t recvCount = 0;
+	uint32_t dropCount = 0;
+
+	RyanMqttDispatchTestReset(100);
+	result = RyanMqttDispatchTestInit(&client, 1, 2, overflowPolicy, RyanMqttFalse, keyHandle);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	for (int32_t i = 0; i < RyanMqttDispatchTestDropCount; i++)
+	{
+		RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttDispatchTestTopic, (int)i);
+		result = RyanMqttPublish(client, topic, "drop", RyanMqttStrlen("drop"), RyanMqttQos0, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	// 被丢弃的消息加上已回调的消息应等于发送总数
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDispatchTestMaxDelayMs; elapsed += 10)
+	{
+		RyanMqttTestEnableCritical();
+		recvCount = dispatchTestRecvCount;
+		RyanMqttTestExitCritical();
+		RyanMqttGetDispatchDropCount(client, &dropCount);
+		if (RyanMqttDispatchTestDropCount == recvCount + dropCount)
+		{
+			break;
+		}
+		delay(10);
+	}
+
+	if (RyanMqttDispatchTestDropCount != recvCount + dropCount || 0 == dropCount)
+	{
+		RyanMqttLog_e("回调队列丢弃策略异常 policy: %d, ordered: %d, recv: %u, drop: %u", overflowPolicy,
+			      (NULL != keyHandle) ? 1 : 0, recvCount, dropCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 保序模式，多个主题交替发布，每个主题的消息必须按发布顺序回调
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDispatchOrderTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	char topic[64];
+	char payload[16];
+	uint32_t recvCount = 0;
+	uint32_t totalCount = RyanMqttDispatchTestOrderTopicCount * RyanMqttDispatchTestOrderMsgCount;
+
+	RyanMqttDispatchTestReset(1);
+	result = RyanMqttDispatchTestInit(&client, 4, 16, RyanMqttDispatchOverflowBlock, RyanMqttFalse,
+					  RyanMqttDispatchTestKeyHandle);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	dispatchTestCheckOrderFlag = RyanMqttTrue;
+
+	for (int32_t seq = 0; seq < RyanMqttDispatchTestOrderMsgCount; seq++)
+	{
+		for (int32_t i = 0; i < RyanMqttDispatchTestOrderTopicCount; i++)
+		{
+			RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttDispatchTestTopic, (int)i);
+			RyanMqttSnprintf(payload, sizeof(payload), "%d", (int)seq);
+			result = RyanMqttPublish(client, topic, payload, RyanMqttStrlen(payload), RyanMqttQos1,
+						 RyanMqttFalse);
+			RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+						  { goto __exit; });
+		}
+	}
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttDispatchTestMaxDelayMs; elapsed += 10)
+	{
+		RyanMqttTestEnableCritical();
+		recvCount = dispatchTestRecvCount;
+		RyanMqttTestExitCritical();
+		if (totalCount == recvCount)
+		{
+			break;
+		}
+		delay(10);
+	}
+
+	if (totalCount != recvCount || 0 != dispatchTestOrderErrorCount)
+	{
+		RyanMqttLog_e("保序分发异常 recv: %u, total: %u, orderError: %u", recvCount, totalCount,
+			      dispatchTestOrderErrorCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+__exit:
+	dispatchTestCheckOrderFlag = RyanMqttFalse;
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+static void RyanMqttDispatchBenchMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	// 模拟回调中的计算量
+	volatile uint32_t sum = 0;
+	for (uint32_t i = 0; i < RyanMqttDispatchBenchWorkLoop; i++)
+	{
+		sum += i;
+	}
+
+	RyanMqttDispatchTestCheckOrder(msgData, RyanMqttStrlen(RyanMqttDispatchBenchTopic));
+
+	RyanMqttTestEnableCritical();
+	dispatchTestRecvCount++;
+	RyanMqttTestExitCritical();
+}
+
+/**
+ * @brief 保序模式下 1 - 8 个工作线程的吞吐对比
+ * 测试线程代替mqtt线程直接入队，期间没有入站消息，不会和mqtt线程同时使用收集数组
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDispatchBenchmark(void)
+{
+	static const uint8_t workerCounts[] = {1, 2, 4, 8};
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t elapsedMs[getArraySize(workerCounts)];
+	char topic[64];
+	char payload[16];
+
+	for (int32_t n = 0; n < getArraySize(workerCounts); n++)
+	{
+		RyanMqttClient_t *client = NULL;
+		uint32_t recvCount = 0;
+
+		RyanMqttDispatchTestReset(0);
+		result = RyanMqttDispatchTestInit(&client, workerCounts[n], 256, RyanMqttDispatchOverflowBlock,
+						  RyanMqttFalse, RyanMqttDispatchTestKeyHandle);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, {
+			if (NULL != client)
+			{
+				RyanMqttTestDestroyClient(client);
+			}
+			return result;
+		});
+
+		// 性能测试使用默认的主题哈希分片
+		client->dispatchPool->keyHandle = NULL;
+
+		uint32_t startMs = platformUptimeMs();
+		for (int32_t i = 0; i < RyanMqttDispatchBenchMsgCount; i++)
+		{
+			int32_t index = i % RyanMqttDispatchBenchTopicCount;
+			RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttDispatchBenchTopic, (int)index);
+			RyanMqttSnprintf(payload, sizeof(payload), "%d", (int)(i / RyanMqttDispatchBenchTopicCount));
+
+			RyanMqttMsgData_t msgData = {.topic = topic,
+						     .topicLen = (uint16_t)RyanMqttStrlen(topic),
+						     .payload = payload,
+						     .payloadLen = RyanMqttStrlen(payload),
+						     .qos = RyanMqttQos0};
+			RyanMqttDispatchCollect(client, RyanMqttDispatchBenchMsgHandle, NULL);
+			result = RyanMqttDispatchMsg(client, &msgData, RyanMqttFalse, RyanMqttFalse);
+			if (RyanMqttSuccessError != result)
+			{
+				break;
+			}
+		}
+
+		while (RyanMqttSuccessError == result && RyanMqttDispatchBenchMsgCount != recvCount &&
+		       platformUptimeMs() - startMs < RyanMqttDispatchTestMaxDelayMs * 3)
+		{
+			delay(1);
+			RyanMqttTestEnableCritical();
+			recvCount = dispatchTestRecvCount;
+			RyanMqttTestExitCritical();
+		}
+		elapsedMs[n] = platformUptimeMs() - startMs;
+
+		RyanMqttTestDestroyClient(client);
+		checkMemory;
+
+		if (RyanMqttDispatchBenchMsgCount != recvCount || 0 != dispatchTestOrderErrorCount)
+		{
+			RyanMqttLog_e("保序分发性能测试异常 worker: %d, recv: %u, orderError: %u",
+				      workerCounts[n], recvCount, dispatchTestOrderErrorCount);
+			return RyanMqttFailedError;
+		}
+	}
+
+	RyanMqttLog_raw("保序分发性能: 1线程 %u ms, 2线程 %u ms, 4线程 %u ms, 8线程 %u ms, 共 %u 条消息\r\n",
+			elapsedMs[0], elapsedMs[1], elapsedMs[2], elapsedMs[3], RyanMqttDispatchBenchMsgCount);
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttDispatchPoolTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	result = RyanMqttDispatchWorkerTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttDispatchDropTest(RyanMqttDispatchOverflowDropNewest, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttDispatchDropTest(RyanMqttDispatchOverflowDropOldest, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttDispatchDropTest(RyanMqttDispatchOverflowDropNewest, RyanMqttDispatchTestKeyHandle);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttDispatchDropTest(RyanMqttDispatchOverflowDropOldest, RyanMqttDispatchTestKeyHandle);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttDispatchOrderTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttDispatchBenchmark();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
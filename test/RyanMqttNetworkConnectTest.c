@@ -0,0 +1,156 @@
+#include "RyanMqttTest.h"
+
+// 不可路由的地址，SYN没有任何响应，只能依靠连接超时返回
+#define RyanMqttConnectTestBlackholeHost ("10.255.255.1")
+#define RyanMqttConnectTestInvalidHost   ("RyanMqttConnectTest.invalid")
+#define RyanMqttConnectTestThreadCount   (4)
+#define RyanMqttConnectTestLoopCount     (200)
+
+static uint32_t connectTestErrorCount = 0;
+static volatile RyanMqttBool_e connectTestRunFlag = RyanMqttFalse;
+
+/**
+ * @brief 连接指定地址并统计耗时，成功后立即断开
+ *
+ * @param host
+ * @param port
+ * @param elapsedMs
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttConnectTestOnce(const char *host, uint16_t port, uint32_t *elapsedMs)
+{
+	platformNetwork_t network;
+	RyanMqttError_e result;
+
+	platformNetworkInit(NULL, &network);
+
+	uint32_t startMs = platformUptimeMs();
+	result = platformNetworkConnect(NULL, &network, host, port);
+	*elapsedMs = platformUptimeMs() - startMs;
+
+	platformNetworkClose(NULL, &network);
+	platformNetworkDestroy(NULL, &network);
+	return result;
+}
+
+/**
+ * @brief 并发连接没有监听的端口，dns缓存必须每次都返回有效地址，连接失败原因只能是被拒绝
+ *
+ * @param arg
+ * @return void*
+ */
+static void *RyanMqttConnectTestThread(void *arg)
+{
+	uint32_t elapsedMs;
+
+	while (RyanMqttTrue != connectTestRunFlag)
+	{
+		sched_yield();
+	}
+
+	for (int32_t i = 0; i < RyanMqttConnectTestLoopCount; i++)
+	{
+		if (RyanMqttSocketConnectFailError != RyanMqttConnectTestOnce(RyanMqttHost, 1, &elapsedMs))
+		{
+			RyanMqttTestEnableCritical();
+			connectTestErrorCount++;
+			RyanMqttTestExitCritical();
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief 多个线程并发解析的同时不断刷新缓存
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttDnsCacheConcurrentTest(void)
+{
+	pthread_t threads[RyanMqttConnectTestThreadCount];
+
+	connectTestErrorCount = 0;
+	connectTestRunFlag = RyanMqttFalse;
+	for (int32_t i = 0; i < RyanMqttConnectTestThreadCount; i++)
+	{
+		int createResult = pthread_create(&threads[i], NULL, RyanMqttConnectTestThread, NULL);
+		RyanMqttCheck(0 == createResult, RyanMqttFailedError, RyanMqttLog_e);
+	}
+
+	connectTestRunFlag = RyanMqttTrue;
+	for (int32_t i = 0; i < RyanMqttConnectTestLoopCount; i++)
+	{
+		platformNetworkDnsRefresh((0 == i % 2) ? RyanMqttHost : NULL);
+		sched_yield();
+	}
+
+	for (int32_t i = 0; i < RyanMqttConnectTestThreadCount; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	if (0 != connectTestErrorCount)
+	{
+		RyanMqttLog_e("dns缓存并发读取异常 error: %u", connectTestErrorCount);
+		return RyanMqttFailedError;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttNetworkConnectTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t elapsedMs = 0;
+
+	platformNetworkDnsRefresh(NULL);
+
+	// 域名需要dns解析
+	result = RyanMqttConnectTestOnce(RyanMqttHost, RyanMqttPort, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	// 端口没有监听，应立即收到RST
+	result = RyanMqttConnectTestOnce("127.0.0.1", 1, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError != result && elapsedMs < 1000, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 不可达的地址必须在连接超时时间内返回，而不是等待内核的SYN重试超时
+	result = RyanMqttConnectTestOnce(RyanMqttConnectTestBlackholeHost, RyanMqttPort, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError != result && elapsedMs <= platformNetworkConnectTimeout + 500,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  RyanMqttLog_e("连接超时异常 elapsed: %u", elapsedMs);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 解析失败会被缓存，第二次直接返回
+	result = RyanMqttConnectTestOnce(RyanMqttConnectTestInvalidHost, RyanMqttPort, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttNoRescourceError == result, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	result = RyanMqttConnectTestOnce(RyanMqttConnectTestInvalidHost, RyanMqttPort, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttNoRescourceError == result && elapsedMs < 10, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 刷新后重新解析，依然可以连接
+	platformNetworkDnsRefresh(RyanMqttHost);
+	result = RyanMqttConnectTestOnce(RyanMqttHost, RyanMqttPort, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttDnsCacheConcurrentTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	checkMemory;
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
@@ -0,0 +1,551 @@
+#include "RyanMqttTest.h"
+#include "platformSpill.h"
+
+#define RyanMqttOfflineTestTopic     "testOffline/seq"
+#define RyanMqttOfflineTestTopicAll  "testOffline/#"
+#define RyanMqttOfflineTestSpillPath "/tmp/RyanMqttOfflineTest.spill"
+#define RyanMqttOfflineTestMaxDelay  (10 * 1000)
+
+static uint32_t offlineTestDiscardCount = 0;
+static uint32_t offlineTestDiscardNextSeq = 0;
+
+/**
+ * @brief 解析payload开头的十进制序号
+ *
+ * @param payload
+ * @param payloadLen
+ * @return uint32_t
+ */
+static uint32_t RyanMqttOfflineTestParseSeq(const char *payload, uint32_t payloadLen)
+{
+	char buf[16] = {0};
+
+	RyanMqttMemcpy(buf, payload, payloadLen < sizeof(buf) - 1 ? payloadLen : sizeof(buf) - 1);
+	return (uint32_t)atoi(buf);
+}
+
+static void RyanMqttOfflineTestEventHandle(void *pclient, RyanMqttEventId_e event, const void *eventData)
+{
+	switch (event)
+	{
+	// 丢弃的一定是最早的消息
+	case RyanMqttEventOfflineDiscard: {
+		const RyanMqttOfflineMsg_t *msg = (const RyanMqttOfflineMsg_t *)eventData;
+		if (RyanMqttOfflineTestParseSeq(msg->payload, msg->payloadLen) == offlineTestDiscardNextSeq &&
+		    0 == strcmp(msg->topic, RyanMqttOfflineTestTopic))
+		{
+			offlineTestDiscardNextSeq++;
+		}
+		offlineTestDiscardCount++;
+		break;
+	}
+
+	default: mqttEventBaseHandle(pclient, event, eventData); break;
+	}
+}
+
+/**
+ * @brief 初始化客户端并等待连接成功
+ *
+ * @param client
+ * @param mqttConfig 只需要填写测试相关的字段，连接相关的字段在这里补充
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineTestInit(RyanMqttClient_t **client, RyanMqttClientConfig_t *mqttConfig)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	mqttConfig->userName = RyanMqttUserName;
+	mqttConfig->password = RyanMqttPassword;
+	mqttConfig->host = RyanMqttHost;
+	mqttConfig->port = RyanMqttPort;
+	mqttConfig->taskName = "mqttThread";
+	mqttConfig->taskPrio = 16;
+	mqttConfig->taskStack = 4096;
+	mqttConfig->mqttVersion = 4;
+	mqttConfig->ackHandlerRepeatCountWarning = 600;
+	mqttConfig->ackHandlerCountWarning = 60000;
+	mqttConfig->cleanSessionFlag = RyanMqttTrue;
+	mqttConfig->reconnectTimeout = RyanMqttReconnectTimeout;
+	mqttConfig->recvTimeout = RyanMqttRecvTimeout;
+	mqttConfig->sendTimeout = RyanMqttSendTimeout;
+	mqttConfig->ackTimeout = RyanMqttAckTimeout;
+	mqttConfig->keepaliveTimeoutS = 120;
+	mqttConfig->mqttEventHandle = RyanMqttOfflineTestEventHandle;
+	mqttConfig->userData = eventUserData;
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < 30000; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 接收端使用拉取模式，按到达顺序检查序号
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineTestReceiverInit(RyanMqttClient_t **client)
+{
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttOfflineRecv",
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .recvQueueSize = 64};
+	RyanMqttError_e result = RyanMqttOfflineTestInit(client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSubscribe(*client, RyanMqttOfflineTestTopicAll, RyanMqttQos1);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	int32_t subscribeTotalCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttOfflineTestMaxDelay; elapsed += 10)
+	{
+		RyanMqttGetSubscribeTotalCount(*client, &subscribeTotalCount);
+		if (1 == subscribeTotalCount)
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	// 等待broker处理完订阅
+	delay(100);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 按顺序读取序号从 firstSeq 到 endSeq - 1 的消息
+ *
+ * @param receiver
+ * @param firstSeq
+ * @param endSeq
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineTestExpectSeq(RyanMqttClient_t *receiver, uint32_t firstSeq, uint32_t endSeq)
+{
+	RyanMqttMsgData_t msgData;
+
+	for (uint32_t seq = firstSeq; seq < endSeq; seq++)
+	{
+		RyanMqttError_e result = RyanMqttRecvMessage(receiver, &msgData, RyanMqttOfflineTestMaxDelay);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+		uint32_t recvSeq = RyanMqttOfflineTestParseSeq(msgData.payload, msgData.payloadLen);
+		RyanMqttReleaseMessage(&msgData);
+		if (recvSeq != seq)
+		{
+			RyanMqttLog_e("离线消息顺序异常 expect: %u, recv: %u", seq, recvSeq);
+			return RyanMqttFailedError;
+		}
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 断开发送端并等待状态变化
+ *
+ * @param client
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineTestDisconnect(RyanMqttClient_t *client)
+{
+	RyanMqttError_e result = RyanMqttDisconnect(client, RyanMqttTrue);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttOfflineTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState != RyanMqttGetState(client))
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(10);
+	}
+
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 等待离线队列补发完成
+ *
+ * @param client
+ * @param pElapsedMs 可以为NULL
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineTestWaitDrain(RyanMqttClient_t *client, uint32_t *pElapsedMs)
+{
+	uint32_t startMs = platformUptimeMs();
+	uint32_t count = 0;
+
+	while (platformUptimeMs() - startMs < RyanMqttOfflineTestMaxDelay)
+	{
+		RyanMqttGetOfflineCount(client, &count);
+		if (0 == count)
+		{
+			if (NULL != pElapsedMs)
+			{
+				*pElapsedMs = platformUptimeMs() - startMs;
+			}
+			return RyanMqttSuccessError;
+		}
+		delay(1);
+	}
+
+	RyanMqttLog_e("离线队列补发超时, 剩余: %u", count);
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 发布序号从 firstSeq 到 endSeq - 1 的消息，payload 用 padLen 个字符补齐
+ *
+ * @param client
+ * @param qos
+ * @param firstSeq
+ * @param endSeq
+ * @param padLen
+ * @return RyanMqttError_e 第一个失败的返回值
+ */
+static RyanMqttError_e RyanMqttOfflineTestPublish(RyanMqttClient_t *client, RyanMqttQos_e qos, uint32_t firstSeq,
+						  uint32_t endSeq, uint32_t padLen)
+{
+	char payload[128];
+
+	RyanMqttAssert(padLen < sizeof(payload) - 16);
+	for (uint32_t seq = firstSeq; seq < endSeq; seq++)
+	{
+		int32_t len = RyanMqttSnprintf(payload, sizeof(payload), "%u ", seq);
+		RyanMqttMemset(payload + len, 'x', padLen);
+
+		RyanMqttError_e result = RyanMqttPublish(client, RyanMqttOfflineTestTopic, payload, len + padLen, qos,
+							 RyanMqttFalse);
+		if (RyanMqttSuccessError != result)
+		{
+			return result;
+		}
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 断开期间缓存，重连后按顺序补发。队列已满时丢弃新消息，qos0不缓存
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineOrderTest(RyanMqttClient_t *receiver)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	uint32_t count = 0;
+
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttOfflineSend",
+					     .autoReconnectFlag = RyanMqttFalse,
+					     .offlineQueueMaxCount = 20,
+					     .offlinePolicy = {RyanMqttOfflineNotQueue, RyanMqttOfflineDropNewest,
+							       RyanMqttOfflineDropNewest}};
+	result = RyanMqttOfflineTestInit(&client, &mqttConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestDisconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos0, 0, 1, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttNotConnectError == result, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// qos1和qos2交替缓存，超过上限的消息直接拒绝
+	for (uint32_t seq = 0; seq < 20; seq++)
+	{
+		result = RyanMqttOfflineTestPublish(client, (seq % 2) ? RyanMqttQos2 : RyanMqttQos1, seq, seq + 1, 0);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos1, 20, 21, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttNoRescourceError == result, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	RyanMqttGetOfflineCount(client, &count);
+	RyanMqttCheckCodeNoReturn(20 == count, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttReconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 补发完成后新消息直接发送，排在补发的消息之后
+	result = RyanMqttOfflineTestWaitDrain(client, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos1, 20, 25, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestExpectSeq(receiver, 0, 25);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = checkAckList(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 内存缓存已满时溢出到环形文件，数量上限已满时丢弃最早的消息
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineSpillTest(RyanMqttClient_t *receiver)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	platformSpillFile_t spillFile;
+	uint32_t count = 0;
+
+	result = platformSpillFileInit(&spillFile, RyanMqttOfflineTestSpillPath, 16 * 1024);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	// 内存中只能缓存几条消息，其余进入溢出存储
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttOfflineSend",
+					     .autoReconnectFlag = RyanMqttFalse,
+					     .offlineQueueMaxBytes = 1024,
+					     .offlineQueueMaxCount = 50,
+					     .offlinePolicy = {RyanMqttOfflineDropOldest, RyanMqttOfflineDropOldest,
+							       RyanMqttOfflineDropOldest},
+					     .offlineSpill = &spillFile.spill};
+	result = RyanMqttOfflineTestInit(&client, &mqttConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestDisconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	offlineTestDiscardCount = 0;
+	offlineTestDiscardNextSeq = 0;
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos1, 0, 60, 100);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttGetOfflineCount(client, &count);
+	RyanMqttCheckCodeNoReturn(50 == count && spillFile.count > 0 && 10 == offlineTestDiscardCount &&
+					  10 == offlineTestDiscardNextSeq,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  RyanMqttLog_e("count: %u, spill: %u, discard: %u, nextSeq: %u", count,
+							spillFile.count, offlineTestDiscardCount,
+							offlineTestDiscardNextSeq);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttReconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestExpectSeq(receiver, 10, 60);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(0 == spillFile.count, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformSpillFileDestroy(&spillFile);
+	return result;
+}
+
+/**
+ * @brief 各qos使用不同策略时，队列已满只能丢弃同样是 RyanMqttOfflineDropOldest 策略的消息
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineMixedPolicyTest(RyanMqttClient_t *receiver)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttOfflineSend",
+					     .autoReconnectFlag = RyanMqttFalse,
+					     .offlineQueueMaxCount = 10,
+					     .offlinePolicy = {RyanMqttOfflineDropOldest, RyanMqttOfflineDropNewest,
+							       RyanMqttOfflineDropNewest}};
+	result = RyanMqttOfflineTestInit(&client, &mqttConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestDisconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 队列中只有qos2消息，qos0的新消息不能挤掉它们
+	offlineTestDiscardCount = 0;
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos2, 0, 10, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos0, 10, 11, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttNoRescourceError == result && 0 == offlineTestDiscardCount,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  RyanMqttLog_e("qos0丢弃了其他策略的消息, result: %d, discard: %u", result,
+							offlineTestDiscardCount);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttReconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestWaitDrain(client, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestExpectSeq(receiver, 0, 10);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestDisconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// qos0在前qos2在后，qos0的新消息只丢弃最早的qos0消息，qos1的新消息直接拒绝
+	offlineTestDiscardCount = 0;
+	offlineTestDiscardNextSeq = 10;
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos0, 10, 15, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos2, 15, 20, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos1, 20, 21, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttNoRescourceError == result, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos0, 20, 21, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && 1 == offlineTestDiscardCount &&
+					  11 == offlineTestDiscardNextSeq,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  RyanMqttLog_e("result: %d, discard: %u, nextSeq: %u", result,
+							offlineTestDiscardCount, offlineTestDiscardNextSeq);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttReconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttOfflineTestExpectSeq(receiver, 11, 21);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 重连后按配置的速率补发
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttOfflineDrainRateTest(RyanMqttClient_t *receiver)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	uint32_t elapsedMs = 0;
+
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttOfflineSend",
+					     .autoReconnectFlag = RyanMqttFalse,
+					     .offlineQueueMaxCount = 100,
+					     .offlineDrainRate = 20};
+	result = RyanMqttOfflineTestInit(&client, &mqttConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestDisconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineTestPublish(client, RyanMqttQos1, 0, 21, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttReconnect(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 每秒20条，第一条立即发送，剩余20条至少需要1秒
+	result = RyanMqttOfflineTestWaitDrain(client, &elapsedMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	RyanMqttLog_raw("离线队列限速补发: 21 条消息, 速率 20 条/秒, 耗时 %u ms\r\n", elapsedMs);
+	RyanMqttCheckCodeNoReturn(elapsedMs >= 900 && elapsedMs < 3000, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttOfflineTestExpectSeq(receiver, 0, 21);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+RyanMqttError_e RyanMqttOfflineQueueTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *receiver = NULL;
+
+	result = RyanMqttOfflineTestReceiverInit(&receiver);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineOrderTest(receiver);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineSpillTest(receiver);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineMixedPolicyTest(receiver);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttOfflineDrainRateTest(receiver);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttTestDestroyClient(receiver);
+	checkMemory;
+	return RyanMqttSuccessError;
+
+__exit:
+	if (NULL != receiver)
+	{
+		RyanMqttTestDestroyClient(receiver);
+	}
+	return RyanMqttFailedError;
+}
@@ -0,0 +1,468 @@
+#include "RyanMqttTest.h"
+#include "core_mqtt_serializer.h"
+#include "platformPersist.h"
+
+#define RyanMqttPersistTestPath      "/tmp/RyanMqttPersistTest.journal"
+#define RyanMqttPersistTestClientId  "RyanMqttPersistTest"
+#define RyanMqttPersistTestTopic     "testPersist/restore"
+#define RyanMqttPersistTestCount     (2000)
+#define RyanMqttPersistTestPacketLen (200)
+
+static uint32_t persistTestPublishedCount = 0;
+
+static void RyanMqttPersistTestEventHandle(void *pclient, RyanMqttEventId_e event, const void *eventData)
+{
+	switch (event)
+	{
+	case RyanMqttEventPublished: persistTestPublishedCount++; break;
+
+	default: mqttEventBaseHandle(pclient, event, eventData); break;
+	}
+}
+
+static RyanMqttError_e RyanMqttPersistTestInit(RyanMqttClient_t **client, RyanMqttPersist_t *persist)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = RyanMqttPersistTestClientId,
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = RyanMqttHost,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttFalse,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = RyanMqttPersistTestEventHandle,
+					     .userData = eventUserData,
+					     .persist = persist};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t i = 0; i < 3000 && RyanMqttConnectState != RyanMqttGetState(*client); i++)
+	{
+		delay(10);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 等待 persistTestPublishedCount 达到期望值
+ *
+ * @param count
+ * @param timeoutMs
+ * @return RyanMqttBool_e
+ */
+static RyanMqttBool_e RyanMqttPersistTestWaitPublished(uint32_t count, uint32_t timeoutMs)
+{
+	uint32_t startMs = platformUptimeMs();
+	while (persistTestPublishedCount < count)
+	{
+		if (platformUptimeMs() - startMs > timeoutMs)
+		{
+			RyanMqttLog_e("等待发布完成超时, published: %d, expect: %d", persistTestPublishedCount, count);
+			return RyanMqttFalse;
+		}
+		delay(1);
+	}
+	return RyanMqttTrue;
+}
+
+struct RyanMqttPersistTestLoadCtx
+{
+	uint32_t count;
+	uint16_t lastPacketId;
+};
+
+static RyanMqttError_e RyanMqttPersistTestLoadHandle(void *ctx, const RyanMqttPersistRecord_t *record)
+{
+	struct RyanMqttPersistTestLoadCtx *loadCtx = (struct RyanMqttPersistTestLoadCtx *)ctx;
+
+	if (record->packetId <= loadCtx->lastPacketId || 0 != record->packetId % 10 ||
+	    RyanMqttPersistTestPacketLen != record->packetLen || (uint8_t)record->packetId != record->packet[0] ||
+	    0 != RyanMqttStrncmp(record->topic, RyanMqttPersistTestTopic, record->topicLen))
+	{
+		return RyanMqttFailedError;
+	}
+
+	loadCtx->lastPacketId = record->packetId;
+	loadCtx->count++;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 日志文件的增删、压缩、重放和截断
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPersistJournalTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformPersistFile_t file;
+	uint8_t packet[RyanMqttPersistTestPacketLen];
+	struct RyanMqttPersistTestLoadCtx loadCtx = {0};
+
+	unlink(RyanMqttPersistTestPath);
+	result = platformPersistFileInit(&file, RyanMqttPersistTestPath, 0);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	// 只保留十分之一的记录，写入量远超文件大小，会触发多次压缩
+	for (uint16_t i = 1; i <= 1000; i++)
+	{
+		RyanMqttMemset(packet, (uint8_t)i, sizeof(packet));
+		RyanMqttPersistRecord_t record = {.topic = RyanMqttPersistTestTopic,
+						  .packet = packet,
+						  .packetLen = sizeof(packet),
+						  .packetId = i,
+						  .topicLen = RyanMqttStrlen(RyanMqttPersistTestTopic),
+						  .packetType = MQTT_PACKET_TYPE_PUBACK,
+						  .qos = RyanMqttQos1};
+		result = file.persist.put(file.persist.userData, &record);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+		if (0 != i % 10)
+		{
+			result = file.persist.del(file.persist.userData, MQTT_PACKET_TYPE_PUBACK, i);
+			RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e,
+						  { goto __exit; });
+		}
+	}
+	result = file.persist.del(file.persist.userData, MQTT_PACKET_TYPE_PUBREL, 1); // 不存在的记录
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttCheckCodeNoReturn(100 == platformPersistFileGetCount(&file), RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	RyanMqttCheckCodeNoReturn(file.capacity <= platformPersistMinCapacity * 4, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 模拟进程崩溃时写了一半的记录
+	uint32_t tail = file.tail;
+	RyanMqttMemset(file.base + tail, 0x5A, 64);
+	platformPersistFileDestroy(&file);
+
+	result = platformPersistFileInit(&file, RyanMqttPersistTestPath, 0);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+	RyanMqttCheckCodeNoReturn(100 == platformPersistFileGetCount(&file) && tail == file.tail, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 按写入顺序加载，内容不变
+	result = file.persist.load(file.persist.userData, RyanMqttPersistTestLoadHandle, &loadCtx);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && 100 == loadCtx.count, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	platformPersistFileDestroy(&file);
+	unlink(RyanMqttPersistTestPath);
+	return result;
+}
+
+/**
+ * @brief 删除记录写入失败时返回错误，记录仍然有效
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPersistDelFailTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformPersistFile_t file;
+	uint8_t packet[16] = {0};
+	RyanMqttPersistRecord_t record = {.topic = RyanMqttPersistTestTopic,
+					  .packet = packet,
+					  .packetLen = sizeof(packet),
+					  .packetId = 1,
+					  .topicLen = RyanMqttStrlen(RyanMqttPersistTestTopic),
+					  .packetType = MQTT_PACKET_TYPE_PUBACK,
+					  .qos = RyanMqttQos1};
+
+	unlink(RyanMqttPersistTestPath);
+	result = platformPersistFileInit(&file, RyanMqttPersistTestPath, 0);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = file.persist.put(file.persist.userData, &record);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 日志已满需要压缩，临时文件所在目录不存在时压缩失败，删除记录无法写入
+	char *path = file.path;
+	uint32_t tail = file.tail;
+	file.path = "/nonexistent/RyanMqttPersistTest.journal";
+	file.tail = file.capacity - sizeof(uint32_t);
+	result = file.persist.del(file.persist.userData, MQTT_PACKET_TYPE_PUBACK, 1);
+	file.path = path;
+	file.tail = tail;
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError != result && 1 == platformPersistFileGetCount(&file),
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = file.persist.del(file.persist.userData, MQTT_PACKET_TYPE_PUBACK, 1);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && 0 == platformPersistFileGetCount(&file),
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	platformPersistFileDestroy(&file);
+	unlink(RyanMqttPersistTestPath);
+	return result;
+}
+
+/**
+ * @brief 模拟进程重启，上次未完成的qos1/qos2发布在连接成功后立即重发
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPersistRestoreTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	platformPersistFile_t file;
+	uint8_t buffer[128];
+
+	unlink(RyanMqttPersistTestPath);
+	result = platformPersistFileInit(&file, RyanMqttPersistTestPath, 0);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	// 先建立broker上的会话，并检查正常完成的发布不会残留记录
+	persistTestPublishedCount = 0;
+	result = RyanMqttPersistTestInit(&client, &file.persist);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		RyanMqttQos_e qos = (i % 2) ? RyanMqttQos2 : RyanMqttQos1;
+		result = RyanMqttPublish(client, RyanMqttPersistTestTopic, "hello", 5, qos, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+	RyanMqttCheckCodeNoReturn(RyanMqttTrue == RyanMqttPersistTestWaitPublished(20, 5000), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+	RyanMqttTestDestroyClient(client);
+	client = NULL;
+	RyanMqttCheckCodeNoReturn(0 == platformPersistFileGetCount(&file), RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// 写入上次进程退出前没有收到ack的qos1和qos2发布
+	for (uint8_t qos = RyanMqttQos1; qos <= RyanMqttQos2; qos++)
+	{
+		MQTTPublishInfo_t publishInfo = {.qos = (MQTTQoS_t)qos,
+						 .pTopicName = RyanMqttPersistTestTopic,
+						 .topicNameLength = RyanMqttStrlen(RyanMqttPersistTestTopic),
+						 .pPayload = "restore",
+						 .payloadLength = RyanMqttStrlen("restore")};
+		MQTTFixedBuffer_t fixedBuffer = {.pBuffer = buffer, .size = sizeof(buffer)};
+		size_t remainingLength, packetSize;
+		uint16_t packetId = 30000 + qos;
+
+		MQTT_GetPublishPacketSize(&publishInfo, &remainingLength, &packetSize);
+		MQTT_SerializePublish(&publishInfo, packetId, remainingLength, &fixedBuffer);
+		RyanMqttPersistRecord_t record = {
+			.topic = RyanMqttPersistTestTopic,
+			.packet = buffer,
+			.packetLen = packetSize,
+			.packetId = packetId,
+			.topicLen = RyanMqttStrlen(RyanMqttPersistTestTopic),
+			.packetType = (RyanMqttQos1 == qos) ? MQTT_PACKET_TYPE_PUBACK : MQTT_PACKET_TYPE_PUBREC,
+			.qos = qos};
+		result = file.persist.put(file.persist.userData, &record);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+
+	// 模拟进程重启
+	platformPersistFileDestroy(&file);
+	result = platformPersistFileInit(&file, RyanMqttPersistTestPath, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && 2 == platformPersistFileGetCount(&file),
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	persistTestPublishedCount = 0;
+	result = RyanMqttPersistTestInit(&client, &file.persist);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(RyanMqttTrue == RyanMqttPersistTestWaitPublished(2, 5000), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 新的发布不能和恢复的packetId冲突
+	RyanMqttCheckCodeNoReturn(client->packetId >= 30000 + RyanMqttQos2, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// PUBCOMP 处理完成后记录才会删除
+	for (uint32_t i = 0; i < 100 && 0 != platformPersistFileGetCount(&file); i++)
+	{
+		delay(10);
+	}
+	RyanMqttCheckCodeNoReturn(0 == platformPersistFileGetCount(&file), RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformPersistFileDestroy(&file);
+	unlink(RyanMqttPersistTestPath);
+	return result;
+}
+
+/**
+ * @brief 连续发布qos1消息直到全部收到PUBACK
+ *
+ * @param persist
+ * @param pElapsedMs
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPersistTestPublish(RyanMqttPersist_t *persist, uint32_t *pElapsedMs)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+
+	persistTestPublishedCount = 0;
+	result = RyanMqttPersistTestInit(&client, persist);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	uint32_t startMs = platformUptimeMs();
+	for (uint32_t i = 0; i < RyanMqttPersistTestCount; i++)
+	{
+		result = RyanMqttPublish(client, RyanMqttPersistTestTopic, "persist", 7, RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+	RyanMqttCheckCodeNoReturn(RyanMqttTrue == RyanMqttPersistTestWaitPublished(RyanMqttPersistTestCount, 10000),
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+	*pElapsedMs = platformUptimeMs() - startMs;
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 持久化对qos1吞吐的影响，只打印耗时对比，受机器负载影响不作为测试结果
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPersistThroughputTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformPersistFile_t file;
+	uint32_t plainMs = 0;
+	uint32_t persistMs = 0;
+
+	unlink(RyanMqttPersistTestPath);
+	result = platformPersistFileInit(&file, RyanMqttPersistTestPath, 0);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	// 交替测试两次取较小值，减少网络抖动的影响
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		uint32_t elapsedMs = 0;
+
+		result = RyanMqttPersistTestPublish(NULL, &elapsedMs);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+		plainMs = (0 == i || elapsedMs < plainMs) ? elapsedMs : plainMs;
+
+		result = RyanMqttPersistTestPublish(&file.persist, &elapsedMs);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+		persistMs = (0 == i || elapsedMs < persistMs) ? elapsedMs : persistMs;
+	}
+
+	RyanMqttLog_raw("持久化性能: 不持久化 %d ms, 持久化 %d ms, 共 %d 条qos1消息\r\n", plainMs, persistMs,
+			RyanMqttPersistTestCount);
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	platformPersistFileDestroy(&file);
+	unlink(RyanMqttPersistTestPath);
+	return result;
+}
+
+RyanMqttError_e RyanMqttPersistTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	result = RyanMqttPersistJournalTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttPersistDelFailTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttPersistRestoreTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttPersistThroughputTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	checkMemory;
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
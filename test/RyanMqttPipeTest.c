@@ -0,0 +1,451 @@
+#include "RyanMqttTest.h"
+#include "RyanMqttPipe.h"
+
+#define RyanMqttPipeTestTopic    "testPipe/echo"
+#define RyanMqttPipeTestMaxDelay (10 * 1000)
+
+// 性能测试的qos1消息数
+#define RyanMqttPipeBenchCount (5000)
+
+// 内存管道另一端的最小broker，只回复ack并把所有publish以qos0回显给客户端
+typedef struct
+{
+	RyanMqttPipe_t *pipe;
+	pthread_t thread;
+	volatile RyanMqttBool_e runFlag;
+	volatile uint32_t acceptCount;
+	uint8_t packet[2048];
+} RyanMqttPipeBroker_t;
+
+static uint32_t pipeTestRecvCount = 0;
+
+static void RyanMqttPipeTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	RyanMqttTestEnableCritical();
+	pipeTestRecvCount++;
+	RyanMqttTestExitCritical();
+}
+
+static uint32_t RyanMqttPipeTestGetRecvCount(void)
+{
+	RyanMqttTestEnableCritical();
+	uint32_t count = pipeTestRecvCount;
+	RyanMqttTestExitCritical();
+	return count;
+}
+
+/**
+ * @brief broker读取指定长度的数据
+ *
+ * @param broker
+ * @param buf
+ * @param len
+ * @return RyanMqttError_e 连接断开或broker停止时返回失败
+ */
+static RyanMqttError_e RyanMqttPipeBrokerRead(RyanMqttPipeBroker_t *broker, uint8_t *buf, uint32_t len)
+{
+	uint32_t offset = 0;
+	while (offset < len)
+	{
+		int32_t recvLen = RyanMqttPipePeerRecv(broker->pipe, (char *)buf + offset, len - offset, 100);
+		if (recvLen < 0 || (0 == recvLen && RyanMqttFalse == broker->runFlag))
+		{
+			return RyanMqttFailedError;
+		}
+		offset += (uint32_t)recvLen;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+static RyanMqttError_e RyanMqttPipeBrokerWrite(RyanMqttPipeBroker_t *broker, uint8_t *buf, uint32_t len)
+{
+	uint32_t offset = 0;
+	while (offset < len)
+	{
+		int32_t sendLen = RyanMqttPipePeerSend(broker->pipe, (char *)buf + offset, len - offset, 100);
+		if (sendLen < 0 || (0 == sendLen && RyanMqttFalse == broker->runFlag))
+		{
+			return RyanMqttFailedError;
+		}
+		offset += (uint32_t)sendLen;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 读取并处理一个mqtt报文
+ *
+ * @param broker
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPipeBrokerHandle(RyanMqttPipeBroker_t *broker)
+{
+	uint8_t header;
+	uint8_t lenByte;
+	uint32_t remainLen = 0;
+	uint8_t *packet = broker->packet;
+	uint8_t ack[5];
+
+	RyanMqttCheck(RyanMqttSuccessError == RyanMqttPipeBrokerRead(broker, &header, 1), RyanMqttFailedError,
+		      RyanMqttLog_d);
+	for (uint32_t multiplier = 1; multiplier <= 128 * 128 * 128; multiplier *= 128)
+	{
+		RyanMqttCheck(RyanMqttSuccessError == RyanMqttPipeBrokerRead(broker, &lenByte, 1), RyanMqttFailedError,
+			      RyanMqttLog_d);
+		remainLen += (lenByte & 0x7FU) * multiplier;
+		if (0 == (lenByte & 0x80U))
+		{
+			break;
+		}
+	}
+	RyanMqttCheck(remainLen + 5 <= sizeof(broker->packet), RyanMqttFailedError, RyanMqttLog_e);
+	RyanMqttCheck(RyanMqttSuccessError == RyanMqttPipeBrokerRead(broker, packet, remainLen), RyanMqttFailedError,
+		      RyanMqttLog_d);
+
+	switch (header & 0xF0U)
+	{
+	case 0x10: // CONNECT
+		ack[0] = 0x20, ack[1] = 2, ack[2] = 0, ack[3] = 0;
+		return RyanMqttPipeBrokerWrite(broker, ack, 4);
+
+	case 0x80: // SUBSCRIBE，只支持一次订阅一个主题，授予请求的qos
+		ack[0] = 0x90, ack[1] = 3, ack[2] = packet[0], ack[3] = packet[1], ack[4] = packet[remainLen - 1];
+		return RyanMqttPipeBrokerWrite(broker, ack, 5);
+
+	case 0xA0: // UNSUBSCRIBE
+		ack[0] = 0xB0, ack[1] = 2, ack[2] = packet[0], ack[3] = packet[1];
+		return RyanMqttPipeBrokerWrite(broker, ack, 4);
+
+	case 0x60: // PUBREL
+		ack[0] = 0x70, ack[1] = 2, ack[2] = packet[0], ack[3] = packet[1];
+		return RyanMqttPipeBrokerWrite(broker, ack, 4);
+
+	case 0xC0: // PINGREQ
+		ack[0] = 0xD0, ack[1] = 0;
+		return RyanMqttPipeBrokerWrite(broker, ack, 2);
+
+	case 0xE0: // DISCONNECT
+		RyanMqttPipePeerClose(broker->pipe);
+		return RyanMqttFailedError;
+
+	case 0x30: // PUBLISH
+	{
+		uint8_t qos = (header >> 1) & 0x03U;
+		uint16_t topicLen = (uint16_t)((packet[0] << 8) | packet[1]);
+		uint32_t packetIdOffset = 2U + topicLen;
+
+		if (qos > 0)
+		{
+			ack[0] = (1 == qos) ? 0x40 : 0x50, ack[1] = 2;
+			ack[2] = packet[packetIdOffset], ack[3] = packet[packetIdOffset + 1];
+			RyanMqttCheck(RyanMqttSuccessError == RyanMqttPipeBrokerWrite(broker, ack, 4),
+				      RyanMqttFailedError, RyanMqttLog_d);
+
+			// 去掉报文标识符后以qos0回显
+			memmove(packet + packetIdOffset, packet + packetIdOffset + 2, remainLen - packetIdOffset - 2);
+			remainLen -= 2;
+		}
+
+		uint8_t echoHeader[5] = {0x30};
+		uint32_t echoHeaderLen = 1;
+		uint32_t len = remainLen;
+		do
+		{
+			echoHeader[echoHeaderLen] = len % 128;
+			len /= 128;
+			if (len > 0)
+			{
+				echoHeader[echoHeaderLen] |= 0x80U;
+			}
+			echoHeaderLen++;
+		} while (len > 0);
+
+		RyanMqttCheck(RyanMqttSuccessError == RyanMqttPipeBrokerWrite(broker, echoHeader, echoHeaderLen),
+			      RyanMqttFailedError, RyanMqttLog_d);
+		return RyanMqttPipeBrokerWrite(broker, packet, remainLen);
+	}
+
+	default: return RyanMqttSuccessError;
+	}
+}
+
+static void *RyanMqttPipeBrokerThread(void *arg)
+{
+	RyanMqttPipeBroker_t *broker = (RyanMqttPipeBroker_t *)arg;
+
+	while (RyanMqttTrue == broker->runFlag)
+	{
+		if (RyanMqttSuccessError != RyanMqttPipePeerAccept(broker->pipe, 100))
+		{
+			continue;
+		}
+
+		broker->acceptCount++;
+		while (RyanMqttSuccessError == RyanMqttPipeBrokerHandle(broker))
+		{
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief 初始化客户端并订阅回显主题
+ *
+ * @param client
+ * @param transport 为NULL时连接测试broker
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPipeTestInit(RyanMqttClient_t **client, RyanMqttTransport_t *transport)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = NULL == transport ? "RyanMqttPipeTcp" : "RyanMqttPipe",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = NULL == transport ? RyanMqttHost : "pipe",
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = 100,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = mqttEventBaseHandle,
+					     .userData = eventUserData,
+					     .socketOption = {.noDelayFlag = RyanMqttTrue},
+					     .transport = transport};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttPipeTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	uint16_t topicLen = RyanMqttStrlen(RyanMqttPipeTestTopic);
+	result = RyanMqttSubscribeWithMsgHandle(*client, RyanMqttPipeTestTopic, topicLen, RyanMqttQos0,
+						RyanMqttPipeTestMsgHandle, NULL);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	int32_t subscribeTotalCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttPipeTestMaxDelay && 1 != subscribeTotalCount; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttGetSubscribeTotalCount(*client, &subscribeTotalCount);
+	}
+	RyanMqttCheck(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	// 等待broker处理完订阅
+	delay(100);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 等待收到的回显消息达到指定个数
+ *
+ * @param expectCount
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPipeTestWaitRecv(uint32_t expectCount)
+{
+	for (uint32_t elapsed = 0; elapsed < RyanMqttPipeTestMaxDelay; elapsed++)
+	{
+		if (RyanMqttPipeTestGetRecvCount() >= expectCount)
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(1);
+	}
+
+	RyanMqttLog_e("收到 %u 条回显，期望 %u 条", RyanMqttPipeTestGetRecvCount(), expectCount);
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 连续发布qos1消息，统计全部收到ack和回显的耗时
+ *
+ * @param client
+ * @param costMs
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttPipeBench(RyanMqttClient_t *client, uint32_t *costMs)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t startCount = RyanMqttPipeTestGetRecvCount();
+	uint32_t startMs = platformUptimeMs();
+
+	for (uint32_t i = 0; i < RyanMqttPipeBenchCount; i++)
+	{
+		result = RyanMqttPublish(client, RyanMqttPipeTestTopic, "0123456789", 10, RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+	}
+
+	result = RyanMqttPipeTestWaitRecv(startCount + RyanMqttPipeBenchCount);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	while (0 != client->ackHandlerCount && platformUptimeMs() - startMs < RyanMqttPipeTestMaxDelay)
+	{
+		delay(1);
+	}
+	RyanMqttCheck(0 == client->ackHandlerCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	*costMs = platformUptimeMs() - startMs;
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttPipeTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttClient_t *tcpClient = NULL;
+	RyanMqttPipeBroker_t *broker = NULL;
+	uint32_t pipeCostMs = 0;
+	uint32_t tcpCostMs = 0;
+
+	pipeTestRecvCount = 0;
+
+	broker = (RyanMqttPipeBroker_t *)malloc(sizeof(RyanMqttPipeBroker_t));
+	RyanMqttCheck(NULL != broker, RyanMqttNotEnoughMemError, RyanMqttLog_e);
+	RyanMqttMemset(broker, 0, sizeof(RyanMqttPipeBroker_t));
+
+	result = RyanMqttPipeCreate(&broker->pipe, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, {
+		free(broker);
+		return result;
+	});
+
+	broker->runFlag = RyanMqttTrue;
+	pthread_create(&broker->thread, NULL, RyanMqttPipeBrokerThread, broker);
+
+	// 同一进程中的客户端分别使用内存管道和tcp
+	result = RyanMqttPipeTestInit(&client, RyanMqttPipeGetTransport(broker->pipe));
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttPipeTestInit(&tcpClient, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 两个客户端的订阅各自收到回显
+	for (uint8_t qos = RyanMqttQos0; qos <= RyanMqttQos2; qos++)
+	{
+		result = RyanMqttPublish(client, RyanMqttPipeTestTopic, "pipe", 4, (RyanMqttQos_e)qos, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+		result = RyanMqttPublish(tcpClient, RyanMqttPipeTestTopic, "tcp", 3, (RyanMqttQos_e)qos, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+	result = RyanMqttPipeTestWaitRecv(6);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 对端断开后客户端自动重连
+	RyanMqttPipePeerClose(broker->pipe);
+	for (uint32_t elapsed = 0; elapsed < RyanMqttPipeTestMaxDelay && broker->acceptCount < 2; elapsed += 10)
+	{
+		delay(10);
+	}
+	RyanMqttCheckCodeNoReturn(broker->acceptCount >= 2, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	for (uint32_t elapsed = 0; elapsed < RyanMqttPipeTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(client))
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState == RyanMqttGetState(client), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// cleanSession 重连后订阅已被清除，重新订阅
+	int32_t subscribeTotalCount = 0;
+	result = RyanMqttSubscribeWithMsgHandle(client, RyanMqttPipeTestTopic, RyanMqttStrlen(RyanMqttPipeTestTopic),
+						RyanMqttQos0, RyanMqttPipeTestMsgHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	for (uint32_t elapsed = 0; elapsed < RyanMqttPipeTestMaxDelay && 1 != subscribeTotalCount; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttGetSubscribeTotalCount(client, &subscribeTotalCount);
+	}
+	RyanMqttCheckCodeNoReturn(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// tcp客户端断开，避免broker把内存管道客户端的性能测试消息也计入
+	RyanMqttTestDestroyClient(tcpClient);
+	tcpClient = NULL;
+
+	result = RyanMqttPipeBench(client, &pipeCostMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	RyanMqttTestDestroyClient(client);
+	client = NULL;
+
+	result = RyanMqttPipeTestInit(&tcpClient, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttPipeBench(tcpClient, &tcpCostMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttLog_raw("%d条qos1发布及回显: 内存管道 %u ms, tcp %u ms\r\n", RyanMqttPipeBenchCount, pipeCostMs,
+			tcpCostMs);
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	if (NULL != tcpClient)
+	{
+		RyanMqttTestDestroyClient(tcpClient);
+	}
+
+	broker->runFlag = RyanMqttFalse;
+	pthread_join(broker->thread, NULL);
+	RyanMqttPipeDestroy(broker->pipe);
+	free(broker);
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
@@ -58,6 +58,67 @@ static RyanMqttError_e RyanMqttBaseApiParamCheckTest(void)
 	result = RyanMqttGetKeepAliveRemain(validClient, NULL);
 	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
 
+	uint32_t dispatchDropCount;
+	// NULL客户端指针
+	result = RyanMqttGetDispatchDropCount(NULL, &dispatchDropCount);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL丢弃计数指针
+	result = RyanMqttGetDispatchDropCount(validClient, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL客户端指针
+	result = RyanMqttStep(NULL, RyanMqttFalse, RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 没有使能单步模式
+	result = RyanMqttStep(validClient, RyanMqttFalse, RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttFailedError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	int32_t fd;
+	// NULL客户端指针
+	result = RyanMqttGetFd(NULL, &fd);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL描述符指针
+	result = RyanMqttGetFd(validClient, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	uint32_t nextTimeoutMs;
+	// NULL客户端指针
+	result = RyanMqttGetNextTimeoutMs(NULL, &nextTimeoutMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL超时时间指针
+	result = RyanMqttGetNextTimeoutMs(validClient, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttMsgData_t recvMsgData = {0};
+	int32_t recvCount;
+	// NULL客户端指针
+	result = RyanMqttRecvMessage(NULL, &recvMsgData, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL消息指针
+	result = RyanMqttRecvMessages(validClient, NULL, 1, &recvCount, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 无效的读取数量
+	result = RyanMqttRecvMessages(validClient, &recvMsgData, 0, &recvCount, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL读取数量指针
+	result = RyanMqttRecvMessages(validClient, &recvMsgData, 1, NULL, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 没有使能拉取模式
+	result = RyanMqttRecvMessage(validClient, &recvMsgData, 0);
+	RyanMqttCheckCodeNoReturn(RyanMqttFailedError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 没有接收缓冲区的消息
+	result = RyanMqttReleaseMessage(&recvMsgData);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
 	// NULL客户端指针
 	result = RyanMqttDiscardAckHandler(NULL, MQTT_PACKET_TYPE_PUBACK, 1);
 	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
@@ -411,6 +472,14 @@ static RyanMqttError_e RyanMqttSubApiParamCheckTest(void)
 	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e,
 				  { goto __exit; }); // 清理资源
 
+	// NULL客户端指针
+	result = RyanMqttIterateSubscribe(NULL, NULL, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// NULL遍历回调
+	result = RyanMqttIterateSubscribe(validClient, NULL, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, result, RyanMqttLog_e, { goto __exit; });
+
 	/**
 	 * @brief
 	 *
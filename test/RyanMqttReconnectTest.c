@@ -1,5 +1,7 @@
 #include "RyanMqttTest.h"
 
+#define RyanMqttFirstReconnectClientCount (8) // 同时断开的客户端个数
+
 // todo 增加在回调函数里面调用重连函数的测试，应该会失败
 static RyanMqttBool_e reconnectCheckMqttConnectState(RyanMqttClient_t *client)
 {
@@ -38,14 +40,18 @@ static RyanMqttError_e autoReconnectTest(uint32_t count, uint32_t delayms)
 		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
 					  { goto __exit; });
 
-		// 应该失败
-		result = RyanMqttReconnect(client);
-		RyanMqttCheckCodeNoReturn(RyanMqttNoRescourceError == result, RyanMqttFailedError, RyanMqttLog_e, {
-			result = RyanMqttFailedError;
-			goto __exit;
-		});
-
-		RyanMqttLog_i("mqtt自动重连测试，将在 %dms 后重新连接", client->config.reconnectTimeout);
+		// 奇数次等待自动重连，偶数次调用 RyanMqttReconnect 跳过重连等待
+		uint32_t startMs = platformUptimeMs();
+		if (i % 2 == 0)
+		{
+			result = RyanMqttReconnect(client);
+			RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+						  { goto __exit; });
+		}
+		else
+		{
+			RyanMqttLog_i("mqtt自动重连测试，将在 %dms 后重新连接", client->config.reconnectTimeout);
+		}
 
 		RyanMqttCheckCodeNoReturn(RyanMqttTrue == reconnectCheckMqttConnectState(client), RyanMqttFailedError,
 					  RyanMqttLog_e, {
@@ -53,6 +59,13 @@ static RyanMqttError_e autoReconnectTest(uint32_t count, uint32_t delayms)
 						  goto __exit;
 					  });
 
+		if (i % 2 == 0 && platformUptimeMs() - startMs >= client->config.reconnectTimeout)
+		{
+			RyanMqttLog_e("RyanMqttReconnect 没有打断重连等待, 耗时: %d ms", platformUptimeMs() - startMs);
+			result = RyanMqttFailedError;
+			goto __exit;
+		}
+
 		if (delayms)
 		{
 			delay(delayms);
@@ -87,11 +100,6 @@ static RyanMqttError_e manualReconnectTest(uint32_t count, uint32_t delayms)
 		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
 					  { goto __exit; });
 
-		// todo
-		// 这里可能还没有调度mqtt线程就更新状态了,目前通过延时强制等待mqtt线程调度完成
-		// 这里可以使用信号量也通知应用层，但又要增加plarform移植难度和内存占用
-		delay(20);
-
 		// 应该成功
 		result = RyanMqttReconnect(client);
 		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
@@ -119,10 +127,288 @@ __exit:
 	return result;
 }
 
+/**
+ * @brief 断线重连时复用缓存的connect报文，修改遗嘱后重新序列化
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e connectPacketCacheTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	uint8_t *connectPacket;
+	result = RyanMqttTestInit(&client, RyanMqttTrue, RyanMqttFalse, 120, NULL, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	connectPacket = client->connectPacket;
+	RyanMqttCheckCodeNoReturn(NULL != connectPacket, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		result = RyanMqttDisconnect(client, RyanMqttTrue);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+
+		// 修改遗嘱后缓存失效
+		if (i % 2 == 1)
+		{
+			result = RyanMqttSetLwt(client, "pub/lwt/test", "lwt", RyanMqttStrlen("lwt"), RyanMqttQos1,
+						RyanMqttFalse);
+			RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+						  { goto __exit; });
+			RyanMqttCheckCodeNoReturn(NULL == client->connectPacket, RyanMqttFailedError, RyanMqttLog_e, {
+				result = RyanMqttFailedError;
+				goto __exit;
+			});
+		}
+
+		result = RyanMqttReconnect(client);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+		RyanMqttCheckCodeNoReturn(RyanMqttTrue == reconnectCheckMqttConnectState(client), RyanMqttFailedError,
+					  RyanMqttLog_e, {
+						  result = RyanMqttFailedError;
+						  goto __exit;
+					  });
+
+		// 没有修改遗嘱时发送的是同一个缓存报文
+		if (i % 2 == 0 && connectPacket != client->connectPacket)
+		{
+			RyanMqttLog_e("断线重连时重新序列化了connect报文");
+			result = RyanMqttFailedError;
+			goto __exit;
+		}
+		connectPacket = client->connectPacket;
+	}
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	if (client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 单步模式下连接一个拒绝连接的端口，检查每次重连的等待时间不超过退避上限并且带有随机抖动
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e backoffReconnectTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	uint32_t ceiling = 100;
+	uint32_t lastTimeout = 0;
+	uint32_t diffCount = 0;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttBackoffTest",
+					     .host = "127.0.0.1",
+					     .port = 1, // 没有服务监听，连接立即被拒绝
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .stepModeFlag = RyanMqttTrue,
+					     .reconnectTimeout = 100,
+					     .reconnectMaxTimeout = 1600,
+					     .reconnectMultiplier = 2,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120};
+
+	result = RyanMqttInit(&client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(client, &mqttConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	// 最大间隔小于最小间隔时应该失败
+	mqttConfig.reconnectMaxTimeout = 50;
+	result = RyanMqttSetConfig(client, &mqttConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttParamInvalidError == result, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttStart(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	// 开始状态直接连接
+	RyanMqttStep(client, RyanMqttFalse, RyanMqttFalse);
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		uint32_t timeoutMs = 0;
+		RyanMqttCheckCodeNoReturn(RyanMqttDisconnectState == RyanMqttGetState(client), RyanMqttFailedError,
+					  RyanMqttLog_e, {
+						  result = RyanMqttFailedError;
+						  goto __exit;
+					  });
+
+		// 每次重连前退避上限先翻倍，第一次重连的上限是 200 ms
+		ceiling = (ceiling * 2 > 1600) ? 1600 : ceiling * 2;
+		RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+		if (timeoutMs > ceiling)
+		{
+			RyanMqttLog_e("第%d次重连等待 %d ms, 超过退避上限 %d ms", i, timeoutMs, ceiling);
+			result = RyanMqttFailedError;
+			goto __exit;
+		}
+
+		// 等待时间不应该小于 reconnectTimeout，留出step执行的耗时
+		if (timeoutMs + 20 < 100)
+		{
+			RyanMqttLog_e("第%d次重连等待 %d ms, 小于最小重连间隔 100 ms", i, timeoutMs);
+			result = RyanMqttFailedError;
+			goto __exit;
+		}
+
+		if (timeoutMs != lastTimeout)
+		{
+			diffCount++;
+		}
+		lastTimeout = timeoutMs;
+
+		// 跳过退避等待，请求重连后应该立即执行
+		result = RyanMqttReconnect(client);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+		RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+		RyanMqttCheckCodeNoReturn(0 == timeoutMs, RyanMqttFailedError, RyanMqttLog_e, {
+			result = RyanMqttFailedError;
+			goto __exit;
+		});
+
+		RyanMqttStep(client, RyanMqttFalse, RyanMqttFalse); // 切换到重连状态
+		RyanMqttStep(client, RyanMqttFalse, RyanMqttFalse); // 连接失败
+	}
+
+	// 等待时间应该是随机的
+	RyanMqttCheckCodeNoReturn(diffCount > 8, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	if (client)
+	{
+		// 单步模式下 RyanMqttDestroy 直接在当前线程释放资源
+		RyanMqttDestroy(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 多个客户端同时断开，第一次重连的等待时间也应该是随机的，不会一起重连
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e firstReconnectJitterTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *clientArr[RyanMqttFirstReconnectClientCount] = {0};
+	uint32_t minTimeout = UINT32_MAX;
+	uint32_t maxTimeout = 0;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttFirstReconnectTest",
+					     .host = "127.0.0.1",
+					     .port = 1, // 没有服务监听，连接立即被拒绝
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .stepModeFlag = RyanMqttTrue,
+					     .reconnectTimeout = 100,
+					     .reconnectMaxTimeout = 1600,
+					     .reconnectMultiplier = 2,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120};
+
+	for (uint32_t i = 0; i < RyanMqttFirstReconnectClientCount; i++)
+	{
+		result = RyanMqttInit(&clientArr[i]);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+
+		result = RyanMqttSetConfig(clientArr[i], &mqttConfig);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+
+		result = RyanMqttStart(clientArr[i]);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	// 所有客户端同时连接失败，记录各自第一次重连的等待时间
+	for (uint32_t i = 0; i < RyanMqttFirstReconnectClientCount; i++)
+	{
+		RyanMqttStep(clientArr[i], RyanMqttFalse, RyanMqttFalse);
+	}
+
+	for (uint32_t i = 0; i < RyanMqttFirstReconnectClientCount; i++)
+	{
+		uint32_t timeoutMs = 0;
+		RyanMqttGetNextTimeoutMs(clientArr[i], &timeoutMs);
+		if (timeoutMs > 200)
+		{
+			RyanMqttLog_e("第一次重连等待 %d ms, 超过退避上限 200 ms", timeoutMs);
+			result = RyanMqttFailedError;
+			goto __exit;
+		}
+
+		minTimeout = (timeoutMs < minTimeout) ? timeoutMs : minTimeout;
+		maxTimeout = (timeoutMs > maxTimeout) ? timeoutMs : maxTimeout;
+	}
+
+	// 8个客户端在 100 ms 的范围内随机，全部挤在 20 ms 以内的概率可以忽略
+	RyanMqttLog_raw("第一次重连等待时间: 最短 %u ms, 最长 %u ms\r\n", minTimeout, maxTimeout);
+	RyanMqttCheckCodeNoReturn(maxTimeout - minTimeout > 20, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	for (uint32_t i = 0; i < RyanMqttFirstReconnectClientCount; i++)
+	{
+		if (NULL != clientArr[i])
+		{
+			RyanMqttDestroy(clientArr[i]);
+		}
+	}
+	return result;
+}
+
 RyanMqttError_e RyanMqttReconnectTest(void)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
 
+	result = backoffReconnectTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = firstReconnectJitterTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = connectPacketCacheTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
 	result = autoReconnectTest(3, 2);
 	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
 
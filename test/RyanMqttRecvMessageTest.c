@@ -0,0 +1,383 @@
+#include "RyanMqttTest.h"
+
+#define RyanMqttRecvTestTopic      "testPull/"
+#define RyanMqttRecvTestTopicAll   "testPull/#"
+#define RyanMqttRecvTestCount      (20)
+#define RyanMqttRecvTestQueueSize  (4)
+#define RyanMqttRecvTestBatchCount (3)
+#define RyanMqttRecvTestMaxDelayMs (10 * 1000)
+
+static uint32_t recvTestDataEventCount = 0;
+
+static void RyanMqttRecvTestEventHandle(void *pclient, RyanMqttEventId_e event, const void *eventData)
+{
+	switch (event)
+	{
+	// 拉取模式下没有消息回调的订阅不应再触发数据事件
+	case RyanMqttEventData:
+		RyanMqttTestEnableCritical();
+		recvTestDataEventCount++;
+		RyanMqttTestExitCritical();
+		break;
+
+	default: mqttEventBaseHandle(pclient, event, eventData); break;
+	}
+}
+
+/**
+ * @brief 使能拉取模式的客户端初始化
+ *
+ * @param client
+ * @param recvQueueSize
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttRecvTestInit(RyanMqttClient_t **client, uint16_t recvQueueSize)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttRecvTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = RyanMqttHost,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .recvQueueSize = recvQueueSize,
+					     .mqttEventHandle = RyanMqttRecvTestEventHandle,
+					     .userData = eventUserData};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+	RyanMqttCheck(NULL != (*client)->recvRing, RyanMqttFailedError, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < 30000; elapsed += 100)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			break;
+		}
+		delay(100);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	// 不注册消息回调，消息进入拉取队列
+	result = RyanMqttSubscribe(*client, RyanMqttRecvTestTopicAll, RyanMqttQos1);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	int32_t subscribeTotalCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttRecvTestMaxDelayMs; elapsed += 10)
+	{
+		RyanMqttGetSubscribeTotalCount(*client, &subscribeTotalCount);
+		if (1 == subscribeTotalCount)
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 检查拉取到的消息，payload为十进制序号，必须按发布顺序到达
+ *
+ * @param msgData
+ * @param nextSeq
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttRecvTestCheckMsg(RyanMqttMsgData_t *msgData, uint32_t *nextSeq)
+{
+	char payload[16] = {0};
+
+	RyanMqttCheck(NULL != msgData->packetBuf, RyanMqttFailedError, RyanMqttLog_e);
+	RyanMqttCheck(msgData->payloadLen < sizeof(payload), RyanMqttFailedError, RyanMqttLog_e);
+	RyanMqttCheck(0 == RyanMqttStrncmp(msgData->topic, RyanMqttRecvTestTopic,
+					   RyanMqttStrlen(RyanMqttRecvTestTopic)),
+		      RyanMqttFailedError, RyanMqttLog_e);
+
+	// payload没有结束符
+	RyanMqttMemcpy(payload, msgData->payload, msgData->payloadLen);
+	if ((uint32_t)atoi(payload) != *nextSeq)
+	{
+		RyanMqttLog_e("拉取消息顺序异常 expect: %u, payload: %s", *nextSeq, payload);
+		return RyanMqttFailedError;
+	}
+
+	(*nextSeq)++;
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 小队列 + 延迟读取，验证队列满时不丢消息、单条和批量读取以及空队列超时
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttRecvQueueTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttMsgData_t msgDatas[RyanMqttRecvTestBatchCount];
+	char topic[64];
+	char payload[16];
+	uint32_t nextSeq = 0;
+	int32_t count = 0;
+
+	recvTestDataEventCount = 0;
+	result = RyanMqttRecvTestInit(&client, RyanMqttRecvTestQueueSize);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	for (int32_t i = 0; i < RyanMqttRecvTestCount; i++)
+	{
+		RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttRecvTestTopic, (int)(i % 3));
+		RyanMqttSnprintf(payload, sizeof(payload), "%d", (int)i);
+		result = RyanMqttPublish(client, topic, payload, RyanMqttStrlen(payload), RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	// 暂不读取，让接收队列被填满
+	delay(1000);
+
+	// 单条读取
+	for (int32_t i = 0; i < RyanMqttRecvTestQueueSize; i++)
+	{
+		result = RyanMqttRecvMessage(client, &msgDatas[0], RyanMqttRecvTestMaxDelayMs);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+
+		result = RyanMqttRecvTestCheckMsg(&msgDatas[0], &nextSeq);
+		RyanMqttReleaseMessage(&msgDatas[0]);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	// 批量读取剩余消息
+	while (nextSeq < RyanMqttRecvTestCount)
+	{
+		result = RyanMqttRecvMessages(client, msgDatas, RyanMqttRecvTestBatchCount, &count,
+					      RyanMqttRecvTestMaxDelayMs);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+
+		for (int32_t i = 0; i < count; i++)
+		{
+			if (RyanMqttSuccessError == result)
+			{
+				result = RyanMqttRecvTestCheckMsg(&msgDatas[i], &nextSeq);
+			}
+			RyanMqttReleaseMessage(&msgDatas[i]);
+		}
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	// 队列为空时超时返回
+	result = RyanMqttRecvMessage(client, &msgDatas[0], 100);
+	RyanMqttCheckCodeNoReturn(RyanMqttRecvPacketTimeOutError == result, RyanMqttFailedError, RyanMqttLog_e, {
+		RyanMqttReleaseMessage(&msgDatas[0]);
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	if (0 != recvTestDataEventCount)
+	{
+		RyanMqttLog_e("拉取模式下触发了 %u 次数据事件", recvTestDataEventCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	result = RyanMqttUnSubscribe(client, RyanMqttRecvTestTopicAll);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = checkAckList(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 队列中还有未读取的消息时销毁客户端，未读取的消息随客户端一起释放
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttRecvDestroyTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttMsgData_t msgData;
+	char topic[64];
+
+	result = RyanMqttRecvTestInit(&client, RyanMqttRecvTestQueueSize);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	for (int32_t i = 0; i < RyanMqttRecvTestQueueSize * 2; i++)
+	{
+		RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttRecvTestTopic, (int)i);
+		result = RyanMqttPublish(client, topic, "pull", RyanMqttStrlen("pull"), RyanMqttQos0, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	// 读取一条后不释放，销毁客户端后再释放
+	result = RyanMqttRecvMessage(client, &msgData, RyanMqttRecvTestMaxDelayMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	delay(500);
+
+	RyanMqttTestDestroyClient(client);
+	client = NULL;
+	RyanMqttReleaseMessage(&msgData);
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+// 阻塞在空队列上的读取线程
+typedef struct
+{
+	RyanMqttClient_t *client;
+	RyanMqttError_e result; // 读取的返回值
+	uint32_t returnTime;    // 读取返回的时间
+	volatile int doneFlag;  // 读取已经返回
+} RyanMqttRecvBlockedReader_t;
+
+static void *RyanMqttRecvBlockedReaderThread(void *arg)
+{
+	RyanMqttRecvBlockedReader_t *reader = (RyanMqttRecvBlockedReader_t *)arg;
+	RyanMqttMsgData_t msgData;
+
+	reader->result = RyanMqttRecvMessage(reader->client, &msgData, RyanMqttRecvTestMaxDelayMs * 3);
+	if (RyanMqttSuccessError == reader->result)
+	{
+		RyanMqttReleaseMessage(&msgData);
+	}
+	reader->returnTime = platformUptimeMs();
+	reader->doneFlag = 1;
+	return NULL;
+}
+
+/**
+ * @brief 用户线程阻塞在空队列上时销毁客户端，读取线程被唤醒并返回错误，不会访问已经释放的队列
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttRecvBlockedDestroyTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttRecvBlockedReader_t readers[3] = {0};
+	pthread_t threads[3];
+	int32_t threadCount = 0;
+
+	result = RyanMqttRecvTestInit(&client, RyanMqttRecvTestQueueSize);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	for (; threadCount < 3; threadCount++)
+	{
+		RyanMqttRecvBlockedReader_t *reader = &readers[threadCount];
+		reader->client = client;
+		int createResult = pthread_create(&threads[threadCount], NULL, RyanMqttRecvBlockedReaderThread, reader);
+		RyanMqttCheckCodeNoReturn(0 == createResult, RyanMqttFailedError, RyanMqttLog_e, {
+						  result = RyanMqttFailedError;
+						  goto __exit;
+					  });
+	}
+
+	// 等读取线程都进入等待
+	delay(200);
+	uint32_t destroyTime = platformUptimeMs();
+	RyanMqttTestDestroyClient(client);
+	client = NULL;
+
+	for (int32_t i = 0; i < threadCount; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	threadCount = 0;
+
+	for (int32_t i = 0; i < 3; i++)
+	{
+		RyanMqttLog_raw("读取线程%d 返回: %d, 销毁后 %u ms\r\n", (int)i, readers[i].result,
+				readers[i].returnTime - destroyTime);
+		RyanMqttCheckCodeNoReturn(1 == readers[i].doneFlag && RyanMqttFailedError == readers[i].result &&
+						  readers[i].returnTime - destroyTime < RyanMqttRecvTestMaxDelayMs,
+					  RyanMqttFailedError, RyanMqttLog_e, {
+						  result = RyanMqttFailedError;
+						  goto __exit;
+					  });
+	}
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	for (int32_t i = 0; i < threadCount; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	return result;
+}
+
+RyanMqttError_e RyanMqttRecvMessageTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	result = RyanMqttRecvQueueTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttRecvDestroyTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttRecvBlockedDestroyTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
@@ -0,0 +1,431 @@
+#include "RyanMqttTest.h"
+#include "RyanMqttShard.h"
+
+#define RyanMqttShardTestTopic      "testShard/"
+#define RyanMqttShardTestTopicAll   "testShard/#"
+#define RyanMqttShardTestMaxDelayMs (10 * 1000)
+
+// 保序测试使用的主题个数和每个主题的消息数
+#define RyanMqttShardTestTopicCount (8)
+#define RyanMqttShardTestMsgCount   (25)
+
+// 性能测试使用的发布线程数和每个线程发布的qos1消息数
+#define RyanMqttShardBenchTopic       "benchShard/"
+#define RyanMqttShardBenchThreadCount (4)
+#define RyanMqttShardBenchMsgCount    (2000)
+
+static uint32_t shardTestRecvCount = 0;
+static uint32_t shardTestOrderErrorCount = 0;
+static uint32_t shardTestNextSeq[RyanMqttShardTestTopicCount];
+
+struct RyanMqttShardBenchThread
+{
+	pthread_t threadId;
+	RyanMqttShardClient_t *shard;
+	uint32_t index;
+	uint32_t failCount;
+};
+
+/**
+ * @brief 创建分片客户端并等待所有连接成功，所有连接共享一个事件userData
+ *
+ * @param pShard
+ * @param shardCount
+ * @param route
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttShardTestInit(RyanMqttShardClient_t **pShard, uint32_t shardCount,
+					     RyanMqttShardRoute_e route)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttShardTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = RyanMqttHost,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = mqttEventBaseHandle,
+					     .userData = eventUserData};
+
+	result = RyanMqttShardInit(pShard, shardCount, route);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, {
+		sem_destroy(&eventUserData->sem);
+		free(eventUserData);
+		return result;
+	});
+
+	RyanMqttShardRegisterEventId(*pShard, RyanMqttEventAnyId);
+
+	result = RyanMqttShardSetConfig(*pShard, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttShardStart(*pShard);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttShardTestMaxDelayMs; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttShardGetState(*pShard))
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(10);
+	}
+
+	RyanMqttLog_e("分片客户端连接超时");
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 销毁分片客户端，等待每个连接的销毁事件后释放共享的userData
+ *
+ * @param shard
+ */
+static void RyanMqttShardTestDestroy(RyanMqttShardClient_t *shard)
+{
+	RyanMqttClient_t *client = NULL;
+	uint32_t shardCount = shard->shardCount;
+
+	RyanMqttShardGetClient(shard, 0, &client);
+	struct RyanMqttTestEventUserData *eventUserData = (struct RyanMqttTestEventUserData *)client->config.userData;
+
+	for (uint32_t i = 0; i < shardCount; i++)
+	{
+		RyanMqttShardGetClient(shard, i, &client);
+		RyanMqttDisconnect(client, RyanMqttTrue);
+	}
+
+	RyanMqttShardDestroy(shard);
+	for (uint32_t i = 0; i < shardCount; i++)
+	{
+		sem_wait(&eventUserData->sem);
+	}
+	sem_destroy(&eventUserData->sem);
+
+	delay(20); // 等待mqtt线程回收资源
+	free(eventUserData);
+}
+
+/**
+ * @brief 等待所有连接的qos1消息收到ack
+ *
+ * @param shard
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttShardTestWaitAck(RyanMqttShardClient_t *shard)
+{
+	RyanMqttShardStatistics_t statistics;
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttShardTestMaxDelayMs * 3; elapsed++)
+	{
+		RyanMqttShardGetStatistics(shard, &statistics);
+		if (0 == statistics.ackHandlerCount)
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(1);
+	}
+
+	RyanMqttLog_e("等待ack超时, 剩余: %u", statistics.ackHandlerCount);
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 解析十进制数字，topic和payload没有结束符，不能直接使用atoi
+ *
+ * @param str
+ * @param len
+ * @return uint32_t
+ */
+static uint32_t RyanMqttShardTestParseNum(const char *str, uint32_t len)
+{
+	uint32_t num = 0;
+
+	for (uint32_t i = 0; i < len && str[i] >= '0' && str[i] <= '9'; i++)
+	{
+		num = num * 10 + (uint32_t)(str[i] - '0');
+	}
+
+	return num;
+}
+
+/**
+ * @brief 接收端在mqtt线程中按顺序回调，主题和payload都是十进制数字，同一主题的序号必须连续递增
+ *
+ * @param pclient
+ * @param msgData
+ * @param userData
+ */
+static void RyanMqttShardTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	uint32_t prefixLen = RyanMqttStrlen(RyanMqttShardTestTopic);
+	uint32_t index = RyanMqttShardTestParseNum(msgData->topic + prefixLen, msgData->topicLen - prefixLen);
+	uint32_t seq = RyanMqttShardTestParseNum(msgData->payload, msgData->payloadLen);
+
+	RyanMqttTestEnableCritical();
+	if (index >= RyanMqttShardTestTopicCount || seq != shardTestNextSeq[index])
+	{
+		shardTestOrderErrorCount++;
+	}
+	else
+	{
+		shardTestNextSeq[index] = seq + 1;
+	}
+	shardTestRecvCount++;
+	RyanMqttTestExitCritical();
+}
+
+/**
+ * @brief 按主题哈希发布时，同一主题的消息经过同一个连接，接收端看到的顺序与发布顺序一致
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttShardOrderTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttShardClient_t *shard = NULL;
+	RyanMqttClient_t *receiver = NULL;
+	RyanMqttShardStatistics_t statistics;
+	uint32_t totalCount = RyanMqttShardTestTopicCount * RyanMqttShardTestMsgCount;
+	char topic[64];
+	char payload[16];
+
+	shardTestRecvCount = 0;
+	shardTestOrderErrorCount = 0;
+	RyanMqttMemset(shardTestNextSeq, 0, sizeof(shardTestNextSeq));
+
+	result = RyanMqttTestInit(&receiver, RyanMqttTrue, RyanMqttTrue, 120, NULL, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttSubscribeWithMsgHandle(receiver, RyanMqttShardTestTopicAll,
+						RyanMqttStrlen(RyanMqttShardTestTopicAll), RyanMqttQos1,
+						RyanMqttShardTestMsgHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	delay(200);
+
+	result = RyanMqttShardTestInit(&shard, 4, RyanMqttShardRouteTopicHash);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 不同主题交替发布，分布到不同的连接上
+	for (uint32_t seq = 0; seq < RyanMqttShardTestMsgCount; seq++)
+	{
+		for (uint32_t index = 0; index < RyanMqttShardTestTopicCount; index++)
+		{
+			RyanMqttSnprintf(topic, sizeof(topic), "%s%u", RyanMqttShardTestTopic, index);
+			int32_t payloadLen = RyanMqttSnprintf(payload, sizeof(payload), "%u", seq);
+			result = RyanMqttShardPublish(shard, topic, payload, payloadLen, RyanMqttQos1, RyanMqttFalse);
+			if (RyanMqttSuccessError != result)
+			{
+				RyanMqttLog_e("分片发布失败 result: %d", result);
+				goto __exit;
+			}
+		}
+	}
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttShardTestMaxDelayMs && shardTestRecvCount < totalCount;
+	     elapsed += 10)
+	{
+		delay(10);
+	}
+
+	RyanMqttShardGetStatistics(shard, &statistics);
+	RyanMqttCheckCodeNoReturn(totalCount == shardTestRecvCount && 0 == shardTestOrderErrorCount &&
+					  totalCount == statistics.publishCount && 4 == statistics.shardCount &&
+					  4 == statistics.connectedCount,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  RyanMqttLog_e("recv: %u, orderError: %u, publish: %u, connected: %u",
+							shardTestRecvCount, shardTestOrderErrorCount,
+							statistics.publishCount, statistics.connectedCount);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttShardTestWaitAck(shard);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != shard)
+	{
+		RyanMqttShardTestDestroy(shard);
+	}
+	if (NULL != receiver)
+	{
+		RyanMqttTestDestroyClient(receiver);
+	}
+	return result;
+}
+
+/**
+ * @brief 订阅和取消订阅只发送到主题过滤器哈希对应的一个连接
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttShardSubscribeTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttShardClient_t *shard = NULL;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttShardStatistics_t statistics;
+	uint32_t index = 0;
+	int32_t subscribeCount = 0;
+	char *topic = RyanMqttShardTestTopic "sub/#";
+
+	result = RyanMqttShardTestInit(&shard, 3, RyanMqttShardRouteRoundRobin);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttShardSubscribe(shard, topic, RyanMqttQos1);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttShardGetIndex(shard, topic, RyanMqttStrlen(topic), &index);
+	RyanMqttShardGetClient(shard, index, &client);
+	for (uint32_t elapsed = 0; elapsed < RyanMqttShardTestMaxDelayMs && 1 != subscribeCount; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttGetSubscribeTotalCount(client, &subscribeCount);
+	}
+
+	RyanMqttShardGetStatistics(shard, &statistics);
+	RyanMqttCheckCodeNoReturn(1 == subscribeCount && 1 == statistics.subscribeCount, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttShardUnSubscribe(shard, topic);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	for (uint32_t elapsed = 0; elapsed < RyanMqttShardTestMaxDelayMs && 0 != subscribeCount; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttGetSubscribeTotalCount(client, &subscribeCount);
+	}
+	RyanMqttCheckCodeNoReturn(0 == subscribeCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+__exit:
+	if (NULL != shard)
+	{
+		RyanMqttShardTestDestroy(shard);
+	}
+	return result;
+}
+
+static void *RyanMqttShardBenchPublishThread(void *argument)
+{
+	struct RyanMqttShardBenchThread *benchThread = (struct RyanMqttShardBenchThread *)argument;
+	char topic[64];
+	char payload[16];
+
+	RyanMqttSnprintf(topic, sizeof(topic), "%s%u", RyanMqttShardBenchTopic, benchThread->index);
+	for (uint32_t seq = 0; seq < RyanMqttShardBenchMsgCount; seq++)
+	{
+		int32_t payloadLen = RyanMqttSnprintf(payload, sizeof(payload), "%u", seq);
+		if (RyanMqttSuccessError !=
+		    RyanMqttShardPublish(benchThread->shard, topic, payload, payloadLen, RyanMqttQos1, RyanMqttFalse))
+		{
+			benchThread->failCount++;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief 多个线程轮询发布qos1消息，统计不同连接数下全部收到ack的耗时
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttShardBenchTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t shardCounts[] = {1, 2, 4, 8};
+	uint32_t elapsedMs[getArraySize(shardCounts)];
+	struct RyanMqttShardBenchThread benchThreads[RyanMqttShardBenchThreadCount];
+
+	for (int32_t n = 0; n < getArraySize(shardCounts); n++)
+	{
+		RyanMqttShardClient_t *shard = NULL;
+		uint32_t failCount = 0;
+
+		result = RyanMqttShardTestInit(&shard, shardCounts[n], RyanMqttShardRouteRoundRobin);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, {
+			if (NULL != shard)
+			{
+				RyanMqttShardTestDestroy(shard);
+			}
+			return result;
+		});
+
+		uint32_t startMs = platformUptimeMs();
+		for (uint32_t i = 0; i < RyanMqttShardBenchThreadCount; i++)
+		{
+			benchThreads[i].shard = shard;
+			benchThreads[i].index = i;
+			benchThreads[i].failCount = 0;
+			struct RyanMqttShardBenchThread *benchThread = &benchThreads[i];
+			pthread_create(&benchThread->threadId, NULL, RyanMqttShardBenchPublishThread, benchThread);
+		}
+
+		for (uint32_t i = 0; i < RyanMqttShardBenchThreadCount; i++)
+		{
+			pthread_join(benchThreads[i].threadId, NULL);
+			failCount += benchThreads[i].failCount;
+		}
+
+		result = RyanMqttShardTestWaitAck(shard);
+		elapsedMs[n] = platformUptimeMs() - startMs;
+		RyanMqttShardTestDestroy(shard);
+
+		RyanMqttCheck(RyanMqttSuccessError == result && 0 == failCount, RyanMqttFailedError, RyanMqttLog_e);
+	}
+
+	RyanMqttLog_raw("分片发布性能: 1连接 %u ms, 2连接 %u ms, 4连接 %u ms, 8连接 %u ms, %d线程共 %d 条消息\r\n",
+			elapsedMs[0], elapsedMs[1], elapsedMs[2], elapsedMs[3], RyanMqttShardBenchThreadCount,
+			RyanMqttShardBenchThreadCount * RyanMqttShardBenchMsgCount);
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttShardTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	result = RyanMqttShardOrderTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttShardSubscribeTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttShardBenchTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	checkMemory;
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
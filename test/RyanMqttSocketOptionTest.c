@@ -0,0 +1,277 @@
+#include "RyanMqttTest.h"
+
+#define RyanMqttSocketTestTopic     "testSocket/latency"
+#define RyanMqttSocketTestFillTopic "testSocket/fill"
+#define RyanMqttSocketTestMaxDelay  (10 * 1000)
+
+// 延迟测试的往返次数
+#define RyanMqttSocketBenchCount (200)
+
+static sem_t socketTestEchoSem;
+
+static uint64_t RyanMqttSocketTestNowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+static void RyanMqttSocketTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	sem_post(&socketTestEchoSem);
+}
+
+static int RyanMqttSocketTestCompare(const void *a, const void *b)
+{
+	uint32_t left = *(const uint32_t *)a;
+	uint32_t right = *(const uint32_t *)b;
+	return (left > right) - (left < right);
+}
+
+/**
+ * @brief 按指定的socket选项初始化客户端并等待连接成功
+ *
+ * @param client
+ * @param clientId
+ * @param option
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttSocketTestInit(RyanMqttClient_t **client, char *clientId,
+					      const RyanMqttSocketOption_t *option)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = clientId,
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = RyanMqttHost,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = mqttEventBaseHandle,
+					     .userData = eventUserData,
+					     .socketOption = *option};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttSocketTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(10);
+	}
+
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 读取int类型的socket选项并与期望值比较
+ *
+ * @return uint32_t 不一致时返回1
+ */
+static uint32_t RyanMqttSocketTestCheckInt(int fd, int level, int optName, int expect)
+{
+	int value = 0;
+	socklen_t valueLen = sizeof(value);
+
+	if (0 != getsockopt(fd, level, optName, &value, &valueLen) || value != expect)
+	{
+		RyanMqttLog_e("socket选项不一致 level: %d, optName: %d, expect: %d, value: %d", level, optName, expect,
+			      value);
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief 检查连接使用的socket确实应用了配置的选项
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttSocketOptionApplyTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	int32_t fd = -1;
+	uint32_t failCount = 0;
+
+	RyanMqttSocketOption_t option = {.noDelayFlag = RyanMqttTrue,
+					 .keepaliveFlag = RyanMqttTrue,
+					 .keepaliveIdleS = 30,
+					 .keepaliveIntervalS = 5,
+					 .keepaliveCount = 3,
+					 .tos = 0x10,
+					 .sendBufSize = 64 * 1024,
+					 .recvBufSize = 64 * 1024,
+					 .userTimeoutMs = 10000};
+	result = RyanMqttSocketTestInit(&client, "RyanMqttSocketOption", &option);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttGetFd(client, &fd);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	struct sockaddr_storage addr;
+	socklen_t addrLen = sizeof(addr);
+	getsockname(fd, (struct sockaddr *)&addr, &addrLen);
+
+	failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+	failCount += RyanMqttSocketTestCheckInt(fd, SOL_SOCKET, SO_KEEPALIVE, 1);
+	failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_TCP, TCP_KEEPIDLE, 30);
+	failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_TCP, TCP_KEEPINTVL, 5);
+	failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_TCP, TCP_KEEPCNT, 3);
+	failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, 10000);
+	if (AF_INET6 == addr.ss_family)
+	{
+		failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_IPV6, IPV6_TCLASS, 0x10);
+	}
+	else
+	{
+		failCount += RyanMqttSocketTestCheckInt(fd, IPPROTO_IP, IP_TOS, 0x10);
+	}
+
+	// 内核会把缓冲区大小翻倍用于管理开销，这里只检查不小于配置值
+	int sendBufSize = 0;
+	socklen_t sendBufSizeLen = sizeof(sendBufSize);
+	getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBufSize, &sendBufSizeLen);
+	if (sendBufSize < 64 * 1024)
+	{
+		RyanMqttLog_e("SO_SNDBUF 设置失败: %d", sendBufSize);
+		failCount++;
+	}
+
+	RyanMqttCheckCodeNoReturn(0 == failCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 测量往返延迟，每轮先向没有订阅的主题发布一条，再发布一条回环消息并等待收到
+ * 第一条报文没有被确认前，Nagle算法会推迟第二条报文直到收到broker的延迟ack
+ *
+ * @param option
+ * @param p50Us
+ * @param p99Us
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttSocketLatencyBench(const RyanMqttSocketOption_t *option, uint32_t *p50Us,
+						  uint32_t *p99Us)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	uint32_t *latencyUs = (uint32_t *)malloc(sizeof(uint32_t) * RyanMqttSocketBenchCount);
+	RyanMqttCheck(NULL != latencyUs, RyanMqttNotEnoughMemError, RyanMqttLog_e);
+
+	sem_init(&socketTestEchoSem, 0, 0);
+
+	result = RyanMqttSocketTestInit(&client, "RyanMqttSocketLatency", option);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	uint16_t topicLen = RyanMqttStrlen(RyanMqttSocketTestTopic);
+	result = RyanMqttSubscribeWithMsgHandle(client, RyanMqttSocketTestTopic, topicLen, RyanMqttQos0,
+						RyanMqttSocketTestMsgHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	delay(200);
+
+	for (uint32_t i = 0; i < RyanMqttSocketBenchCount; i++)
+	{
+		uint64_t startUs = RyanMqttSocketTestNowUs();
+		RyanMqttPublish(client, RyanMqttSocketTestFillTopic, "f", 1, RyanMqttQos0, RyanMqttFalse);
+		RyanMqttPublish(client, RyanMqttSocketTestTopic, "e", 1, RyanMqttQos0, RyanMqttFalse);
+
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += 2;
+		if (0 != sem_timedwait(&socketTestEchoSem, &deadline))
+		{
+			RyanMqttLog_e("等待回环消息超时 index: %u", i);
+			result = RyanMqttFailedError;
+			goto __exit;
+		}
+
+		latencyUs[i] = (uint32_t)(RyanMqttSocketTestNowUs() - startUs);
+	}
+
+	qsort(latencyUs, RyanMqttSocketBenchCount, sizeof(uint32_t), RyanMqttSocketTestCompare);
+	*p50Us = latencyUs[RyanMqttSocketBenchCount / 2];
+	*p99Us = latencyUs[RyanMqttSocketBenchCount * 99 / 100];
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	sem_destroy(&socketTestEchoSem);
+	free(latencyUs);
+	return result;
+}
+
+RyanMqttError_e RyanMqttSocketOptionTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttSocketOption_t defaultOption = {0};
+	RyanMqttSocketOption_t noDelayOption = {.noDelayFlag = RyanMqttTrue};
+	uint32_t defaultP50Us = 0, defaultP99Us = 0;
+	uint32_t noDelayP50Us = 0, noDelayP99Us = 0;
+
+	result = RyanMqttSocketOptionApplyTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttSocketLatencyBench(&defaultOption, &defaultP50Us, &defaultP99Us);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttSocketLatencyBench(&noDelayOption, &noDelayP50Us, &noDelayP99Us);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttLog_raw("往返延迟: 默认 p50 %u us / p99 %u us, TCP_NODELAY p50 %u us / p99 %u us, 共 %d 次\r\n",
+			defaultP50Us, defaultP99Us, noDelayP50Us, noDelayP99Us, RyanMqttSocketBenchCount);
+
+	checkMemory;
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
@@ -0,0 +1,659 @@
+#include "RyanMqttTest.h"
+
+#define RyanMqttStepTestTopic      "testStep/"
+#define RyanMqttStepTestTopicAll   "testStep/#"
+#define RyanMqttStepTestCount      (20)
+#define RyanMqttStepTestMaxDelayMs (10 * 1000)
+#define RyanMqttStepPartialTopic   "testStep/partial"
+#define RyanMqttStepBlackholeHost  ("10.255.255.1")
+
+// 报文没有全部到达时单次 RyanMqttStep 允许的最长耗时，远小于 recvTimeout，单位ms
+#define RyanMqttStepPartialMaxMs (100)
+
+static pthread_t stepTestLoopThread;
+static uint32_t stepTestRecvCount = 0;
+static uint32_t stepTestPublishedCount = 0;
+static uint32_t stepTestOtherThreadCount = 0;
+
+typedef RyanMqttBool_e (*RyanMqttStepTestDoneHandle)(RyanMqttClient_t *client);
+
+// 可以限制可读字节数的tcp传输层，模拟报文分多次到达
+typedef struct
+{
+	RyanMqttTransport_t transport;
+	platformNetwork_t network;
+	int32_t allowance; // 还允许读取的字节数，为-1时不限制
+} RyanMqttStepTestTransport_t;
+
+static RyanMqttError_e RyanMqttStepTestConnect(void *userData, const char *host, uint16_t port)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+	return platformNetworkConnect(NULL, &st->network, host, port);
+}
+
+static RyanMqttError_e RyanMqttStepTestConnectStart(void *userData, const char *host, uint16_t port,
+						    uint32_t *pendingMs)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+	return platformNetworkConnectAsync(NULL, &st->network, host, port, pendingMs);
+}
+
+static RyanMqttError_e RyanMqttStepTestConnectPoll(void *userData, uint32_t *pendingMs)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+	return platformNetworkConnectPoll(NULL, &st->network, pendingMs);
+}
+
+static int32_t RyanMqttStepTestRecv(void *userData, char *recvBuf, size_t recvLen, int32_t timeout)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+
+	RyanMqttTestEnableCritical();
+	int32_t allowance = st->allowance;
+	RyanMqttTestExitCritical();
+
+	// 剩余部分还没有到达
+	if (0 == allowance)
+	{
+		delay(timeout);
+		return 0;
+	}
+
+	if (allowance > 0 && recvLen > (size_t)allowance)
+	{
+		recvLen = (size_t)allowance;
+	}
+
+	int32_t recvResult = platformNetworkRecvAsync(NULL, &st->network, recvBuf, recvLen, timeout);
+	if (recvResult > 0 && allowance > 0)
+	{
+		RyanMqttTestEnableCritical();
+		st->allowance -= recvResult;
+		RyanMqttTestExitCritical();
+	}
+
+	return recvResult;
+}
+
+static int32_t RyanMqttStepTestSend(void *userData, char *sendBuf, size_t sendLen, int32_t timeout)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+	return platformNetworkSendAsync(NULL, &st->network, sendBuf, sendLen, timeout);
+}
+
+static RyanMqttError_e RyanMqttStepTestClose(void *userData)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+	return platformNetworkClose(NULL, &st->network);
+}
+
+static int32_t RyanMqttStepTestGetFd(void *userData)
+{
+	RyanMqttStepTestTransport_t *st = (RyanMqttStepTestTransport_t *)userData;
+	return platformNetworkGetFd(NULL, &st->network);
+}
+
+static void RyanMqttStepTestCheckThread(void)
+{
+	// 单步模式下所有回调都必须在事件循环线程中执行
+	if (!pthread_equal(pthread_self(), stepTestLoopThread))
+	{
+		stepTestOtherThreadCount++;
+	}
+}
+
+static void RyanMqttStepTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	RyanMqttStepTestCheckThread();
+	stepTestRecvCount++;
+}
+
+static void RyanMqttStepTestEventHandle(void *pclient, RyanMqttEventId_e event, const void *eventData)
+{
+	switch (event)
+	{
+	case RyanMqttEventPublished:
+		RyanMqttStepTestCheckThread();
+		stepTestPublishedCount++;
+		break;
+
+	default: mqttEventBaseHandle(pclient, event, eventData); break;
+	}
+}
+
+/**
+ * @brief 模拟外部事件循环，使用select监听socket，RyanMqttGetWantWrite 为真时同时监听可写，
+ * 超时时间由 RyanMqttGetNextTimeoutMs 决定
+ *
+ * @param client
+ * @param maxDelayMs
+ * @param doneHandle 返回 RyanMqttTrue 时结束循环，为NULL时运行到 maxDelayMs
+ * @return RyanMqttBool_e doneHandle 是否在超时前返回 RyanMqttTrue
+ */
+static RyanMqttBool_e RyanMqttStepTestLoop(RyanMqttClient_t *client, uint32_t maxDelayMs,
+					   RyanMqttStepTestDoneHandle doneHandle)
+{
+	uint32_t startMs = platformUptimeMs();
+
+	while (platformUptimeMs() - startMs < maxDelayMs)
+	{
+		if (NULL != doneHandle && RyanMqttTrue == doneHandle(client))
+		{
+			return RyanMqttTrue;
+		}
+
+		int32_t fd = -1;
+		uint32_t timeoutMs = 0;
+		RyanMqttBool_e wantWrite = RyanMqttFalse;
+		RyanMqttGetFd(client, &fd);
+		RyanMqttGetWantWrite(client, &wantWrite);
+		RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+
+		// 限制单次等待时间，及时检查结束条件
+		if (timeoutMs > 100)
+		{
+			timeoutMs = 100;
+		}
+
+		fd_set readSet;
+		fd_set writeSet;
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		if (fd >= 0)
+		{
+			FD_SET(fd, &readSet);
+			if (RyanMqttTrue == wantWrite)
+			{
+				FD_SET(fd, &writeSet);
+			}
+		}
+
+		struct timeval tv = {.tv_sec = 0, .tv_usec = (suseconds_t)(timeoutMs * 1000)};
+		int ready = select(fd + 1, &readSet, &writeSet, NULL, &tv);
+		RyanMqttBool_e readable = RyanMqttFalse;
+		RyanMqttBool_e writable = RyanMqttFalse;
+		if (ready > 0 && fd >= 0 && FD_ISSET(fd, &readSet))
+		{
+			readable = RyanMqttTrue;
+		}
+		if (ready > 0 && fd >= 0 && FD_ISSET(fd, &writeSet))
+		{
+			writable = RyanMqttTrue;
+		}
+
+		RyanMqttStep(client, readable, writable);
+	}
+
+	return (NULL != doneHandle && RyanMqttTrue == doneHandle(client)) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+static RyanMqttBool_e RyanMqttStepTestIsConnected(RyanMqttClient_t *client)
+{
+	return (RyanMqttConnectState == RyanMqttGetState(client)) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+static RyanMqttBool_e RyanMqttStepTestIsDisconnected(RyanMqttClient_t *client)
+{
+	return (RyanMqttDisconnectState == RyanMqttGetState(client)) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+static RyanMqttBool_e RyanMqttStepTestIsWaitConnack(RyanMqttClient_t *client)
+{
+	return (RyanMqttStepConnectConnack == client->stepConnectState) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+static RyanMqttBool_e RyanMqttStepTestIsSubscribed(RyanMqttClient_t *client)
+{
+	RyanMqttBool_e doneFlag;
+
+	platformMutexLock(client->config.userData, &client->ackHandleLock);
+	doneFlag = RyanMqttListIsEmpty(&client->ackHandlerList) ? RyanMqttTrue : RyanMqttFalse;
+	platformMutexUnLock(client->config.userData, &client->ackHandleLock);
+
+	platformMutexLock(client->config.userData, &client->userSessionLock);
+	if (!RyanMqttListIsEmpty(&client->userAckHandlerList))
+	{
+		doneFlag = RyanMqttFalse;
+	}
+	platformMutexUnLock(client->config.userData, &client->userSessionLock);
+
+	return doneFlag;
+}
+
+static RyanMqttBool_e RyanMqttStepTestIsAllReceived(RyanMqttClient_t *client)
+{
+	return (RyanMqttStepTestCount == stepTestRecvCount && RyanMqttStepTestCount == stepTestPublishedCount)
+		       ? RyanMqttTrue
+		       : RyanMqttFalse;
+}
+
+static RyanMqttBool_e RyanMqttStepTestIsOneReceived(RyanMqttClient_t *client)
+{
+	return (1 == stepTestRecvCount) ? RyanMqttTrue : RyanMqttFalse;
+}
+
+/**
+ * @brief 单步模式的客户端初始化，不创建mqtt线程
+ *
+ * @param client
+ * @param transport 为NULL时使用平台层的网络组件
+ * @param host
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttStepTestInit(RyanMqttClient_t **client, RyanMqttTransport_t *transport,
+					    char *host)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttStepTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = host,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .stepModeFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = RyanMqttStepTestEventHandle,
+					     .userData = eventUserData,
+					     .transport = transport};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	// 没有mqtt线程，不调用 RyanMqttStep 时不会连接
+	delay(100);
+	RyanMqttCheck(RyanMqttStartState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 单步模式下完成连接、订阅、收发、断线重连和销毁
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttStepLoopTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	char topic[64];
+	int32_t fd = -1;
+	uint32_t timeoutMs = 0;
+
+	stepTestLoopThread = pthread_self();
+	stepTestRecvCount = 0;
+	stepTestPublishedCount = 0;
+	stepTestOtherThreadCount = 0;
+
+	result = RyanMqttStepTestInit(&client, NULL, RyanMqttHost);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	// 连接前没有socket，需要立即调用 RyanMqttStep
+	result = RyanMqttGetFd(client, &fd);
+	RyanMqttCheckCodeNoReturn(RyanMqttNotConnectError == result && fd < 0, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+	RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+	RyanMqttCheckCodeNoReturn(0 == timeoutMs, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsConnected);
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState == RyanMqttGetState(client), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttSubscribeWithMsgHandle(client, RyanMqttStepTestTopicAll,
+						RyanMqttStrlen(RyanMqttStepTestTopicAll), RyanMqttQos1,
+						RyanMqttStepTestMsgHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsSubscribed);
+
+	for (int32_t i = 0; i < RyanMqttStepTestCount; i++)
+	{
+		RyanMqttSnprintf(topic, sizeof(topic), "%s%d", RyanMqttStepTestTopic, (int)i);
+		result = RyanMqttPublish(client, topic, "step", RyanMqttStrlen("step"), RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+
+	if (RyanMqttTrue != RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsAllReceived) ||
+	    0 != stepTestOtherThreadCount)
+	{
+		RyanMqttLog_e("单步模式收发异常 recv: %u, published: %u, otherThread: %u", stepTestRecvCount,
+			      stepTestPublishedCount, stepTestOtherThreadCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	// 空闲时只需要按心跳和ack扫描的节奏唤醒
+	RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+	RyanMqttCheckCodeNoReturn(timeoutMs <= client->config.keepaliveTimeoutS * 1000, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 断开后由 RyanMqttStep 按重连间隔自动重连
+	result = RyanMqttDisconnect(client, RyanMqttTrue);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+	RyanMqttCheckCodeNoReturn(timeoutMs > 0 && timeoutMs <= RyanMqttReconnectTimeout, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsConnected);
+	result = RyanMqttGetFd(client, &fd);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && fd >= 0, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttUnSubscribe(client, RyanMqttStepTestTopicAll);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	RyanMqttStepTestLoop(client, RyanMqttRecvTimeout + 50, NULL);
+
+	result = checkAckList(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	// 单步模式下 RyanMqttDestroy 直接在当前线程释放资源
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	return result;
+}
+
+/**
+ * @brief 设置传输层还允许读取的字节数
+ *
+ * @param st
+ * @param allowance 为-1时不限制
+ */
+static void RyanMqttStepTestSetAllowance(RyanMqttStepTestTransport_t *st, int32_t allowance)
+{
+	RyanMqttTestEnableCritical();
+	st->allowance = allowance;
+	RyanMqttTestExitCritical();
+}
+
+/**
+ * @brief 报文分多次到达时，RyanMqttStep 只读取已经到达的部分并立即返回，剩余部分到达后继续读取
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttStepPartialTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttStepTestTransport_t st;
+
+	RyanMqttMemset(&st, 0, sizeof(RyanMqttStepTestTransport_t));
+	st.transport = (RyanMqttTransport_t){.userData = &st,
+					     .connect = RyanMqttStepTestConnect,
+					     .recv = RyanMqttStepTestRecv,
+					     .send = RyanMqttStepTestSend,
+					     .close = RyanMqttStepTestClose,
+					     .getFd = RyanMqttStepTestGetFd};
+	st.allowance = -1;
+	platformNetworkInit(NULL, &st.network);
+
+	stepTestLoopThread = pthread_self();
+	stepTestRecvCount = 0;
+	stepTestPublishedCount = 0;
+	stepTestOtherThreadCount = 0;
+
+	result = RyanMqttStepTestInit(&client, &st.transport, RyanMqttHost);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsConnected);
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState == RyanMqttGetState(client), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttSubscribeWithMsgHandle(client, RyanMqttStepPartialTopic,
+						RyanMqttStrlen(RyanMqttStepPartialTopic), RyanMqttQos0,
+						RyanMqttStepTestMsgHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsSubscribed);
+
+	// 只放行固定报头和 payload 的第一个字节
+	RyanMqttStepTestSetAllowance(&st, 3);
+	result = RyanMqttPublish(client, RyanMqttStepPartialTopic, "partial", RyanMqttStrlen("partial"), RyanMqttQos0,
+				 RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	delay(100);
+
+	for (int32_t i = 0; i < 3; i++)
+	{
+		uint32_t startMs = platformUptimeMs();
+		RyanMqttStep(client, RyanMqttTrue, RyanMqttFalse);
+		uint32_t elapsedMs = platformUptimeMs() - startMs;
+		RyanMqttCheckCodeNoReturn(elapsedMs < RyanMqttStepPartialMaxMs && 0 == stepTestRecvCount,
+					  RyanMqttFailedError, RyanMqttLog_e, {
+						  RyanMqttLog_e("报文没有读完时 RyanMqttStep 阻塞 %u ms", elapsedMs);
+						  result = RyanMqttFailedError;
+						  goto __exit;
+					  });
+	}
+
+	// 剩余部分到达后继续读取同一个报文
+	RyanMqttStepTestSetAllowance(&st, -1);
+	if (RyanMqttTrue != RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsOneReceived) ||
+	    RyanMqttConnectState != RyanMqttGetState(client))
+	{
+		RyanMqttLog_e("报文剩余部分到达后没有收到消息 recv: %u", stepTestRecvCount);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	// 没有读完的报文随连接一起释放，由 checkMemory 检查
+	RyanMqttStepTestSetAllowance(&st, 3);
+	result = RyanMqttPublish(client, RyanMqttStepPartialTopic, "partial", RyanMqttStrlen("partial"), RyanMqttQos0,
+				 RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	delay(100);
+	RyanMqttStep(client, RyanMqttTrue, RyanMqttFalse);
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &st.network);
+	return result;
+}
+
+/**
+ * @brief 连接服务器时 RyanMqttStep 不阻塞，传输层连接中和等待CONNACK时都立即返回，由截止时间驱动超时
+ *
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttStepConnectTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttStepTestTransport_t st;
+	RyanMqttBool_e wantWrite = RyanMqttFalse;
+	uint32_t timeoutMs = 0;
+	uint32_t startMs = 0;
+	uint32_t elapsedMs = 0;
+	int32_t fd = -1;
+
+	RyanMqttMemset(&st, 0, sizeof(RyanMqttStepTestTransport_t));
+	st.transport = (RyanMqttTransport_t){.userData = &st,
+					     .connect = RyanMqttStepTestConnect,
+					     .connectStart = RyanMqttStepTestConnectStart,
+					     .connectPoll = RyanMqttStepTestConnectPoll,
+					     .recv = RyanMqttStepTestRecv,
+					     .send = RyanMqttStepTestSend,
+					     .close = RyanMqttStepTestClose,
+					     .getFd = RyanMqttStepTestGetFd};
+	st.allowance = -1;
+	platformNetworkInit(NULL, &st.network);
+
+	stepTestLoopThread = pthread_self();
+
+	// 不可达的地址，解析和传输层连接中每次都立即返回，开始连接后等待socket可写
+	result = RyanMqttStepTestInit(&client, NULL, RyanMqttStepBlackholeHost);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	startMs = platformUptimeMs();
+	while (fd < 0 && platformUptimeMs() - startMs < 1000)
+	{
+		uint32_t stepStartMs = platformUptimeMs();
+		RyanMqttStep(client, RyanMqttFalse, RyanMqttFalse);
+		uint32_t stepMs = platformUptimeMs() - stepStartMs;
+		if (stepMs > elapsedMs)
+		{
+			elapsedMs = stepMs;
+		}
+
+		RyanMqttGetFd(client, &fd);
+		RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+		if (fd < 0)
+		{
+			delay(timeoutMs);
+		}
+	}
+	RyanMqttGetWantWrite(client, &wantWrite);
+	if (elapsedMs >= RyanMqttStepPartialMaxMs || RyanMqttStartState != RyanMqttGetState(client) ||
+	    RyanMqttTrue != wantWrite || fd < 0 || 0 == timeoutMs || timeoutMs > platformNetworkConnectTimeout)
+	{
+		RyanMqttLog_e("传输层连接中 RyanMqttStep 异常 elapsed: %u, state: %d, wantWrite: %d, fd: %d",
+			      elapsedMs, RyanMqttGetState(client), wantWrite, fd);
+		RyanMqttLog_e("timeout: %u", timeoutMs);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	// 到达连接超时后由截止时间驱动失败
+	RyanMqttStepTestLoop(client, platformNetworkConnectTimeout + 1000, RyanMqttStepTestIsDisconnected);
+	RyanMqttCheckCodeNoReturn(RyanMqttDisconnectState == RyanMqttGetState(client), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+	RyanMqttTestDestroyClient(client);
+	client = NULL;
+
+	// CONNACK 没有到达时立即返回，只等待socket可读
+	RyanMqttStepTestSetAllowance(&st, 0);
+	result = RyanMqttStepTestInit(&client, &st.transport, RyanMqttHost);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsWaitConnack);
+
+	startMs = platformUptimeMs();
+	RyanMqttStep(client, RyanMqttTrue, RyanMqttFalse);
+	elapsedMs = platformUptimeMs() - startMs;
+	RyanMqttGetWantWrite(client, &wantWrite);
+	RyanMqttGetNextTimeoutMs(client, &timeoutMs);
+	if (elapsedMs >= RyanMqttStepPartialMaxMs || RyanMqttStartState != RyanMqttGetState(client) ||
+	    RyanMqttFalse != wantWrite || 0 == timeoutMs || timeoutMs > RyanMqttRecvTimeout)
+	{
+		RyanMqttLog_e("等待CONNACK时 RyanMqttStep 异常 elapsed: %u, state: %d, wantWrite: %d, timeout: %u",
+			      elapsedMs, RyanMqttGetState(client), wantWrite, timeoutMs);
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+	RyanMqttStepTestSetAllowance(&st, -1);
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsConnected);
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState == RyanMqttGetState(client), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 重连时 CONNACK 超过 recvTimeout 没有到达则断开
+	result = RyanMqttDisconnect(client, RyanMqttTrue);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	RyanMqttStepTestSetAllowance(&st, 0);
+	RyanMqttStepTestLoop(client, RyanMqttStepTestMaxDelayMs, RyanMqttStepTestIsWaitConnack);
+	RyanMqttCheckCodeNoReturn(RyanMqttTrue == RyanMqttStepTestIsWaitConnack(client), RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	startMs = platformUptimeMs();
+	RyanMqttStepTestLoop(client, RyanMqttRecvTimeout + 1000, RyanMqttStepTestIsDisconnected);
+	elapsedMs = platformUptimeMs() - startMs;
+	if (RyanMqttDisconnectState != RyanMqttGetState(client) || elapsedMs + 100 < RyanMqttRecvTimeout)
+	{
+		RyanMqttLog_e("CONNACK超时异常 elapsed: %u, state: %d", elapsedMs, RyanMqttGetState(client));
+		result = RyanMqttFailedError;
+		goto __exit;
+	}
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformNetworkDestroy(NULL, &st.network);
+	return result;
+}
+
+RyanMqttError_e RyanMqttStepTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	result = RyanMqttStepLoopTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttStepPartialTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	result = RyanMqttStepConnectTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
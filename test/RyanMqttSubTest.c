@@ -87,6 +87,23 @@ static void RyanMqttSubEventHandle(void *pclient, RyanMqttEventId_e event, const
 	}
 }
 
+static RyanMqttBool_e RyanMqttSubscribeIterateCheck(void *client, const RyanMqttMsgHandler_t *msgHandler,
+						     void *userData)
+{
+	int32_t *iterateCount = (int32_t *)userData;
+	(void)client;
+
+	if (NULL == topicIsSubscribeArr((char *)msgHandler->topic, msgHandler->topicLen))
+	{
+		RyanMqttLog_e("遍历到未订阅的主题 topic: %.*s", msgHandler->topicLen, msgHandler->topic);
+		*iterateCount = -1;
+		return RyanMqttFalse;
+	}
+
+	(*iterateCount)++;
+	return RyanMqttTrue;
+}
+
 static RyanMqttError_e RyanMqttSubscribeCheckMsgHandle(RyanMqttClient_t *client)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
@@ -156,6 +173,16 @@ static RyanMqttError_e RyanMqttSubscribeCheckMsgHandle(RyanMqttClient_t *client)
 		}
 	}
 
+	// 遍历接口和拷贝接口看到的订阅应该一致
+	int32_t iterateCount = 0;
+	result = RyanMqttIterateSubscribe(client, RyanMqttSubscribeIterateCheck, &iterateCount);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && iterateCount == subscribeNum, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  RyanMqttLog_e("遍历订阅数: %d, 应该订阅主题数: %d", iterateCount, subscribeNum);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
 __exit:
 	if (NULL != msgHandles)
 	{
@@ -329,6 +356,137 @@ __exit:
 	return result;
 }
 
+static uint32_t msgHandleEventCount = 0;
+
+static void RyanMqttSubMsgHandleEventHandle(void *pclient, RyanMqttEventId_e event, const void *eventData)
+{
+	switch (event)
+	{
+	case RyanMqttEventData: {
+		RyanMqttTestEnableCritical();
+		msgHandleEventCount++;
+		RyanMqttTestExitCritical();
+		break;
+	}
+
+	default: mqttEventBaseHandle(pclient, event, eventData); break;
+	}
+}
+
+static void RyanMqttSubMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	RyanMqttTestEnableCritical();
+	(*(uint32_t *)userData)++;
+	RyanMqttTestExitCritical();
+}
+
+static RyanMqttError_e RyanMqttSubscribeMsgHandleWait(uint32_t *msgHandleCount, uint32_t expectA, uint32_t expectB,
+						      uint32_t expectEvent)
+{
+	for (int32_t i = 0; i < 100; i++)
+	{
+		RyanMqttTestEnableCritical();
+		RyanMqttBool_e isOk = (msgHandleCount[0] == expectA && msgHandleCount[1] == expectB &&
+				       msgHandleEventCount == expectEvent)
+					      ? RyanMqttTrue
+					      : RyanMqttFalse;
+		RyanMqttTestExitCritical();
+
+		if (RyanMqttTrue == isOk)
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(100);
+	}
+
+	RyanMqttLog_e("订阅回调次数不对, a: %d, b: %d, event: %d, 期望 a: %d, b: %d, event: %d", msgHandleCount[0],
+		      msgHandleCount[1], msgHandleEventCount, expectA, expectB, expectEvent);
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 测试订阅回调函数，消息默认分发给所有匹配的订阅，使能 msgFirstMatchFlag 后只分发给第一个匹配的订阅
+ *
+ * @param count
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttSubscribeMsgHandleTest(int32_t count)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client;
+	uint32_t msgHandleCount[2] = {0};
+	char *exactTopic = "test/msgHandle/x/a";
+	char *wildcardTopic = "test/msgHandle/+/a";
+	char *eventTopic = "test/msgHandle/#";
+	msgHandleEventCount = 0;
+
+	result = RyanMqttTestInit(&client, RyanMqttTrue, RyanMqttTrue, 120, RyanMqttSubMsgHandleEventHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttSubscribeWithMsgHandle(client, wildcardTopic, RyanMqttStrlen(wildcardTopic), RyanMqttQos1,
+						RyanMqttSubMsgHandle, &msgHandleCount[0]);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttSubscribeWithMsgHandle(client, exactTopic, RyanMqttStrlen(exactTopic), RyanMqttQos1,
+						RyanMqttSubMsgHandle, &msgHandleCount[1]);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttSubscribe(client, eventTopic, RyanMqttQos1);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	for (int32_t i = 0; i < 100; i++)
+	{
+		int32_t subscribeTotalCount = 0;
+		RyanMqttGetSubscribeTotalCount(client, &subscribeTotalCount);
+		if (3 == subscribeTotalCount)
+		{
+			break;
+		}
+		delay(100);
+	}
+
+	// 三个订阅都匹配，回调和事件都应该收到
+	for (int32_t i = 0; i < count; i++)
+	{
+		result = RyanMqttPublish(client, exactTopic, "msgHandle", 9, RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+	result = RyanMqttSubscribeMsgHandleWait(msgHandleCount, count, count, count);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	// 只分发给第一个匹配的订阅，精确订阅优先
+	client->config.msgFirstMatchFlag = RyanMqttTrue;
+	for (int32_t i = 0; i < count; i++)
+	{
+		result = RyanMqttPublish(client, exactTopic, "msgHandle", 9, RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e,
+					  { goto __exit; });
+	}
+	result = RyanMqttSubscribeMsgHandleWait(msgHandleCount, count, count * 2, count);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttUnSubscribe(client, wildcardTopic);
+	RyanMqttUnSubscribe(client, exactTopic);
+	RyanMqttUnSubscribe(client, eventTopic);
+	for (int32_t i = 0; i < 100; i++)
+	{
+		int32_t subscribeTotalCount = 0;
+		RyanMqttGetSubscribeTotalCount(client, &subscribeTotalCount);
+		if (0 == subscribeTotalCount)
+		{
+			break;
+		}
+		delay(100);
+	}
+
+	result = checkAckList(client);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	RyanMqttLog_i("mqtt 订阅回调测试，销毁mqtt客户端");
+	RyanMqttTestDestroyClient(client);
+	return result;
+}
+
 RyanMqttError_e RyanMqttSubTest(void)
 {
 	RyanMqttError_e result = RyanMqttSuccessError;
@@ -337,6 +495,10 @@ RyanMqttError_e RyanMqttSubTest(void)
 	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
 	checkMemory;
 
+	result = RyanMqttSubscribeMsgHandleTest(20);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+	checkMemory;
+
 	return RyanMqttSuccessError;
 
 __exit:
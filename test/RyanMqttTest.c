@@ -399,11 +399,24 @@ int main(void)
 	} while (0)
 
 	uint32_t totalElapsedStartMs = platformUptimeMs();
+	runTestWithLogAndTimer(RyanMqttTopicMatchTest);
 	runTestWithLogAndTimer(RyanMqttPublicApiParamCheckTest);
 	runTestWithLogAndTimer(RyanMqttMemoryFaultToleranceTest);
 
 	runTestWithLogAndTimer(RyanMqttSubTest);
 	runTestWithLogAndTimer(RyanMqttPubTest);
+	runTestWithLogAndTimer(RyanMqttDispatchPoolTest);
+	runTestWithLogAndTimer(RyanMqttRecvMessageTest);
+	runTestWithLogAndTimer(RyanMqttStepTest);
+	runTestWithLogAndTimer(RyanMqttNetworkConnectTest);
+	runTestWithLogAndTimer(RyanMqttPersistTest);
+	runTestWithLogAndTimer(RyanMqttOfflineQueueTest);
+	runTestWithLogAndTimer(RyanMqttShardTest);
+	runTestWithLogAndTimer(RyanMqttSocketOptionTest);
+	runTestWithLogAndTimer(RyanMqttUnixSocketTest);
+	runTestWithLogAndTimer(RyanMqttPipeTest);
+	runTestWithLogAndTimer(RyanMqttTlsTest);
+	runTestWithLogAndTimer(RyanMqttDeadlineTest);
 
 	runTestWithLogAndTimer(RyanMqttDestroyTest);
 
@@ -38,6 +38,10 @@ extern "C" {
 // #define RyanMqttUserName (NULL) // 填写你的用户名,没有填NULL
 // #define RyanMqttPassword (NULL) // 填写你的密码,没有填NULL
 
+// 同一个broker监听的unix domain socket，例如 mosquitto 2.x 配置 "listener 0 /tmp/RyanMqtt.sock"
+// socket文件不存在时跳过unix domain socket测试
+#define RyanMqttUnixPath "/tmp/RyanMqtt.sock"
+
 #define RyanMqttReconnectTimeout (3000) // 重连间隔时间，单位ms
 #define RyanMqttRecvTimeout      (2000) // 接收数据超时时间，单位ms
 #define RyanMqttSendTimeout      (1800) // 发送数据超时时间，单位ms
@@ -73,6 +77,19 @@ extern RyanMqttError_e RyanMqttPublicApiParamCheckTest(void);
 extern RyanMqttError_e RyanMqttNetworkFaultToleranceMemoryTest(void);
 extern RyanMqttError_e RyanMqttNetworkFaultQosResilienceTest(void);
 extern RyanMqttError_e RyanMqttMemoryFaultToleranceTest(void);
+extern RyanMqttError_e RyanMqttTopicMatchTest(void);
+extern RyanMqttError_e RyanMqttDispatchPoolTest(void);
+extern RyanMqttError_e RyanMqttRecvMessageTest(void);
+extern RyanMqttError_e RyanMqttStepTest(void);
+extern RyanMqttError_e RyanMqttNetworkConnectTest(void);
+extern RyanMqttError_e RyanMqttPersistTest(void);
+extern RyanMqttError_e RyanMqttOfflineQueueTest(void);
+extern RyanMqttError_e RyanMqttShardTest(void);
+extern RyanMqttError_e RyanMqttSocketOptionTest(void);
+extern RyanMqttError_e RyanMqttUnixSocketTest(void);
+extern RyanMqttError_e RyanMqttPipeTest(void);
+extern RyanMqttError_e RyanMqttTlsTest(void);
+extern RyanMqttError_e RyanMqttDeadlineTest(void);
 
 #ifdef __cplusplus
 }
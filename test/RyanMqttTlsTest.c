@@ -0,0 +1,574 @@
+#include "RyanMqttTest.h"
+#include "platformTls.h"
+
+#ifdef RyanMqttLinuxTlsEnable
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+
+#define RyanMqttTlsTestTopic    "testTls/echo"
+#define RyanMqttTlsTestCaFile   "/tmp/RyanMqttTlsTestCa.pem"
+#define RyanMqttTlsTestMaxDelay (10 * 1000)
+
+// 大报文测试的数据长度，跨越多个tls记录
+#define RyanMqttTlsTestBigLen (64 * 1024)
+
+// 性能测试每种握手的连接次数
+#define RyanMqttTlsBenchCount (50)
+
+// 测试进程内的tls终结代理，解密后转发给测试broker，模拟tls broker
+typedef struct
+{
+	SSL_CTX *ctx;
+	EVP_PKEY *pkey;
+	X509 *cert;
+	int listenFd;
+	uint16_t port;
+	pthread_t thread;
+	volatile RyanMqttBool_e runFlag;
+} RyanMqttTlsServer_t;
+
+static uint32_t tlsTestRecvCount = 0;
+static uint32_t tlsTestBigErrorCount = 0;
+static char *tlsTestBigPayload = NULL;
+
+static void RyanMqttTlsTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	RyanMqttTestEnableCritical();
+	tlsTestRecvCount++;
+	if (RyanMqttTlsTestBigLen == msgData->payloadLen &&
+	    0 != memcmp(msgData->payload, tlsTestBigPayload, RyanMqttTlsTestBigLen))
+	{
+		tlsTestBigErrorCount++;
+	}
+	RyanMqttTestExitCritical();
+}
+
+static uint32_t RyanMqttTlsTestGetRecvCount(void)
+{
+	RyanMqttTestEnableCritical();
+	uint32_t count = tlsTestRecvCount;
+	RyanMqttTestExitCritical();
+	return count;
+}
+
+/**
+ * @brief 生成 localhost 的自签名证书，同时作为客户端校验使用的CA证书写入文件
+ *
+ * @param server
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttTlsServerCreateCert(RyanMqttTlsServer_t *server)
+{
+	X509V3_CTX v3Ctx;
+
+	server->pkey = EVP_EC_gen("P-256");
+	RyanMqttCheck(NULL != server->pkey, RyanMqttFailedError, RyanMqttLog_e);
+	server->cert = X509_new();
+	RyanMqttCheck(NULL != server->cert, RyanMqttFailedError, RyanMqttLog_e);
+
+	X509_set_version(server->cert, 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(server->cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(server->cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(server->cert), 3600);
+	X509_set_pubkey(server->cert, server->pkey);
+
+	X509_NAME *name = X509_get_subject_name(server->cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+	X509_set_issuer_name(server->cert, name);
+
+	X509V3_set_ctx_nodb(&v3Ctx);
+	X509V3_set_ctx(&v3Ctx, server->cert, server->cert, NULL, NULL, 0);
+	X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, &v3Ctx, NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1");
+	RyanMqttCheck(NULL != ext, RyanMqttFailedError, RyanMqttLog_e);
+	X509_add_ext(server->cert, ext, -1);
+	X509_EXTENSION_free(ext);
+	RyanMqttCheck(0 != X509_sign(server->cert, server->pkey, EVP_sha256()), RyanMqttFailedError, RyanMqttLog_e);
+
+	FILE *fp = fopen(RyanMqttTlsTestCaFile, "w");
+	RyanMqttCheck(NULL != fp, RyanMqttFailedError, RyanMqttLog_e);
+	PEM_write_X509(fp, server->cert);
+	fclose(fp);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 在tls连接和测试broker之间转发数据，直到任意一端断开
+ * 收到第一段数据后才连接broker，只握手不发数据的连接不会打扰broker
+ *
+ * @param server
+ * @param fd
+ */
+static void RyanMqttTlsServerRelay(RyanMqttTlsServer_t *server, int fd)
+{
+	char buf[16 * 1024];
+	platformNetwork_t broker;
+	RyanMqttBool_e brokerFlag = RyanMqttFalse;
+	struct timeval tv = {.tv_sec = 2};
+
+	platformNetworkInit(NULL, &broker);
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	SSL *ssl = SSL_new(server->ctx);
+	SSL_set_fd(ssl, fd);
+	if (1 != SSL_accept(ssl))
+	{
+		goto __exit;
+	}
+
+	while (RyanMqttTrue == server->runFlag)
+	{
+		struct pollfd fds[2] = {{.fd = fd, .events = POLLIN}, {.fd = broker.socket, .events = POLLIN}};
+		if (0 == SSL_pending(ssl) && poll(fds, 2, 100) <= 0)
+		{
+			continue;
+		}
+
+		if (SSL_pending(ssl) > 0 || 0 != fds[0].revents)
+		{
+			int len = SSL_read(ssl, buf, sizeof(buf));
+			if (len <= 0)
+			{
+				break;
+			}
+
+			if (RyanMqttFalse == brokerFlag)
+			{
+				if (RyanMqttSuccessError !=
+				    platformNetworkConnect(NULL, &broker, RyanMqttHost, RyanMqttPort))
+				{
+					break;
+				}
+				brokerFlag = RyanMqttTrue;
+			}
+
+			if (len != send(broker.socket, buf, len, MSG_NOSIGNAL))
+			{
+				break;
+			}
+		}
+
+		if (0 != fds[1].revents)
+		{
+			ssize_t len = recv(broker.socket, buf, sizeof(buf), 0);
+			if (len <= 0 || len != SSL_write(ssl, buf, (int)len))
+			{
+				break;
+			}
+		}
+	}
+
+__exit:
+	platformNetworkClose(NULL, &broker);
+	platformNetworkDestroy(NULL, &broker);
+	SSL_free(ssl);
+	ERR_clear_error();
+}
+
+static void *RyanMqttTlsServerThread(void *arg)
+{
+	RyanMqttTlsServer_t *server = (RyanMqttTlsServer_t *)arg;
+
+	while (RyanMqttTrue == server->runFlag)
+	{
+		struct pollfd pollFd = {.fd = server->listenFd, .events = POLLIN};
+		if (poll(&pollFd, 1, 100) <= 0)
+		{
+			continue;
+		}
+
+		int fd = accept(server->listenFd, NULL, NULL);
+		if (fd < 0)
+		{
+			continue;
+		}
+
+		RyanMqttTlsServerRelay(server, fd);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static RyanMqttError_e RyanMqttTlsServerStart(RyanMqttTlsServer_t *server)
+{
+	struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+	socklen_t addrLen = sizeof(addr);
+
+	RyanMqttMemset(server, 0, sizeof(RyanMqttTlsServer_t));
+	server->listenFd = -1;
+	RyanMqttCheck(RyanMqttSuccessError == RyanMqttTlsServerCreateCert(server), RyanMqttFailedError, RyanMqttLog_e);
+
+	server->ctx = SSL_CTX_new(TLS_server_method());
+	RyanMqttCheck(NULL != server->ctx, RyanMqttFailedError, RyanMqttLog_e);
+	SSL_CTX_use_certificate(server->ctx, server->cert);
+	SSL_CTX_use_PrivateKey(server->ctx, server->pkey);
+
+	// 监听随机端口
+	server->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	RyanMqttCheck(server->listenFd >= 0, RyanMqttFailedError, RyanMqttLog_e);
+	RyanMqttCheck(0 == bind(server->listenFd, (struct sockaddr *)&addr, sizeof(addr)), RyanMqttFailedError,
+		      RyanMqttLog_e);
+	RyanMqttCheck(0 == listen(server->listenFd, 8), RyanMqttFailedError, RyanMqttLog_e);
+	getsockname(server->listenFd, (struct sockaddr *)&addr, &addrLen);
+	server->port = ntohs(addr.sin_port);
+
+	server->runFlag = RyanMqttTrue;
+	pthread_create(&server->thread, NULL, RyanMqttTlsServerThread, server);
+	return RyanMqttSuccessError;
+}
+
+static void RyanMqttTlsServerStop(RyanMqttTlsServer_t *server)
+{
+	if (RyanMqttTrue == server->runFlag)
+	{
+		server->runFlag = RyanMqttFalse;
+		pthread_join(server->thread, NULL);
+	}
+
+	if (server->listenFd >= 0)
+	{
+		close(server->listenFd);
+	}
+	SSL_CTX_free(server->ctx);
+	X509_free(server->cert);
+	EVP_PKEY_free(server->pkey);
+	unlink(RyanMqttTlsTestCaFile);
+}
+
+/**
+ * @brief 初始化使用tls传输层的客户端并订阅回显主题
+ *
+ * @param client
+ * @param tls
+ * @param port
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttTlsTestInit(RyanMqttClient_t **client, platformTlsTransport_t *tls, uint16_t port)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttTlsTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = "localhost",
+					     .port = port,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttFalse,
+					     .cleanSessionFlag = RyanMqttFalse,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = mqttEventBaseHandle,
+					     .userData = eventUserData,
+					     .socketOption = {.noDelayFlag = RyanMqttTrue},
+					     .transport = &tls->transport};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttTlsTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	uint16_t topicLen = RyanMqttStrlen(RyanMqttTlsTestTopic);
+	result = RyanMqttSubscribeWithMsgHandle(*client, RyanMqttTlsTestTopic, topicLen, RyanMqttQos1,
+						RyanMqttTlsTestMsgHandle, NULL);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	int32_t subscribeTotalCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttTlsTestMaxDelay && 1 != subscribeTotalCount; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttGetSubscribeTotalCount(*client, &subscribeTotalCount);
+	}
+	RyanMqttCheck(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	// 等待broker处理完订阅
+	delay(100);
+	return RyanMqttSuccessError;
+}
+
+static RyanMqttError_e RyanMqttTlsTestWaitRecv(uint32_t expectCount)
+{
+	for (uint32_t elapsed = 0; elapsed < RyanMqttTlsTestMaxDelay; elapsed++)
+	{
+		if (RyanMqttTlsTestGetRecvCount() >= expectCount)
+		{
+			return RyanMqttSuccessError;
+		}
+		delay(1);
+	}
+
+	RyanMqttLog_e("收到 %u 条回显，期望 %u 条", RyanMqttTlsTestGetRecvCount(), expectCount);
+	return RyanMqttFailedError;
+}
+
+/**
+ * @brief 重复建立和关闭tls连接，统计平均握手耗时
+ *
+ * @param port
+ * @param sessionResumeFlag
+ * @param avgUs
+ * @param resumeCount
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttTlsBench(uint16_t port, RyanMqttBool_e sessionResumeFlag, uint32_t *avgUs,
+					uint32_t *resumeCount)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformTlsTransport_t tls;
+	platformTlsStatistics_t statistics;
+	platformTlsConfig_t tlsConfig = {.caFile = RyanMqttTlsTestCaFile, .sessionResumeFlag = sessionResumeFlag};
+	uint64_t totalUs = 0;
+
+	result = platformTlsTransportInit(&tls, &tlsConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t i = 0; i < RyanMqttTlsBenchCount; i++)
+	{
+		result = tls.transport.connect(tls.transport.userData, "localhost", port);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { break; });
+
+		// tls1.3的会话票据在握手完成后下发且只能使用一次，和mqtt连接一样读取一次来处理新票据
+		char buf[1];
+		tls.transport.recv(tls.transport.userData, buf, sizeof(buf), 10);
+
+		platformTlsTransportGetStatistics(&tls, &statistics);
+		totalUs += statistics.lastHandshakeUs;
+		tls.transport.close(tls.transport.userData);
+	}
+
+	platformTlsTransportGetStatistics(&tls, &statistics);
+	*avgUs = (uint32_t)(totalUs / RyanMqttTlsBenchCount);
+	*resumeCount = statistics.resumeCount;
+	platformTlsTransportDestroy(&tls);
+	return result;
+}
+
+/**
+ * @brief 对端关闭后继续发送返回错误，不触发SIGPIPE，初始化也不修改进程的SIGPIPE处理方式
+ *
+ * @param port
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttTlsPeerCloseTest(uint16_t port)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	platformTlsTransport_t tls = {0};
+	platformTlsConfig_t tlsConfig = {.caFile = RyanMqttTlsTestCaFile};
+	struct sigaction defaultAction = {.sa_handler = SIG_DFL};
+	struct sigaction oldAction, action;
+	char disconnectPacket[2] = {(char)0xE0, 0}; // DISCONNECT报文，broker断开连接后代理关闭tls连接
+	uint32_t failCount = 0;
+
+	// 使用默认处理方式，触发SIGPIPE时测试进程会直接退出
+	sigaction(SIGPIPE, &defaultAction, &oldAction);
+
+	result = platformTlsTransportInit(&tls, &tlsConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	sigaction(SIGPIPE, NULL, &action);
+	RyanMqttCheckCodeNoReturn(SIG_DFL == action.sa_handler, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = tls.transport.connect(tls.transport.userData, "localhost", port);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 第一次失败可能是 ECONNRESET，之后的写入才是 EPIPE
+	for (uint32_t elapsed = 0; elapsed < RyanMqttTlsTestMaxDelay && failCount < 3; elapsed += 10)
+	{
+		if (tls.transport.send(tls.transport.userData, disconnectPacket, sizeof(disconnectPacket), 100) < 0)
+		{
+			failCount++;
+		}
+		delay(10);
+	}
+	RyanMqttCheckCodeNoReturn(3 == failCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	result = RyanMqttSuccessError;
+
+__exit:
+	platformTlsTransportDestroy(&tls);
+	sigaction(SIGPIPE, &oldAction, NULL);
+	return result;
+}
+
+RyanMqttError_e RyanMqttTlsTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	RyanMqttTlsServer_t server;
+	platformTlsTransport_t tls = {0};
+	platformTlsStatistics_t statistics;
+	uint32_t fullUs = 0, fullResumeCount = 0, resumeUs = 0, resumeCount = 0;
+
+	tlsTestRecvCount = 0;
+	tlsTestBigErrorCount = 0;
+	tlsTestBigPayload = (char *)malloc(RyanMqttTlsTestBigLen);
+	RyanMqttCheck(NULL != tlsTestBigPayload, RyanMqttNotEnoughMemError, RyanMqttLog_e);
+	for (uint32_t i = 0; i < RyanMqttTlsTestBigLen; i++)
+	{
+		tlsTestBigPayload[i] = (char)('a' + i % 26);
+	}
+
+	result = RyanMqttTlsServerStart(&server);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 证书主机名不匹配时握手失败
+	platformTlsConfig_t tlsConfig = {.caFile = RyanMqttTlsTestCaFile, .serverName = "wrong.example"};
+	result = platformTlsTransportInit(&tls, &tlsConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = tls.transport.connect(tls.transport.userData, "localhost", server.port);
+	platformTlsTransportDestroy(&tls);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError != result, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	tlsConfig.serverName = NULL;
+	tlsConfig.sessionResumeFlag = RyanMqttTrue;
+	result = platformTlsTransportInit(&tls, &tlsConfig);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttTlsTestInit(&client, &tls, server.port);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	for (uint8_t qos = RyanMqttQos0; qos <= RyanMqttQos2; qos++)
+	{
+		result = RyanMqttPublish(client, RyanMqttTlsTestTopic, "tls", 3, (RyanMqttQos_e)qos, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+
+	// 大报文跨越多个tls记录
+	result = RyanMqttPublish(client, RyanMqttTlsTestTopic, tlsTestBigPayload, RyanMqttTlsTestBigLen, RyanMqttQos1,
+				 RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttTlsTestWaitRecv(4);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	RyanMqttCheckCodeNoReturn(0 == tlsTestBigErrorCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// 重连时恢复会话
+	RyanMqttDisconnect(client, RyanMqttTrue);
+	delay(100);
+	RyanMqttReconnect(client);
+	for (uint32_t elapsed = 0; elapsed < RyanMqttTlsTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(client))
+		{
+			break;
+		}
+		delay(10);
+	}
+
+	platformTlsTransportGetStatistics(&tls, &statistics);
+	RyanMqttCheckCodeNoReturn(RyanMqttConnectState == RyanMqttGetState(client) && 2 == statistics.handshakeCount &&
+					  1 == statistics.resumeCount,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  RyanMqttLog_e("握手 %u 次，恢复会话 %u 次", statistics.handshakeCount,
+							statistics.resumeCount);
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	// 测试broker不保存会话，重连后重新订阅。恢复会话后依然可以正常收发
+	result = RyanMqttSubscribeWithMsgHandle(client, RyanMqttTlsTestTopic, RyanMqttStrlen(RyanMqttTlsTestTopic),
+						RyanMqttQos1, RyanMqttTlsTestMsgHandle, NULL);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	delay(200);
+	result = RyanMqttPublish(client, RyanMqttTlsTestTopic, "tls", 3, RyanMqttQos1, RyanMqttFalse);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	result = RyanMqttTlsTestWaitRecv(5);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttTestDestroyClient(client);
+	client = NULL;
+
+	result = RyanMqttTlsBench(server.port, RyanMqttFalse, &fullUs, &fullResumeCount);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && 0 == fullResumeCount, RyanMqttFailedError,
+				  RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	result = RyanMqttTlsBench(server.port, RyanMqttTrue, &resumeUs, &resumeCount);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result && RyanMqttTlsBenchCount - 1 == resumeCount,
+				  RyanMqttFailedError, RyanMqttLog_e, {
+					  result = RyanMqttFailedError;
+					  goto __exit;
+				  });
+
+	RyanMqttLog_raw("tls握手平均耗时: 完整握手 %u us, 恢复会话 %u us (%u/%d次恢复), kTLS发送: %s\r\n", fullUs,
+			resumeUs, resumeCount, RyanMqttTlsBenchCount, statistics.ktlsFlag ? "是" : "否");
+
+	result = RyanMqttTlsPeerCloseTest(server.port);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	platformTlsTransportDestroy(&tls);
+	RyanMqttTlsServerStop(&server);
+	free(tlsTestBigPayload);
+	tlsTestBigPayload = NULL;
+
+	if (RyanMqttSuccessError == result)
+	{
+		checkMemory;
+	}
+	return result;
+}
+
+#else
+
+RyanMqttError_e RyanMqttTlsTest(void)
+{
+	RyanMqttLog_w("构建时没有找到openssl，跳过tls测试");
+	return RyanMqttSuccessError;
+}
+
+#endif
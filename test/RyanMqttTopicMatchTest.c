@@ -0,0 +1,552 @@
+#include "RyanMqttTest.h"
+
+#define TopicMatchRandomCount     (200000)
+#define TopicMatchBenchmarkRounds (20000)
+#define TopicMatchMaxFilterLevel  (64)
+
+/**
+ * @brief 逐字节匹配的参考实现，与优化前的 RyanMqttMatchTopic 保持一致，用于等价性测试和性能对比
+ *
+ */
+static RyanMqttBool_e RyanMqttMatchTopicReference(const char *topic, const uint16_t topicLength,
+						  const char *topicFilter, const uint16_t topicFilterLength)
+{
+	RyanMqttBool_e topicFilterStartsWithWildcard = RyanMqttFalse, matchFound = RyanMqttFalse,
+		       shouldStopMatching = RyanMqttFalse;
+	uint16_t topicIndex = 0, topicFilterIndex = 0;
+
+	topicFilterStartsWithWildcard = (RyanMqttBool_e)((topicFilter[0] == '+') || (topicFilter[0] == '#'));
+	if ((topic[0] == '$') && (topicFilterStartsWithWildcard == RyanMqttTrue))
+	{
+		return RyanMqttFalse;
+	}
+
+	while ((topicIndex < topicLength) && (topicFilterIndex < topicFilterLength))
+	{
+		if (topic[topicIndex] == topicFilter[topicFilterIndex])
+		{
+			if (topicIndex == (topicLength - 1U))
+			{
+				if ((topicFilterLength >= 3U) && (topicFilterIndex == (topicFilterLength - 3U)) &&
+				    (topicFilter[topicFilterIndex + 1U] == '/') &&
+				    (topicFilter[topicFilterIndex + 2U] == '#'))
+				{
+					matchFound = RyanMqttTrue;
+				}
+
+				if ((topicFilterIndex == (topicFilterLength - 2U)) &&
+				    (topicFilter[topicFilterIndex] == '/'))
+				{
+					matchFound = (RyanMqttBool_e)((topicFilter[topicFilterIndex + 1U] == '+') ||
+								      (topicFilter[topicFilterIndex + 1U] == '#'));
+				}
+			}
+		}
+		else
+		{
+			RyanMqttBool_e locationIsValidForWildcard = (RyanMqttBool_e)(
+				(topicFilterIndex == 0u) || (topicFilter[topicFilterIndex - 1U] == '/'));
+
+			if ((topicFilter[topicFilterIndex] == '+') && (locationIsValidForWildcard == RyanMqttTrue))
+			{
+				RyanMqttBool_e nextLevelExistsInTopicName = RyanMqttFalse;
+				RyanMqttBool_e nextLevelExistsinTopicFilter = RyanMqttFalse;
+
+				while (topicIndex < topicLength)
+				{
+					if (topic[topicIndex] == '/')
+					{
+						nextLevelExistsInTopicName = RyanMqttTrue;
+						break;
+					}
+
+					(topicIndex)++;
+				}
+
+				if ((topicFilterIndex < (topicFilterLength - 1U)) &&
+				    (topicFilter[topicFilterIndex + 1U] == '/'))
+				{
+					nextLevelExistsinTopicFilter = RyanMqttTrue;
+				}
+
+				if ((nextLevelExistsInTopicName == RyanMqttTrue) &&
+				    (nextLevelExistsinTopicFilter == RyanMqttFalse))
+				{
+					matchFound = RyanMqttFalse;
+					shouldStopMatching = RyanMqttTrue;
+				}
+				else if (nextLevelExistsInTopicName == RyanMqttTrue)
+				{
+					(topicFilterIndex)++;
+				}
+				else
+				{
+					(topicIndex)--;
+				}
+			}
+			else if ((topicFilter[topicFilterIndex] == '#') &&
+				 (topicFilterIndex == (topicFilterLength - 1U)) &&
+				 (locationIsValidForWildcard == RyanMqttTrue))
+			{
+				matchFound = RyanMqttTrue;
+				shouldStopMatching = RyanMqttTrue;
+			}
+			else
+			{
+				matchFound = RyanMqttFalse;
+				shouldStopMatching = RyanMqttTrue;
+			}
+		}
+
+		if ((matchFound == RyanMqttTrue) || (shouldStopMatching == RyanMqttTrue))
+		{
+			break;
+		}
+
+		topicIndex++;
+		topicFilterIndex++;
+	}
+
+	if (matchFound == RyanMqttFalse)
+	{
+		matchFound = (RyanMqttBool_e)((topicIndex == topicLength) && (topicFilterIndex == topicFilterLength));
+	}
+
+	return matchFound;
+}
+
+static uint32_t topicMatchRandomState = 0x12345678U;
+static uint32_t topicMatchRandom(void)
+{
+	// xorshift32，固定种子保证每次测试用例一致
+	topicMatchRandomState ^= topicMatchRandomState << 13;
+	topicMatchRandomState ^= topicMatchRandomState >> 17;
+	topicMatchRandomState ^= topicMatchRandomState << 5;
+	return topicMatchRandomState;
+}
+
+/**
+ * @brief 将序号转换为指定字符集上的字符串，用于穷举
+ *
+ */
+static void topicMatchIndexToString(uint32_t index, uint16_t len, const char *alphabet, uint32_t alphabetLen,
+				    char *buf)
+{
+	for (uint16_t i = 0; i < len; i++)
+	{
+		buf[i] = alphabet[index % alphabetLen];
+		index /= alphabetLen;
+	}
+}
+
+/**
+ * @brief 预编译主题过滤器，不符合规范或层级过多时返回0
+ *
+ */
+static uint16_t topicMatchCompileFilter(const char *topicFilter, uint16_t topicFilterLen, RyanMqttTopicLevel_t *levels)
+{
+	uint32_t levelCount = RyanMqttTopicLevelCount(topicFilter, topicFilterLen);
+	if (levelCount > TopicMatchMaxFilterLevel ||
+	    RyanMqttTrue != RyanMqttTopicFilterCompile(topicFilter, topicFilterLen, levels, (uint16_t)levelCount))
+	{
+		return 0;
+	}
+
+	return (uint16_t)levelCount;
+}
+
+static RyanMqttError_e topicMatchCheck(const char *topic, uint16_t topicLen, const char *topicFilter,
+				       uint16_t topicFilterLen)
+{
+	RyanMqttTopicLevel_t filterLevels[TopicMatchMaxFilterLevel];
+	RyanMqttTopicSplit_t topicSplit;
+
+	RyanMqttBool_e expect = RyanMqttMatchTopicReference(topic, topicLen, topicFilter, topicFilterLen);
+	RyanMqttBool_e actual = RyanMqttMatchTopic(topic, topicLen, topicFilter, topicFilterLen);
+	if (expect != actual)
+	{
+		RyanMqttLog_e("主题匹配结果不一致, topic: %.*s, filter: %.*s, expect: %d, actual: %d", topicLen, topic,
+			      topicFilterLen, topicFilter, expect, actual);
+		return RyanMqttFailedError;
+	}
+
+	// 预编译过滤器按层级匹配
+	uint16_t filterLevelCount = topicMatchCompileFilter(topicFilter, topicFilterLen, filterLevels);
+	RyanMqttTopicSplit(&topicSplit, topic, topicLen);
+	actual = RyanMqttMatchTopicLevels(&topicSplit, topicFilter, topicFilterLen, filterLevels, filterLevelCount);
+	if (expect != actual)
+	{
+		RyanMqttLog_e("按层级匹配结果不一致, topic: %.*s, filter: %.*s, expect: %d, actual: %d", topicLen,
+			      topic, topicFilterLen, topicFilter, expect, actual);
+		return RyanMqttFailedError;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 短字符串穷举，覆盖$开头主题、空层级、以"/"结尾的主题和 "/#" "/+" 结尾的过滤器等边界情况
+ *
+ */
+static RyanMqttError_e RyanMqttTopicMatchExhaustiveTest(void)
+{
+	// 主题名称中本不应该出现通配符，这里也覆盖进来，保证结果与逐字节实现完全一致
+	static const char topicAlphabet[] = "a/$+#";
+	static const char filterAlphabet[] = "ab/+#$";
+	const uint32_t topicAlphabetLen = sizeof(topicAlphabet) - 1;
+	const uint32_t filterAlphabetLen = sizeof(filterAlphabet) - 1;
+	char topic[8], topicFilter[8];
+	uint32_t matchCount = 0, totalCount = 0;
+
+	for (uint16_t topicLen = 1; topicLen <= 5; topicLen++)
+	{
+		uint32_t topicTotal = 1;
+		for (uint16_t i = 0; i < topicLen; i++)
+		{
+			topicTotal *= topicAlphabetLen;
+		}
+
+		for (uint32_t topicNum = 0; topicNum < topicTotal; topicNum++)
+		{
+			topicMatchIndexToString(topicNum, topicLen, topicAlphabet, topicAlphabetLen, topic);
+
+			for (uint16_t topicFilterLen = 1; topicFilterLen <= 5; topicFilterLen++)
+			{
+				uint32_t filterTotal = 1;
+				for (uint16_t i = 0; i < topicFilterLen; i++)
+				{
+					filterTotal *= filterAlphabetLen;
+				}
+
+				for (uint32_t filterNum = 0; filterNum < filterTotal; filterNum++)
+				{
+					topicMatchIndexToString(filterNum, topicFilterLen, filterAlphabet,
+								filterAlphabetLen, topicFilter);
+					if (RyanMqttSuccessError !=
+					    topicMatchCheck(topic, topicLen, topicFilter, topicFilterLen))
+					{
+						return RyanMqttFailedError;
+					}
+
+					if (RyanMqttTrue == RyanMqttMatchTopic(topic, topicLen, topicFilter, topicFilterLen))
+					{
+						matchCount++;
+					}
+					totalCount++;
+				}
+			}
+		}
+	}
+
+	RyanMqttLog_i("穷举测试完成, total: %u, match: %u", totalCount, matchCount);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 生成 6-8 个层级的长主题，部分层级超过32字节以覆盖SIMD分块路径
+ *
+ */
+static uint16_t topicMatchRandomTopic(char *buf, uint16_t bufSize)
+{
+	static const char charset[] = "abcdefghijklmnopqrstuvwxyz0123456789_-";
+	uint16_t len = 0;
+	uint32_t levelCount = 6 + topicMatchRandom() % 3;
+
+	if (0 == topicMatchRandom() % 16)
+	{
+		buf[len++] = '$';
+	}
+
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		uint32_t levelLen = (0 == topicMatchRandom() % 4) ? (16 + topicMatchRandom() % 40) : (topicMatchRandom() % 16);
+		if (0 != level)
+		{
+			buf[len++] = '/';
+		}
+
+		for (uint32_t i = 0; i < levelLen && len < bufSize - 2; i++)
+		{
+			buf[len++] = charset[topicMatchRandom() % (sizeof(charset) - 1)];
+		}
+	}
+
+	if (0 == len)
+	{
+		buf[len++] = 'a';
+	}
+
+	return len;
+}
+
+/**
+ * @brief 由主题派生过滤器：替换层级为"+"、截断为"#"、修改字节，使匹配与不匹配的情况都能覆盖到
+ *
+ */
+static uint16_t topicMatchRandomFilter(const char *topic, uint16_t topicLen, char *buf, uint16_t bufSize)
+{
+	uint16_t len = 0, topicIndex = 0;
+	uint32_t plusRate = topicMatchRandom() % 4;
+
+	while (topicIndex <= topicLen && len < bufSize - 3)
+	{
+		uint16_t levelLen = RyanMqttTopicFindSeparator(&topic[topicIndex], (uint16_t)(topicLen - topicIndex));
+
+		if (0 == topicMatchRandom() % 12)
+		{
+			buf[len++] = '#';
+			return len;
+		}
+
+		if (0 != plusRate && 0 == topicMatchRandom() % (plusRate + 1))
+		{
+			buf[len++] = '+';
+		}
+		else
+		{
+			RyanMqttMemcpy(&buf[len], &topic[topicIndex], levelLen);
+			len += levelLen;
+		}
+
+		topicIndex = (uint16_t)(topicIndex + levelLen + 1U);
+		if (topicIndex > topicLen)
+		{
+			break;
+		}
+		buf[len++] = '/';
+	}
+
+	switch (topicMatchRandom() % 8)
+	{
+	case 0: // 修改一个字节
+		buf[topicMatchRandom() % len] ^= 0x01;
+		break;
+
+	case 1: // 以 "/#" 结尾
+		buf[len++] = '/';
+		buf[len++] = '#';
+		break;
+
+	case 2: // 删除最后一个字节
+		if (len > 1)
+		{
+			len--;
+		}
+		break;
+
+	default: break;
+	}
+
+	return len;
+}
+
+static RyanMqttError_e RyanMqttTopicMatchRandomTest(void)
+{
+	char topic[512], topicFilter[512];
+	uint32_t matchCount = 0;
+
+	for (uint32_t count = 0; count < TopicMatchRandomCount; count++)
+	{
+		uint16_t topicLen = topicMatchRandomTopic(topic, sizeof(topic));
+		uint16_t topicFilterLen = topicMatchRandomFilter(topic, topicLen, topicFilter, sizeof(topicFilter));
+
+		if (RyanMqttSuccessError != topicMatchCheck(topic, topicLen, topicFilter, topicFilterLen))
+		{
+			return RyanMqttFailedError;
+		}
+
+		if (RyanMqttTrue == RyanMqttMatchTopic(topic, topicLen, topicFilter, topicFilterLen))
+		{
+			matchCount++;
+		}
+	}
+
+	// 匹配与不匹配都需要有足够的覆盖
+	if (matchCount < TopicMatchRandomCount / 10 || matchCount > TopicMatchRandomCount / 10 * 9)
+	{
+		RyanMqttLog_e("随机测试匹配比例异常, match: %u", matchCount);
+		return RyanMqttFailedError;
+	}
+
+	RyanMqttLog_i("随机测试完成, total: %u, match: %u", TopicMatchRandomCount, matchCount);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 校验分隔符查找和比较函数在各种长度和非对齐地址下的结果
+ *
+ */
+static RyanMqttError_e RyanMqttTopicMatchPrimitiveTest(void)
+{
+	char buf1[160], buf2[160];
+
+	for (uint32_t count = 0; count < 20000; count++)
+	{
+		uint16_t offset = (uint16_t)(topicMatchRandom() % 8);
+		uint16_t len = (uint16_t)(topicMatchRandom() % (sizeof(buf1) - 8));
+
+		for (uint16_t i = 0; i < len; i++)
+		{
+			buf1[offset + i] = (char)('a' + topicMatchRandom() % 26);
+		}
+		if (len > 0 && 0 != topicMatchRandom() % 4)
+		{
+			buf1[offset + topicMatchRandom() % len] = '/';
+		}
+		RyanMqttMemcpy(&buf2[offset], &buf1[offset], len);
+
+		uint16_t expectIndex = 0;
+		while (expectIndex < len && '/' != buf1[offset + expectIndex])
+		{
+			expectIndex++;
+		}
+
+		if (expectIndex != RyanMqttTopicFindSeparator(&buf1[offset], len))
+		{
+			RyanMqttLog_e("分隔符查找错误, len: %d, expect: %d", len, expectIndex);
+			return RyanMqttFailedError;
+		}
+
+		if (RyanMqttTrue != RyanMqttTopicEqual(&buf1[offset], &buf2[offset], len))
+		{
+			RyanMqttLog_e("比较结果错误, len: %d", len);
+			return RyanMqttFailedError;
+		}
+
+		if (len > 0)
+		{
+			buf2[offset + topicMatchRandom() % len] ^= 0x20;
+			if (RyanMqttFalse != RyanMqttTopicEqual(&buf1[offset], &buf2[offset], len))
+			{
+				RyanMqttLog_e("比较结果错误, len: %d", len);
+				return RyanMqttFailedError;
+			}
+		}
+	}
+
+	// 和strncmp不同，'\0'之后的内容也需要比较
+	if (RyanMqttFalse != RyanMqttTopicEqual("a\0b", "a\0c", 3))
+	{
+		return RyanMqttFailedError;
+	}
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 性能对比，使用 60-120 字节、6-8 层级的主题和多个通配符订阅
+ *
+ */
+static RyanMqttError_e RyanMqttTopicMatchBenchmark(void)
+{
+	static const char *topics[] = {
+		"factory/shanghai/line-03/station-0042/sensor/temperature-probe-a/reading",
+		"factory/shanghai/line-03/station-0042/sensor/humidity-probe-b/reading/raw",
+		"fleet/vehicle-7f3a9c21/telemetry/powertrain/battery-pack-02/cell-voltage",
+		"$SYS/brokers/emqx@127.0.0.1/stats/connections/count/current/value/latest",
+		"building/tower-b/floor-23/room-2317/hvac/zone-controller-04/setpoint/target",
+	};
+	// 模拟同时存在多个通配符订阅的场景，大部分订阅与报文主题不匹配
+	static const char *filters[] = {
+		"factory/shanghai/+/+/sensor/+/reading",
+		"factory/shanghai/line-03/#",
+		"factory/beijing/+/+/sensor/+/reading",
+		"factory/shanghai/+/+/actuator/+/state",
+		"fleet/+/telemetry/powertrain/+/cell-voltage",
+		"fleet/+/telemetry/chassis/+/tire-pressure",
+		"fleet/vehicle-7f3a9c22/#",
+		"building/tower-b/floor-23/room-2317/hvac/zone-controller-04/setpoint/target",
+		"building/tower-a/+/+/hvac/+/setpoint/target",
+		"building/+/floor-23/+/lighting/#",
+		"$SYS/brokers/+/stats/connections/count/current/value/latest",
+		"#",
+	};
+	RyanMqttTopicLevel_t filterLevels[getArraySize(filters)][TopicMatchMaxFilterLevel];
+	uint16_t filterLevelCount[getArraySize(filters)];
+	RyanMqttTopicSplit_t topicSplit;
+	uint32_t matchCount[3] = {0, 0, 0};
+	uint32_t elapsedMs[3];
+
+	// 订阅时预编译，不计入耗时
+	for (uint32_t j = 0; j < getArraySize(filters); j++)
+	{
+		filterLevelCount[j] = topicMatchCompileFilter(filters[j], (uint16_t)strlen(filters[j]), filterLevels[j]);
+	}
+
+	for (uint32_t impl = 0; impl < 3; impl++)
+	{
+		uint32_t startMs = platformUptimeMs();
+		for (uint32_t round = 0; round < TopicMatchBenchmarkRounds; round++)
+		{
+			for (uint32_t i = 0; i < getArraySize(topics); i++)
+			{
+				uint16_t topicLen = (uint16_t)strlen(topics[i]);
+
+				// 每个报文只拆分一次
+				if (2 == impl)
+				{
+					RyanMqttTopicSplit(&topicSplit, topics[i], topicLen);
+				}
+
+				for (uint32_t j = 0; j < getArraySize(filters); j++)
+				{
+					uint16_t topicFilterLen = (uint16_t)strlen(filters[j]);
+					RyanMqttBool_e isMatch;
+
+					if (0 == impl)
+					{
+						isMatch = RyanMqttMatchTopicReference(topics[i], topicLen, filters[j],
+										      topicFilterLen);
+					}
+					else if (1 == impl)
+					{
+						isMatch = RyanMqttMatchTopic(topics[i], topicLen, filters[j], topicFilterLen);
+					}
+					else
+					{
+						isMatch = RyanMqttMatchTopicLevels(&topicSplit, filters[j], topicFilterLen,
+										   filterLevels[j], filterLevelCount[j]);
+					}
+
+					if (RyanMqttTrue == isMatch)
+					{
+						matchCount[impl]++;
+					}
+				}
+			}
+		}
+		elapsedMs[impl] = platformUptimeMs() - startMs;
+	}
+
+	if (matchCount[0] != matchCount[1] || matchCount[0] != matchCount[2])
+	{
+		return RyanMqttFailedError;
+	}
+
+	uint32_t totalMatch = TopicMatchBenchmarkRounds * getArraySize(topics) * getArraySize(filters);
+	RyanMqttLog_raw("主题匹配性能(%s): 逐字节 %u ms, 按块 %u ms, 预编译按层级 %u ms, 共 %u 次\r\n",
+			RyanMqttTopicMatchImplName(), elapsedMs[0], elapsedMs[1], elapsedMs[2], totalMatch);
+	return RyanMqttSuccessError;
+}
+
+RyanMqttError_e RyanMqttTopicMatchTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+
+	result = RyanMqttTopicMatchPrimitiveTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttTopicMatchExhaustiveTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttTopicMatchRandomTest();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttTopicMatchBenchmark();
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
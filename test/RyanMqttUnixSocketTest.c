@@ -0,0 +1,255 @@
+#include "RyanMqttTest.h"
+
+#define RyanMqttUnixTestTopic    "testUnix/echo"
+#define RyanMqttUnixTestMaxDelay (10 * 1000)
+
+// 性能测试的往返次数和qos1消息数
+#define RyanMqttUnixBenchPingCount    (1000)
+#define RyanMqttUnixBenchPublishCount (5000)
+
+static sem_t unixTestEchoSem;
+
+static uint64_t RyanMqttUnixTestNowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+static void RyanMqttUnixTestMsgHandle(void *pclient, RyanMqttMsgData_t *msgData, void *userData)
+{
+	sem_post(&unixTestEchoSem);
+}
+
+static int RyanMqttUnixTestCompare(const void *a, const void *b)
+{
+	uint32_t left = *(const uint32_t *)a;
+	uint32_t right = *(const uint32_t *)b;
+	return (left > right) - (left < right);
+}
+
+/**
+ * @brief 连接指定地址的broker并订阅回环主题
+ *
+ * @param client
+ * @param host tcp地址或者 "unix:路径"
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttUnixTestInit(RyanMqttClient_t **client, char *host)
+{
+	struct RyanMqttTestEventUserData *eventUserData =
+		(struct RyanMqttTestEventUserData *)malloc(sizeof(struct RyanMqttTestEventUserData));
+	if (NULL == eventUserData)
+	{
+		RyanMqttLog_e("内存不足");
+		return RyanMqttNotEnoughMemError;
+	}
+
+	RyanMqttMemset(eventUserData, 0, sizeof(struct RyanMqttTestEventUserData));
+	eventUserData->magic = RyanMqttTestEventUserDataMagic;
+	eventUserData->syncFlag = RyanMqttTrue;
+	sem_init(&eventUserData->sem, 0, 0);
+
+	// tcp关闭Nagle算法，只比较传输层本身的开销
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClientConfig_t mqttConfig = {.clientId = "RyanMqttUnixTest",
+					     .userName = RyanMqttUserName,
+					     .password = RyanMqttPassword,
+					     .host = host,
+					     .port = RyanMqttPort,
+					     .taskName = "mqttThread",
+					     .taskPrio = 16,
+					     .taskStack = 4096,
+					     .mqttVersion = 4,
+					     .ackHandlerRepeatCountWarning = 600,
+					     .ackHandlerCountWarning = 60000,
+					     .autoReconnectFlag = RyanMqttTrue,
+					     .cleanSessionFlag = RyanMqttTrue,
+					     .reconnectTimeout = RyanMqttReconnectTimeout,
+					     .recvTimeout = RyanMqttRecvTimeout,
+					     .sendTimeout = RyanMqttSendTimeout,
+					     .ackTimeout = RyanMqttAckTimeout,
+					     .keepaliveTimeoutS = 120,
+					     .mqttEventHandle = mqttEventBaseHandle,
+					     .userData = eventUserData,
+					     .socketOption = {.noDelayFlag = RyanMqttTrue}};
+
+	result = RyanMqttInit(client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttRegisterEventId(*client, RyanMqttEventAnyId);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttSetConfig(*client, &mqttConfig);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	result = RyanMqttStart(*client);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	for (uint32_t elapsed = 0; elapsed < RyanMqttUnixTestMaxDelay; elapsed += 10)
+	{
+		if (RyanMqttConnectState == RyanMqttGetState(*client))
+		{
+			break;
+		}
+		delay(10);
+	}
+	RyanMqttCheck(RyanMqttConnectState == RyanMqttGetState(*client), RyanMqttFailedError, RyanMqttLog_e);
+
+	uint16_t topicLen = RyanMqttStrlen(RyanMqttUnixTestTopic);
+	result = RyanMqttSubscribeWithMsgHandle(*client, RyanMqttUnixTestTopic, topicLen, RyanMqttQos0,
+						RyanMqttUnixTestMsgHandle, NULL);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	int32_t subscribeTotalCount = 0;
+	for (uint32_t elapsed = 0; elapsed < RyanMqttUnixTestMaxDelay && 1 != subscribeTotalCount; elapsed += 10)
+	{
+		delay(10);
+		RyanMqttGetSubscribeTotalCount(*client, &subscribeTotalCount);
+	}
+	RyanMqttCheck(1 == subscribeTotalCount, RyanMqttFailedError, RyanMqttLog_e);
+
+	// 等待broker处理完订阅
+	delay(100);
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 发布一条回环消息并等待收到
+ *
+ * @param client
+ * @param qos
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttUnixTestEcho(RyanMqttClient_t *client, RyanMqttQos_e qos)
+{
+	RyanMqttError_e result = RyanMqttPublish(client, RyanMqttUnixTestTopic, "echo", 4, qos, RyanMqttFalse);
+	RyanMqttCheck(RyanMqttSuccessError == result, result, RyanMqttLog_e);
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 2;
+	RyanMqttCheck(0 == sem_timedwait(&unixTestEchoSem, &deadline), RyanMqttRecvPacketTimeOutError, RyanMqttLog_e);
+
+	return RyanMqttSuccessError;
+}
+
+/**
+ * @brief 统计往返延迟和qos1发布吞吐
+ *
+ * @param host
+ * @param p50Us
+ * @param p99Us
+ * @param publishMs 全部qos1消息收到ack的耗时
+ * @return RyanMqttError_e
+ */
+static RyanMqttError_e RyanMqttUnixBench(char *host, uint32_t *p50Us, uint32_t *p99Us, uint32_t *publishMs)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	RyanMqttClient_t *client = NULL;
+	uint32_t *latencyUs = (uint32_t *)malloc(sizeof(uint32_t) * RyanMqttUnixBenchPingCount);
+	RyanMqttCheck(NULL != latencyUs, RyanMqttNotEnoughMemError, RyanMqttLog_e);
+
+	sem_init(&unixTestEchoSem, 0, 0);
+
+	result = RyanMqttUnixTestInit(&client, host);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+
+	// 确认实际使用的地址族和host一致
+	struct sockaddr_storage localAddr;
+	socklen_t localAddrLen = sizeof(localAddr);
+	RyanMqttBool_e unixFlag =
+		0 == RyanMqttStrncmp(host, platformNetworkUnixPrefix, sizeof(platformNetworkUnixPrefix) - 1);
+	getsockname(client->network.socket, (struct sockaddr *)&localAddr, &localAddrLen);
+	RyanMqttCheckCodeNoReturn(unixFlag == (AF_UNIX == localAddr.ss_family), RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+	// 所有qos的消息都可以正常收发
+	for (uint8_t qos = RyanMqttQos0; qos <= RyanMqttQos2; qos++)
+	{
+		result = RyanMqttUnixTestEcho(client, (RyanMqttQos_e)qos);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+
+	for (uint32_t i = 0; i < RyanMqttUnixBenchPingCount; i++)
+	{
+		uint64_t startUs = RyanMqttUnixTestNowUs();
+		result = RyanMqttUnixTestEcho(client, RyanMqttQos0);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+		latencyUs[i] = (uint32_t)(RyanMqttUnixTestNowUs() - startUs);
+	}
+
+	qsort(latencyUs, RyanMqttUnixBenchPingCount, sizeof(uint32_t), RyanMqttUnixTestCompare);
+	*p50Us = latencyUs[RyanMqttUnixBenchPingCount / 2];
+	*p99Us = latencyUs[RyanMqttUnixBenchPingCount * 99 / 100];
+
+	// 发布到没有订阅的主题，只统计发送和接收ack
+	uint32_t startMs = platformUptimeMs();
+	for (uint32_t i = 0; i < RyanMqttUnixBenchPublishCount; i++)
+	{
+		result = RyanMqttPublish(client, "testUnix/bench", "0123456789", 10, RyanMqttQos1, RyanMqttFalse);
+		RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, result, RyanMqttLog_e, { goto __exit; });
+	}
+
+	while (0 != client->ackHandlerCount && platformUptimeMs() - startMs < RyanMqttUnixTestMaxDelay)
+	{
+		delay(1);
+	}
+	*publishMs = platformUptimeMs() - startMs;
+	RyanMqttCheckCodeNoReturn(0 == client->ackHandlerCount, RyanMqttFailedError, RyanMqttLog_e, {
+		result = RyanMqttFailedError;
+		goto __exit;
+	});
+
+__exit:
+	if (NULL != client)
+	{
+		RyanMqttTestDestroyClient(client);
+	}
+	sem_destroy(&unixTestEchoSem);
+	free(latencyUs);
+	return result;
+}
+
+RyanMqttError_e RyanMqttUnixSocketTest(void)
+{
+	RyanMqttError_e result = RyanMqttSuccessError;
+	uint32_t tcpP50Us = 0, tcpP99Us = 0, tcpPublishMs = 0;
+	uint32_t unixP50Us = 0, unixP99Us = 0, unixPublishMs = 0;
+
+	if (0 != access(RyanMqttUnixPath, F_OK))
+	{
+		RyanMqttLog_w("broker没有监听 %s，跳过unix domain socket测试", RyanMqttUnixPath);
+		return RyanMqttSuccessError;
+	}
+
+	// 路径过长时连接直接失败
+	char longHost[160];
+	RyanMqttMemset(longHost, 'a', sizeof(longHost) - 1);
+	RyanMqttMemcpy(longHost, platformNetworkUnixPrefix, sizeof(platformNetworkUnixPrefix) - 1);
+	longHost[sizeof(longHost) - 1] = '\0';
+	platformNetwork_t network;
+	platformNetworkInit(NULL, &network);
+	result = platformNetworkConnect(NULL, &network, longHost, 0);
+	platformNetworkDestroy(NULL, &network);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError != result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttUnixBench(RyanMqttHost, &tcpP50Us, &tcpP99Us, &tcpPublishMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	result = RyanMqttUnixBench(platformNetworkUnixPrefix RyanMqttUnixPath, &unixP50Us, &unixP99Us, &unixPublishMs);
+	RyanMqttCheckCodeNoReturn(RyanMqttSuccessError == result, RyanMqttFailedError, RyanMqttLog_e, { goto __exit; });
+
+	RyanMqttLog_raw("回环传输性能: tcp p50 %u us / p99 %u us / %d条qos1 %u ms, "
+			"unix p50 %u us / p99 %u us / %d条qos1 %u ms\r\n",
+			tcpP50Us, tcpP99Us, RyanMqttUnixBenchPublishCount, tcpPublishMs, unixP50Us, unixP99Us,
+			RyanMqttUnixBenchPublishCount, unixPublishMs);
+
+	checkMemory;
+	return RyanMqttSuccessError;
+
+__exit:
+	return RyanMqttFailedError;
+}
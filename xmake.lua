@@ -1,4 +1,5 @@
 add_rules("plugin.compile_commands.autoupdate", {outputdir = ".vscode"})
+add_requires("openssl", {system = true, optional = true})
 target("RyanMqtt",function()
     set_kind("binary")
 
@@ -10,6 +11,14 @@ target("RyanMqtt",function()
     add_defines("PKG_USING_RYANMQTT_IS_ENABLE_ASSERT") -- 开启assert
     add_defines("RyanMqttLinuxTestEnable") -- linux测试
 
+    -- 找到openssl时编译linux平台的tls传输层
+    add_packages("openssl")
+    on_load(function (target)
+        if target:pkg("openssl") then
+            target:add("defines", "RyanMqttLinuxTlsEnable")
+        end
+    end)
+
     -- set_optimize("smallest") -- -Os
     -- set_optimize("faster") -- -O2
     -- set_optimize("fastest") -- -O3